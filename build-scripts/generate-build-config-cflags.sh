@@ -35,6 +35,7 @@ CFGFILE_OPTIONS_LIST=(\
 	"USE_LEAK_SANITIZER" \
 	"WITH_FASTA_FORMAT_SUPPORT" \
 	"USE_SCHEDULED_DELETION" \
+	"ZSTD_SUPPORT" \
 )
 
 DASHD_DEFINES_CFLAG_SPECS=(\
@@ -47,6 +48,7 @@ DASHD_DEFINES_CFLAG_SPECS=(\
 	"WITHGPERFTOOLS" \
 	"WITH_FASTA_FORMAT_SUPPORT" \
 	"USE_SCHEDULED_DELETION" \
+	"BUILD_WITH_ZSTD_SUPPORT" \
 )
 
 EXTRA_CFLAGS_LIST=""
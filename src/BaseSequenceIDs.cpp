@@ -3,18 +3,22 @@
  * Created: 2019.10.30
  */
 
-#include <openssl/sha.h>
+#include <openssl/evp.h>
 
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <vector>
+#include <unordered_map>
 
 #include "BaseSequenceIDs.h"
 #include "TerminalPrinting.h"
 #include "ConfigParser.h"
 #include "RNAStructure.h"
+#include "SequenceFingerprint.h"
+#include "CompressedInput.h"
 
-/* Hash Scheme: [FIRST 8 BYTES OF BSEQ + LAST 8 BYTES OF BSEQ + 256/8=32 BYTES OF SHA256 HASH] */
+/* Legacy Hash Scheme: [FIRST 8 BYTES OF BSEQ + LAST 8 BYTES OF BSEQ + 256/8=32 BYTES OF SHA256 HASH] */
 std::string HashBaseSequence(const char *baseSeq) {
      
      if(baseSeq == NULL) {
@@ -22,29 +26,153 @@ std::string HashBaseSequence(const char *baseSeq) {
      }
 
      int baseSeqLen = strlen(baseSeq);
-     unsigned char hashBuf[SHA256_DIGEST_LENGTH];
-     SHA256_CTX sha256HasherObj;
-     SHA256_Init(&sha256HasherObj);
-     SHA256_Update(&sha256HasherObj, baseSeq, MIN(baseSeqLen, MAX_BYTES_TO_HASH));
-     SHA256_Final(hashBuf, &sha256HasherObj);
-
-     std::stringstream ss;
-     for(int hidx = 0; hidx < SHA256_DIGEST_LENGTH; hidx++) {
-          ss << std::hex << std::setw(2) << std::setfill('0') << (int) hashBuf[hidx];
+     unsigned char hashBuf[EVP_MAX_MD_SIZE];
+     unsigned int hashLength = 0;
+     if(!EVP_Digest(baseSeq, MIN(baseSeqLen, MAX_BYTES_TO_HASH), hashBuf, &hashLength, 
+                    EVP_sha256(), NULL)) {
+          return "";
      }
-     std::string hashBytes = ss.str();
-     std::string baseSeqStr = string(baseSeq);
-     hashBytes = baseSeqStr.substr(0, 8) + hashBytes + baseSeqStr.substr(baseSeqLen - 8, 8);
+
+     static const char hexDigits[] = "0123456789abcdef";
+     char hashHexBuf[2 * EVP_MAX_MD_SIZE];
+     for(unsigned int hidx = 0; hidx < hashLength; hidx++) {
+          hashHexBuf[2 * hidx] = hexDigits[hashBuf[hidx] >> 4];
+          hashHexBuf[2 * hidx + 1] = hexDigits[hashBuf[hidx] & 0x0f];
+     }
+     std::string hashBytes;
+     hashBytes.reserve(2 * hashLength + 16);
+     hashBytes.append(baseSeq, MIN(baseSeqLen, 8));
+     hashBytes.append(hashHexBuf, 2 * hashLength);
+     hashBytes.append(baseSeq + MAX(0, baseSeqLen - 8), MIN(baseSeqLen, 8));
 
      return hashBytes;
 
 }
 
+/* Key Scheme: [STICKY_KEY_PREFIX + 32 HEX DIGITS OF THE (HIGH, LOW) FULL SEQUENCE FINGERPRINT] */
+std::string StickyFolderNameKey(const SequenceFingerprint_t &seqFP) {
+     char keyBuf[MAX_BUFFER_SIZE];
+     snprintf(keyBuf, MAX_BUFFER_SIZE, "%s%016llx%016llx", STICKY_KEY_PREFIX, 
+              (unsigned long long) seqFP.high, (unsigned long long) seqFP.low);
+     return std::string(keyBuf);
+}
+
+static inline bool IsLegacyStickyKey(const std::string &entryKey) {
+     return entryKey.compare(0, strlen(STICKY_KEY_PREFIX), STICKY_KEY_PREFIX) != 0;
+}
+
+/* The legacy keys are indexed by their first BSHASH_BYTES characters: */
+static inline std::string GetStickyIndexKey(const std::string &entryKey) {
+     return IsLegacyStickyKey(entryKey) ? entryKey.substr(0, BSHASH_BYTES) : entryKey;
+}
+
+/* The sticky folder names are read from the config file once into this 
+ * index. The file is treated as an append-only log where a later line for 
+ * the same sequence hash replaces an earlier one, and it is rewritten with 
+ * one line per sequence by CompactStickyFolderNameConfigFile at shutdown. 
+ * The entries with legacy keys are re-keyed when their sequence is first 
+ * looked up (and are then written with the new key by the compaction): 
+ */
+typedef struct {
+     std::string indexedCfgFilePath;
+     bool indexLoaded;
+     std::unordered_map<std::string, size_t> entryByHash;
+     std::vector<std::string> entryHashes, entryFolderNames;
+     size_t logLineCount;
+     size_t legacyEntryCount;
+     bool entriesRekeyed;
+} StickyFolderNameIndex_t;
+
+static StickyFolderNameIndex_t stickyFolderNameIndex = { "", false, {}, {}, {}, 0, 0, false };
+
+static StickyFolderNameIndex_t & GetStickyFolderNameIndex(const char *cfgFilePath) {
+     
+     std::string fullCfgFilePath = GetStickyFolderConfigPath(cfgFilePath);
+     StickyFolderNameIndex_t &sfIndex = stickyFolderNameIndex;
+     if(sfIndex.indexLoaded && sfIndex.indexedCfgFilePath == fullCfgFilePath) {
+          return sfIndex;
+     }
+     ResetStickyFolderNameIndex();
+     sfIndex.indexedCfgFilePath = fullCfgFilePath;
+     sfIndex.indexLoaded = true;
+     FILE *fpCfgFile = fopen(fullCfgFilePath.c_str(), "r");
+     if(!fpCfgFile) {
+          TerminalText::PrintDebug("Unable to open \"%s\" : %s II\n", fullCfgFilePath.c_str(), strerror(errno));
+          return sfIndex;
+     }
+     char lineBuf[MAX_BUFFER_SIZE];
+     while(fgets(lineBuf, MAX_BUFFER_SIZE, fpCfgFile)) {
+          std::string stickyStrEntry = std::string(lineBuf);
+          size_t firstQuotePos = stickyStrEntry.find_first_of('\"');
+          size_t lastQuotePos = stickyStrEntry.find_last_of('\"');
+          if(stickyStrEntry.length() < BSHASH_BYTES || firstQuotePos == std::string::npos || 
+             lastQuotePos == firstQuotePos) {
+               continue;
+          }
+          sfIndex.logLineCount++;
+          std::string baseSeqHash = stickyStrEntry.substr(0, stickyStrEntry.find_first_of(';'));
+          std::string savedFolderName = stickyStrEntry.substr(firstQuotePos + 1, 
+                                                              lastQuotePos - firstQuotePos - 1);
+          std::string indexKey = GetStickyIndexKey(baseSeqHash);
+          auto entryIt = sfIndex.entryByHash.find(indexKey);
+          if(entryIt != sfIndex.entryByHash.end()) {
+               sfIndex.entryFolderNames[entryIt->second] = savedFolderName;
+               continue;
+          }
+          sfIndex.entryByHash[indexKey] = sfIndex.entryHashes.size();
+          sfIndex.entryHashes.push_back(baseSeqHash);
+          sfIndex.entryFolderNames.push_back(savedFolderName);
+          sfIndex.legacyEntryCount += IsLegacyStickyKey(baseSeqHash) ? 1 : 0;
+     }
+     fclose(fpCfgFile);
+     return sfIndex;
+
+}
+
+void ResetStickyFolderNameIndex() {
+     StickyFolderNameIndex_t &sfIndex = stickyFolderNameIndex;
+     sfIndex.indexedCfgFilePath = "";
+     sfIndex.indexLoaded = false;
+     sfIndex.entryByHash.clear();
+     sfIndex.entryHashes.clear();
+     sfIndex.entryFolderNames.clear();
+     sfIndex.logLineCount = 0;
+     sfIndex.legacyEntryCount = 0;
+     sfIndex.entriesRekeyed = false;
+}
+
+static size_t LookupStickyFolderNameEntry(const char *cfgFilePath, const SequenceFingerprint_t &seqFP, 
+		                          const char *baseSeq) {
+     StickyFolderNameIndex_t &sfIndex = GetStickyFolderNameIndex(cfgFilePath);
+     if(sfIndex.entryHashes.empty()) {
+          return STICKY_ENTRY_NOT_FOUND;
+     }
+     std::string seqKey = StickyFolderNameKey(seqFP);
+     auto entryIt = sfIndex.entryByHash.find(seqKey);
+     if(entryIt != sfIndex.entryByHash.end()) {
+          return entryIt->second;
+     }
+     else if(sfIndex.legacyEntryCount == 0 || baseSeq == NULL) {
+          return STICKY_ENTRY_NOT_FOUND;
+     }
+     entryIt = sfIndex.entryByHash.find(GetStickyIndexKey(HashBaseSequence(baseSeq)));
+     if(entryIt == sfIndex.entryByHash.end()) {
+          return STICKY_ENTRY_NOT_FOUND;
+     }
+     size_t entryIdx = entryIt->second;
+     sfIndex.entryByHash.erase(entryIt);
+     sfIndex.entryByHash[seqKey] = entryIdx;
+     sfIndex.entryHashes[entryIdx] = seqKey;
+     sfIndex.legacyEntryCount--;
+     sfIndex.entriesRekeyed = true;
+     return entryIdx;
+}
+
 char * LookupStickyFolderNameForSequence(const char *cfgFilePath, const char *baseSeqSpec) {
      if(cfgFilePath == NULL || baseSeqSpec == NULL) {
           return NULL;
      }
-     off_t fnamePos = FolderNameForSequenceExists(cfgFilePath, baseSeqSpec);
+     size_t fnamePos = FolderNameForSequenceExists(cfgFilePath, baseSeqSpec);
      return LookupStickyFolderNameForSequence(cfgFilePath, fnamePos);
 }
 
@@ -52,151 +180,113 @@ char * LookupStickyFolderNameForSequence(const char *cfgFilePath, RNAStructure *
      if(cfgFilePath == NULL || rnaStructSpec == NULL) {
           return NULL;
      }
-     std::string baseSeq = std::string(rnaStructSpec->GetSequenceString());
-     return LookupStickyFolderNameForSequence(cfgFilePath, baseSeq.c_str());
+     size_t fnamePos = FolderNameForSequenceExists(cfgFilePath, rnaStructSpec);
+     return LookupStickyFolderNameForSequence(cfgFilePath, fnamePos);
 }
 
-char * LookupStickyFolderNameForSequence(const char *cfgFilePath, off_t fnameFileOffset) {
+char * LookupStickyFolderNameForSequence(const char *cfgFilePath, size_t fnameEntryIndex) {
      
-     if(cfgFilePath == NULL || fnameFileOffset == LSEEK_NOT_FOUND) {
+     if(cfgFilePath == NULL || fnameEntryIndex == STICKY_ENTRY_NOT_FOUND) {
           return NULL;
      }
-     std::string fullCfgFilePath = GetStickyFolderConfigPath(cfgFilePath);
-     FILE *fpCfgFile = fopen(fullCfgFilePath.c_str(), "r");
-     if(!fpCfgFile) {
-      TerminalText::PrintError("Unable to open \"%s\" : %s I\n", fullCfgFilePath.c_str(), strerror(errno));
+     StickyFolderNameIndex_t &sfIndex = GetStickyFolderNameIndex(cfgFilePath);
+     if(fnameEntryIndex >= sfIndex.entryFolderNames.size()) {
           return NULL;
      }
-     char lineBuf[MAX_BUFFER_SIZE];
-     fseek(fpCfgFile, fnameFileOffset, SEEK_SET);
-     fgets(lineBuf, MAX_BUFFER_SIZE, fpCfgFile);
-     std::string stickyStrEntry = std::string(lineBuf);
-     fclose(fpCfgFile);
-
-     size_t firstQuotePos = stickyStrEntry.find_first_of('\"');
-     size_t lastQuotePos = stickyStrEntry.find_last_of('\"');
-     if(firstQuotePos == std::string::npos || lastQuotePos == std::string::npos) {
-          return NULL;
-     }
-     std::string savedFolderName = stickyStrEntry.substr(firstQuotePos + 1, lastQuotePos - firstQuotePos - 1);
-     char *rstr = (char *) malloc((savedFolderName.length() + 1) * sizeof(char));
-     strcpy(rstr, savedFolderName.c_str());
-     rstr[savedFolderName.length()] = '\0';
-     return rstr;
+     return strdup(sfIndex.entryFolderNames[fnameEntryIndex].c_str());
      
 }
 
-off_t FolderNameForSequenceExists(const char *cfgFilePath, const char *baseSeqSpec) {
+size_t FolderNameForSequenceExists(const char *cfgFilePath, const char *baseSeqSpec) {
      if(cfgFilePath == NULL || baseSeqSpec == NULL) {
-          return LSEEK_NOT_FOUND;
-     }
-     std::string fullCfgFilePath = GetStickyFolderConfigPath(cfgFilePath);
-     FILE *fpCfgFile = fopen(fullCfgFilePath.c_str(), "r");
-     if(!fpCfgFile) {
-          TerminalText::PrintDebug("Unable to open \"%s\" : %s II\n", fullCfgFilePath.c_str(), strerror(errno));
-          return LSEEK_NOT_FOUND;
+          return STICKY_ENTRY_NOT_FOUND;
      }
-     std::string baseSeqHash = HashBaseSequence(baseSeqSpec);
-     char lineBuf[MAX_BUFFER_SIZE];
-     off_t curFileOffset = 0;
-     bool foundMatch = false;
-     while(!feof(fpCfgFile) && fgets(lineBuf, MAX_BUFFER_SIZE, fpCfgFile)) {
-          if(!strncmp(baseSeqHash.c_str(), lineBuf, BSHASH_BYTES)) {
-           foundMatch = true;
-           break;
-      }
-      curFileOffset = ftell(fpCfgFile);
-     }
-     fclose(fpCfgFile);
-     if(foundMatch) {
-          return curFileOffset;
-     }
-     return LSEEK_NOT_FOUND;
+     SequenceFingerprint_t seqFP = SequenceFingerprint::ComputeFingerprint(baseSeqSpec, strlen(baseSeqSpec));
+     return LookupStickyFolderNameEntry(cfgFilePath, seqFP, baseSeqSpec);
 }
 
-off_t FolderNameForSequenceExists(const char *cfgFilePath, RNAStructure *rnaStructSpec) {
+size_t FolderNameForSequenceExists(const char *cfgFilePath, RNAStructure *rnaStructSpec) {
      if(cfgFilePath == NULL || rnaStructSpec == NULL) {
-          return LSEEK_NOT_FOUND;
+          return STICKY_ENTRY_NOT_FOUND;
      }
-     std::string baseSeq = std::string(rnaStructSpec->GetSequenceString());
-     return FolderNameForSequenceExists(cfgFilePath, baseSeq.c_str());
+     return LookupStickyFolderNameEntry(cfgFilePath, rnaStructSpec->GetSequenceFingerprint(), 
+                                        rnaStructSpec->GetSequenceString());
 }
 
-int SaveStickyFolderNameToFirstConfigFile(const char *cfgFilePath, std::string baseSeq, 
-                                          std::string folderName) {
-
-     if(FolderNameForSequenceExists(cfgFilePath, baseSeq.c_str()) != LSEEK_NOT_FOUND) {
-          return 0;
-     }
-     FILE *fpCfgFile = fopen(cfgFilePath, "w+");
+static int AppendStickyFolderNameLogLine(const std::string &fullCfgFilePath, const char *fopenMode, 
+		                         const std::string &baseSeqHash, const std::string &folderName) {
+     FILE *fpCfgFile = fopen(fullCfgFilePath.c_str(), fopenMode);
      if(!fpCfgFile) {
-          TerminalText::PrintError("Unable to open \"%s\": %s IV\n", cfgFilePath, strerror(errno));
-      return errno;
+          TerminalText::PrintError("Unable to open \"%s\": %s IV\n", fullCfgFilePath.c_str(), strerror(errno));
+          return errno;
      }
-     std::string baseSeqHash = HashBaseSequence(baseSeq.c_str());
      fprintf(fpCfgFile, "%s;\"%s\"\n", baseSeqHash.c_str(), folderName.c_str());
      fclose(fpCfgFile);
-     
      return EXIT_SUCCESS;
-
 }
-                     
+
 int SaveStickyFolderNameToConfigFile(const char *cfgFilePath, std::string baseSeq, 
-                                     std::string folderName, off_t replacePos) {
+                                     std::string folderName, size_t replaceEntryIndex) {
      
      if(cfgFilePath == NULL) {
           return EINVAL;
      }
-     else if(FolderNameForSequenceExists(cfgFilePath, baseSeq.c_str()) != LSEEK_NOT_FOUND) {
+     // Only the cheap fingerprint is computed (and compared) for the check:
+     else if(FolderNameForSequenceExists(cfgFilePath, baseSeq.c_str()) != STICKY_ENTRY_NOT_FOUND && 
+             replaceEntryIndex == STICKY_ENTRY_NOT_FOUND) {
           return EXIT_SUCCESS;
      }
-     std::string fullCfgFilePath = GetStickyFolderConfigPath(cfgFilePath);
-     if(!ConfigParser::fileExists(fullCfgFilePath.c_str())) {
-          return SaveStickyFolderNameToFirstConfigFile(fullCfgFilePath.c_str(), baseSeq, folderName);
+     StickyFolderNameIndex_t &sfIndex = GetStickyFolderNameIndex(cfgFilePath);
+     std::string baseSeqHash = StickyFolderNameKey(
+          SequenceFingerprint::ComputeFingerprint(baseSeq.c_str(), baseSeq.length()));
+     int saveStatus = AppendStickyFolderNameLogLine(sfIndex.indexedCfgFilePath, "a", 
+		                                    baseSeqHash, folderName);
+     if(saveStatus != EXIT_SUCCESS) {
+          return saveStatus;
+     }
+     sfIndex.logLineCount++;
+     std::string hashKey = GetStickyIndexKey(baseSeqHash);
+     auto entryIt = sfIndex.entryByHash.find(hashKey);
+     if(entryIt != sfIndex.entryByHash.end()) {
+          sfIndex.entryFolderNames[entryIt->second] = folderName;
+     }
+     else {
+          sfIndex.entryByHash[hashKey] = sfIndex.entryHashes.size();
+          sfIndex.entryHashes.push_back(baseSeqHash);
+          sfIndex.entryFolderNames.push_back(folderName);
      }
+     return EXIT_SUCCESS;
 
-     FILE *fpCfgFile = fopen(fullCfgFilePath.c_str(), "r");
-     if(!fpCfgFile) {
-          TerminalText::PrintError("Unable to open \"%s\" : %s III\n", fullCfgFilePath.c_str(), strerror(errno));
-          return errno;
+}
+
+int CompactStickyFolderNameConfigFile(const char *cfgFilePath) {
+
+     if(cfgFilePath == NULL) {
+          return EINVAL;
+     }
+     StickyFolderNameIndex_t &sfIndex = GetStickyFolderNameIndex(cfgFilePath);
+     if(sfIndex.logLineCount <= sfIndex.entryHashes.size() && !sfIndex.entriesRekeyed) {
+          return EXIT_SUCCESS;
      }
-     int fdCfgFile = fileno(fpCfgFile);
-     char tempFilePath[MAX_BUFFER_SIZE];
-     strcpy(tempFilePath, fullCfgFilePath.c_str());
-     strcat(tempFilePath, ".temp");
-     FILE *fpTempFile = fopen(tempFilePath, "w+");
+     std::string tempFilePath = sfIndex.indexedCfgFilePath + std::string(".temp");
+     FILE *fpTempFile = fopen(tempFilePath.c_str(), "w+");
      if(!fpTempFile) {
-          TerminalText::PrintError("Unable to open \"%s\": %s IV\n", tempFilePath, strerror(errno));
-          fclose(fpCfgFile);
+          TerminalText::PrintError("Unable to open \"%s\": %s IV\n", tempFilePath.c_str(), strerror(errno));
           return errno;
      }
-
-     std::string baseSeqHash = HashBaseSequence(baseSeq.c_str());
-
-     char lineBuf[MAX_BUFFER_SIZE];
-     off_t curCfgFileOffset = 0;
-     while(fgets(lineBuf, MAX_BUFFER_SIZE, fpCfgFile)) {
-           off_t nextOffset = ftell(fpCfgFile);
-           if(curCfgFileOffset != replacePos) {
-                fprintf(fpTempFile, "%s", lineBuf);
-           }
-           else {
-                fprintf(fpTempFile, "%s;\"%s\"\n", baseSeqHash.c_str(), folderName.c_str());
-           }
-           curCfgFileOffset = nextOffset;
-     }
-     if(replacePos == LSEEK_NOT_FOUND) {
-          fprintf(fpTempFile, "%s;\"%s\"\n", baseSeqHash.c_str(), folderName.c_str());
+     for(size_t eidx = 0; eidx < sfIndex.entryHashes.size(); eidx++) {
+          fprintf(fpTempFile, "%s;\"%s\"\n", sfIndex.entryHashes[eidx].c_str(), 
+                  sfIndex.entryFolderNames[eidx].c_str());
      }
-
-     fclose(fpCfgFile);
      fclose(fpTempFile);
-     if(rename(tempFilePath, fullCfgFilePath.c_str())) {
+     if(rename(tempFilePath.c_str(), sfIndex.indexedCfgFilePath.c_str())) {
           TerminalText::PrintError("Unable to move \"%s\" to \"%s\" : %s\n", 
-                                   tempFilePath, cfgFilePath, strerror(errno));
-           return errno;
+                                   tempFilePath.c_str(), sfIndex.indexedCfgFilePath.c_str(), 
+                                   strerror(errno));
+          return errno;
      }
-
+     sfIndex.logLineCount = sfIndex.entryHashes.size();
+     sfIndex.entriesRekeyed = false;
      return EXIT_SUCCESS;
 
 }
@@ -208,7 +298,8 @@ InputFileTypeSpec ClassifyInputFileTypeByExtension(const char *fileExt) {
      else if(!strcasecmp(fileExt, "nopct")) {
       return FILETYPE_NOPCT;
      }
-     else if(!strcasecmp(fileExt, "dot") || !strcasecmp(fileExt, "bracket") || !strcasecmp(fileExt, "dbn")) {
+     else if(!strcasecmp(fileExt, "dot") || !strcasecmp(fileExt, "bracket") || !strcasecmp(fileExt, "dbn") || 
+             !strcasecmp(fileExt, "subopt")) {
       return FILETYPE_DOTBRACKET;
      }
      else if(!strcasecmp(fileExt, "bpseq")) {
@@ -227,7 +318,10 @@ InputFileTypeSpec ClassifyInputFileType(const char *inputFilePath) {
      if(inputFilePath == NULL) {
           return FILETYPE_NONE;
      }
-     const char *extPos = strrchr(inputFilePath, '.');
+     // The compressed files are classified by the extension under the 
+     // compression extension (e.g., "x.ct.gz" is a CT file):
+     std::string uncompressedPath = CompressedInput::GetUncompressedFilePath(inputFilePath);
+     const char *extPos = strrchr(uncompressedPath.c_str(), '.');
      if(extPos == NULL) {
           return FILETYPE_NONE;
      }
@@ -257,7 +351,7 @@ std::string GetSequenceFileHeaderLines(const char *filePath, InputFileTypeSpec f
              filePath = (const char *) actualFilePath;
         }
      }
-     FILE *fpInputSeq = fopen(filePath, "r");
+     FILE *fpInputSeq = CompressedInput::OpenInputFile(filePath, "r");
      if(!fpInputSeq) {
           TerminalText::PrintError("Unable to open file \"%s\" : %s V\n", filePath, strerror(errno));
           return "";
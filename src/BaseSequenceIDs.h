@@ -20,6 +20,7 @@
 
 #include "ConfigOptions.h"
 #include "RNAStructVizTypes.h"
+#include "SequenceFingerprint.h"
 
 class RNAStructure;
 
@@ -27,24 +28,39 @@ class RNAStructure;
 #define DEFAULT_STICKY_FOLDERNAME_CFGFILE       ("sequence-folder-names.dat")
 #define GetStickyFolderConfigPath(cfgFile)      (std::string(USER_CONFIG_DIR) + std::string(cfgFile))
 
+/* The sticky folder names are keyed by the (XXH64) fingerprint of the full 
+ * sequence. The files saved by older versions are keyed by HashBaseSequence 
+ * instead, which only hashes the first MAX_BYTES_TO_HASH bytes of the 
+ * sequence, and those keys are still read (and replaced as they are used): 
+ */
+#define STICKY_KEY_PREFIX                       ("xxh64:")
 #define BSHASH_BYTES                            (48)
 #define MAX_BYTES_TO_HASH                       (2048)
+std::string StickyFolderNameKey(const SequenceFingerprint_t &seqFP);
 std::string HashBaseSequence(const char *baseSeq); 
 
+/* The sticky folder names file is loaded into an in-memory hash index on 
+ * first use. FolderNameForSequenceExists returns the position of the entry 
+ * in that index (not a file offset), which is then passed to 
+ * LookupStickyFolderNameForSequence to get a (malloc'ed) copy of the name. 
+ * New names are appended to the file as they are saved, and the file is 
+ * compacted to one line per sequence by CompactStickyFolderNameConfigFile: 
+ */
 char * LookupStickyFolderNameForSequence(const char *cfgFilePath, const char *baseSeqSpec);
 char * LookupStickyFolderNameForSequence(const char *cfgFilePath, RNAStructure *rnaStructSpec);
-char * LookupStickyFolderNameForSequence(const char *cfgFilePath, off_t fnameFileOffset);
+char * LookupStickyFolderNameForSequence(const char *cfgFilePath, size_t fnameEntryIndex);
 
-#define LSEEK_NOT_FOUND                         ((off_t) -1)
+/* The entry index returned when there is no saved name (like std::string::npos): */
+#define STICKY_ENTRY_NOT_FOUND                  ((size_t) -1)
 
-off_t FolderNameForSequenceExists(const char *cfgFilePath, const char *baseSeqSpec);
-off_t FolderNameForSequenceExists(const char *cfgFilePath, RNAStructure *rnaStructSpec);
+size_t FolderNameForSequenceExists(const char *cfgFilePath, const char *baseSeqSpec);
+size_t FolderNameForSequenceExists(const char *cfgFilePath, RNAStructure *rnaStructSpec);
 
-int SaveStickyFolderNameToFirstConfigFile(const char *cfgFilePath, 
-		                          std::string baseSeq, std::string folderName);
 int SaveStickyFolderNameToConfigFile(const char *cfgFilePath, 
 		                     std::string baseSeq, std::string folderName, 
-		                     off_t replacePos = LSEEK_NOT_FOUND);
+		                     size_t replaceEntryIndex = STICKY_ENTRY_NOT_FOUND);
+int CompactStickyFolderNameConfigFile(const char *cfgFilePath);
+void ResetStickyFolderNameIndex();
 
 InputFileTypeSpec ClassifyInputFileTypeByExtension(const char *fileExt);
 InputFileTypeSpec ClassifyInputFileType(const char *inputFilePath);
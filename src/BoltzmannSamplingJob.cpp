@@ -0,0 +1,221 @@
+/* BoltzmannSamplingJob.cpp : Implementation of the background sampling jobs;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <algorithm>
+
+#include "BoltzmannSamplingJob.h"
+#include "RNAStructure.h"
+#include "ConfigOptions.h"
+#include "TerminalPrinting.h"
+
+BoltzmannSamplingJob_t::BoltzmannSamplingJob_t(const char *fastaFilePath,
+		                               unsigned int sampleSize, bool nonRedundant,
+					       bool computePredictions) :
+     filePath(fastaFilePath != NULL ? fastaFilePath : ""), sampleSize(sampleSize),
+     nonRedundant(nonRedundant), computePredictions(computePredictions),
+     cancelRequested(false), finished(false),
+     samplesDone(0), recordCount(0), abandoned(false), fastaReader(NULL) {}
+
+BoltzmannSamplingJob_t::~BoltzmannSamplingJob_t() {
+     Cancel();
+     if(workerThread.joinable()) {
+          workerThread.join();
+     }
+     for(size_t s = 0; s < readyStructs.size(); s++) {
+          Delete(readyStructs[s], RNAStructure);
+     }
+     readyStructs.clear();
+}
+
+void BoltzmannSamplingJob_t::Start() {
+     if(workerThread.joinable() || finished) {
+          return;
+     }
+     workerThread = std::thread(&BoltzmannSamplingJob_t::Run, this);
+}
+
+void BoltzmannSamplingJob_t::Cancel() {
+     cancelRequested = true;
+}
+
+void BoltzmannSamplingJob_t::Abandon(BoltzmannSamplingJob_t *samplingJob) {
+     if(samplingJob == NULL) {
+          return;
+     }
+     samplingJob->Cancel();
+     {
+          std::lock_guard<std::mutex> finishGuard(samplingJob->finishLock);
+	  if(!samplingJob->finished && samplingJob->workerThread.joinable()) {
+	       samplingJob->abandoned = true;
+	       samplingJob->workerThread.detach();
+	       return;
+	  }
+     }
+     Delete(samplingJob, BoltzmannSamplingJob_t);
+}
+
+std::string BoltzmannSamplingJob_t::GetStatusMessage() {
+     std::lock_guard<std::mutex> readyGuard(readyLock);
+     return statusMessage;
+}
+
+void BoltzmannSamplingJob_t::SetStatusMessage(const std::string &statusMsg) {
+     std::lock_guard<std::mutex> readyGuard(readyLock);
+     statusMessage = statusMsg;
+}
+
+int BoltzmannSamplingJob_t::TakeReadyStructures(std::vector<RNAStructure *> &readyOut) {
+     std::lock_guard<std::mutex> readyGuard(readyLock);
+     int numReady = readyStructs.size();
+     readyOut.insert(readyOut.end(), readyStructs.begin(), readyStructs.end());
+     readyStructs.clear();
+     return numReady;
+}
+
+void BoltzmannSamplingJob_t::Run() {
+
+     const char *fastaFile = filePath.c_str();
+     try {
+          SetStatusMessage("Reading the FASTA records ...");
+	  recordCount = ViennaBoltzmannSampling::FASTARecordReader_t::CountRecords(fastaFile);
+	  fastaReader = new ViennaBoltzmannSampling::FASTARecordReader_t(fastaFile);
+     } catch(std::string errorMsg) {
+          TerminalText::PrintError("Unable to read the FASTA file \"%s\": %s\n",
+			           fastaFile, errorMsg.c_str());
+	  FinishRun("Done.");
+	  return;
+     }
+     // The records are only sampled in parallel when the workers each have 
+     // their own RNAlib random state, so the samples do not depend on the 
+     // thread timing:
+     int numWorkers = MIN(MAX(1, (int) std::thread::hardware_concurrency()),
+		          SAMPLING_JOB_MAX_RECORD_WORKERS);
+     if(!ViennaBoltzmannSampling::VRNARandomStateIsThreadLocal()) {
+          numWorkers = 1;
+     }
+     numWorkers = MIN(numWorkers, (int) recordCount);
+     std::vector<std::thread> recordWorkers;
+     for(int w = 1; w < numWorkers; w++) {
+          recordWorkers.push_back(std::thread(&BoltzmannSamplingJob_t::RecordWorker, this));
+     }
+     if(numWorkers > 0) {
+          RecordWorker();
+     }
+     for(size_t w = 0; w < recordWorkers.size(); w++) {
+          recordWorkers[w].join();
+     }
+     Delete(fastaReader, ViennaBoltzmannSampling::FASTARecordReader_t);
+     if(recordCount == 0) {
+          TerminalText::PrintError("Unable to sample the structures for FASTA file \"%s\": %s\n",
+			           fastaFile, "No sequence records found.");
+     }
+     else if(samplesDone == 0 && !cancelRequested) {
+          TerminalText::PrintError("Unable to sample the structures for FASTA file \"%s\": %s\n",
+			           fastaFile, "VRNA returned no samples.");
+     }
+     FinishRun(cancelRequested ? "Cancelled." : "Done.");
+
+}
+
+void BoltzmannSamplingJob_t::FinishRun(const char *statusMsg) {
+     SetStatusMessage(statusMsg);
+     std::unique_lock<std::mutex> finishGuard(finishLock);
+     finished = true;
+     if(abandoned) {
+          // The worker thread was detached, so nothing else refers to the job:
+          finishGuard.unlock();
+	  delete this;
+     }
+}
+
+void BoltzmannSamplingJob_t::RecordWorker() {
+     ViennaBoltzmannSampling::FASTARecord_t fastaRecord;
+     while(!cancelRequested) {
+          try {
+	       std::lock_guard<std::mutex> readerGuard(readerLock);
+	       if(!fastaReader->NextRecord(fastaRecord)) {
+	            break;
+	       }
+	  } catch(std::string errorMsg) {
+	       TerminalText::PrintError("Unable to read the FASTA file \"%s\": %s\n",
+			                filePath.c_str(), errorMsg.c_str());
+	       break;
+	  }
+	  SampleRecord(fastaRecord);
+     }
+}
+
+void BoltzmannSamplingJob_t::SampleRecord(const ViennaBoltzmannSampling::FASTARecord_t &fastaRecord) {
+
+     const char *fastaFile = filePath.c_str();
+     std::string recordID = ViennaBoltzmannSampling::FASTARecordReader_t::GetRecordID(fastaRecord);
+     std::string recordDesc = recordCount > 1 ? 
+	                      std::string(" [") + recordID + std::string("]") : std::string("");
+     try {
+	  if(fastaRecord.baseSeq.length() == 0) {
+	       throw string("No sequence data found in the record.");
+	  }
+	  const string &baseSeq = fastaRecord.baseSeq;
+	  SetStatusMessage("Computing the partition function" + recordDesc + " ...");
+	  std::shared_ptr<ViennaBoltzmannSampling::PartitionFunction_t> pfEntry =
+	       ViennaBoltzmannSampling::GetPartitionFunction(baseSeq);
+	  if(!pfEntry) {
+	       throw string("VRNA could not fold the sequence.");
+	  }
+	  std::shared_ptr<RNAStructure::SharedSequence_t> sharedSeq = 
+	       RNAStructure::CreateSharedSequence(baseSeq.c_str());
+	  ViennaBoltzmannSampling::SampleStream_t sampleStream(pfEntry, nonRedundant);
+	  SetStatusMessage("Drawing the Boltzmann samples" + recordDesc + " ...");
+	  unsigned int numDrawn = 0, recordSamplesDone = 0;
+	  while(numDrawn < sampleSize && !cancelRequested) {
+	       // The first chunk has the extra (index zero) sample, so the later
+	       // chunks start on a block boundary:
+	       unsigned int chunkSize = SAMPLING_JOB_CHUNK_SIZE + (numDrawn == 0 ? 1 : 0);
+	       chunkSize = std::min(chunkSize, sampleSize - numDrawn);
+	       char **dotSampleData = sampleStream.DrawSamples(chunkSize);
+	       std::vector<RNAStructure *> chunkStructs;
+	       unsigned int numSamples = ViennaBoltzmannSampling::GenerateStructuresFromSamples(
+			                      fastaFile, sharedSeq, dotSampleData, recordSamplesDone, 
+					      chunkStructs, fastaRecord.recordIndex);
+	       if(recordSamplesDone == 0 && numSamples > 0 && recordCount > 1) {
+	            // Name the folder for the record by its ID:
+		    chunkStructs[0]->SetSuggestedStructureFolderName(recordID.c_str());
+	       }
+	       {
+	            std::lock_guard<std::mutex> readyGuard(readyLock);
+		    readyStructs.insert(readyStructs.end(), chunkStructs.begin(), chunkStructs.end());
+	       }
+	       numDrawn += chunkSize;
+	       recordSamplesDone += numSamples;
+	       samplesDone += numSamples;
+	       if(sampleStream.exhausted) {
+	            break;
+	       }
+	  }
+	  if(computePredictions && !cancelRequested) {
+	       SetStatusMessage("Computing the MFE, centroid and MEA structures" + recordDesc + " ...");
+	       std::vector<RNAStructure *> predictedStructs;
+	       ViennaBoltzmannSampling::GeneratePredictedStructures(*pfEntry, fastaFile, sharedSeq,
+			                                            predictedStructs,
+								    fastaRecord.recordIndex);
+	       if(recordSamplesDone == 0 && predictedStructs.size() > 0 && recordCount > 1) {
+		    predictedStructs[0]->SetSuggestedStructureFolderName(recordID.c_str());
+	       }
+	       std::lock_guard<std::mutex> readyGuard(readyLock);
+	       readyStructs.insert(readyStructs.end(), predictedStructs.begin(), predictedStructs.end());
+	  }
+	  if(recordSamplesDone == 0 && !cancelRequested) {
+	       throw string("VRNA returned no samples.");
+	  }
+	  else if(recordSamplesDone < sampleSize && !cancelRequested) {
+	       TerminalText::PrintWarning("Actual computed sample size for \"%s\"%s is %d < %d\n",
+			                  fastaFile, recordDesc.c_str(), recordSamplesDone, sampleSize);
+	  }
+     } catch(std::string errorMsg) {
+          TerminalText::PrintError("Unable to sample the structures for FASTA file \"%s\"%s: %s\n",
+			           fastaFile, recordDesc.c_str(), errorMsg.c_str());
+     }
+
+}
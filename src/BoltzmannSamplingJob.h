@@ -0,0 +1,109 @@
+/* BoltzmannSamplingJob.h : A cancellable background job which computes the
+ *                          Boltzmann samples for the records in a FASTA file
+ *                          on a pool of worker threads and hands the
+ *                          structures back in chunks;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#ifndef __BOLTZMANN_SAMPLING_JOB_H__
+#define __BOLTZMANN_SAMPLING_JOB_H__
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#include "ViennaBoltzmannSampling.h"
+
+class RNAStructure;
+
+/* The number of samples drawn (and converted to structures) between the
+ * checks for cancellation. This is a multiple of the sample block size, so
+ * the chunks give the same samples as drawing them all at once: */
+#define SAMPLING_JOB_CHUNK_SIZE            (4 * VRNA_SAMPLE_BLOCK_SIZE)
+
+/* The most records of a multi-record FASTA file which are folded and sampled
+ * at once (each holds an O(N^2) partition function while it is in flight): */
+#define SAMPLING_JOB_MAX_RECORD_WORKERS    (4)
+
+class BoltzmannSamplingJob_t {
+
+     public:
+          /* When computePredictions is set, the MFE, centroid and MEA
+	   * structures of each sequence are added after its samples: */
+          BoltzmannSamplingJob_t(const char *fastaFilePath,
+			         unsigned int sampleSize = DEFAULT_SAMPLE_SIZE,
+				 bool nonRedundant = true,
+				 bool computePredictions = true);
+
+	  /* Cancels the job and waits for the worker to stop. Any structures
+	   * which were not taken yet are deleted: */
+	  ~BoltzmannSamplingJob_t();
+
+	  void Start();
+	  void Cancel();
+
+	  /* Cancels the job without waiting for the worker, which only sees the
+	   * cancellation between the calls into RNAlib (vrna_pf cannot be
+	   * interrupted, so this can take minutes for a long sequence). The job
+	   * deletes itself once the worker stops, so the caller must not use it
+	   * after this call: */
+	  static void Abandon(BoltzmannSamplingJob_t *samplingJob);
+
+	  inline bool IsFinished() const { return finished; }
+	  inline bool IsCancelled() const { return cancelRequested; }
+	  inline unsigned int GetSamplesDone() const { return samplesDone; }
+	  inline unsigned int GetSampleSize() const { return sampleSize; }
+
+	  /* The number of records in the file (zero until they are counted),
+	   * and the total number of samples to draw over all of them: */
+	  inline unsigned int GetRecordCount() const { return recordCount; }
+	  inline unsigned int GetTotalSampleCount() const {
+	       return recordCount * sampleSize;
+	  }
+	  inline const char * GetFilePath() const { return filePath.c_str(); }
+
+	  /* A short description of what the worker is doing now (for the
+	   * progress window): */
+	  std::string GetStatusMessage();
+
+	  /* Moves the structures computed since the last call into readyOut
+	   * (the caller then owns them). Returns the number moved: */
+	  int TakeReadyStructures(std::vector<RNAStructure *> &readyOut);
+
+     private:
+	  void Run();
+	  void FinishRun(const char *statusMsg);
+	  void RecordWorker();
+	  void SampleRecord(const ViennaBoltzmannSampling::FASTARecord_t &fastaRecord);
+	  void SetStatusMessage(const std::string &statusMsg);
+
+	  std::string filePath;
+	  unsigned int sampleSize;
+	  bool nonRedundant;
+	  bool computePredictions;
+
+	  std::thread workerThread;
+	  std::atomic<bool> cancelRequested;
+	  std::atomic<bool> finished;
+	  std::atomic<unsigned int> samplesDone;
+	  std::atomic<unsigned int> recordCount;
+
+	  // Guards the hand off between finishing the worker and abandoning the job:
+	  std::mutex finishLock;
+	  bool abandoned;
+
+	  // The records are read one at a time by the workers as they finish
+	  // the previous ones:
+	  ViennaBoltzmannSampling::FASTARecordReader_t *fastaReader;
+	  std::mutex readerLock;
+
+	  std::mutex readyLock;
+	  std::vector<RNAStructure *> readyStructs;
+	  std::string statusMessage;
+
+};
+
+#endif
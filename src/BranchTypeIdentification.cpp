@@ -1,7 +1,7 @@
-/* BranchTypeIdentification.cpp 
+/* BranchTypeIdentification.cpp
    Author:  Maxie D. Schmidt (maxieds@gmail.com)
    Created: 2018.06.16
-*/ 
+*/
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,90 +9,22 @@
 
 #include <vector>
 #include <algorithm>
-using std::vector;
-using std::sort;
 
 #include "BranchTypeIdentification.h"
+#include "ConfigOptions.h"
 
 #if PERFORM_BRANCH_TYPE_ID
 #pragma message "Compiling in support for branch-type ID in " __FILE__ "..."
 
-vector<RNAStructure::BaseData *> RNABranchType_t::getEnclosingArcs( 
-       RNAStructure * &rnaStructBase, bool removeTopFour = false) { 
-     vector<RNAStructure::BaseData *> rBaseDataVec;
-     for(int bd = 0; bd < rnaStructBase->GetLength(); bd++) {
-          bool isAlreadyEnclosed = false;
-          RNAStructure::BaseData *curBaseData = rnaStructBase->GetBaseAt(bd);
-          for(int v = 0; v < rBaseDataVec.size(); v++) {
-               if(curBaseData->m_pair == RNAStructure::UNPAIRED) { 
-                    isAlreadyEnclosed = true;
-                    break;
-               }
-               else if(curBaseData->isContainedIn(*(rBaseDataVec[v]))) {
-                    isAlreadyEnclosed = true;
-                    break;
-               }
-               else if(rBaseDataVec[v]->isContainedIn(*curBaseData)) {
-                    rBaseDataVec[v] = curBaseData;
-                    isAlreadyEnclosed = true;
-                    break;
-               }
-          }
-          if(!isAlreadyEnclosed && (rBaseDataVec.size() > 0 || curBaseData->m_pair != RNAStructure::UNPAIRED)) {
-               rBaseDataVec.push_back(curBaseData);
-          }
-     }
-     sort(rBaseDataVec.begin(), rBaseDataVec.end(), RNAStructureBaseDataArcLengthSort());
-     if(removeTopFour) {
-          rBaseDataVec.erase(rBaseDataVec.begin(), rBaseDataVec.begin() + 4);
-     }
-     return rBaseDataVec;
-}
-
-RNABranchType_t::RNABranchType_t() {
-     branchID = BRANCH_UNDEFINED;
-     branchParent = NULL;
-}
-
-RNABranchType_t::RNABranchType_t(BranchID_t bid, class RNAStructure::BaseData *bparent = NULL) {
-     branchID = bid;
-     branchParent = bparent;
-} 
- 
-RNABranchType_t & RNABranchType_t::operator=(const BranchID_t &rhs) {
-     setBranchID(rhs);
-     branchParent = NULL;
-     return *this;
-} 
-         
-bool RNABranchType_t::operator==(const RNABranchType_t &rhs) const {
-     return branchID == rhs.branchID && branchParent == rhs.branchParent;
-}
-          
-bool RNABranchType_t::operator==(const BranchID_t &rhs) const {
-     return branchID == rhs;
-}
-
-const BranchID_t & RNABranchType_t::getBranchID() const {
-     return branchID;
-} 
-          
-void RNABranchType_t::setBranchID(BranchID_t bid) {
-     branchID = bid;
-}
-          
-const RNAStructure::BaseData* RNABranchType_t::getBranchParent() const {
-     return branchParent;
-}
-          
-void RNABranchType_t::setBranchParent(class RNAStructure::BaseData* bparent) {
-     branchParent = bparent;
-}
+typedef struct {
+     int openIdx;
+     int closeIdx;
+} OuterArc_t;
 
 void RNABranchType_t::SetBranchColor(cairo_t * &cr, BranchID_t bt) {
      switch(bt) {
           case BRANCH_UNDEFINED:
-               cairo_set_source_rgb(cr, 0.0, 0.0, 0.0); 
+               cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
                break;
           case BRANCH1:
                cairo_set_source_rgb(cr, 92.0 / 255, 160.0 / 255, 215.0 / 255);
@@ -111,155 +43,124 @@ void RNABranchType_t::SetBranchColor(cairo_t * &cr, BranchID_t bt) {
      }
 }
 
-bool RNABranchType_t::PerformBranchClassification(class RNAStructure * &rnaStructBase, unsigned int alength) {
+bool RNABranchType_t::PerformBranchClassification(const std::vector<int> &pairTable,
+		                                  uint8_t *branchIDs) {
 
-     if(alength < 4)
-          return false;     
+     int seqLength = pairTable.size();
+     memset(branchIDs, BRANCH_UNDEFINED, seqLength * sizeof(uint8_t));
+     if(seqLength < NUM_BRANCHES) {
+          return false;
+     }
 
-     // first we determine the four most enclosing arcs on the circle: 
-     RNAStructure::BaseData* mostEnclosingArcs[4] = {NULL, NULL, NULL, NULL};
-     unsigned int mostEnclosingArcsSize = 0;
-     for(int rs = 0; rs < alength; rs++) {
-          RNAStructure::BaseData* rnaStruct = rnaStructBase->GetBaseAt(rs);
-          if(rnaStruct->m_pair == RNAStructure::UNPAIRED) 
+     // The outermost arcs are those that close with nothing left open on the
+     // stack, and so are found in their natural order on the circle:
+     std::vector<OuterArc_t> outerArcs;
+     std::vector<int> openStack;
+     std::vector<bool> openOnStack(seqLength, false);
+     for(int pos = 0; pos < seqLength; pos++) {
+          int partner = pairTable[pos];
+          if(partner < 0 || partner >= seqLength || partner == pos || pairTable[partner] != pos) {
                continue;
-          else if(mostEnclosingArcsSize == 0) {
-               mostEnclosingArcs[0] = rnaStructBase->GetBaseAt(rs);
-               mostEnclosingArcsSize++;
+          }
+          else if(partner > pos) {
+               openStack.push_back(pos);
+               openOnStack[pos] = true;
                continue;
           }
-          bool isEnclosedInLargerBranch = false;
-          for(int mea = 0; mea < mostEnclosingArcsSize; mea++) {
-               if(rnaStruct->isContainedIn(*(mostEnclosingArcs[mea]))) {
-                    isEnclosedInLargerBranch = true;
-                    break;
-               }
+          else if(!openOnStack[partner]) {
+               continue;
           }
-          if(isEnclosedInLargerBranch) 
-               continue; // this cannot be an outer containing branch
-          RNAStructure::BaseData *currentBaseData = rnaStructBase->GetBaseAt(rs);;
-          unsigned int pairDistance = ABS(MAX(currentBaseData->m_pair, currentBaseData->m_index) - 
-                                          MIN(currentBaseData->m_pair, currentBaseData->m_index));
-          for(int mea = 0; mea < mostEnclosingArcsSize; mea++) { 
-               RNAStructure::BaseData *meaBaseData = mostEnclosingArcs[mea];
-               unsigned int meaPairDistance = ABS(MAX(meaBaseData->m_pair, meaBaseData->m_index) - 
-                                                  MIN(meaBaseData->m_pair, meaBaseData->m_index)); 
-               bool needToResort = false;
-               if(meaPairDistance < pairDistance && meaBaseData->m_pair > meaBaseData->m_index) {
-                    if(mostEnclosingArcsSize < 4) {
-                         mostEnclosingArcs[mostEnclosingArcsSize] = mostEnclosingArcs[mea];
-                         mostEnclosingArcsSize++;
-                         needToResort = true;
-                    }
-                    mostEnclosingArcs[mea] = rnaStructBase->GetBaseAt(rs);
-                    if(needToResort) {
-                         qsort(&mostEnclosingArcs[0], mostEnclosingArcsSize, 
-                               sizeof(RNAStructure::BaseData*), compareMostEnclosingArcs);
-                    }
-                    break;
-               }
+          // Any arcs still open inside of (partner, pos) cross it and are dropped:
+          while(openStack.back() != partner) {
+               openOnStack[openStack.back()] = false;
+               openStack.pop_back();
+          }
+          openOnStack[partner] = false;
+          openStack.pop_back();
+          if(openStack.empty()) {
+               OuterArc_t outerArc = { partner, pos };
+               outerArcs.push_back(outerArc);
           }
      }
-     // sort the identified branches according to their natural order on the circle:
-     IntIndexPair_t branchOrderMappings[mostEnclosingArcsSize];
-     for(int i = 0; i < mostEnclosingArcsSize; i++) { 
-          branchOrderMappings[i].intValue = MIN(mostEnclosingArcs[i]->m_index, mostEnclosingArcs[i]->m_pair); 
-          branchOrderMappings[i].index = i;
-     }
-     qsort(&branchOrderMappings[0], mostEnclosingArcsSize, sizeof(IntIndexPair_t), compareIntegerIndexPair); 
-     RNAStructure::BaseData* mostEnclosingArcsTemp[4];
-     for(int j = 0; j < mostEnclosingArcsSize; j++) { 
-          mostEnclosingArcsTemp[j] = mostEnclosingArcs[branchOrderMappings[j].index];
-     }
-     for(int k = 0; k < mostEnclosingArcsSize; k++) { 
-          mostEnclosingArcs[k] = mostEnclosingArcsTemp[k];
-     }
-     // now that we've identified most of the the enclosing branches, 
-     // we reset the branch types by number on all (except for the nubbins, 
-     // see below) entries in the array: 
-     vector<RNAStructure::BaseData *> enclosingArcs = getEnclosingArcs(rnaStructBase, false);
-     if(enclosingArcs.size() < 7 || mostEnclosingArcsSize < 4) {
+     int numTopArcs = NUM_BRANCHES + NUM_BRANCH_NUBBINS;
+     if((int) outerArcs.size() < numTopArcs) {
           return false;
      }
-     sort(enclosingArcs.begin(), enclosingArcs.begin() + 4, RNAStructureBaseDataIndexSort());
-     // handle labeling of the arc nubbins (and contained pairs) to the sides of the big arcs: 
-     vector<RNAStructure::BaseData *> enclosingArcsNubbins(enclosingArcs.begin() + 4, enclosingArcs.begin() + 7);
-     sort(enclosingArcsNubbins.begin(), enclosingArcsNubbins.end(), RNAStructureBaseDataIndexSort());
-     BranchID_t nubbinBranchIDs[3] = {BRANCH1, BRANCH2, BRANCH4};
-     for(int n = 0; n < 3; n++) {
-          rnaStructBase->GetBranchTypeAt(enclosingArcsNubbins[n]->m_index)->setBranchID(nubbinBranchIDs[n]);
-          rnaStructBase->GetBranchTypeAt(enclosingArcsNubbins[n]->m_index)->setBranchParent(enclosingArcs[(int) (nubbinBranchIDs[n] - 1)]);
-          rnaStructBase->GetBranchTypeAt(enclosingArcsNubbins[n]->m_pair)->setBranchID(nubbinBranchIDs[n]);
-          rnaStructBase->GetBranchTypeAt(enclosingArcsNubbins[n]->m_pair)->setBranchParent(enclosingArcs[(int) (nubbinBranchIDs[n] - 1)]);
-          for(int b = 0; b < alength; b++) {
-               RNAStructure::BaseData *curBase = rnaStructBase->GetBaseAt(b);
-               if(curBase->isContainedIn(*(enclosingArcsNubbins[n])) || 
-                  curBase->m_pair == RNAStructure::UNPAIRED && 
-                  curBase->m_index < MAX(enclosingArcsNubbins[n]->m_index, enclosingArcsNubbins[n]->m_pair) && 
-                  curBase->m_index > MIN(enclosingArcsNubbins[n]->m_index, enclosingArcsNubbins[n]->m_pair)) {
-                    rnaStructBase->GetBranchTypeAt(b)->setBranchID(nubbinBranchIDs[n]);
-                    rnaStructBase->GetBranchTypeAt(b)->setBranchParent(enclosingArcs[(int) (nubbinBranchIDs[n] - 1)]);
+
+     // Keep the indices of the seven longest outermost arcs (ties go to the
+     // arc nearest the 5' end) with a bounded insertion pass:
+     int topArcs[NUM_BRANCHES + NUM_BRANCH_NUBBINS];
+     int topArcsCount = 0;
+     for(int a = 0; a < (int) outerArcs.size(); a++) {
+          int arcLength = outerArcs[a].closeIdx - outerArcs[a].openIdx;
+          int insertPos = topArcsCount;
+          while(insertPos > 0) {
+               const OuterArc_t &prevArc = outerArcs[topArcs[insertPos - 1]];
+               if(prevArc.closeIdx - prevArc.openIdx >= arcLength) {
+                    break;
                }
+               insertPos--;
           }
+          if(insertPos >= numTopArcs) {
+               continue;
+          }
+          int lastPos = std::min(topArcsCount, numTopArcs - 1);
+          for(int t = lastPos; t > insertPos; t--) {
+               topArcs[t] = topArcs[t - 1];
+          }
+          topArcs[insertPos] = a;
+          topArcsCount = std::min(topArcsCount + 1, numTopArcs);
      }
-     // handle labeling of the big arcs (and contained pairs and unpaired components contained within):
-     for(int k = 0; k < 4; k++) { 
-          rnaStructBase->GetBranchTypeAt(enclosingArcs[k]->m_index)->setBranchID((BranchID_t) (k + 1));
-          rnaStructBase->GetBranchTypeAt(enclosingArcs[k]->m_index)->setBranchParent(enclosingArcs[k]);
-          rnaStructBase->GetBranchTypeAt(enclosingArcs[k]->m_pair)->setBranchID((BranchID_t) (k + 1));
-          rnaStructBase->GetBranchTypeAt(enclosingArcs[k]->m_pair)->setBranchParent(enclosingArcs[k]);
-          for(int b = 0; b < alength; b++) {
-               RNAStructure::BaseData *curBase = rnaStructBase->GetBaseAt(b);
-               if(curBase->isContainedIn(*(enclosingArcs[k])) || 
-                  (curBase->m_pair == RNAStructure::UNPAIRED && curBase->m_index < MAX(enclosingArcs[k]->m_index, enclosingArcs[k]->m_pair) && 
-                  curBase->m_index > MIN(enclosingArcs[k]->m_index, enclosingArcs[k]->m_pair))) {
-                    rnaStructBase->GetBranchTypeAt(b)->setBranchID((BranchID_t) (k + 1));
-                    rnaStructBase->GetBranchTypeAt(b)->setBranchParent(enclosingArcs[k]);
-               }
+     int *branchArcs = &topArcs[0], *nubbinArcs = &topArcs[NUM_BRANCHES];
+     std::sort(branchArcs, branchArcs + NUM_BRANCHES);
+     std::sort(nubbinArcs, nubbinArcs + NUM_BRANCH_NUBBINS);
+
+     // Label the nubbins and the big arcs together with everything they enclose:
+     const BranchID_t nubbinBranchIDs[NUM_BRANCH_NUBBINS] = { BRANCH1, BRANCH2, BRANCH4 };
+     for(int n = 0; n < NUM_BRANCH_NUBBINS; n++) {
+          const OuterArc_t &nubbin = outerArcs[nubbinArcs[n]];
+          memset(branchIDs + nubbin.openIdx, nubbinBranchIDs[n],
+                 nubbin.closeIdx - nubbin.openIdx + 1);
+     }
+     for(int b = 0; b < NUM_BRANCHES; b++) {
+          const OuterArc_t &branch = outerArcs[branchArcs[b]];
+          memset(branchIDs + branch.openIdx, (BranchID_t) (b + 1),
+                 branch.closeIdx - branch.openIdx + 1);
+     }
+
+     // Unpaired bases before the first big arc belong to the first branch,
+     // those after the last to the fourth, and those in between two of the
+     // big arcs are split in half between them:
+     for(int pos = 0; pos < outerArcs[branchArcs[0]].openIdx; pos++) {
+          if(pairTable[pos] < 0 && branchIDs[pos] == BRANCH_UNDEFINED) {
+               branchIDs[pos] = BRANCH1;
           }
      }
-     // handle labeling of the unpaired components in between the big arcs:
-     for(int b = 0; b < 4; b++) { 
-          int unpairedBetweenBranchCount = 0;
-          vector<RNAStructure::BaseData *> unpairedBetweenVec;
-          for(int v = 0; v < alength; v++) { 
-               RNAStructure::BaseData *curUnpaired = rnaStructBase->GetBaseAt(v);
-               if(curUnpaired->isContainedIn(*(enclosingArcs[b])) || 
-                  curUnpaired->m_index == enclosingArcs[b]->m_pair && curUnpaired->m_pair == enclosingArcs[b]->m_index) { 
-                    rnaStructBase->GetBranchTypeAt(v)->setBranchID((BranchID_t) (b + 1));
-                    rnaStructBase->GetBranchTypeAt(v)->setBranchParent(enclosingArcs[b]);
-               } 
-               else if(curUnpaired->m_pair == RNAStructure::UNPAIRED &&
-                  curUnpaired->m_index > MAX(enclosingArcs[b]->m_pair, enclosingArcs[b]->m_index) && (b == 3 ||  
-                  curUnpaired->m_index < MIN(enclosingArcs[b + 1]->m_pair, enclosingArcs[b + 1]->m_index))) { // we want the unpaired bases between branches <- : 
-                    unpairedBetweenBranchCount++;
-                    unpairedBetweenVec.push_back(curUnpaired);
+     for(int b = 0; b < NUM_BRANCHES; b++) {
+          int gapStart = outerArcs[branchArcs[b]].closeIdx + 1;
+          int gapEnd = (b + 1 < NUM_BRANCHES) ? outerArcs[branchArcs[b + 1]].openIdx : seqLength;
+          int unpairedCount = 0;
+          for(int pos = gapStart; pos < gapEnd; pos++) {
+               if(pairTable[pos] < 0 && branchIDs[pos] == BRANCH_UNDEFINED) {
+                    unpairedCount++;
                }
           }
-          for(int up = 0; up < unpairedBetweenVec.size(); up++) { 
-               if(b < 3 && up <= unpairedBetweenVec.size() / 2) { 
-                    rnaStructBase->GetBranchTypeAt(unpairedBetweenVec[up]->m_index)->setBranchID((BranchID_t) (b + 1));
-                    rnaStructBase->GetBranchTypeAt(unpairedBetweenVec[up]->m_index)->setBranchParent(enclosingArcs[b]);
+          int unpairedIdx = 0;
+          for(int pos = gapStart; pos < gapEnd; pos++) {
+               if(pairTable[pos] >= 0 || branchIDs[pos] != BRANCH_UNDEFINED) {
+                    continue;
                }
-               else if(b < 3) {
-                    rnaStructBase->GetBranchTypeAt(unpairedBetweenVec[up]->m_index)->setBranchID((BranchID_t) (b + 2));
-                    rnaStructBase->GetBranchTypeAt(unpairedBetweenVec[up]->m_index)->setBranchParent(enclosingArcs[b + 1]);
+               else if(b + 1 < NUM_BRANCHES && unpairedIdx > unpairedCount / 2) {
+                    branchIDs[pos] = (BranchID_t) (b + 2);
                }
                else {
-                    rnaStructBase->GetBranchTypeAt(unpairedBetweenVec[up]->m_index)->setBranchID(BRANCH4);
-                    rnaStructBase->GetBranchTypeAt(unpairedBetweenVec[up]->m_index)->setBranchParent(enclosingArcs[3]);
+                    branchIDs[pos] = (BranchID_t) (b + 1);
                }
-          }
-     }
-     // handle labeling of the unpaired components before the first big arc:
-     for(int up = 0; up < alength; up++) { 
-          RNAStructure::BaseData *curUnpaired = rnaStructBase->GetBaseAt(up);
-          if(curUnpaired->m_index < MIN(enclosingArcs[0]->m_index, enclosingArcs[0]->m_pair) && curUnpaired->m_pair == RNAStructure::UNPAIRED) { 
-               rnaStructBase->GetBranchTypeAt(up)->setBranchID(BRANCH1);
-               rnaStructBase->GetBranchTypeAt(up)->setBranchParent(enclosingArcs[0]);
+               unpairedIdx++;
           }
      }
      return true;
+
 }
 
 #endif
@@ -0,0 +1,286 @@
+/* CompressedInput.cpp : Implementation of the compressed input streams;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/types.h>
+
+#include <zlib.h>
+#if BUILD_WITH_ZSTD_SUPPORT > 0
+     #include <zstd.h>
+#endif
+
+#include "CompressedInput.h"
+
+namespace CompressedInput {
+
+typedef struct {
+     const char *fileExt;
+     CompressionType_t compressionType;
+} CompressionExtension_t;
+
+static const CompressionExtension_t COMPRESSION_EXTENSIONS[] = {
+     { ".gz",   COMPRESSION_GZIP },
+     { ".gzip", COMPRESSION_GZIP },
+     { ".zst",  COMPRESSION_ZSTD },
+     { ".zstd", COMPRESSION_ZSTD },
+};
+
+static const CompressionExtension_t * GetCompressionExtension(const char *filePath) {
+     if(filePath == NULL) {
+          return NULL;
+     }
+     const char *extPos = strrchr(filePath, '.');
+     if(extPos == NULL || strchr(extPos, '/') != NULL) {
+          return NULL;
+     }
+     int numExts = sizeof(COMPRESSION_EXTENSIONS) / sizeof(CompressionExtension_t);
+     for(int eidx = 0; eidx < numExts; eidx++) {
+          if(!strcasecmp(extPos, COMPRESSION_EXTENSIONS[eidx].fileExt)) {
+               return &COMPRESSION_EXTENSIONS[eidx];
+          }
+     }
+     return NULL;
+}
+
+CompressionType_t GetCompressionTypeByExtension(const char *filePath) {
+     const CompressionExtension_t *compressionExt = GetCompressionExtension(filePath);
+     return compressionExt != NULL ? compressionExt->compressionType : COMPRESSION_NONE;
+}
+
+CompressionType_t GetCompressionType(const char *filePath) {
+     CompressionType_t compressionType = GetCompressionTypeByExtension(filePath);
+     if(compressionType != COMPRESSION_NONE || filePath == NULL) {
+          return compressionType;
+     }
+     FILE *fpInput = fopen(filePath, "rb");
+     if(fpInput == NULL) {
+          return COMPRESSION_NONE;
+     }
+     unsigned char magicBytes[4];
+     size_t numRead = fread(magicBytes, 1, sizeof(magicBytes), fpInput);
+     fclose(fpInput);
+     if(numRead >= 2 && magicBytes[0] == 0x1f && magicBytes[1] == 0x8b) {
+          return COMPRESSION_GZIP;
+     }
+     else if(numRead == 4 && magicBytes[0] == 0x28 && magicBytes[1] == 0xb5 &&
+             magicBytes[2] == 0x2f && magicBytes[3] == 0xfd) {
+          return COMPRESSION_ZSTD;
+     }
+     return COMPRESSION_NONE;
+}
+
+std::string GetUncompressedFilePath(const char *filePath) {
+     if(filePath == NULL) {
+          return std::string("");
+     }
+     const CompressionExtension_t *compressionExt = GetCompressionExtension(filePath);
+     if(compressionExt == NULL) {
+          return std::string(filePath);
+     }
+     return std::string(filePath, strlen(filePath) - strlen(compressionExt->fileExt));
+}
+
+bool IsSupportedCompression(CompressionType_t compressionType) {
+     switch(compressionType) {
+          case COMPRESSION_NONE:
+          case COMPRESSION_GZIP:
+               return true;
+          case COMPRESSION_ZSTD:
+               return BUILD_WITH_ZSTD_SUPPORT > 0;
+          default:
+               return false;
+     }
+}
+
+/* The stdio cookie streams are fopencookie on glibc and funopen on the BSDs
+ * (and Mac OS), which take slightly different callbacks: */
+#ifdef __GLIBC__
+     typedef ssize_t CookieReadReturn_t;
+     typedef size_t CookieReadSize_t;
+#else
+     typedef int CookieReadReturn_t;
+     typedef int CookieReadSize_t;
+#endif
+
+static CookieReadReturn_t GzipCookieRead(void *cookie, char *readBuf, CookieReadSize_t readSize) {
+     unsigned int maxRead = readSize < (CookieReadSize_t) INT_MAX ? readSize : INT_MAX;
+     int bytesRead = gzread((gzFile) cookie, readBuf, maxRead);
+     // A file which ends in the middle of the gzip stream is not an error
+     // to gzread (it is only reported by gzerror once the data runs out):
+     int gzStatus = Z_OK;
+     if(bytesRead == 0) {
+          gzerror((gzFile) cookie, &gzStatus);
+     }
+     if(bytesRead < 0 || gzStatus == Z_BUF_ERROR) {
+          errno = EIO;
+          return -1;
+     }
+     return bytesRead;
+}
+
+static int GzipCookieClose(void *cookie) {
+     return gzclose((gzFile) cookie) == Z_OK ? 0 : EOF;
+}
+
+#if BUILD_WITH_ZSTD_SUPPORT > 0
+typedef struct {
+     FILE *fpInput;
+     ZSTD_DStream *zstdStream;
+     std::vector<char> inputBuffer;
+     ZSTD_inBuffer inputPos;
+} ZstdCookie_t;
+
+static CookieReadReturn_t ZstdCookieRead(void *cookie, char *readBuf, CookieReadSize_t readSize) {
+     ZstdCookie_t *zstdCookie = (ZstdCookie_t *) cookie;
+     ZSTD_outBuffer outputPos = { readBuf, (size_t) readSize, 0 };
+     while(outputPos.pos == 0) {
+          if(zstdCookie->inputPos.pos == zstdCookie->inputPos.size) {
+               size_t bytesRead = fread(zstdCookie->inputBuffer.data(), 1,
+                                        zstdCookie->inputBuffer.size(), zstdCookie->fpInput);
+               if(bytesRead == 0) {
+                    return ferror(zstdCookie->fpInput) ? -1 : 0;
+               }
+               zstdCookie->inputPos.src = zstdCookie->inputBuffer.data();
+               zstdCookie->inputPos.size = bytesRead;
+               zstdCookie->inputPos.pos = 0;
+          }
+          size_t zstdStatus = ZSTD_decompressStream(zstdCookie->zstdStream, &outputPos,
+                                                    &(zstdCookie->inputPos));
+          if(ZSTD_isError(zstdStatus)) {
+               errno = EIO;
+               return -1;
+          }
+     }
+     return outputPos.pos;
+}
+
+static int ZstdCookieClose(void *cookie) {
+     ZstdCookie_t *zstdCookie = (ZstdCookie_t *) cookie;
+     ZSTD_freeDStream(zstdCookie->zstdStream);
+     int closeStatus = fclose(zstdCookie->fpInput);
+     delete zstdCookie;
+     return closeStatus;
+}
+#endif
+
+static FILE * OpenCookieStream(void *cookie,
+                               CookieReadReturn_t (*readFunc)(void *, char *, CookieReadSize_t),
+                               int (*closeFunc)(void *)) {
+     #ifdef __GLIBC__
+          cookie_io_functions_t cookieFuncs;
+          memset(&cookieFuncs, 0, sizeof(cookie_io_functions_t));
+          cookieFuncs.read = readFunc;
+          cookieFuncs.close = closeFunc;
+          return fopencookie(cookie, "r", cookieFuncs);
+     #else
+          return funopen(cookie, readFunc, NULL, NULL, closeFunc);
+     #endif
+}
+
+FILE * OpenInputFile(const char *filePath, const char *fopenMode) {
+
+     if(filePath == NULL) {
+          errno = EINVAL;
+          return NULL;
+     }
+     CompressionType_t compressionType = GetCompressionType(filePath);
+     if(compressionType == COMPRESSION_NONE) {
+          return fopen(filePath, fopenMode);
+     }
+     else if(!IsSupportedCompression(compressionType)) {
+          errno = ENOTSUP;
+          return NULL;
+     }
+     else if(compressionType == COMPRESSION_GZIP) {
+          gzFile gzInput = gzopen(filePath, "rb");
+          if(gzInput == NULL) {
+               errno = errno != 0 ? errno : ENOMEM;
+               return NULL;
+          }
+          gzbuffer(gzInput, COMPRESSED_INPUT_BUFSIZE);
+          FILE *fpInput = OpenCookieStream((void *) gzInput, GzipCookieRead, GzipCookieClose);
+          if(fpInput == NULL) {
+               gzclose(gzInput);
+          }
+          return fpInput;
+     }
+     #if BUILD_WITH_ZSTD_SUPPORT > 0
+     else if(compressionType == COMPRESSION_ZSTD) {
+          FILE *fpCompressed = fopen(filePath, "rb");
+          if(fpCompressed == NULL) {
+               return NULL;
+          }
+          ZstdCookie_t *zstdCookie = new ZstdCookie_t();
+          zstdCookie->fpInput = fpCompressed;
+          zstdCookie->zstdStream = ZSTD_createDStream();
+          zstdCookie->inputBuffer.resize(ZSTD_DStreamInSize());
+          zstdCookie->inputPos.src = zstdCookie->inputBuffer.data();
+          zstdCookie->inputPos.size = zstdCookie->inputPos.pos = 0;
+          ZSTD_initDStream(zstdCookie->zstdStream);
+          FILE *fpInput = OpenCookieStream((void *) zstdCookie, ZstdCookieRead, ZstdCookieClose);
+          if(fpInput == NULL) {
+               ZstdCookieClose((void *) zstdCookie);
+          }
+          return fpInput;
+     }
+     #endif
+     errno = ENOTSUP;
+     return NULL;
+
+}
+
+InputStreamBuf_t::InputStreamBuf_t(FILE *fpInput) :
+     fpInput(fpInput), readBuffer(COMPRESSED_INPUT_BUFSIZE) {
+     setg(readBuffer.data(), readBuffer.data(), readBuffer.data());
+}
+
+InputStreamBuf_t::~InputStreamBuf_t() {
+     Close();
+}
+
+void InputStreamBuf_t::Close() {
+     if(fpInput != NULL) {
+          fclose(fpInput);
+          fpInput = NULL;
+     }
+     setg(readBuffer.data(), readBuffer.data(), readBuffer.data());
+}
+
+InputStreamBuf_t::int_type InputStreamBuf_t::underflow() {
+     if(gptr() < egptr()) {
+          return traits_type::to_int_type(*gptr());
+     }
+     else if(fpInput == NULL) {
+          return traits_type::eof();
+     }
+     size_t bytesRead = fread(readBuffer.data(), 1, readBuffer.size(), fpInput);
+     if(bytesRead == 0) {
+          return traits_type::eof();
+     }
+     setg(readBuffer.data(), readBuffer.data(), readBuffer.data() + bytesRead);
+     return traits_type::to_int_type(*gptr());
+}
+
+InputFileStream_t::InputFileStream_t(const char *filePath) :
+     std::istream(NULL), streamBuf(OpenInputFile(filePath, "r")) {
+     init(&streamBuf);
+     if(!streamBuf.IsOpen()) {
+          setstate(std::ios_base::failbit);
+     }
+}
+
+InputFileStream_t::~InputFileStream_t() {
+     close();
+}
+
+void InputFileStream_t::close() {
+     streamBuf.Close();
+}
+
+}
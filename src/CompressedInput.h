@@ -0,0 +1,88 @@
+/* CompressedInput.h : Transparent streaming decompression of the gzip (and
+ *                     optionally zstd) compressed structure files, so the
+ *                     same parsers read them without any temporary files;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#ifndef __COMPRESSED_INPUT_H__
+#define __COMPRESSED_INPUT_H__
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <streambuf>
+
+#ifndef BUILD_WITH_ZSTD_SUPPORT
+     #define BUILD_WITH_ZSTD_SUPPORT         (0)
+#endif
+
+/* The size of the buffers the compressed data is read (and inflated) in: */
+#define COMPRESSED_INPUT_BUFSIZE             (128 * 1024)
+
+namespace CompressedInput {
+
+     typedef enum {
+          COMPRESSION_NONE = 0,
+          COMPRESSION_GZIP = 1,
+          COMPRESSION_ZSTD = 2,
+     } CompressionType_t;
+
+     /* The compression of the file by its (last) extension: */
+     CompressionType_t GetCompressionTypeByExtension(const char *filePath);
+
+     /* The compression of the file by its extension, or else by the magic
+      * bytes at the start of the file: */
+     CompressionType_t GetCompressionType(const char *filePath);
+
+     /* The path without the compression extension (so the extension of
+      * the structure format is the last one, e.g., "x.ct.gz" -> "x.ct"): */
+     std::string GetUncompressedFilePath(const char *filePath);
+
+     bool IsSupportedCompression(CompressionType_t compressionType);
+
+     /* Opens the file for reading. The compressed files are returned as a
+      * stdio stream which inflates the data as it is read, so the callers
+      * use fgets/getline/fclose on it the same as for the plain files: */
+     FILE * OpenInputFile(const char *filePath, const char *fopenMode = "r");
+
+     /* A stream buffer which reads from a stdio stream: */
+     class InputStreamBuf_t : public std::streambuf {
+
+          public:
+               InputStreamBuf_t(FILE *fpInput);
+               ~InputStreamBuf_t();
+
+               inline bool IsOpen() const { return fpInput != NULL; }
+               void Close();
+
+          protected:
+               int_type underflow();
+
+          private:
+               FILE *fpInput;
+               std::vector<char> readBuffer;
+
+     };
+
+     /* A replacement for std::ifstream in the parsers which also reads the
+      * compressed files: */
+     class InputFileStream_t : public std::istream {
+
+          public:
+               InputFileStream_t(const char *filePath);
+               ~InputFileStream_t();
+
+               inline bool is_open() const { return streamBuf.IsOpen(); }
+               void close();
+
+          private:
+               InputStreamBuf_t streamBuf;
+
+     };
+
+}
+
+#endif
@@ -28,6 +28,8 @@ extern bool GUI_USE_DEFAULT_FOLDER_NAMES;
 extern bool GUI_KEEP_STICKY_FOLDER_NAMES;
 extern int  DEBUGGING_ON;
 extern bool DISPLAY_FIRSTRUN_MESSAGE;
+extern int  STATS_SLIPPAGE_TOLERANCE;
+extern bool AUTOLOAD_LAZY_PARSING;
 
 extern char rnaStructVizExecPath[MAX_BUFFER_SIZE];
 extern char runtimeCWDPath[MAX_BUFFER_SIZE];
@@ -25,7 +25,7 @@ using std::string;
 #include "CairoDrawingUtils.h"
 
 #ifndef PERFORM_BRANCH_TYPE_ID
-     #define PERFORM_BRANCH_TYPE_ID          (0)
+     #define PERFORM_BRANCH_TYPE_ID          (1)
 #endif
 
 #define MAX_BUFFER_SIZE                 (384)
@@ -40,6 +40,10 @@ using std::string;
                                         /* As a strftime format string */
 #define DEFAULT_FLTK_THEME              ("gtk+")
 #define FLTK_THEME_COUNT                (6)
+#define DEFAULT_STATS_SLIPPAGE          (1)
+                                        /* Pairs (i, j) are accepted as (i +/- k, j) or (i, j +/- k) */
+#define DEFAULT_AUTOLOAD_LAZY_PARSING   (true)
+                                        /* Defer parsing the pairs of autoloaded files until first use */
 #define USER_CONFIG_DIR                 ((string(GetUserHome()) + string("/.RNAStructViz/")).c_str())
 #define USER_AUTOLOAD_PATH              ((string(USER_CONFIG_DIR) + string("AutoLoad/")).c_str())
 #define USER_CONFIG_PATH                ((USER_CONFIG_DIR + string("config.cfg")).c_str())
@@ -124,6 +124,12 @@ int ConfigParser::parseFile(const char *userCfgFile, bool silenceErrors) {
       else if(!strcmp(parsedLine.cfgOption, "GUI_KEEP_STICKY_FOLDER_NAMES")) {
            guiKeepStickyFolderNames = !strcasecmp(parsedLine.cfgValue, "true") ? true : false;
       }
+      else if(!strcmp(parsedLine.cfgOption, "STATS_SLIPPAGE_TOLERANCE")) {
+           statsSlippageTolerance = MAX(0, atoi(parsedLine.cfgValue));
+      }
+      else if(!strcmp(parsedLine.cfgOption, "AUTOLOAD_LAZY_PARSING")) {
+           autoloadLazyParsing = !strcasecmp(parsedLine.cfgValue, "true") ? true : false;
+      }
       else if(!strncmp(parsedLine.cfgOption, "DWIN_COLORS_STRUCT", 18) && 
               strlen(parsedLine.cfgOption) == 19) {
                int structIndex = atoi(parsedLine.cfgOption + 18) - 1;
@@ -258,13 +264,25 @@ int ConfigParser::writeFile(const char *userCfgFile, bool silenceErrors) const {
            }
      }
 
+     char slippageOutputLine[MAX_BUFFER_SIZE];
+     int slippageLineLen = snprintf(slippageOutputLine, MAX_BUFFER_SIZE, "%s=%d\n", 
+                                    "STATS_SLIPPAGE_TOLERANCE", statsSlippageTolerance);
+     curLineNum++;
+     if(!fwrite(slippageOutputLine, sizeof(char), slippageLineLen, fpCfgFile)) {
+          TerminalText::PrintError("Error writing line #%d to file: %s\n", curLineNum, strerror(errno));
+          fclose(fpCfgFile);
+          return errno;
+     }
+
      const char *BOOLEAN_VALUED_CFGOPTS[] = {
           "DISPLAY_FIRSTRUN_MESSAGE",
           "GUI_KEEP_STICKY_FOLDER_NAMES",
+          "AUTOLOAD_LAZY_PARSING",
      };
      bool BOOLEAN_VALUED_CFGOPTS_VALUES[] = {
            guiDisplayFirstRunMessage,
            guiKeepStickyFolderNames,
+           autoloadLazyParsing,
      };
      int lineLen;
      char lastOutputLine[MAX_BUFFER_SIZE];
@@ -319,6 +337,8 @@ void ConfigParser::storeVariables() const {
 
      DISPLAY_FIRSTRUN_MESSAGE = guiDisplayFirstRunMessage;
      GUI_KEEP_STICKY_FOLDER_NAMES = guiKeepStickyFolderNames;
+     STATS_SLIPPAGE_TOLERANCE = statsSlippageTolerance;
+     AUTOLOAD_LAZY_PARSING = autoloadLazyParsing;
 
 } 
 
@@ -390,6 +410,7 @@ bool ConfigParser::ParseAutoloadStructuresDirectory(const char *autoloadDirPath)
         fs::directory_iterator cwdDirIter(dirPath);
         std::vector<boost::filesystem::path> sortedFilePaths(cwdDirIter, boost::filesystem::directory_iterator());
         std::sort(sortedFilePaths.begin(), sortedFilePaths.end(), FileFormatSortCmp);
+        std::vector<std::string> autoloadFilePaths;
         for(int sfileIdx = 0; sfileIdx < sortedFilePaths.size(); sfileIdx++) {
          curFilePath = sortedFilePaths[sfileIdx].filename().string();
 	     bool isSymlink = fs::symlink_status(sortedFilePaths[sfileIdx]).type() == fs::symlink_file;
@@ -405,8 +426,10 @@ bool ConfigParser::ParseAutoloadStructuresDirectory(const char *autoloadDirPath)
 	     std::string parentDir = curStructFilePath.parent_path().string();
 	     std::string fullStructFilePath = parentDir + "/" + curStructFilePath.filename().string();
 	     TerminalText::PrintDebug("(Auto)Loading structure file at path \"%s\" ... \n", fullStructFilePath.c_str());
-	     RNAStructViz::GetInstance()->GetStructureManager()->AddFile(fullStructFilePath.c_str(), false, true);
+	     autoloadFilePaths.push_back(fullStructFilePath);
         }
+        RNAStructViz::GetInstance()->GetStructureManager()->AddFiles(autoloadFilePaths, false, true, 
+		                                                          AUTOLOAD_LAZY_PARSING);
      } catch(fs::filesystem_error fse) {
           TerminalText::PrintWarning("Unable to copy autoloaded file \"%s\": %s\n (ABORTING ENTIRE OPERATION)", curFilePath.c_str(), fse.what());
      }
@@ -445,6 +468,8 @@ void ConfigParser::setDefaults() {
      
      guiDisplayFirstRunMessage = DISPLAY_FIRSTRUN_MESSAGE;
      guiKeepStickyFolderNames = GUI_KEEP_STICKY_FOLDER_NAMES;
+     statsSlippageTolerance = STATS_SLIPPAGE_TOLERANCE;
+     autoloadLazyParsing = AUTOLOAD_LAZY_PARSING;
 
 }
 
@@ -31,6 +31,8 @@ class ConfigParser {
                 int guiStructureDiagramColorsCount[3];
 		bool guiDisplayFirstRunMessage;
 		bool guiKeepStickyFolderNames;
+		int statsSlippageTolerance;
+		bool autoloadLazyParsing;
 
 	public:
 		ConfigParser(); 
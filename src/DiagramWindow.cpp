@@ -72,6 +72,7 @@ void DiagramWindow::Construct(int w, int h, const std::vector<int> &structures)
     m_drawBranchesIndicator = NULL;
     m_cbShowTicks = NULL;
     m_cbDrawBases = NULL;
+    m_cbDrawKnots = NULL;
     userConflictAlerted = false;
     showPlotTickMarks = true;
     baseColorPaletteImg = NULL;
@@ -153,6 +154,7 @@ DiagramWindow::~DiagramWindow() {
     Delete(m_drawBranchesIndicator, Fl_Check_Button);
     Delete(m_cbShowTicks, Fl_Check_Button);
     Delete(m_cbDrawBases, Fl_Check_Button);
+    Delete(m_cbDrawKnots, Fl_Check_Button);
     Delete(baseColorPaletteImg, Fl_RGB_Image);
     Delete(baseColorPaletteImgBtn, Fl_Button);
     Delete(baseColorPaletteChangeBtn, Fl_Button);
@@ -306,6 +308,9 @@ void DiagramWindow::drawWidgets(cairo_t *crDraw = NULL) {
     if(m_cbDrawBases) { 
      m_cbDrawBases->redraw();
     }
+    if(m_cbDrawKnots) { 
+     m_cbDrawKnots->redraw();
+    }
     if(baseColorPaletteImgBtn) {
      baseColorPaletteImgBtn->redraw();
     }
@@ -512,6 +517,9 @@ void DiagramWindow::RedrawBuffer(cairo_t *cr, RNAStructure **structures,
     } else if (numStructures == 3) {
         Draw3(cr, structures, resolution);
     }
+    if(m_cbDrawKnots != NULL && m_cbDrawKnots->value()) {
+        DrawPseudoknotLayer(cr, structures, numStructures, resolution);
+    }
 
     fl_font(priorFont, priorFontSize);
 }
@@ -806,7 +814,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                     fl_color(STRUCTURE_DIAGRAM_COLORS[2][0]);
                     SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][0]);
                     #if PERFORM_BRANCH_TYPE_ID
-                         SetCairoBranchColor(cr, structures[0]->GetBranchTypeAt(ui)->getBranchID(),
+                         SetCairoBranchColor(cr, structures[0]->GetBranchIDAt(ui),
                                             (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_BLACK);
                     #endif
                     DrawArc(cr, ui, baseData1->m_pair, centerX, centerY, angleBase,
@@ -815,7 +823,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                     fl_color(STRUCTURE_DIAGRAM_COLORS[2][1]);
                     SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][1]);
                     #if PERFORM_BRANCH_TYPE_ID
-                         SetCairoBranchColor(cr, structures[1]->GetBranchTypeAt(ui)->getBranchID(),
+                         SetCairoBranchColor(cr, structures[1]->GetBranchIDAt(ui),
                                             (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_YELLOW);
                     #endif
                     DrawArc(cr, ui, baseData1->m_pair, centerX, centerY, angleBase,
@@ -826,7 +834,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                         fl_color(STRUCTURE_DIAGRAM_COLORS[2][2]);
                         SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][2]);
                         #if PERFORM_BRANCH_TYPE_ID
-                             SetCairoBranchColor(cr, structures[2]->GetBranchTypeAt(ui)->getBranchID(),
+                             SetCairoBranchColor(cr, structures[2]->GetBranchIDAt(ui),
                                                  (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_BLUE);
                         #endif
                         DrawArc(cr, ui, baseData3->m_pair, centerX, centerY, angleBase,
@@ -838,7 +846,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                 fl_color(STRUCTURE_DIAGRAM_COLORS[2][3]);
                 SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][3]);
                 #if PERFORM_BRANCH_TYPE_ID
-                     SetCairoBranchColor(cr, structures[0]->GetBranchTypeAt(ui)->getBranchID(),
+                     SetCairoBranchColor(cr, structures[0]->GetBranchIDAt(ui),
                                          (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_MAGENTA);
                 #endif
                 DrawArc(cr, ui, baseData1->m_pair, centerX, centerY, angleBase,
@@ -849,7 +857,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                     fl_color(STRUCTURE_DIAGRAM_COLORS[2][4]);
                     SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][4]);
                     #if PERFORM_BRANCH_TYPE_ID
-                         SetCairoBranchColor(cr, structures[1]->GetBranchTypeAt(ui)->getBranchID(),
+                         SetCairoBranchColor(cr, structures[1]->GetBranchIDAt(ui),
                                              (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_GREEN);
                     #endif
                     DrawArc(cr, ui, baseData2->m_pair, centerX, centerY, angleBase,
@@ -860,7 +868,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                 fl_color(STRUCTURE_DIAGRAM_COLORS[2][5]);
                 SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][5]);
                 #if PERFORM_BRANCH_TYPE_ID
-                     SetCairoBranchColor(cr, structures[2]->GetBranchTypeAt(ui)->getBranchID(),
+                     SetCairoBranchColor(cr, structures[2]->GetBranchIDAt(ui),
                                          (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_RED);
                 #endif
                 DrawArc(cr, ui, baseData1->m_pair, centerX, centerY, angleBase,
@@ -872,7 +880,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                         fl_color(STRUCTURE_DIAGRAM_COLORS[2][6]);
                         SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][6]);
                         #if PERFORM_BRANCH_TYPE_ID
-                             SetCairoBranchColor(cr, structures[1]->GetBranchTypeAt(ui)->getBranchID(),
+                             SetCairoBranchColor(cr, structures[1]->GetBranchIDAt(ui),
                                                  (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_CYAN);
                         #endif
                         DrawArc(cr, ui, baseData2->m_pair, centerX, centerY, angleBase,
@@ -881,8 +889,8 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                         fl_color(STRUCTURE_DIAGRAM_COLORS[2][4]);
                         SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][4]);
                         #if PERFORM_BRANCH_TYPE_ID
-                             SetCairoBranchColor(cr, structures[2]->GetBranchTypeAt(ui)->getBranchID(),
-                                                 (int) m_drawBranchesIndicator->value(), CairoColoDrawBasesCR_GREEN);
+                             SetCairoBranchColor(cr, structures[2]->GetBranchIDAt(ui),
+                                                 (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_GREEN);
                         #endif
                         DrawArc(cr, ui, baseData2->m_pair, centerX, centerY, angleBase,
                                 angleDelta, radius);
@@ -892,7 +900,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                             fl_color(STRUCTURE_DIAGRAM_COLORS[2][2]);
                             SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][2]);
                             #if PERFORM_BRANCH_TYPE_ID
-                                 SetCairoBranchColor(cr, structures[2]->GetBranchTypeAt(ui)->getBranchID(),
+                                 SetCairoBranchColor(cr, structures[2]->GetBranchIDAt(ui),
                                                      (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_BLUE);
                             #endif
                             DrawArc(cr, ui, baseData3->m_pair, centerX, centerY, angleBase,
@@ -904,7 +912,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                     fl_color(STRUCTURE_DIAGRAM_COLORS[2][2]);
                     SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][2]);
                     #if PERFORM_BRANCH_TYPE_ID
-                         SetCairoBranchColor(cr, structures[2]->GetBranchTypeAt(ui)->getBranchID(),
+                         SetCairoBranchColor(cr, structures[2]->GetBranchIDAt(ui),
                                              (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_BLUE);
                     #endif
                     DrawArc(cr, ui, baseData3->m_pair, centerX, centerY, angleBase,
@@ -917,7 +925,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                 fl_color(STRUCTURE_DIAGRAM_COLORS[2][6]);
                 SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][6]);
                 #if PERFORM_BRANCH_TYPE_ID
-                     SetCairoBranchColor(cr, structures[1]->GetBranchTypeAt(ui)->getBranchID(),
+                     SetCairoBranchColor(cr, structures[1]->GetBranchIDAt(ui),
                                          (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_CYAN);
                 #endif
                 DrawArc(cr, ui, baseData2->m_pair, centerX, centerY, angleBase,
@@ -926,7 +934,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                 fl_color(STRUCTURE_DIAGRAM_COLORS[2][4]);
                 SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][4]);
                 #if PERFORM_BRANCH_TYPE_ID
-                     SetCairoBranchColor(cr, structures[1]->GetBranchTypeAt(ui)->getBranchID(),
+                     SetCairoBranchColor(cr, structures[1]->GetBranchIDAt(ui),
                                          (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_GREEN);
                 #endif
                 DrawArc(cr, ui, baseData2->m_pair, centerX, centerY, angleBase,
@@ -937,7 +945,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
                     fl_color(STRUCTURE_DIAGRAM_COLORS[2][2]);
             SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][2]);
                     #if PERFORM_BRANCH_TYPE_ID
-            SetCairoBranchColor(cr, structures[2]->GetBranchTypeAt(ui)->getBranchID(),
+            SetCairoBranchColor(cr, structures[2]->GetBranchIDAt(ui),
                                         (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_BLUE);
                     #endif
             DrawArc(cr, ui, baseData3->m_pair, centerX, centerY, angleBase,
@@ -949,7 +957,7 @@ void DiagramWindow::Draw3(cairo_t *cr, RNAStructure **structures, const int reso
             fl_color(STRUCTURE_DIAGRAM_COLORS[2][2]);
             SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[2][2]);
             #if PERFORM_BRANCH_TYPE_ID
-                 SetCairoBranchColor(cr, structures[2]->GetBranchTypeAt(ui)->getBranchID(),
+                 SetCairoBranchColor(cr, structures[2]->GetBranchIDAt(ui),
                                      (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_BLUE);
             #endif
             DrawArc(cr, ui, baseData3->m_pair, centerX, centerY, angleBase,
@@ -984,7 +992,7 @@ void DiagramWindow::Draw2(cairo_t *cr, RNAStructure **structures, const int reso
                 fl_color(STRUCTURE_DIAGRAM_COLORS[1][0]);
                 SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[1][0]);
                 #if PERFORM_BRANCH_TYPE_ID
-                     SetCairoBranchColor(cr, structures[0]->GetBranchTypeAt(ui)->getBranchID(),
+                     SetCairoBranchColor(cr, structures[0]->GetBranchIDAt(ui),
                                          (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_BLACK);
                 #endif
                 DrawArc(cr, ui, baseData1->m_pair, centerX, centerY, angleBase,
@@ -993,7 +1001,7 @@ void DiagramWindow::Draw2(cairo_t *cr, RNAStructure **structures, const int reso
                 fl_color(STRUCTURE_DIAGRAM_COLORS[1][1]);
                 SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[1][1]);
                 #if PERFORM_BRANCH_TYPE_ID
-                     SetCairoBranchColor(cr, structures[1]->GetBranchTypeAt(ui)->getBranchID(),
+                     SetCairoBranchColor(cr, structures[1]->GetBranchIDAt(ui),
                                          (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_RED);
                 #endif
                 DrawArc(cr, ui, baseData1->m_pair, centerX, centerY, angleBase,
@@ -1004,7 +1012,7 @@ void DiagramWindow::Draw2(cairo_t *cr, RNAStructure **structures, const int reso
                     fl_color(STRUCTURE_DIAGRAM_COLORS[1][2]);
                     SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[1][2]);
                     #if PERFORM_BRANCH_TYPE_ID
-                         SetCairoBranchColor(cr, structures[1]->GetBranchTypeAt(ui)->getBranchID(),
+                         SetCairoBranchColor(cr, structures[1]->GetBranchIDAt(ui),
                                              (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_GREEN);
                     #endif
                      DrawArc(cr, ui, baseData2->m_pair, centerX, centerY, angleBase,
@@ -1016,7 +1024,7 @@ void DiagramWindow::Draw2(cairo_t *cr, RNAStructure **structures, const int reso
             fl_color(STRUCTURE_DIAGRAM_COLORS[1][2]);
             SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[1][2]);
             #if PERFORM_BRANCH_TYPE_ID
-                 SetCairoBranchColor(cr, structures[1]->GetBranchTypeAt(ui)->getBranchID(),
+                 SetCairoBranchColor(cr, structures[1]->GetBranchIDAt(ui),
                                      (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_GREEN);
             #endif
             DrawArc(cr, ui, baseData2->m_pair, centerX, centerY, angleBase,
@@ -1049,7 +1057,7 @@ void DiagramWindow::Draw1(cairo_t *cr, RNAStructure **structures, const int reso
             fl_color(STRUCTURE_DIAGRAM_COLORS[0][0]);
             SetCairoToFLColor(cr, STRUCTURE_DIAGRAM_COLORS[0][0]);
             #if PERFORM_BRANCH_TYPE_ID
-                 SetCairoBranchColor(cr, structures[0]->GetBranchTypeAt(ui)->getBranchID(),
+                 SetCairoBranchColor(cr, structures[0]->GetBranchIDAt(ui),
                                      (int) m_drawBranchesIndicator->value(), CairoColorSpec_t::CR_BLACK);
             #endif
             DrawArc(cr, ui, baseData1->m_pair, centerX, centerY, angleBase,
@@ -1059,6 +1067,44 @@ void DiagramWindow::Draw1(cairo_t *cr, RNAStructure **structures, const int reso
     }
 }
 
+void DiagramWindow::DrawPseudoknotLayer(cairo_t *cr, RNAStructure **structures, 
+		                        const int numStructures, const int resolution) {
+    float centerX = 0.0f;
+    float centerY = 0.0f;
+    float angleBase = 0.0f;
+    float angleDelta = 0.0f;
+    float radius = 0.0f;
+
+    unsigned int numBases = structures[0]->GetLength();
+    ComputeDiagramParams(numBases, resolution, centerX, centerY, angleBase,
+                         angleDelta, radius);
+
+    const CairoColorSpec_t pkLayerColors[] = { 
+         CairoColorSpec_t::CR_DARK_RED, 
+         CairoColorSpec_t::CR_DEEP_BLUE, 
+         CairoColorSpec_t::CR_MEDIUM_GREEN,
+    };
+    const double pkDashPattern[] = { 4.0, 3.0 };
+    cairo_save(cr);
+    cairo_set_dash(cr, pkDashPattern, 2, 0.0);
+    for (int s = 0; s < numStructures; s++) {
+        if (structures[s] == NULL || !structures[s]->IsPseudoknotted()) {
+            continue;
+        }
+        SetCairoColor(cr, pkLayerColors[s % 3], true);
+        for (unsigned int ui = 0; ui < numBases; ++ui) {
+            const RNAStructure::BaseData *baseData = structures[s]->GetBaseAt(ui);
+            if (baseData->m_pair == RNAStructure::UNPAIRED || baseData->m_pair < ui || 
+                structures[s]->GetPseudoknotPageAt(ui) == 0) {
+                continue;
+            }
+            DrawArc(cr, ui, baseData->m_pair, centerX, centerY, angleBase,
+                    angleDelta, radius);
+        }
+    }
+    cairo_restore(cr);
+}
+
 void DiagramWindow::ComputeNumPairs(RNAStructure **structures,
                                     int numStructures) {
 
@@ -1514,6 +1560,19 @@ void DiagramWindow::RebuildMenus() {
               m_cbDrawBases->selection_color(GUI_TEXT_COLOR); // checkmark color
               m_cbDrawBases->value(0);
               m_cbDrawBases->tooltip("Draw selected bases from the sequence around the bounding circle");
+              offsetY += 25;
+              
+              m_cbDrawKnots = new Fl_Check_Button(horizCheckBoxPos + 4, offsetY, 
+                                                  EXPORT_BUTTON_WIDTH, 25, 
+                                                  "Draw Knots");
+              m_cbDrawKnots->callback(DrawKnotsCallback);
+              m_cbDrawKnots->type(FL_TOGGLE_BUTTON);
+              m_cbDrawKnots->labelcolor(GUI_BTEXT_COLOR);
+              m_cbDrawKnots->labelfont(FL_HELVETICA);
+              m_cbDrawKnots->labelsize(12);
+              m_cbDrawKnots->selection_color(GUI_TEXT_COLOR); // checkmark color
+              m_cbDrawKnots->value(0);
+              m_cbDrawKnots->tooltip("Highlight the pseudoknotted (crossing) pairs in a separate dashed layer");
      	      offsetY += 35;
      
               baseColorPaletteImg = new Fl_RGB_Image(
@@ -1753,12 +1812,12 @@ int DiagramWindow::handle(int flEvent) {
                             }
                             StructureManager *structManager = RNAStructViz::GetInstance()->GetStructureManager();
                             int ctFileSelectIndex = ctFileSelectWin->getFileSelectionIndex();
-			    int structIdx = structManager->GetFolderAt(folderIndex)->
+			    StructureHandle_t structHandle = structManager->GetFolderAt(folderIndex)->
                                                                 folderStructs[ctFileSelectIndex];
-                            RNAStructure *rnaStruct = structManager->GetStructure(structIdx);
-                            const char *rnaSeqStr = rnaStruct->GetSequenceString();
+                            RNAStructure *rnaStruct = structManager->GetStructure(structHandle);
                             size_t seqStartPos = (zoomBufferMinArcIndex > 0) ? zoomBufferMinArcIndex - 1 : 0;
                             size_t seqEndPos = (zoomBufferMaxArcIndex > 0) ? zoomBufferMaxArcIndex - 1 : MAX_SIZET;
+                            seqEndPos = MIN(seqEndPos, rnaStruct->GetLength() - 1);
                             // we have to include all pairs of the clipped / highlighted radial view (increase as needed):
                             size_t nextStartPos = seqStartPos, nextEndPos = seqEndPos;
                             for(int pos = seqStartPos; pos <= seqEndPos; pos++) {
@@ -1770,19 +1829,6 @@ int DiagramWindow::handle(int flEvent) {
                             }
                             seqStartPos = nextStartPos;
                             seqEndPos = nextEndPos;
-                            if(seqEndPos - seqStartPos + 1 > RadialLayoutDisplayWindow::MAX_SEQUENCE_DISPLAY_LENGTH) {
-                                      char numericBuf[MAX_BUFFER_SIZE];
-                                      snprintf(numericBuf, MAX_BUFFER_SIZE, "%d\0", 
-                                      RadialLayoutDisplayWindow::MAX_SEQUENCE_DISPLAY_LENGTH);
-                                      string errMsg = string("DISABLED FEATURE: We only support radial layout ") + 
-                                                                          string("for sequences <= ") + string(numericBuf) + 
-                                                                          string(" bases (currently ") + 
-                                                                          std::to_string(seqStartPos) + 
-                                                                          string(" to ") + std::to_string(seqEndPos) + 
-                                                                          string(")."); 
-                                      AddNewErrorMessageToDisplay(errMsg);
-                                      return 1;
-                            }
                             radialDisplayWindow = new RadialLayoutDisplayWindow();
                             radialDisplayWindow->SetTitleFormat(
                                                          "Radial Display for %s -- Highlighting Bases #%d to #%d", 
@@ -1792,7 +1838,7 @@ int DiagramWindow::handle(int flEvent) {
 	                    );
                             radialDisplayWindow->SetStructureFolderName(structManager->GetFolderAt(folderIndex)->folderName);
                             radialDisplayWindow->SetParentWindow(this);
-                            radialDisplayWindow->DisplayRadialDiagram(rnaSeqStr, seqStartPos, seqEndPos, rnaStruct->GetLength());
+                            radialDisplayWindow->DisplayRadialDiagram(rnaStruct, seqStartPos, seqEndPos);
                             radialDisplayWindow->show();
                      }
                      return 1;
@@ -2102,6 +2148,12 @@ void DiagramWindow::DrawBasesCallback(Fl_Widget *cbw, void *udata) {
      dwin->redraw();
 }
 
+void DiagramWindow::DrawKnotsCallback(Fl_Widget *cbw, void *udata) {
+     DiagramWindow *dwin = (DiagramWindow *) cbw->parent();
+     dwin->m_redrawStructures = true;
+     dwin->redraw();
+}
+
 void DiagramWindow::WarnUserDrawingConflict() {
     if (!userConflictAlerted && m_drawBranchesIndicator != NULL && m_drawBranchesIndicator->value()) {
         fl_message_title("User Warning ... ");
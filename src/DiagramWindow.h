@@ -168,6 +168,11 @@ private:
     void Draw2(cairo_t *cr, RNAStructure** structures, const int resolution); // 2 structures
     void Draw1(cairo_t *cr, RNAStructure** structures, const int resolution); // 1 structure
     
+    /* Redraws the pseudoknotted arcs (pairs off the primary page) of each 
+       structure as a separate dashed layer on top of the others */
+    void DrawPseudoknotLayer(cairo_t *cr, RNAStructure** structures, 
+		             const int numStructures, const int resolution);
+    
     /* Computes the numbers for the base pairs, updates the counters in the 
        legend */
     void ComputeNumPairs(RNAStructure** structures, int numStructures);
@@ -226,7 +231,7 @@ private:
 
     Fl_Choice* m_menus[3];
     Fl_Check_Button *m_drawBranchesIndicator;
-    Fl_Check_Button *m_cbShowTicks, *m_cbDrawBases;
+    Fl_Check_Button *m_cbShowTicks, *m_cbDrawBases, *m_cbDrawKnots;
     Fl_Button *exportButton;
     Fl_RGB_Image *baseColorPaletteImg;
     Fl_Button *baseColorPaletteImgBtn, *baseColorPaletteChangeBtn;
@@ -268,6 +273,7 @@ private:
     
     static void ShowTickMarksCallback(Fl_Widget *cbw, void *udata);
     static void DrawBasesCallback(Fl_Widget *cbw, void *udata);
+    static void DrawKnotsCallback(Fl_Widget *cbw, void *udata);
 
     void WarnUserDrawingConflict();
     std::string GetExportPNGFilePath();
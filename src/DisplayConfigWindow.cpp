@@ -77,6 +77,8 @@
      bool GUI_KEEP_STICKY_FOLDER_NAMES;
      int  DEBUGGING_ON;
      bool DISPLAY_FIRSTRUN_MESSAGE;
+     int  STATS_SLIPPAGE_TOLERANCE;
+     bool AUTOLOAD_LAZY_PARSING;
 
 #endif
 
@@ -142,6 +144,8 @@ bool DisplayConfigWindow::SetupInitialConfig() {
      GUI_KEEP_STICKY_FOLDER_NAMES = false;
      DEBUGGING_ON = 0;
      DISPLAY_FIRSTRUN_MESSAGE = true;
+     STATS_SLIPPAGE_TOLERANCE = DEFAULT_STATS_SLIPPAGE;
+     AUTOLOAD_LAZY_PARSING = DEFAULT_AUTOLOAD_LAZY_PARSING;
 
      ConfigParser cfgParser(USER_CONFIG_PATH, !DEBUGGING_ON);
      cfgParser.storeVariables();      
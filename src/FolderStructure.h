@@ -3,6 +3,8 @@
 
 #include <string.h>
 
+#include <vector>
+
 #include <FL/Fl_Button.H>
 
 #include "MainWindow.h"
@@ -11,6 +13,7 @@
 #include "ConfigOptions.h"
 #include "ConfigExterns.h"
 #include "BaseSequenceIDs.h"
+#include "StructureSlotMap.h"
 
 #define DEFAULT_FOLDER_NAME_BUFSIZE        (64)
 #define DEFAULT_FOLDER_NAME_LBLSIZE        (72)
@@ -23,16 +26,11 @@
 class Folder {
 
   public:
-    inline Folder() : folderName(NULL), folderNameFileCount(NULL), folderStructs(NULL), 
-	              structCount(NULL), selected(false), fileType(FILETYPE_NONE), 
-		      capacity(2 * DEFAULT_FOLDER_NAME_BUFSIZE), folderWindow(NULL), 
-		      mainWindowFolderBtn(NULL), navUpBtn(NULL), navDownBtn(NULL), 
-		      navCloseBtn(NULL), 
-		      doWidgetDeletion(true) {
-        folderStructs = (int *) malloc(capacity * sizeof(int));
-        for(int fsi = 0; fsi < capacity; fsi++) {
-	     folderStructs[fsi] = -1;
-	}
+    inline Folder() : folderName(NULL), folderNameFileCount(NULL), 
+	              selected(false), fileType(FILETYPE_NONE), sequenceFingerprint(0), 
+		      folderIndex(-1), folderWindow(NULL), guiPackingContainerRef(NULL), 
+		      guiPackingGroup(NULL), mainWindowFolderBtn(NULL), navUpBtn(NULL), navDownBtn(NULL), 
+		      navCloseBtn(NULL), navExportBtn(NULL), doWidgetDeletion(true) {
 	tooltipText[0] = '\0';
     }
     
@@ -43,7 +41,6 @@ class Folder {
 	    mainWindowFolderBtn->tooltip("");
 	}*/
 	Free(folderNameFileCount);
-        Free(folderStructs); 
         if(doWidgetDeletion) {
 	     DeleteGUIWidgetData();
 	     //if(folderWindow != NULL) {
@@ -51,7 +48,6 @@ class Folder {
 	     //}
 	     //Delete(folderWindow, FolderWindow);
 	}
-	structCount = 0;
         selected = false;
     }
 
@@ -78,6 +74,7 @@ class Folder {
 	 Folder::WaitForHiddenWidget(navUpBtn);
 	 Folder::WaitForHiddenWidget(navDownBtn);
 	 Folder::WaitForHiddenWidget(navCloseBtn);
+	 Folder::WaitForHiddenWidget(navExportBtn);
     }
 
     inline void DeleteGUIWidgetData() {
@@ -96,7 +93,8 @@ class Folder {
 	 Delete(guiPackingGroup, Fl_Group);
     }
 
-    static Folder * AddNewFolderFromData(const RNAStructure *structure, const int index, bool isSelected = false) {
+    static Folder * AddNewFolderFromData(const RNAStructure *structure, const StructureHandle_t &handle, 
+		                         bool isSelected = false) {
          Folder *nextFolder = new Folder();
 	 nextFolder->folderName = (char *) malloc(DEFAULT_FOLDER_NAME_BUFSIZE * sizeof(char));
 	 nextFolder->fileType = ClassifyInputFileType(structure->GetFilename());
@@ -108,8 +106,7 @@ class Folder {
               nextFolder->folderName[DEFAULT_FOLDER_NAME_BUFSIZE - 4] = '\0';
          }
          nextFolder->folderNameFileCount = (char *) malloc(DEFAULT_FOLDER_NAME_LBLSIZE * sizeof(char));
-	 nextFolder->folderStructs[0] = index;
-         nextFolder->structCount = 1;
+	 nextFolder->AddStructure(handle);
 	 nextFolder->CreateFolderGUIElements();
 	 nextFolder->SetFolderLabel();
 	 nextFolder->SetTooltipTextData();
@@ -119,17 +116,38 @@ class Folder {
 
     }
 
-    inline void AddStructToFolderByIndex(int index) {
-         if(structCount >= capacity) {
-	      folderStructs = (int *) realloc(folderStructs, 2 * capacity);
-	      capacity *= 2;
+    inline void AddStructure(const StructureHandle_t &handle) {
+         folderStructs.push_back(handle);
+    }
+
+    /* Drops the structure in that slot from the folder (keeping the order of 
+     * the others), and returns whether the folder had it: */
+    inline bool RemoveStructure(int slotIndex) {
+         for(unsigned int fsi = 0; fsi < folderStructs.size(); fsi++) {
+	      if(folderStructs[fsi].slotIndex == slotIndex) {
+	           folderStructs.erase(folderStructs.begin() + fsi);
+		   return true;
+	      }
+	 }
+	 return false;
+    }
+
+    /* The structures in the folder which are still loaded (in the folder 
+     * order). A stale handle (to a structure removed behind the folder's 
+     * back) is skipped rather than resolved to a newer structure in its slot: */
+    inline void CollectStructures(const StructureSlotMap_t &structSlots, 
+		                  std::vector<RNAStructure *> &liveStructs) const {
+         for(unsigned int fsi = 0; fsi < folderStructs.size(); fsi++) {
+	      RNAStructure *rnaStruct = structSlots.Get(folderStructs[fsi]);
+	      if(rnaStruct != NULL) {
+	           liveStructs.push_back(rnaStruct);
+	      }
 	 }
-	 folderStructs[structCount++] = index;
     }
 
     inline void SetFolderLabel() {
          sprintf(folderNameFileCount, Folder::folderLabelFmt,
-                 structCount, folderName,
+                 (int) GetSize(), folderName,
                  strlen(folderName) > FOLDER_LABEL_TRUNC_LENGTH ? "..." : "");
 	 if(mainWindowFolderBtn != NULL) {
 	      mainWindowFolderBtn->copy_label(folderNameFileCount);
@@ -137,7 +155,7 @@ class Folder {
     }
 
     inline void SetTooltipTextData() {
-         snprintf(tooltipText, MAX_BUFFER_SIZE - 1, Folder::tooltipTextFmt, folderName, structCount);
+         snprintf(tooltipText, MAX_BUFFER_SIZE - 1, Folder::tooltipTextFmt, folderName, (int) GetSize());
 	 if(mainWindowFolderBtn != NULL) {
 	      mainWindowFolderBtn->copy_tooltip(tooltipText);
 	 }
@@ -165,7 +183,7 @@ class Folder {
 	 pack->hide();
 	 pack->begin();
 	 guiPackingGroup = new Fl_Group(pack->x() + x, pack->y() + y, pack->w(), FOLDER_WIDGET_HEIGHT);
-	 mainWindowFolderBtn = new Fl_Button(pack->x() + x + 8, pack->y() + y, pack->w() - 70, FOLDER_WIDGET_HEIGHT, "");
+	 mainWindowFolderBtn = new Fl_Button(pack->x() + x + 8, pack->y() + y, pack->w() - 90, FOLDER_WIDGET_HEIGHT, "");
 	 mainWindowFolderBtn->align(FL_ALIGN_CENTER | FL_ALIGN_INSIDE | FL_ALIGN_LEFT);
 	 mainWindowFolderBtn->callback(MainWindow::ShowFolderCallback);
 	 mainWindowFolderBtn->user_data((void *) folderName);
@@ -173,6 +191,12 @@ class Folder {
 	 mainWindowFolderBtn->labelsize(10);
 	 mainWindowFolderBtn->labelfont(FL_HELVETICA_BOLD_ITALIC);
 	 mainWindowFolderBtn->box(FL_UP_BOX);
+         navExportBtn = new Fl_Button(pack->x() + x + pack->w() - 78, pack->y() + y + 5, 
+			              FOLDER_ACTION_BUTTON_SIZE, FOLDER_ACTION_BUTTON_SIZE, Folder::navExportBtnLabel);
+	 navExportBtn->tooltip("Export all of the structures in the folder to one file");
+	 navExportBtn->labelcolor(Darker(GUI_BTEXT_COLOR, 0.50));
+	 navExportBtn->box(FL_PLASTIC_UP_BOX);
+	 navExportBtn->callback(MainWindow::ExportFolderCallback);
          navUpBtn = new Fl_Button(pack->x() + x + pack->w() - 58, pack->y() + y + 5, 
 			          FOLDER_ACTION_BUTTON_SIZE, FOLDER_ACTION_BUTTON_SIZE, Folder::navUpBtnLabel);
 	 navUpBtn->tooltip("Move folder up in list");
@@ -202,12 +226,19 @@ class Folder {
     /* Folder data accounting fields: */
     char *folderName;
     char *folderNameFileCount;
-    int  *folderStructs;
-    int  capacity;
-    int  structCount;
+    /* The handles of the structures in the folder, packed in the folder order: */
+    std::vector<StructureHandle_t> folderStructs;
     bool selected;
     InputFileTypeSpec fileType;
 
+    /* Fingerprint of the base sequence shared by the structures in the folder
+     * (see StructureManager::SequenceFingerprint): */
+    uint64_t sequenceFingerprint;
+
+    /* The position of the folder in StructureManager::folders (kept current 
+     * by StructureManager::AddFolder and RemoveFolder): */
+    int folderIndex;
+
     /* Reference to main parent structure: */ 
     FolderWindow *folderWindow;
     
@@ -215,7 +246,7 @@ class Folder {
     Fl_Pack   *guiPackingContainerRef;
     Fl_Group  *guiPackingGroup;
     Fl_Button *mainWindowFolderBtn;
-    Fl_Button *navUpBtn, *navDownBtn, *navCloseBtn;
+    Fl_Button *navUpBtn, *navDownBtn, *navCloseBtn, *navExportBtn;
 
   protected:
     bool doWidgetDeletion;
@@ -234,6 +265,7 @@ class Folder {
     inline static const char *navUpBtnLabel = "@8>";
     inline static const char *navDownBtnLabel = "@2>";
     inline static const char *navCloseBtnLabel = "@1+";
+    inline static const char *navExportBtnLabel = "@filesave";
 
     bool operator==(Fl_Widget *widgetLabelToCmp) {
         if(widgetLabelToCmp == NULL) {
@@ -268,6 +300,7 @@ class Folder {
 	 NAVUP_BUTTON      = 3, 
 	 NAVDOWN_BUTTON    = 4,
 	 NAVCLOSE_BUTTON   = 5,
+	 NAVEXPORT_BUTTON  = 6,
     } WidgetAccessorIndexType_t;
 
     Fl_Widget* GetGUIWidgetByIndexType(WidgetAccessorIndexType_t widgetIndex) {
@@ -284,6 +317,8 @@ class Folder {
 		   return navDownBtn;
 	      case NAVCLOSE_BUTTON:
 		   return navCloseBtn;
+	      case NAVEXPORT_BUTTON:
+		   return navExportBtn;
 	      default:
 		   break;
 	 }
@@ -296,11 +331,11 @@ class Folder {
     }
 
     inline unsigned int GetSize() const {
-	 return structCount;
+	 return folderStructs.size();
     }
 
     inline bool IsEmpty() const {
-	 return structCount == 0;
+	 return folderStructs.empty();
     }
     
     inline bool IsFASTAFormatOnly() const {
@@ -147,16 +147,14 @@ void FolderWindow::SetStructures(int folderIndex) {
     StructureManager* structureManager = RNAStructViz::GetInstance()->GetStructureManager();
     Folder* folder = structureManager->GetFolderAt(folderIndex);
     m_folderIndex = folderIndex;
-    int shift = 0;
-    for(int ui = 0; ui < folder->structCount; ui++)
+    for(unsigned int ui = 0; ui < folder->folderStructs.size(); ui++)
     {
-        if(folder->folderStructs[(ui+shift)] == -1)
+        RNAStructure *strct = structureManager->GetStructure(folder->folderStructs[ui]);
+        if(strct == NULL)
         {
-            shift++;
+            continue;
         }
-        int i = folder->folderStructs[(ui+shift)];
-        RNAStructure *strct = structureManager->GetStructure(i);
-	AddStructure(strct->GetPathname(), i);
+	AddStructure(strct->GetPathname(), folder->folderStructs[ui].slotIndex);
     }
     char structLabel[MAX_BUFFER_SIZE];
     snprintf(structLabel, MAX_BUFFER_SIZE - 1, "%s%s", STRUCT_PANE_LABEL_PREFIX, folder->folderName);
@@ -236,10 +234,16 @@ void FolderWindow::RemoveCallback(Fl_Widget* widget, void* userData)
             fwindow->folderScroll->redraw();
             
             Folder *folder = appInstance->GetStructureManager()->GetFolderAt(fwindow->m_folderIndex);
-	    if(folder != NULL && folder->structCount > 1) {
+	    if(folder != NULL && folder->GetSize() > 1) {
 	         appInstance->GetStructureManager()->RemoveStructure(userDataIdx);
+		 folder->SetTooltipTextData();
+		 folder->SetFolderLabel();
+		 Fl::redraw();
+	    }
+	    else {
+	         // The last structure is removed along with its folder:
+	         MainWindow::RemoveFolderByIndex(fwindow->m_folderIndex);
 	    }
-	    appInstance->GetStructureManager()->DecreaseStructCount(fwindow->m_folderIndex);
 	    break;
         }
     }	    
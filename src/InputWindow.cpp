@@ -138,7 +138,7 @@ InputWindow::InputWindow(int w, int h, const char *label,
 
         StructureManager *structManager = RNAStructViz::GetInstance()->GetStructureManager();
         Folder *curFolder = structManager->GetFolderAt(folderIndex);
-        for(int s = 0; s < curFolder->structCount; s++) { 
+        for(unsigned int s = 0; s < curFolder->folderStructs.size(); s++) { 
                  RNAStructure *rnaStruct = structManager->GetStructure(curFolder->folderStructs[s]);
                  const char *ctFileName = rnaStruct->GetFilename();
                  ctFileChooser->add(ctFileName);
@@ -235,11 +235,11 @@ std::string InputWindow::ExtractStructureNameFromFile(const char *seqFilePath, I
                               LookupStructureByCTPath(seqFilePath);
     
     // see if there is a sticky folder name already saved to display:
-    off_t stickyFolderExists = FolderNameForSequenceExists(
+    size_t stickyFolderExists = FolderNameForSequenceExists(
                     DEFAULT_STICKY_FOLDERNAME_CFGFILE,
                     rnaStruct
           );
-    if(stickyFolderExists != LSEEK_NOT_FOUND) {
+    if(stickyFolderExists != STICKY_ENTRY_NOT_FOUND) {
          char *stickyFolderName = LookupStickyFolderNameForSequence(
                        DEFAULT_STICKY_FOLDERNAME_CFGFILE,
                        stickyFolderExists
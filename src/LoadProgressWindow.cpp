@@ -0,0 +1,90 @@
+/* LoadProgressWindow.cpp : Implementation of the load progress indicator window;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdio.h>
+
+#include <FL/Fl.H>
+
+#include "LoadProgressWindow.h"
+#include "ThemesConfig.h"
+
+LoadProgressWindow::LoadProgressWindow(const char *title, int totalItems, bool cancelable, 
+		                       bool modalWindow) : 
+     Fl_Window(LOAD_PROGRESS_WINDOW_WIDTH, 
+	       LOAD_PROGRESS_WINDOW_HEIGHT + (cancelable ? LOAD_PROGRESS_CANCEL_BTN_HEIGHT : 0), 
+	       title), 
+     itemNameBox(NULL), progressBar(NULL), cancelButton(NULL), cancelRequested(false), 
+     totalItemCount(MAX(1, totalItems)) {
+
+     progressLabel[0] = '\0';
+     copy_label(title);
+     color(GUI_WINDOW_BGCOLOR);
+     begin();
+     itemNameBox = new Fl_Box(10, 8, w() - 20, 24, "");
+     itemNameBox->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE | FL_ALIGN_CLIP);
+     itemNameBox->labelcolor(GUI_TEXT_COLOR);
+     itemNameBox->labelsize(12);
+     progressBar = new Fl_Progress(10, 40, w() - 20, 26, "");
+     progressBar->minimum(0.0);
+     progressBar->maximum((float) totalItemCount);
+     progressBar->value(0.0);
+     progressBar->color(GUI_BGCOLOR);
+     progressBar->selection_color(Lighter(GUI_BTEXT_COLOR, 0.5f));
+     progressBar->labelcolor(GUI_TEXT_COLOR);
+     if(cancelable) {
+          cancelButton = new Fl_Button(w() - 110, LOAD_PROGRESS_WINDOW_HEIGHT - 4, 100, 26, "Cancel");
+	  cancelButton->color(GUI_BGCOLOR);
+	  cancelButton->labelcolor(GUI_BTEXT_COLOR);
+	  cancelButton->user_data((void *) this);
+	  cancelButton->callback(CancelButtonCallback);
+     }
+     end();
+     if(modalWindow) {
+          set_modal();
+     }
+     else {
+          set_non_modal();
+     }
+     show();
+     Fl::check();
+
+}
+
+LoadProgressWindow::~LoadProgressWindow() {
+     hide();
+     // The box and progress bar are deleted with the window's children
+}
+
+void LoadProgressWindow::SetProgress(int numDone, const char *curItemName) {
+     UpdateProgressBar(numDone);
+     if(curItemName != NULL) {
+          itemNameBox->copy_label(curItemName);
+     }
+     Fl::check();
+}
+
+void LoadProgressWindow::SetProgressNoEvents(int numDone) {
+     UpdateProgressBar(numDone);
+     Fl::flush();
+}
+
+void LoadProgressWindow::UpdateProgressBar(int numDone) {
+     numDone = MIN(MAX(0, numDone), totalItemCount);
+     snprintf(progressLabel, MAX_BUFFER_SIZE, "%d / %d", numDone, totalItemCount);
+     progressBar->value((float) numDone);
+     progressBar->copy_label(progressLabel);
+}
+
+void LoadProgressWindow::SetTotalItems(int totalItems) {
+     totalItemCount = MAX(1, totalItems);
+     progressBar->maximum((float) totalItemCount);
+}
+
+void LoadProgressWindow::CancelButtonCallback(Fl_Widget *btn, void *udata) {
+     LoadProgressWindow *progressWin = (LoadProgressWindow *) udata;
+     progressWin->cancelRequested = true;
+     btn->deactivate();
+     btn->copy_label("Cancelling ...");
+}
@@ -0,0 +1,69 @@
+/* LoadProgressWindow.h : A small window with a progress bar shown while batches
+ *                        of structure files are parsed and loaded (or other
+ *                        long running jobs complete);
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#ifndef __LOAD_PROGRESS_WINDOW_H__
+#define __LOAD_PROGRESS_WINDOW_H__
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <FL/Enumerations.H>
+#include <FL/Fl_Window.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Progress.H>
+#include <FL/Fl_Button.H>
+
+#include "ConfigOptions.h"
+#include "ConfigExterns.h"
+
+#define LOAD_PROGRESS_WINDOW_WIDTH         (420)
+#define LOAD_PROGRESS_WINDOW_HEIGHT        (80)
+#define LOAD_PROGRESS_CANCEL_BTN_HEIGHT    (34)
+
+class LoadProgressWindow : public Fl_Window {
+
+     public:
+	  /* A modal window blocks the other windows (and their callbacks) until
+	   * it is deleted, for jobs which must finish before anything else runs:
+	   */
+          LoadProgressWindow(const char *title, int totalItems, bool cancelable = false, 
+			     bool modalWindow = false);
+          ~LoadProgressWindow();
+
+	  /* Marks the first numDone items as finished and shows the name of
+	   * the item currently being processed (the label is copied):
+	   */
+	  void SetProgress(int numDone, const char *curItemName = NULL);
+
+	  /* Only redraws the window (Fl::flush) without handling any pending
+	   * events, so that no other callbacks can run while the caller waits
+	   * on a background job:
+	   */
+	  void SetProgressNoEvents(int numDone);
+
+	  /* Changes the total (for jobs whose size is only known once they start): */
+	  void SetTotalItems(int totalItems);
+
+	  /* Whether the cancel button (if any) has been pressed: */
+	  inline bool CancelRequested() const {
+	       return cancelRequested;
+	  }
+
+     private:
+	  Fl_Box *itemNameBox;
+	  Fl_Progress *progressBar;
+	  Fl_Button *cancelButton;
+	  bool cancelRequested;
+	  int totalItemCount;
+	  char progressLabel[MAX_BUFFER_SIZE];
+
+	  void UpdateProgressBar(int numDone);
+	  static void CancelButtonCallback(Fl_Widget *btn, void *udata);
+
+};
+
+#endif
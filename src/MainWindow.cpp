@@ -7,8 +7,11 @@
 #include "TerminalPrinting.h"
 #include "ThemesConfig.h"
 #include "RNAStructVizTypes.h"
+#include "StructureArchive.h"
+#include "XMLExportWriter.h"
 
 #include <unistd.h>
+#include <strings.h>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -318,6 +321,7 @@ void MainWindow::OpenFileCallback(Fl_Widget* widget, void* userData)
     }
     else {
         bool avoidDuplicateStructs = ms_instance->m_fileChooserSelectAllBtn->AvoidDuplicateStructures();
+        std::vector<std::string> selectedFilePaths;
 	for (int i = 0; i < ms_instance->m_fileChooser->count(); ++i) {
             const char *nextFilename = strrchr(ms_instance->m_fileChooser->value(i), '/');
             nextFilename = nextFilename ? nextFilename : ms_instance->m_fileChooser->value(i);
@@ -335,8 +339,9 @@ void MainWindow::OpenFileCallback(Fl_Widget* widget, void* userData)
             snprintf(nextFilePath, MAX_BUFFER_SIZE, "%s%s%s\0", nextWorkingDir, 
                      nextWorkingDir[strlen(nextWorkingDir) - 1] == '/' ? "" : "/", 
                      nextFilename);
-            RNAStructViz::GetInstance()->GetStructureManager()->AddFile(nextFilePath, avoidDuplicateStructs, false);
+            selectedFilePaths.push_back(std::string(nextFilePath));
         }
+        RNAStructViz::GetInstance()->GetStructureManager()->AddFiles(selectedFilePaths, avoidDuplicateStructs, false);
     }
 
     if(ms_instance->selectedFolderIndex >= 0) {
@@ -525,6 +530,79 @@ void MainWindow::MoveFolderDown(Fl_Widget *widget, void* userData)
     pack->redraw();
 }
 
+static bool HasFileExtension(const std::string &filePath, const char *fileExt)
+{
+    size_t extLength = strlen(fileExt);
+    return filePath.length() > extLength && 
+           !strcasecmp(filePath.c_str() + filePath.length() - extLength, fileExt);
+}
+
+void MainWindow::ExportFolderCallback(Fl_Widget *widget, void* userData)
+{
+    Fl_Button* folderLabel = (Fl_Button*)(widget->parent()->child(0));
+    StructureManager *structManager = RNAStructViz::GetInstance()->GetStructureManager();
+    const std::vector<Folder*>& folders = structManager->GetFolders();
+    unsigned int index;
+    for (index = 0; index < folders.size(); ++index)
+    {
+        if (!strcmp(folders[index]->folderName, (char*)(folderLabel->user_data())))
+            break;
+    }
+    if (index >= folders.size())
+        return;
+
+    char defaultFileName[MAX_BUFFER_SIZE];
+    snprintf(defaultFileName, MAX_BUFFER_SIZE, "%s%s", folders[index]->folderName, 
+             STRUCTURE_ARCHIVE_FILEEXT);
+    Fl_Native_File_Chooser fileChooser;
+    fileChooser.directory((char *) CTFILE_SEARCH_DIRECTORY);
+    fileChooser.title("Choose a file name for the exported folder ...");
+    fileChooser.type(Fl_Native_File_Chooser::BROWSE_SAVE_FILE);
+    fileChooser.options(Fl_Native_File_Chooser::NEW_FOLDER | 
+                        Fl_Native_File_Chooser::SAVEAS_CONFIRM);
+    fileChooser.filter("Structure Archives\t*.rsvarchive\n"
+                       "XML Files\t*.{xml,xml.gz}");
+    fileChooser.preset_file(defaultFileName);
+    switch(fileChooser.show()) {
+        case -1: // ERROR
+            fl_alert("Error selecting the file path to export the folder: \"%s\".", 
+                     fileChooser.errmsg());
+            return;
+        case 1: // CANCEL
+            return;
+        default:
+            break;
+    }
+    // The folder is written as XML when that filter is chosen or the 
+    // file name has the XML extension, and as an archive otherwise:
+    std::string exportPath(fileChooser.filename());
+    bool xmlExport = HasFileExtension(exportPath, ".xml") || 
+                     HasFileExtension(exportPath, ".xml.gz") || 
+                     (fileChooser.filter_value() == 1 && 
+                      !StructureArchive::IsArchiveFile(exportPath.c_str()));
+    bool exportOK;
+    if (xmlExport)
+    {
+        if (!HasFileExtension(exportPath, ".xml") && !HasFileExtension(exportPath, ".xml.gz"))
+            exportPath += ".xml";
+        // The file chooser has already asked before overwriting the file:
+        exportOK = XMLExport::ExportStructureToXML(exportPath, XMLExport::XMLEXPORTFMT_FULL_FOLDER, 
+                                                   index, XMLExport::XMLEXPORT_ALLOW_OVERWRITES | 
+                                                   XMLExport::XMLEXPORT_STRUCTURE_FULL) == 0;
+    }
+    else
+    {
+        if (!StructureArchive::IsArchiveFile(exportPath.c_str()))
+            exportPath += STRUCTURE_ARCHIVE_FILEEXT;
+        exportOK = structManager->WriteFolderArchive(index, exportPath.c_str());
+    }
+    if (!exportOK)
+    {
+        fl_alert("Unable to export the folder \"%s\" to the file \"%s\".", 
+                 folders[index]->folderName, exportPath.c_str());
+    }
+}
+
 bool MainWindow::CreateFileChooser() {
 
     // Get the current working directory.
@@ -544,15 +622,17 @@ bool MainWindow::CreateFileChooser() {
     m_fileChooser->label("Select RNA Structures From File(s) ...");
     m_fileChooser->filter(
                  #if WITH_FASTA_FORMAT_SUPPORT > 0
-		 "All Formats (*.{boltz,ct,nopct,dot,bracket,dbn,fasta,helix,hlx,bpseq})\t"
+		 "All Formats (*.{boltz,ct,nopct,dot,bracket,dbn,subopt,fasta,helix,hlx,bpseq,rsvarchive,gz})\t"
                  #else
-		 "All Formats (*.{boltz,ct,nopct,dot,bracket,dbn,helix,hlx,bpseq})\t"
+		 "All Formats (*.{boltz,ct,nopct,dot,bracket,dbn,subopt,helix,hlx,bpseq,rsvarchive,gz})\t"
                  #endif
 		 "CT Files (*.{nopct,ct})\t"
-                 "DOT Bracket (*.{dot,bracket,dbn})\t"
+                 "DOT Bracket (*.{dot,bracket,dbn,subopt})\t"
                  "Boltzmann Format (*.boltz)\t"
                  "Helix Triple Format (*.{helix,hlx})\t"
                  "SEQ Files (*.bpseq)\t"
+                 "Structure Archives (*.rsvarchive)\t"
+                 "Compressed Files (*.{gz,gzip,zst,zstd})\t"
                  #if WITH_FASTA_FORMAT_SUPPORT > 0
                  "FASTA Files (*.fasta)\t"
                  #endif
@@ -758,9 +838,10 @@ void MainWindow::RemoveFolderByIndex(const int index)
     Fl_Pack* pack = ms_instance->m_packedInfo;
 
     HideFolderByIndex(index);    
-    for(int si = 0; si < folders[index]->structCount; si++) {
-        int sindex = folders[index]->folderStructs[si];
-	appInstance->GetStructureManager()->RemoveStructure(sindex);
+    // RemoveStructure drops each structure from the folder as it goes:
+    std::vector<StructureHandle_t> folderStructs = folders[index]->folderStructs;
+    for(unsigned int si = 0; si < folderStructs.size(); si++) {
+	appInstance->GetStructureManager()->RemoveStructure(folderStructs[si].slotIndex);
     }
     appInstance->GetStructureManager()->RemoveFolder(index);
     ms_instance->m_packedInfo->hide();
@@ -781,7 +862,7 @@ void MainWindow::RemoveFolderByIndex(const int index)
         pane->hide();
         pane->show();
         int nextIndex = index % folders.size();    
-        if(folders[nextIndex] != NULL && folders[nextIndex]->structCount > 0) { 
+        if(folders[nextIndex] != NULL && !folders[nextIndex]->IsEmpty()) { 
              ShowFolderByIndex(nextIndex);
 	     Fl_Button *folderLabel = folders[nextIndex]->mainWindowFolderBtn;
              ms_instance->selectedFolderBtn = folderLabel;
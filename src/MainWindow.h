@@ -155,6 +155,11 @@ class MainWindow
         */
         static void MoveFolderUp(Fl_Widget *widget, void* userData);
         static void MoveFolderDown(Fl_Widget *widget, void* userData);
+
+        /*
+        Callback to export all of the structures in a folder to one file.
+        */
+        static void ExportFolderCallback(Fl_Widget *widget, void* userData);
    
 	/* Give the Folder class access to set callbacks on its GUI buttons: */
 	friend class Folder;
@@ -13,6 +13,8 @@
 #include "CommonDialogs.h"
 #include "RNAStructViz.h"
 #include "DisplayConfigWindow.h"
+#include "StructureManager.h"
+#include "RadialLayoutImage.h"
 
 void ProcessAboutOption() {
      std::string infoAboutMsg = CommonDialogs::GetInfoAboutMessageString();
@@ -52,16 +54,53 @@ void ProcessVerboseOption() {
      CFG_VERBOSE_MODE = 1;
 }
 
+void ProcessExportLayoutOption(const char *structFilePath, const char *pngOutputPath, 
+		               bool useNAViewLayout) {
+     std::string outputPath = pngOutputPath != NULL ? std::string(pngOutputPath) : 
+	                      std::string(structFilePath) + ".png";
+     StructureManager::ParsedStructureFile_t parsedFile;
+     StructureManager::ParseStructureFile(structFilePath, parsedFile);
+     if(parsedFile.structures == NULL || parsedFile.structCount <= 0 || 
+        parsedFile.structures[0] == NULL) {
+          TerminalText::PrintError("Unable to load a structure to export from \"%s\"\n", structFilePath);
+	  Free(parsedFile.structures);
+	  exit(EXIT_FAILURE);
+     }
+     else if(parsedFile.structCount > 1) {
+          TerminalText::PrintWarning("Exporting only the first of the %d structures in \"%s\"\n", 
+			             parsedFile.structCount, structFilePath);
+     }
+     RadialLayoutDisplayWindow::VRNAPlotType_t plotType = useNAViewLayout ? 
+	  RadialLayoutDisplayWindow::PLOT_TYPE_NAVIEW : RadialLayoutDisplayWindow::PLOT_TYPE_SIMPLE;
+     bool exportOK = RadialLayoutDisplayWindow::WriteLayoutImage(parsedFile.structures[0], 
+		                                                 outputPath.c_str(), plotType);
+     for(int s = 0; s < parsedFile.structCount; s++) {
+          Delete(parsedFile.structures[s], RNAStructure);
+     }
+     Free(parsedFile.structures);
+     if(!exportOK) {
+          TerminalText::PrintError("Unable to write the layout image \"%s\"\n", outputPath.c_str());
+	  exit(EXIT_FAILURE);
+     }
+     TerminalText::PrintInfo("Wrote the layout of \"%s\" to \"%s\"\n", structFilePath, outputPath.c_str());
+     exit(EXIT_SUCCESS);
+}
+
 int ParseStructVizCommandOptions(int &argc, char ** &argv) {
 
      int argcInput = argc; 
      char **argvInput = argv;
      bool doneParsingStructViz = false;
+     const char *exportLayoutPath = NULL, *exportLayoutOutputPath = NULL;
+     bool exportNAViewLayout = false;
      while(true) {
           
       static struct option longarg_options[] = {
                { "about",           no_argument,      NULL,                      PRINT_ABOUT },
                { "debug",           no_argument,      NULL,                      PRINT_DEBUG }, 
+               { "export-layout",   required_argument, NULL,                     EXPORT_LAYOUT },
+               { "export-layout-output", required_argument, NULL,                EXPORT_LAYOUT_OUTPUT },
+               { "export-layout-naview", no_argument, NULL,                      EXPORT_LAYOUT_NAVIEW },
                { "help",            no_argument,      NULL,                      PRINT_HELP  },
                { "new-config",      no_argument,      NULL,                      NEW_CONFIG  },
                { "no-ansi-color",   no_argument,      &PRINT_ANSI_COLOR,         SETVAR      },
@@ -102,6 +141,15 @@ int ParseStructVizCommandOptions(int &argc, char ** &argv) {
            case NEW_CONFIG:
                 ProcessNewConfigOption();
             break;
+           case EXPORT_LAYOUT:
+                exportLayoutPath = optarg;
+            break;
+           case EXPORT_LAYOUT_OUTPUT:
+                exportLayoutOutputPath = optarg;
+            break;
+           case EXPORT_LAYOUT_NAVIEW:
+                exportNAViewLayout = true;
+            break;
            case 'q':
             ProcessQuietOption();
             break;
@@ -116,6 +164,9 @@ int ParseStructVizCommandOptions(int &argc, char ** &argv) {
                break;
       }
      }
+     if(exportLayoutPath != NULL) {
+          ProcessExportLayoutOption(exportLayoutPath, exportLayoutOutputPath, exportNAViewLayout);
+     }
      int numOptionsParsed = optind - 1;
      if(REMOVE_STRUCTVIZ_OPTIONS) {
           argc -= numOptionsParsed;
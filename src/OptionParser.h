@@ -25,6 +25,9 @@ typedef enum {
      PRINT_HELP  = 4,
      PRINT_DEBUG = 5,
      NEW_CONFIG  = 6,
+     EXPORT_LAYOUT        = 7,
+     EXPORT_LAYOUT_OUTPUT = 8,
+     EXPORT_LAYOUT_NAVIEW = 9,
 } StructVizOptionAction_t;
 
 void ProcessAboutOption();
@@ -34,6 +37,11 @@ void ProcessNewConfigOption();
 void ProcessQuietOption();
 void ProcessVerboseOption();
 
+/* Writes the layout of the (first) structure in the file to a PNG image 
+ * without starting the GUI, and exits: */
+void ProcessExportLayoutOption(const char *structFilePath, const char *pngOutputPath, 
+		               bool useNAViewLayout);
+
 int ParseStructVizCommandOptions(int &argc, char ** &argv);
 
 #endif
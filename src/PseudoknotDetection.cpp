@@ -0,0 +1,153 @@
+/* PseudoknotDetection.cpp : Implementation of the crossing arc detection and
+ *                           page decomposition routines;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.11
+ */
+
+#include <algorithm>
+
+#include "PseudoknotDetection.h"
+
+namespace PseudoknotDetection {
+
+     FenwickTree_t::FenwickTree_t(int n) : treeData(n + 1, 0) {}
+
+     void FenwickTree_t::Add(int pos, int delta) {
+          int treeSize = treeData.size();
+          for(int tidx = pos + 1; tidx < treeSize; tidx += tidx & (-tidx)) {
+               treeData[tidx] += delta;
+          }
+     }
+
+     int FenwickTree_t::PrefixSum(int pos) const {
+          int psum = 0;
+          for(int tidx = pos + 1; tidx > 0; tidx -= tidx & (-tidx)) {
+               psum += treeData[tidx];
+          }
+          return psum;
+     }
+
+     int FenwickTree_t::RangeSum(int lowerPos, int upperPos) const {
+          if(upperPos < lowerPos) {
+               return 0;
+          }
+          return PrefixSum(upperPos) - PrefixSum(lowerPos - 1);
+     }
+
+     static inline bool IsValidArc(const std::vector<int> &pairTable, int pos) {
+          int partner = pairTable[pos];
+          return partner >= 0 && partner != pos && partner < (int) pairTable.size() &&
+                 pairTable[partner] == pos;
+     }
+
+     size_t CountCrossingPairs(const std::vector<int> &pairTable,
+		               std::vector<int> *crossingsPerBase) {
+          int seqLength = pairTable.size();
+          if(crossingsPerBase != NULL) {
+               crossingsPerBase->assign(seqLength, 0);
+          }
+          // Left-to-right sweep: when the arc (i, j) closes at j, the arcs opened
+          // strictly inside (i, j) which are still open close after j, so they
+          // cross (i, j) on the right. Each crossing pair is counted exactly once:
+          size_t crossingCount = 0;
+          FenwickTree_t openArcs(seqLength);
+          for(int pos = 0; pos < seqLength; pos++) {
+               if(!IsValidArc(pairTable, pos)) {
+                    continue;
+               }
+               int partner = pairTable[pos];
+               if(partner > pos) {
+                    openArcs.Add(pos, 1);
+                    continue;
+               }
+               openArcs.Add(partner, -1);
+               int rightCrossings = openArcs.RangeSum(partner + 1, pos - 1);
+               crossingCount += rightCrossings;
+               if(crossingsPerBase != NULL) {
+                    (*crossingsPerBase)[partner] += rightCrossings;
+                    (*crossingsPerBase)[pos] += rightCrossings;
+               }
+          }
+          if(crossingsPerBase == NULL) {
+               return crossingCount;
+          }
+          // Right-to-left sweep to count the arcs crossing each (i, j) on the left:
+          FenwickTree_t closedArcs(seqLength);
+          for(int pos = seqLength - 1; pos >= 0; pos--) {
+               if(!IsValidArc(pairTable, pos)) {
+                    continue;
+               }
+               int partner = pairTable[pos];
+               if(partner < pos) {
+                    closedArcs.Add(pos, 1);
+                    continue;
+               }
+               closedArcs.Add(partner, -1);
+               int leftCrossings = closedArcs.RangeSum(pos + 1, partner - 1);
+               (*crossingsPerBase)[pos] += leftCrossings;
+               (*crossingsPerBase)[partner] += leftCrossings;
+          }
+          return crossingCount;
+     }
+
+     int ComputePageDecomposition(const std::vector<int> &pairTable,
+		                  std::vector<uint8_t> &pageLayers) {
+          int seqLength = pairTable.size();
+          pageLayers.assign(seqLength, PKPAGE_UNPAIRED);
+          // Each page keeps a stack of the 3' ends of its arcs that are open at
+          // the current position. Since the arcs on a page are nested, the top
+          // of the stack is the innermost open arc, so the arc (i, j) fits on
+          // the page exactly when j lies before the 3' end at the top:
+          std::vector<std::vector<int> > pageStacks;
+          std::vector<int> pagePairCounts;
+          for(int pos = 0; pos < seqLength; pos++) {
+               if(!IsValidArc(pairTable, pos) || pairTable[pos] < pos) {
+                    continue;
+               }
+               int partner = pairTable[pos];
+               int page = 0;
+               for(; page < (int) pageStacks.size(); page++) {
+                    std::vector<int> &openStack = pageStacks[page];
+                    while(!openStack.empty() && openStack.back() < pos) {
+                         openStack.pop_back();
+                    }
+                    if(openStack.empty() || partner < openStack.back()) {
+                         break;
+                    }
+               }
+               if(page == (int) pageStacks.size()) {
+                    if(page >= PKPAGE_MAX_PAGES) {
+                         page = PKPAGE_MAX_PAGES - 1;
+                    }
+                    else {
+                         pageStacks.push_back(std::vector<int>());
+                         pagePairCounts.push_back(0);
+                    }
+               }
+               pageStacks[page].push_back(partner);
+               pagePairCounts[page]++;
+               pageLayers[pos] = pageLayers[partner] = (uint8_t) page;
+          }
+          // Relabel the pages so that the primary (non-knotted) layer is the largest:
+          int numPages = pageStacks.size();
+          std::vector<int> pageOrder(numPages);
+          for(int p = 0; p < numPages; p++) {
+               pageOrder[p] = p;
+          }
+          std::stable_sort(pageOrder.begin(), pageOrder.end(),
+                           [&pagePairCounts](int p1, int p2) {
+                                return pagePairCounts[p1] > pagePairCounts[p2];
+                           });
+          std::vector<uint8_t> pageRelabel(numPages);
+          for(int p = 0; p < numPages; p++) {
+               pageRelabel[pageOrder[p]] = (uint8_t) p;
+          }
+          for(int pos = 0; pos < seqLength; pos++) {
+               if(pageLayers[pos] != PKPAGE_UNPAIRED) {
+                    pageLayers[pos] = pageRelabel[pageLayers[pos]];
+               }
+          }
+          return numPages;
+     }
+
+}
@@ -0,0 +1,64 @@
+/* PseudoknotDetection.h : Sub-quadratic detection of crossing (pseudoknotted)
+ *                         arcs in a pair table together with a greedy
+ *                         decomposition of the pairs into non-crossing pages;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.11
+ */
+
+#ifndef __PSEUDOKNOT_DETECTION_H__
+#define __PSEUDOKNOT_DETECTION_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace PseudoknotDetection {
+
+     /* The pair tables passed to the functions below are indexed from zero
+      * with pairTable[i] = j when base i pairs with base j, and a negative
+      * value when base i is unpaired:
+      */
+     #define PKPT_UNPAIRED                 (-1)
+     #define PKPAGE_UNPAIRED               ((uint8_t) 0xff)
+     #define PKPAGE_MAX_PAGES              (PKPAGE_UNPAIRED - 1)
+
+     /* A binary indexed (Fenwick) tree over the base positions, used to count
+      * the number of currently open arcs within an interval in O(log N) time:
+      */
+     class FenwickTree_t {
+
+          public:
+               FenwickTree_t(int n);
+
+               void Add(int pos, int delta);
+               int PrefixSum(int pos) const;
+               int RangeSum(int lowerPos, int upperPos) const;
+
+          private:
+               std::vector<int> treeData;
+
+     };
+
+     /* Counts the number of pairs of arcs (i, j), (k, l) with i < k < j < l
+      * in O(N log N) time. If crossingsPerBase is non-NULL, it is resized to
+      * the sequence length and filled with the number of arcs that cross the
+      * arc incident to each base (zero for unpaired bases):
+      */
+     size_t CountCrossingPairs(const std::vector<int> &pairTable,
+		               std::vector<int> *crossingsPerBase = NULL);
+
+     /* Greedily assigns each arc to the first page on which it does not cross
+      * any arc that is already placed there (scanning arcs by their 5' end).
+      * The pages are then relabeled so that page 0 holds the most pairs, i.e.,
+      * all pairs on pages > 0 are the pseudoknotted ones. The page of each
+      * base is written to pageLayers (PKPAGE_UNPAIRED for unpaired bases).
+      * Runs in O(N * K) time where K is the number of pages in the result.
+      * Returns the number of pages used:
+      */
+     int ComputePageDecomposition(const std::vector<int> &pairTable,
+		                  std::vector<uint8_t> &pageLayers);
+
+}
+
+#endif
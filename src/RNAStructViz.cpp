@@ -120,12 +120,18 @@ bool RNAStructViz::Initialize(int argc, char** argv)
 
 void RNAStructViz::Shutdown()
 {
+    // Stop the sampling jobs first, since the events handled while waiting 
+    // below would otherwise keep inserting their structures:
+    if(RNAStructViz::ms_instance != NULL) {
+         RNAStructViz::ms_instance->GetStructureManager()->StopSamplingJobs();
+    }
     while(RNAStructViz::ScheduledDeletion::CleanupWaiting()) {
          Fl::wait(1.0);
     }
     //Fl::remove_timeout(RNAStructViz::ScheduledDeletion::PerformScheduledDeletion, NULL);
     //RNAStructViz::ScheduledDeletion::PerformScheduledDeletion(NULL);
     ConfigParser::WriteUserConfigFile(USER_CONFIG_PATH);
+    CompactStickyFolderNameConfigFile(DEFAULT_STICKY_FOLDERNAME_CFGFILE);
     Delete(RNAStructViz::ms_instance, RNAStructViz);
     MainWindow::Shutdown();
     Delete(RNAStructure::m_ctFileSelectionWin, InputWindow);
@@ -160,7 +166,6 @@ void RNAStructViz::AddDiagramWindow(int index)
 {
     std::vector<int> structures;
     const std::vector<Folder*>& folders = m_structureManager->GetFolders();
-    int shift = 0;
     
     if(folders.empty())
     {
@@ -168,14 +173,12 @@ void RNAStructViz::AddDiagramWindow(int index)
         return;
     }
         
-    for (int i = 0; i < folders.at(index)->structCount; ++i)
+    const std::vector<StructureHandle_t>& folderStructs = folders.at(index)->folderStructs;
+    for (unsigned int i = 0; i < folderStructs.size(); ++i)
     {
-        if(folders[index]->folderStructs[(i + shift)] == -1)
-            shift++;
-        if (m_structureManager->
-            GetStructure(folders[index]->folderStructs[(i + shift)]))
+        if(m_structureManager->GetStructure(folderStructs[i]))
         {
-            structures.push_back(folders[index]->folderStructs[(i + shift)]);
+            structures.push_back(folderStructs[i].slotIndex);
         }
     }
     
@@ -212,7 +215,6 @@ void RNAStructViz::AddStatsWindow(int index)
 {
     std::vector<int> structures;
     const std::vector<Folder*>& folders = m_structureManager->GetFolders();
-    int shift = 0;
     
     if(folders.empty())
     {
@@ -220,13 +222,12 @@ void RNAStructViz::AddStatsWindow(int index)
         return;
     }
     
-    for (int i = 0; i < folders.at(index)->structCount; ++i)
+    const std::vector<StructureHandle_t>& folderStructs = folders.at(index)->folderStructs;
+    for (unsigned int i = 0; i < folderStructs.size(); ++i)
     {
-        if(folders[index]->folderStructs[(i + shift)] == -1)
-            shift++;
-        if(m_structureManager->GetStructure(folders[index]->folderStructs[(i + shift)]))
+        if(m_structureManager->GetStructure(folderStructs[i]))
         {
-            structures.push_back(folders[index]->folderStructs[(i + shift)]);
+            structures.push_back(folderStructs[i].slotIndex);
         }
     }
     
@@ -441,6 +442,7 @@ int RNAStructViz::BackupAndUnlinkLocalConfigFiles(bool clearStickyFolderNamesOnl
      std::string stickyFolderBackupPath = 
              std::string(GetStickyFolderConfigPath(DEFAULT_STICKY_FOLDERNAME_CFGFILE)) + 
              std::string(dateStampSuffix);
+     ResetStickyFolderNameIndex();
      if(!clearStickyFolderNamesOnly && rename(configPath.c_str(), configBackupPath.c_str()) || 
         rename(stickyFolderPath.c_str(), stickyFolderBackupPath.c_str())) {
           TerminalText::PrintInfo("Unable to rename backup config files \"%s\" and/or \"%s\" : %s\n", 
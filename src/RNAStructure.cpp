@@ -1,10 +1,12 @@
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <sys/types.h>
 
 #include <fstream>
 #include <vector>
 #include <stack>
+#include <unordered_map>
 using std::stack;
 
 #include <FL/Fl_Box.H>
@@ -18,19 +20,25 @@ using std::stack;
 #include "TerminalPrinting.h"
 #include "ConfigParser.h"
 #include "ViennaBoltzmannSampling.h"
+#include "PseudoknotDetection.h"
+#include "StructureElementTree.h"
+#include "StructureCache.h"
+#include "CompressedInput.h"
 
-#if PERFORM_BRANCH_TYPE_ID
-     #include "BranchTypeIdentification.h"
-#endif
+#include "BranchTypeIdentification.h"
 
 const RNAStructure::BasePair RNAStructure::UNPAIRED = ~0x0;
 
 RNAStructure::RNAStructure()
     : m_sequenceLength(0), m_sequence(NULL), 
+      m_deferredParse(false), m_deferredIsBPSEQ(false), 
       charSeq(NULL), dotFormatCharSeq(NULL), charSeqSize(0), 
+      m_seqFingerprintValid(false), 
+      m_pairListHash(0), m_pairListHashValid(false), 
       m_pathname(NULL), m_pathname_noext(NULL), m_exactPathName(NULL), 
       m_fileType(FILETYPE_NONE), 
       m_fileCommentLine(NULL), m_suggestedFolderName(NULL), 
+      m_freeEnergy(0.0), m_haveFreeEnergy(false), 
       m_ctDisplayString(NULL), m_ctDisplayFormatString(NULL), 
       m_seqDisplayString(NULL), m_seqDisplayFormatString(NULL), 
       m_ctTextDisplay(NULL), m_ctStyleBuffer(NULL), 
@@ -38,11 +46,11 @@ RNAStructure::RNAStructure()
       m_exportExtFilesBox(NULL), m_seqSubwindowBox(NULL), 
       m_ctSubwindowBox(NULL), m_ctViewerNotationBox(NULL), 
       m_exportFASTABtn(NULL), m_exportDBBtn(NULL), 
-      m_cwinResizeBox(NULL) 
+      m_cwinResizeBox(NULL), 
+      m_pkPageLayers(NULL), m_pkPageCount(-1), 
+      m_pkCrossingPairsCount(0), m_pkKnottedPairsCount(0), 
+      m_elementTree(NULL), m_branchIDs(NULL) 
 {
-     #if PERFORM_BRANCH_TYPE_ID
-     branchType = NULL; 
-     #endif
      m_contentWindow = NULL;
 }
 
@@ -69,7 +77,9 @@ RNAStructure::~RNAStructure()
     Free(m_seqDisplayFormatString); 
     Free(m_sequence);
     if(charSeqSize > 0) { 
-        free((void *) charSeq); 
+        if(!m_sharedSequence) {
+             free((void *) charSeq); 
+        }
         free((void *) dotFormatCharSeq);
     }
     if(m_exactPathName != NULL && m_exactPathName != m_pathname) {
@@ -77,19 +87,17 @@ RNAStructure::~RNAStructure()
     }
     Free(m_pathname);
     Free(m_pathname_noext);
-    #if PERFORM_BRANCH_TYPE_ID
-    if(branchType != NULL) {
-         delete branchType;
-         branchType = NULL;
-    }
-    #endif
     DeleteContentWindow();
     Free(m_fileCommentLine); 
     Free(m_suggestedFolderName); 
+    Free(m_pkPageLayers);
+    Delete(m_elementTree, StructureElementTree_t);
+    Free(m_branchIDs);
 }
 
 const RNAStructure::BaseData* RNAStructure::GetBaseAt(unsigned int position) const
 {
+    EnsureParsed();
     if (position < m_sequenceLength)
     {
         return &m_sequence[position];
@@ -99,6 +107,7 @@ const RNAStructure::BaseData* RNAStructure::GetBaseAt(unsigned int position) con
 
 RNAStructure::BaseData* RNAStructure::GetBaseAt(unsigned int position) 
 {
+    EnsureParsed();
     if (position < m_sequenceLength)
     {
         return &m_sequence[position];
@@ -106,20 +115,25 @@ RNAStructure::BaseData* RNAStructure::GetBaseAt(unsigned int position)
     return NULL;
 }
 
-#if PERFORM_BRAMCH_TYPE_ID
-RNABranchType_t* RNAStructure::GetBranchTypeAt(unsigned int position)
+#if PERFORM_BRANCH_TYPE_ID
+BranchID_t RNAStructure::GetBranchIDAt(unsigned int position)
 {
-    if (position < m_sequenceLength)
+    if (position >= m_sequenceLength)
     {
-        return &branchType[position];
+        return BRANCH_UNDEFINED;
     }
-    return NULL;
+    else if (m_branchIDs == NULL)
+    {
+        m_branchIDs = (uint8_t *) malloc(m_sequenceLength * sizeof(uint8_t));
+        RNABranchType_t::PerformBranchClassification(GetNestedPairTable(), m_branchIDs);
+    }
+    return (BranchID_t) m_branchIDs[position];
 }
 #endif
 
 RNAStructure* RNAStructure::CreateFromFile(const char* filename, const bool isBPSEQ)
 {
-    std::ifstream inStream(filename);
+    CompressedInput::InputFileStream_t inStream(filename);
     if (!inStream.good())
     {
         if (strlen(filename) > 1000)
@@ -319,10 +333,6 @@ RNAStructure* RNAStructure::CreateFromFile(const char* filename, const bool isBP
     result->m_sequence = (BaseData*) realloc(result->m_sequence, 
                                              sizeof(BaseData) * result->m_sequenceLength);
     
-    #if PERFORM_BRANCH_TYPE_ID
-    result->branchType = (RNABranchType_t*) malloc( 
-                         sizeof(RNABranchType_t) * result->m_sequenceLength);
-    #endif
     result->m_pathname = strdup(filename);
     result->charSeqSize = tempSeq.size();
     result->charSeq = (char *) malloc((result->charSeqSize + 1) * sizeof(char));
@@ -343,57 +353,172 @@ RNAStructure* RNAStructure::CreateFromFile(const char* filename, const bool isBP
     }
     result->charSeq[result->charSeqSize] = '\0';
     result->dotFormatCharSeq[result->charSeqSize] = '\0';
-    #if PERFORM_BRANCH_TYPE_ID    
-    RNABranchType_t::PerformBranchClassification(result, result->m_sequenceLength);
-    #endif
 
     return result;
 }
 
-RNAStructure * RNAStructure::CreateFromDotBracketFile(const char *filename) {
-     
-     FILE *fpDotBracketFile = fopen(filename, "r+");
-     if(fpDotBracketFile == NULL) {
-         TerminalText::PrintError("Opening file \"%s\" : %s\n", filename, strerror(errno));
-     }
-     char lineBuf[MAX_SEQUENCE_SIZE + 1];
-     char baseDataBuf[MAX_SEQUENCE_SIZE + 1], pairingDataBuf[MAX_SEQUENCE_SIZE + 1];
-     baseDataBuf[0] = pairingDataBuf[0] = '\0';
-     bool haveBaseData = false, havePairData = false;
-     while(true) {
-          char *lineReturn = fgets(lineBuf, MAX_SEQUENCE_SIZE, fpDotBracketFile);
-      if(lineReturn == NULL && feof(fpDotBracketFile)) { 
-           break;
-      }
-      else if(lineReturn == NULL) {
-           TerminalText::PrintError("Reading DotBracket file \"%s\" : %s\n", filename, strerror(errno));
-           break;
-      }
-      if(lineBuf[0] == '\n' || lineBuf[0] == '>') { // blank or comment line (skip it): 
-           continue;
-      }
-      int lineLength = strnlen(lineBuf, MAX_SEQUENCE_SIZE);
-      if(lineBuf[lineLength - 1] == '\n') {
-               lineBuf[lineLength - 1] = '\0';
-      }
-      if(!haveBaseData) {
-           strncpy(baseDataBuf, lineBuf, MAX_SEQUENCE_SIZE);
-           haveBaseData = true;
-           continue;
-      }
-      else if(!havePairData) {
-           strncpy(pairingDataBuf, lineBuf, MAX_SEQUENCE_SIZE);
-           havePairData = true;
-      }
-      if(haveBaseData && havePairData) {
-           break;
-      }
-     }
-     fclose(fpDotBracketFile);
-     return RNAStructure::CreateFromDotBracketData(filename, (const char *) baseDataBuf, (const char *) pairingDataBuf);
+RNAStructure* RNAStructure::CreateDeferredFromFile(const char* filename, const bool isBPSEQ)
+{
+    CompressedInput::InputFileStream_t inStream(filename);
+    if (!inStream.good())
+    {
+        inStream.close();
+        return 0;
+    }
+
+    // Only the leading id, the base and the pair on each line are looked 
+    // at here, with the same rule as CreateFromFile for skipping comment 
+    // lines. The pairs are stored as CreateFromFile would store them:
+    std::string tempSeq, fileLine;
+    std::vector<BasePair> pairList;
+    bool pairListValid = true;
+    while (std::getline(inStream, fileLine))
+    {
+        const char *linePos = fileLine.c_str();
+        char *idEnd = NULL;
+        long baseID = strtol(linePos, &idEnd, 10);
+        if (idEnd == linePos || baseID != (long) tempSeq.size() + 1)
+        {
+            continue;
+        }
+        while (*idEnd == ' ' || *idEnd == '\t')
+        {
+            idEnd++;
+        }
+        switch (*idEnd)
+        {
+            case 'a':
+            case 'A':
+                tempSeq.push_back('A');
+                break;
+            case 'c':
+            case 'C':
+                tempSeq.push_back('C');
+                break;
+            case 'g':
+            case 'G':
+                tempSeq.push_back('G');
+                break;
+            case 't':
+            case 'T':
+            case 'u':
+            case 'U':
+                tempSeq.push_back('U');
+                break;
+            default:
+                inStream.close();
+                return 0;
+        }
+        // The CT files have the previous and next ids before the pair:
+        char *fieldEnd = idEnd + 1;
+        long pairID = -1;
+        for (int fidx = 0; fidx < (isBPSEQ ? 1 : 3); fidx++)
+        {
+            const char *fieldStart = fieldEnd;
+            pairID = strtol(fieldStart, &fieldEnd, 10);
+            if (fieldEnd == fieldStart)
+            {
+                pairListValid = false;
+                break;
+            }
+        }
+        if (pairID < 0 || pairID > UNPAIRED)
+        {
+            pairListValid = false;
+        }
+        pairList.push_back(pairID == 0 ? UNPAIRED : (BasePair) (pairID - 1));
+    }
+    inStream.close();
+    if (tempSeq.size() == 0)
+    {
+        return 0;
+    }
+
+    RNAStructure* result = new RNAStructure();
+    result->m_sequenceLength = tempSeq.size();
+    result->m_pathname = strdup(filename);
+    result->charSeqSize = tempSeq.size();
+    result->charSeq = strdup(tempSeq.c_str());
+    result->m_deferredParse = true;
+    result->m_deferredIsBPSEQ = isBPSEQ;
+    if (pairListValid)
+    {
+        result->m_pairListHash = SequenceFingerprint::XXH64(pairList.data(), 
+                                                            pairList.size() * sizeof(BasePair), 0);
+        result->m_pairListHashValid = true;
+    }
+    return result;
+}
+
+uint64_t RNAStructure::GetPairListHash() const
+{
+    if (m_pairListHashValid)
+    {
+        return m_pairListHash;
+    }
+    EnsureParsed();
+    std::vector<BasePair> pairList(m_sequenceLength);
+    for (unsigned int i = 0; i < m_sequenceLength; i++)
+    {
+        pairList[i] = m_sequence[i].m_pair;
+    }
+    m_pairListHash = SequenceFingerprint::XXH64(pairList.data(), 
+                                                pairList.size() * sizeof(BasePair), 0);
+    m_pairListHashValid = true;
+    return m_pairListHash;
+}
+
+void RNAStructure::CompleteDeferredParse()
+{
+    if (!m_deferredParse)
+    {
+        return;
+    }
+    m_deferredParse = false;
+    bool haveScanPairHash = m_pairListHashValid;
+    uint64_t scanPairHash = m_pairListHash;
+    InvalidatePairData();
+    RNAStructure *fullStruct = CreateFromFile(m_pathname, m_deferredIsBPSEQ);
+    if (fullStruct != NULL && fullStruct->m_sequenceLength == m_sequenceLength)
+    {
+        m_sequence = fullStruct->m_sequence;
+        fullStruct->m_sequence = NULL;
+        Free(dotFormatCharSeq);
+        dotFormatCharSeq = fullStruct->dotFormatCharSeq;
+        fullStruct->dotFormatCharSeq = NULL;
+        Delete(fullStruct, RNAStructure);
+        StructureCache::StoreStructure(m_pathname, this);
+    }
+    else
+    {
+        Delete(fullStruct, RNAStructure);
+        // The file changed or went missing since it was first scanned, so 
+        // keep the sequence we have and show the structure with no pairs:
+        TerminalText::PrintError("Unable to reload the pairs from file: %s\n", m_pathname);
+        m_sequence = (BaseData *) malloc(MAX(1, m_sequenceLength) * sizeof(BaseData));
+        dotFormatCharSeq = (char *) malloc((charSeqSize + 1) * sizeof(char));
+        for (unsigned int i = 0; i < m_sequenceLength; i++)
+        {
+            m_sequence[i].m_index = i;
+            m_sequence[i].m_pair = UNPAIRED;
+            m_sequence[i].m_base = (Base) charSeq[i];
+            dotFormatCharSeq[i] = '.';
+        }
+        dotFormatCharSeq[charSeqSize] = '\0';
+    }
+
+    // The structure manager indexed the structure by the pair hash from the 
+    // scan, which is stale if the pairs in the file changed since then:
+    if (haveScanPairHash && GetPairListHash() != scanPairHash)
+    {
+        RNAStructViz *appInstance = RNAStructViz::GetInstance();
+        if (appInstance != NULL && appInstance->GetStructureManager() != NULL)
+        {
+            appInstance->GetStructureManager()->ReindexStructurePairs(this, scanPairHash);
+        }
+    }
+}
 
-}     
-     
 RNAStructure * RNAStructure::CreateFromDotBracketData(const char *fileName, 
 		                                      const char *baseDataBuf, const char *pairingDataBuf, int index) {
 
@@ -466,42 +591,372 @@ RNAStructure * RNAStructure::CreateFromDotBracketData(const char *fileName,
      }
      seqLength = baseIdx; // allows for space characters in the parsing
      rnaStruct->m_sequenceLength = seqLength;    
-     #if PERFORM_BRANCH_TYPE_ID
-     rnaStruct->branchType = (RNABranchType_t*) malloc( 
-                             sizeof(RNABranchType_t) * rnaStruct->m_sequenceLength);
-     #endif
      rnaStruct->m_exactPathName = strdup(fileName);
-     if(index == -1) {
-	  rnaStruct->m_pathname = strdup(fileName);
-     }
-     else {
-          // we will have multiple samples in this files, need to append a sample number suffix to 
-          // distinguish between them for the users in the GUI: 
-          int nextFileIdentifierLen = strlen(fileName) + 16;
-          rnaStruct->m_pathname = (char *) malloc(nextFileIdentifierLen * sizeof(char));
-          rnaStruct->m_pathname[0] = '\0';
-          char *fileExtPos = strrchr((char *) fileName, '.');
-          if(fileExtPos == NULL) {
-               fileExtPos = ((char *) fileName) + strlen(fileName);
-          }
-          strncpy(rnaStruct->m_pathname, fileName, fileExtPos - fileName);
-          rnaStruct->m_pathname[fileExtPos - fileName] = '\0';
-          char sampleSuffix[MAX_BUFFER_SIZE];
-          snprintf(sampleSuffix, MAX_BUFFER_SIZE, "-S%06d", index + 1);
-          strcat(rnaStruct->m_pathname, sampleSuffix);
-          strcat(rnaStruct->m_pathname, fileExtPos);
-     }
+     rnaStruct->m_pathname = GetSamplePathname(fileName, index);
      rnaStruct->charSeqSize = seqLength;
      rnaStruct->charSeq = (char *) malloc((rnaStruct->charSeqSize + 1) * sizeof(char));
      strncpy(rnaStruct->charSeq, baseDataBuf, seqLength + 1);
      rnaStruct->charSeq[rnaStruct->charSeqSize] = '\0';
      rnaStruct->GenerateDotFormatDataFromPairings();
-     #if PERFORM_BRANCH_TYPE_ID    
-     RNABranchType_t::PerformBranchClassification(rnaStruct, rnaStruct->m_sequenceLength);
-     #endif
      return rnaStruct;
 }
 
+char * RNAStructure::GetSamplePathname(const char *fileName, int index, int recordIndex, 
+		                       const char *nameSuffix) {
+     if(index == -1 && nameSuffix == NULL) {
+	  return strdup(fileName);
+     }
+     // we will have multiple samples in this files, need to append a sample number suffix to 
+     // distinguish between them for the users in the GUI: 
+     int nextFileIdentifierLen = strlen(fileName) + 32 + (nameSuffix != NULL ? strlen(nameSuffix) : 0);
+     char *samplePathname = (char *) malloc(nextFileIdentifierLen * sizeof(char));
+     samplePathname[0] = '\0';
+     char *fileExtPos = strrchr((char *) fileName, '.');
+     if(fileExtPos == NULL) {
+          fileExtPos = ((char *) fileName) + strlen(fileName);
+     }
+     strncpy(samplePathname, fileName, fileExtPos - fileName);
+     samplePathname[fileExtPos - fileName] = '\0';
+     // samples of the later records in a multi-record FASTA file also get the record number:
+     // (and the predicted structures are named by the predictor instead of a sample number):
+     char sampleSuffix[MAX_BUFFER_SIZE];
+     if(recordIndex > 0) {
+          snprintf(sampleSuffix, MAX_BUFFER_SIZE, "-R%04d", recordIndex + 1);
+	  strcat(samplePathname, sampleSuffix);
+     }
+     if(nameSuffix != NULL) {
+          strcat(samplePathname, "-");
+	  strcat(samplePathname, nameSuffix);
+     }
+     else {
+          snprintf(sampleSuffix, MAX_BUFFER_SIZE, "-S%06d", index + 1);
+	  strcat(samplePathname, sampleSuffix);
+     }
+     strcat(samplePathname, fileExtPos);
+     return samplePathname;
+}
+
+RNAStructure::SharedSequence_t::~SharedSequence_t() {
+     Free(charSeq);
+     Free(unpairedBases);
+}
+
+std::shared_ptr<RNAStructure::SharedSequence_t> RNAStructure::CreateSharedSequence(const char *baseSeq) {
+     
+     unsigned int seqLength = baseSeq != NULL ? strlen(baseSeq) : 0;
+     if(seqLength == 0 || seqLength >= UNPAIRED) {
+          return std::shared_ptr<SharedSequence_t>();
+     }
+     std::shared_ptr<SharedSequence_t> sharedSeq(new SharedSequence_t());
+     sharedSeq->seqLength = seqLength;
+     sharedSeq->charSeq = (char *) malloc((seqLength + 1) * sizeof(char));
+     sharedSeq->unpairedBases = (BaseData *) malloc(seqLength * sizeof(BaseData));
+     for(unsigned int bidx = 0; bidx < seqLength; bidx++) {
+          char baseChar = toupper(baseSeq[bidx]);
+	  BaseData *curBaseData = &(sharedSeq->unpairedBases[bidx]);
+	  curBaseData->m_index = bidx;
+	  curBaseData->m_pair = UNPAIRED;
+	  switch(baseChar) {
+	       case 'A':
+	       case 'C':
+	       case 'G':
+	       case 'U':
+	            curBaseData->m_base = (Base) baseChar;
+		    break;
+	       default:
+	            curBaseData->m_base = X;
+		    break;
+	  }
+	  sharedSeq->charSeq[bidx] = baseChar;
+     }
+     sharedSeq->charSeq[seqLength] = '\0';
+     sharedSeq->seqFingerprint = SequenceFingerprint::ComputeFingerprint(sharedSeq->charSeq, seqLength);
+     return sharedSeq;
+
+}
+
+RNAStructure * RNAStructure::CreateFromPairTable(const char *fileName, 
+		                                 const std::shared_ptr<SharedSequence_t> &sharedSeq, 
+						 const short *pairTable, int index, 
+						 int recordIndex, const char *nameSuffix) {
+     
+     if(!sharedSeq || pairTable == NULL || 
+        pairTable[0] < 0 || (unsigned int) pairTable[0] != sharedSeq->seqLength) {
+          TerminalText::PrintError("Sampled structure length does not match the sequence for \"%s\"\n", 
+			           fileName);
+          return NULL;
+     }
+     unsigned int seqLength = sharedSeq->seqLength;
+     RNAStructure *rnaStruct = new RNAStructure();
+     rnaStruct->m_sequenceLength = seqLength;
+     rnaStruct->m_sequence = (BaseData *) malloc(seqLength * sizeof(BaseData));
+     memcpy(rnaStruct->m_sequence, sharedSeq->unpairedBases, seqLength * sizeof(BaseData));
+     rnaStruct->dotFormatCharSeq = (char *) malloc((seqLength + 1) * sizeof(char));
+     for(unsigned int bidx = 0; bidx < seqLength; bidx++) {
+          short pairIdx = pairTable[bidx + 1];
+	  if(pairIdx <= 0) {
+	       rnaStruct->dotFormatCharSeq[bidx] = '.';
+	       continue;
+	  }
+	  rnaStruct->m_sequence[bidx].m_pair = pairIdx - 1;
+	  rnaStruct->dotFormatCharSeq[bidx] = ((unsigned int) (pairIdx - 1) > bidx) ? '(' : ')';
+     }
+     rnaStruct->dotFormatCharSeq[seqLength] = '\0';
+     rnaStruct->m_sharedSequence = sharedSeq;
+     rnaStruct->charSeq = sharedSeq->charSeq;
+     rnaStruct->charSeqSize = seqLength;
+     rnaStruct->m_seqFingerprint = sharedSeq->seqFingerprint;
+     rnaStruct->m_seqFingerprintValid = true;
+     rnaStruct->m_exactPathName = strdup(fileName);
+     rnaStruct->m_pathname = GetSamplePathname(fileName, index, recordIndex, nameSuffix);
+     return rnaStruct;
+
+}
+
+RNAStructure * RNAStructure::CreateFromSharedDotBracket(const char *fileName, 
+		                                        const std::shared_ptr<SharedSequence_t> &sharedSeq, 
+							const char *dotData, size_t dotLength, 
+							int index, int recordIndex) {
+
+     if(!sharedSeq || dotData == NULL || dotLength != sharedSeq->seqLength) {
+          return NULL;
+     }
+     static const char *OPEN_BRACKETS = "([{<";
+     static const char *CLOSE_BRACKETS = ")]}>";
+     std::vector<unsigned int> openBases[4];
+     unsigned int seqLength = sharedSeq->seqLength;
+     BaseData *baseData = (BaseData *) malloc(seqLength * sizeof(BaseData));
+     memcpy(baseData, sharedSeq->unpairedBases, seqLength * sizeof(BaseData));
+     bool parseError = false;
+     for(unsigned int bidx = 0; bidx < seqLength && !parseError; bidx++) {
+          char pairChar = dotData[bidx];
+	  const char *bracketPos = NULL;
+	  if(pairChar == '.') {
+	       continue;
+	  }
+	  else if(pairChar != '\0' && (bracketPos = strchr(OPEN_BRACKETS, pairChar)) != NULL) {
+	       openBases[bracketPos - OPEN_BRACKETS].push_back(bidx);
+	  }
+	  else if(pairChar != '\0' && (bracketPos = strchr(CLOSE_BRACKETS, pairChar)) != NULL) {
+	       std::vector<unsigned int> &bracketStack = openBases[bracketPos - CLOSE_BRACKETS];
+	       if(bracketStack.empty()) {
+	            parseError = true;
+		    break;
+	       }
+	       unsigned int pairIdx = bracketStack.back();
+	       bracketStack.pop_back();
+	       baseData[bidx].m_pair = pairIdx;
+	       baseData[pairIdx].m_pair = bidx;
+	  }
+	  else {
+	       parseError = true;
+	  }
+     }
+     for(int btype = 0; btype < 4; btype++) {
+          parseError = parseError || !openBases[btype].empty();
+     }
+     if(parseError) {
+          Free(baseData);
+	  return NULL;
+     }
+     RNAStructure *rnaStruct = new RNAStructure();
+     rnaStruct->m_sequenceLength = seqLength;
+     rnaStruct->m_sequence = baseData;
+     rnaStruct->dotFormatCharSeq = (char *) malloc((seqLength + 1) * sizeof(char));
+     memcpy(rnaStruct->dotFormatCharSeq, dotData, seqLength);
+     rnaStruct->dotFormatCharSeq[seqLength] = '\0';
+     rnaStruct->m_sharedSequence = sharedSeq;
+     rnaStruct->charSeq = sharedSeq->charSeq;
+     rnaStruct->charSeqSize = seqLength;
+     rnaStruct->m_seqFingerprint = sharedSeq->seqFingerprint;
+     rnaStruct->m_seqFingerprintValid = true;
+     rnaStruct->m_exactPathName = strdup(fileName);
+     rnaStruct->m_pathname = GetSamplePathname(fileName, index, recordIndex);
+     return rnaStruct;
+
+}
+
+/* The sequence lines are the ones where the first field has some letters 
+ * and no digits or dot bracket structure symbols (the symbols other than the 
+ * nucleotides, e.g., 'X', '-' or '&', are read as X bases), and where only 
+ * numbers follow it (like the energies RNAsubopt prints). This rules out 
+ * the other lines that RNAfold prints, e.g., 
+ * " frequency of mfe structure in ensemble ...": */
+static bool IsDotBracketSequenceField(const char *field, size_t fieldLength) {
+     bool haveLetters = false;
+     for(size_t cidx = 0; cidx < fieldLength; cidx++) {
+          if(strchr(".,|()[]{}<>", field[cidx]) != NULL || isdigit((unsigned char) field[cidx])) {
+	       return false;
+	  }
+	  haveLetters = haveLetters || isalpha((unsigned char) field[cidx]);
+     }
+     const char *linePos = field + fieldLength;
+     while(haveLetters && *linePos != '\0') {
+          char *numberEnd = NULL;
+	  strtod(linePos, &numberEnd);
+	  if(numberEnd == linePos) {
+	       return false;
+	  }
+	  linePos = numberEnd;
+	  while(isspace(*linePos)) {
+	       linePos++;
+	  }
+     }
+     return haveLetters;
+}
+
+/* The free energy after the structure is given as "-3.40" (RNAsubopt), 
+ * "(-3.40)" or "( -3.40)" (RNAfold) or "[-3.40]": */
+static bool ParseDotBracketFreeEnergy(const char *energyField, double *freeEnergy) {
+     while(*energyField != '\0' && strchr(" \t([{", *energyField) != NULL) {
+          energyField++;
+     }
+     char *energyEnd = NULL;
+     double energyValue = strtod(energyField, &energyEnd);
+     if(energyEnd == energyField) {
+          return false;
+     }
+     *freeEnergy = energyValue;
+     return true;
+}
+
+typedef struct {
+     std::shared_ptr<RNAStructure::SharedSequence_t> sharedSeq;
+     std::string recordName;
+     int recordIndex;
+     int structCount;
+} DotBracketRecord_t;
+
+RNAStructure ** RNAStructure::CreateFromDotBracketRecordsFile(const char *filename, int *arrayCount) {
+
+     if(arrayCount == NULL) {
+          return NULL;
+     }
+     *arrayCount = 0;
+
+     FILE *fpDotBracketFile = CompressedInput::OpenInputFile(filename, "r");
+     if(fpDotBracketFile == NULL) {
+          TerminalText::PrintError("Opening file \"%s\" : %s\n", filename, strerror(errno));
+	  return NULL;
+     }
+     // The records are looked up by sequence, so that a sequence which is 
+     // repeated later in the file adds its structures to the same record:
+     std::vector<DotBracketRecord_t> dbRecords;
+     std::unordered_map<SequenceFingerprint_t, int, SequenceFingerprint::Hasher_t> recordsBySequence;
+     int curRecordIdx = -1;
+     std::string nextRecordName;
+     RNAStructure **rnaStructsArray = (RNAStructure **) malloc(RNASTRUCT_ARRAY_SIZE * sizeof(RNAStructure *));
+     int rnaStructArraySize = RNASTRUCT_ARRAY_SIZE;
+     int lineNum = 0, skippedLineCount = 0, firstSkippedLineNum = 0;
+     char *lineBuf = NULL;
+     size_t lineBufSize = 0;
+     ssize_t lineLength;
+     while((lineLength = getline(&lineBuf, &lineBufSize, fpDotBracketFile)) != -1) {
+          lineNum++;
+	  while(lineLength > 0 && isspace(lineBuf[lineLength - 1])) {
+	       lineBuf[--lineLength] = '\0';
+	  }
+	  char *linePos = lineBuf;
+	  while(isspace(*linePos)) {
+	       linePos++;
+	  }
+	  size_t fieldLength = strcspn(linePos, " \t");
+	  if(*linePos == '\0' || *linePos == '#') { // blank or comment line (skip it):
+	       continue;
+	  }
+	  else if(*linePos == '>') {
+	       linePos++;
+	       while(isspace(*linePos)) {
+	            linePos++;
+	       }
+	       nextRecordName = std::string(linePos);
+	       curRecordIdx = -1;
+	       continue;
+	  }
+	  else if(IsDotBracketSequenceField(linePos, fieldLength)) {
+	       for(size_t cidx = 0; cidx < fieldLength; cidx++) {
+	            linePos[cidx] = toupper(linePos[cidx]);
+	       }
+	       // The fingerprints of two different sequences may collide, so the 
+	       // record is only reused when the stored sequence matches as well:
+	       SequenceFingerprint_t seqFP = SequenceFingerprint::ComputeFingerprint(linePos, fieldLength);
+	       auto recordIt = recordsBySequence.find(seqFP);
+	       const RNAStructure::SharedSequence_t *recordSeq = recordIt != recordsBySequence.end() ? 
+		                                                 dbRecords[recordIt->second].sharedSeq.get() : 
+								 NULL;
+	       if(recordSeq != NULL && recordSeq->seqLength == fieldLength && 
+	          !strncmp(recordSeq->charSeq, linePos, fieldLength)) {
+	            curRecordIdx = recordIt->second;
+	       }
+	       else {
+	            linePos[fieldLength] = '\0';
+	            DotBracketRecord_t dbRecord;
+		    dbRecord.sharedSeq = CreateSharedSequence(linePos);
+		    dbRecord.recordName = nextRecordName;
+		    dbRecord.recordIndex = dbRecords.size();
+		    dbRecord.structCount = 0;
+		    if(!dbRecord.sharedSeq) {
+		         curRecordIdx = -1;
+			 skippedLineCount++;
+			 firstSkippedLineNum = firstSkippedLineNum > 0 ? firstSkippedLineNum : lineNum;
+			 continue;
+		    }
+		    curRecordIdx = dbRecords.size();
+		    dbRecords.push_back(dbRecord);
+		    recordsBySequence.emplace(seqFP, curRecordIdx);
+	       }
+	       nextRecordName.clear();
+	       continue;
+	  }
+	  RNAStructure *rnaStruct = NULL;
+	  if(curRecordIdx >= 0) {
+	       DotBracketRecord_t &dbRecord = dbRecords[curRecordIdx];
+	       rnaStruct = CreateFromSharedDotBracket(filename, dbRecord.sharedSeq, linePos, fieldLength, 
+			                              dbRecord.structCount, dbRecord.recordIndex);
+	       if(rnaStruct != NULL && dbRecord.structCount++ == 0 && !dbRecord.recordName.empty()) {
+	            rnaStruct->SetSuggestedStructureFolderName(dbRecord.recordName.c_str());
+	       }
+	  }
+	  if(rnaStruct == NULL) {
+	       skippedLineCount++;
+	       firstSkippedLineNum = firstSkippedLineNum > 0 ? firstSkippedLineNum : lineNum;
+	       continue;
+	  }
+	  double freeEnergy;
+	  if(ParseDotBracketFreeEnergy(linePos + fieldLength, &freeEnergy)) {
+	       rnaStruct->SetFreeEnergy(freeEnergy);
+	  }
+	  rnaStructsArray[*arrayCount] = rnaStruct;
+	  *arrayCount += 1;
+	  if(*arrayCount >= rnaStructArraySize) {
+	       rnaStructArraySize *= 2;
+	       rnaStructsArray = (RNAStructure **) 
+		                 realloc(rnaStructsArray, sizeof(RNAStructure *) * rnaStructArraySize);
+	  }
+     }
+     if(ferror(fpDotBracketFile)) {
+          TerminalText::PrintError("Reading DotBracket file \"%s\" : %s\n", filename, strerror(errno));
+     }
+     Free(lineBuf);
+     fclose(fpDotBracketFile);
+     if(skippedLineCount > 0) {
+          TerminalText::PrintWarning("Skipped %d malformed lines in the DotBracket file \"%s\" "
+			             "(the first is on line %d)\n", 
+			             skippedLineCount, filename, firstSkippedLineNum);
+     }
+     if(*arrayCount == 0) {
+          TerminalText::PrintError("Problem parsing the DOT file \"%s\" (is your syntax correct?)\n", filename);
+	  Free(rnaStructsArray);
+	  return NULL;
+     }
+     else if(*arrayCount == 1) { // a single structure keeps the plain file name:
+          Free(rnaStructsArray[0]->m_pathname);
+	  rnaStructsArray[0]->m_pathname = strdup(filename);
+     }
+     return rnaStructsArray;
+
+}
+
 RNAStructure ** RNAStructure::CreateFromBoltzmannFormatFile(const char *filename, int *arrayCount) {
 
      if(arrayCount == NULL) {
@@ -509,7 +964,7 @@ RNAStructure ** RNAStructure::CreateFromBoltzmannFormatFile(const char *filename
      }
      *arrayCount = 0;
      
-     FILE *fpDotBracketFile = fopen(filename, "r+");
+     FILE *fpDotBracketFile = CompressedInput::OpenInputFile(filename, "r");
      if(fpDotBracketFile == NULL) {
           TerminalText::PrintError("Opening file \"%s\" : %s\n", filename, strerror(errno));
      }
@@ -591,7 +1046,7 @@ RNAStructure ** RNAStructure::CreateFromBoltzmannFormatFile(const char *filename
                pairingDataBuf[baseIdx] == '}') {
                 int pairIndex = unpairedBasePairs.top();
                 unpairedBasePairs.pop();
-                curBaseData->m_pair = pairIndex;
+                curBaseData->m_pair = pairIndex - 1;
                 RNAStructure::BaseData *pairedBaseData = &(rnaStruct->m_sequence[pairIndex - 1]);
                 pairedBaseData->m_pair = baseIdx;
            }
@@ -606,10 +1061,6 @@ RNAStructure ** RNAStructure::CreateFromBoltzmannFormatFile(const char *filename
                 return NULL;
              }
           }
-          #if PERFORM_BRANCH_TYPE_ID
-          rnaStruct->branchType = (RNABranchType_t*) malloc( 
-                                   sizeof(RNABranchType_t) * rnaStruct->m_sequenceLength);
-          #endif
 
       // we will have multiple samples in this files, need to append a sample number suffix to 
       // distinguish between them for the users in the GUI: 
@@ -633,9 +1084,6 @@ RNAStructure ** RNAStructure::CreateFromBoltzmannFormatFile(const char *filename
       strncpy(rnaStruct->charSeq, baseDataBuf, seqLength + 1);
       rnaStruct->charSeq[rnaStruct->charSeqSize] = '\0';
       rnaStruct->GenerateDotFormatDataFromPairings();
-      #if PERFORM_BRANCH_TYPE_ID    
-      RNABranchType_t::PerformBranchClassification(rnaStruct, rnaStruct->m_sequenceLength);
-      #endif
      
       *arrayCount += 1;
       if(*arrayCount >= rnaStructArraySize) {
@@ -661,9 +1109,10 @@ RNAStructure ** RNAStructure::CreateFromHelixTripleFormatFile(const char *filena
      }
      *arrayCount = 0;
      
-     FILE *fpHelixFile = fopen(filename, "r+");
+     FILE *fpHelixFile = CompressedInput::OpenInputFile(filename, "r");
      if(fpHelixFile == NULL) {
           TerminalText::PrintError("Opening file \"%s\" : %s\n", filename, strerror(errno));
+          return NULL;
      }
      char lineBuf[MAX_SEQUENCE_SIZE + 1];
      char baseDataBuf[MAX_SEQUENCE_SIZE + 1], pairingDataBuf[MAX_SEQUENCE_SIZE + 1];
@@ -780,7 +1229,7 @@ RNAStructure ** RNAStructure::CreateFromHelixTripleFormatFile(const char *filena
           pairingDataBuf[baseIdx] == '}') {
            int pairIndex = unpairedBasePairs.top();
            unpairedBasePairs.pop();
-           curBaseData->m_pair = pairIndex;
+           curBaseData->m_pair = pairIndex - 1;
            RNAStructure::BaseData *pairedBaseData = &(rnaStruct->m_sequence[pairIndex - 1]);
            pairedBaseData->m_pair = baseIdx;
       }
@@ -795,19 +1244,12 @@ RNAStructure ** RNAStructure::CreateFromHelixTripleFormatFile(const char *filena
            return NULL;
       }
      }
-     #if PERFORM_BRANCH_TYPE_ID
-     rnaStruct->branchType = (RNABranchType_t*) malloc( 
-                              sizeof(RNABranchType_t) * rnaStruct->m_sequenceLength);
-     #endif
      rnaStruct->m_pathname = strdup(filename);
      rnaStruct->charSeqSize = seqLength;
      rnaStruct->charSeq = (char *) malloc((rnaStruct->charSeqSize + 1) * sizeof(char));
      strncpy(rnaStruct->charSeq, baseDataBuf, seqLength + 1);
      rnaStruct->charSeq[rnaStruct->charSeqSize] = '\0';
      rnaStruct->GenerateDotFormatDataFromPairings();
-     #if PERFORM_BRANCH_TYPE_ID    
-     RNABranchType_t::PerformBranchClassification(rnaStruct, rnaStruct->m_sequenceLength);
-     #endif
      *arrayCount += 1;
      if(*arrayCount < rnaStructArraySize) {
           rnaStructArraySize = *arrayCount;
@@ -822,15 +1264,30 @@ RNAStructure** RNAStructure::CreateFromFASTAFile(const char *filename, int *arra
      if(filename == NULL || arrayCount == NULL) {
           return NULL;
      }
+     *arrayCount = 0;
      try {
-          vector<ViennaBoltzmannSampling::StructureData_t> sdv = 
-		 ViennaBoltzmannSampling::GetBoltzmannSamples(filename);
-	  *arrayCount = sdv.size();
-	  RNAStructure** rnaStructsArr = ViennaBoltzmannSampling::GenerateStructuresFromSampleData(filename, sdv);
-	  if(rnaStructsArr == NULL) {
-	       *arrayCount = 0;
+          vector<string> fastaParseResults = ViennaBoltzmannSampling::ParseFASTAFileFromPath(filename);
+	  char **dotSampleData = ViennaBoltzmannSampling::ComputeVRNABoltzmannSamples(fastaParseResults);
+	  if(ViennaBoltzmannSampling::CountVRNASampleSize(dotSampleData) == 0) {
+	       Free(dotSampleData);
+	       throw string("VRNA returned no samples.");
+	  }
+	  std::shared_ptr<SharedSequence_t> sharedSeq = CreateSharedSequence(
+		  fastaParseResults[ViennaBoltzmannSampling::INDEX_BASESEQ_DATA].c_str());
+	  vector<RNAStructure *> sampleStructs;
+	  ViennaBoltzmannSampling::GenerateStructuresFromSamples(filename, sharedSeq, dotSampleData, 
+			                                         0, sampleStructs);
+	  if(sampleStructs.size() == 0) {
 	       return NULL;
 	  }
+	  else if(sampleStructs.size() < DEFAULT_SAMPLE_SIZE) {
+               TerminalText::PrintWarning("Actual computed sample size for \"%s\" is %d < %d\n", 
+			                  filename, (int) sampleStructs.size(), DEFAULT_SAMPLE_SIZE);
+	  }
+	  RNAStructure **rnaStructsArr = (RNAStructure **) malloc(sampleStructs.size() * 
+			                                          sizeof(RNAStructure *));
+	  std::copy(sampleStructs.begin(), sampleStructs.end(), rnaStructsArr);
+	  *arrayCount = sampleStructs.size();
 	  return rnaStructsArr;
      } catch(std::string errorMsg) {
           TerminalText::PrintError("Unable to parse FASTA file \"%s\": %s\n", filename, errorMsg.c_str());
@@ -901,6 +1358,13 @@ void RNAStructure::SetFileCommentLines(std::string commentLineData, InputFileTyp
      m_fileType = fileType;
 }
 
+void RNAStructure::SetSuggestedStructureFolderName(const char *folderName) {
+     Free(m_suggestedFolderName);
+     if(folderName != NULL && folderName[0] != '\0') {
+          m_suggestedFolderName = strdup(folderName);
+     }
+}
+
 const char* RNAStructure::GetSuggestedStructureFolderName() {
       
      if(m_suggestedFolderName) { // we have already computed this data:
@@ -1180,7 +1644,23 @@ void RNAStructure::DisplayFileContents(const char *titleSuffix)
 }
 
 std::string RNAStructure::GetHelicesList(std::string strDelim) {
-     throw "NOT IMPLEMENTED ERROR!!";
+     const StructureElementTree_t *elementTree = GetElementTree();
+     std::string helicesList;
+     for(int n = 0; n < elementTree->GetNodeCount(); n++) {
+          const StructureElementTree_t::ElementNode_t &stemNode = elementTree->GetNode(n);
+	  if(stemNode.elementType != StructureElementTree_t::ELEMENT_STEM) {
+	       continue;
+	  }
+	  char helixStr[MAX_BUFFER_SIZE];
+	  snprintf(helixStr, MAX_BUFFER_SIZE, "(%d-%d, %d-%d)", 
+		   stemNode.openIdx + 1, stemNode.openIdx + stemNode.length, 
+		   stemNode.closeIdx - stemNode.length + 2, stemNode.closeIdx + 1);
+	  if(helicesList.length() > 0) {
+	       helicesList += strDelim;
+	  }
+	  helicesList += std::string(helixStr);
+     }
+     return helicesList;
 }
 
 std::string RNAStructure::GetWatsonCrickPairs(std::string strDelim) {
@@ -1196,7 +1676,103 @@ std::string RNAStructure::GetNonCanonicalPairs(std::string strDelim) {
 }
 
 std::string RNAStructure::GetPseudoKnots(std::string strDelim) {
-     throw "NOT IMPLEMENTED ERROR!!";
+     std::string pkPairsList;
+     for(unsigned int bidx = 0; bidx < GetLength(); bidx++) {
+          BasePair pairIdx = GetBaseAt(bidx)->m_pair;
+	  if(pairIdx == UNPAIRED || pairIdx < bidx || GetPseudoknotPageAt(bidx) == 0) {
+	       continue;
+	  }
+	  char pairStr[MAX_BUFFER_SIZE];
+	  snprintf(pairStr, MAX_BUFFER_SIZE, "(%d, %d)", bidx + 1, pairIdx + 1);
+	  if(pkPairsList.length() > 0) {
+	       pkPairsList += strDelim;
+	  }
+	  pkPairsList += std::string(pairStr);
+     }
+     return pkPairsList;
+}
+
+std::vector<int> RNAStructure::GetPairTable() const {
+     EnsureParsed();
+     std::vector<int> pairTable(m_sequenceLength, PKPT_UNPAIRED);
+     for(unsigned int bidx = 0; bidx < m_sequenceLength; bidx++) {
+          if(m_sequence[bidx].m_pair != UNPAIRED) {
+	       pairTable[bidx] = m_sequence[bidx].m_pair;
+	  }
+     }
+     return pairTable;
+}
+
+std::vector<int> RNAStructure::GetNestedPairTable() {
+     ComputePseudoknotData();
+     std::vector<int> nestedPairTable = GetPairTable();
+     for(unsigned int bidx = 0; bidx < m_sequenceLength; bidx++) {
+          if(m_pkPageLayers[bidx] != 0) {
+	       nestedPairTable[bidx] = PKPT_UNPAIRED;
+	  }
+     }
+     return nestedPairTable;
+}
+
+void RNAStructure::ComputePseudoknotData() {
+     if(m_pkPageCount >= 0) {
+          return;
+     }
+     EnsureParsed();
+     std::vector<int> pairTable = GetPairTable();
+     std::vector<uint8_t> pageLayers;
+     m_pkCrossingPairsCount = PseudoknotDetection::CountCrossingPairs(pairTable);
+     m_pkPageCount = PseudoknotDetection::ComputePageDecomposition(pairTable, pageLayers);
+     m_pkKnottedPairsCount = 0;
+     Free(m_pkPageLayers);
+     m_pkPageLayers = (uint8_t *) malloc(MAX(1, m_sequenceLength) * sizeof(uint8_t));
+     for(unsigned int bidx = 0; bidx < m_sequenceLength; bidx++) {
+          m_pkPageLayers[bidx] = pageLayers[bidx];
+	  if(pageLayers[bidx] != PKPAGE_UNPAIRED && pageLayers[bidx] > 0 && 
+	     m_sequence[bidx].m_pair > bidx) {
+	       m_pkKnottedPairsCount++;
+	  }
+     }
+}
+
+unsigned int RNAStructure::GetCrossingPairsCount() {
+     ComputePseudoknotData();
+     return m_pkCrossingPairsCount;
+}
+
+unsigned int RNAStructure::GetPseudoknottedPairsCount() {
+     ComputePseudoknotData();
+     return m_pkKnottedPairsCount;
+}
+
+int RNAStructure::GetPseudoknotPageCount() {
+     ComputePseudoknotData();
+     return m_pkPageCount;
+}
+
+uint8_t RNAStructure::GetPseudoknotPageAt(unsigned int position) {
+     ComputePseudoknotData();
+     if(position >= m_sequenceLength) {
+          return PKPAGE_UNPAIRED;
+     }
+     return m_pkPageLayers[position];
+}
+
+void RNAStructure::InvalidatePairData() {
+     m_pairListHashValid = false;
+     Free(m_pkPageLayers);
+     m_pkPageCount = -1;
+     m_pkCrossingPairsCount = m_pkKnottedPairsCount = 0;
+     Delete(m_elementTree, StructureElementTree_t);
+     Free(m_branchIDs);
+}
+
+const StructureElementTree_t * RNAStructure::GetElementTree() {
+     if(m_elementTree != NULL) {
+          return m_elementTree;
+     }
+     m_elementTree = new StructureElementTree_t(GetNestedPairTable());
+     return m_elementTree;
 }
 
 std::string RNAStructure::GetWobblePairs(std::string strDelim) {
@@ -1204,11 +1780,34 @@ std::string RNAStructure::GetWobblePairs(std::string strDelim) {
 }
 
 std::string RNAStructure::GetIsolatedPairs(std::string strDelim) {
-     throw "NOT IMPLEMENTED ERROR!!";
+     return GetStemPairsList(strDelim, true);
 }
 
 std::string RNAStructure::GetNonIsolatedPairs(std::string strDelim) {
-     throw "NOT IMPLEMENTED ERROR!!";
+     return GetStemPairsList(strDelim, false);
+}
+
+std::string RNAStructure::GetStemPairsList(std::string strDelim, bool isolatedPairs) {
+     const StructureElementTree_t *elementTree = GetElementTree();
+     std::string pairsList;
+     for(unsigned int bidx = 0; bidx < GetLength(); bidx++) {
+          int stemIdx = elementTree->GetElementIndexAt(bidx);
+	  if(elementTree->GetElementTypeAt(bidx) != StructureElementTree_t::ELEMENT_STEM || 
+	     GetBaseAt(bidx)->m_pair < bidx) {
+	       continue;
+	  }
+	  bool isolatedStem = elementTree->GetNode(stemIdx).length == 1;
+	  if(isolatedStem != isolatedPairs) {
+	       continue;
+	  }
+	  char pairStr[MAX_BUFFER_SIZE];
+	  snprintf(pairStr, MAX_BUFFER_SIZE, "(%d, %d)", bidx + 1, GetBaseAt(bidx)->m_pair + 1);
+	  if(pairsList.length() > 0) {
+	       pairsList += strDelim;
+	  }
+	  pairsList += std::string(pairStr);
+     }
+     return pairsList;
 }
 
 void RNAStructure::GenerateString()
@@ -1216,6 +1815,7 @@ void RNAStructure::GenerateString()
     /*
        <id> [ACGU] - [ACGU] <id>
     */
+    EnsureParsed();
     int size = (m_sequenceLength + 2) * 38;
     m_ctDisplayString = (char *) malloc(sizeof(char) * (size + 1));
     m_ctDisplayFormatString = (char *) malloc(sizeof(char) * (size + 1));
@@ -1400,7 +2000,7 @@ size_t RNAStructure::GenerateDotBracketFormatString(char *strBuf,
      }
      strcpy(strBuf, fastaFileStr);
      strcat(strBuf, "\n");
-     strcat(strBuf, dotFormatCharSeq);
+     strcat(strBuf, GetDotBracketSequenceString());
      return fastaFileSize + 1 + charSeqSize;
 }
 
@@ -1569,9 +2169,10 @@ int RNAStructure::ActionOpenCTFileViewerWindow(int structureFolderIndex,
      m_ctFileSelectionWin->hide();
      StructureManager *rnaStructManager = RNAStructViz::GetInstance()->GetStructureManager();
      int fileSelectionIndex = m_ctFileSelectionWin->getFileSelectionIndex();
-     int structIndex = rnaStructManager->GetFolderAt(structureFolderIndex)->
-                       folderStructs[fileSelectionIndex];
-     RNAStructure *rnaStructure = rnaStructManager->GetStructure(structIndex);
+     StructureHandle_t structHandle = rnaStructManager->GetFolderAt(structureFolderIndex)->
+                                      folderStructs[fileSelectionIndex];
+     int structIndex = structHandle.slotIndex;
+     RNAStructure *rnaStructure = rnaStructManager->GetStructure(structHandle);
      if((rnaStructManager != NULL) && (rnaStructure != NULL)) { 
           if(minArcIdx <= 0 || maxArcIdx <= 0) { 
                minArcIdx = 1;
@@ -16,12 +16,15 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 
 #include "ConfigOptions.h"
 #include "BaseSequenceIDs.h"
 #include "InputWindow.h"
+#include "BranchTypeIdentification.h"
+#include "SequenceFingerprint.h"
 
-class RNABranchType_t;
+class StructureElementTree_t;
 
 #ifndef MIN3
      #define MIN3(x, y, z)                MIN((x), MIN((y), (z)))
@@ -49,10 +52,6 @@ class RNAStructure
         
 	typedef uint16_t BasePair;
 
-        #if PERFORM_BRANCH_TYPE_ID
-        class RNABranchType_t *branchType;
-        #endif
-
         // A value for the pair of unpaired bases.
         static const BasePair UNPAIRED;
 
@@ -115,18 +114,106 @@ class RNAStructure
 	    0 is returned if there is an error reading the file.
         */
         static RNAStructure* CreateFromFile(const char* filename, const bool isBPSEQ);
-        static RNAStructure* CreateFromDotBracketFile(const char *filename); 
+
+        /*
+	    Reads only the base and pair columns of a CT/NOPCT/BPSEQ file, so 
+	    the sequence (used to group structures into folders) and the hash 
+	    of the pairs (used to spot duplicate structures) are available 
+	    right away. This still reads every line of the file, but does not 
+	    build the base array or any of the display data: that is parsed 
+	    from the file the first time any of the base or pair data is 
+	    requested (see EnsureParsed).
+	    Returns 0 if the base column is malformed, in which case the 
+	    caller should fall back to CreateFromFile to report the error.
+        */
+        static RNAStructure* CreateDeferredFromFile(const char* filename, const bool isBPSEQ);
 	static RNAStructure* CreateFromDotBracketData(const char *fileName, 
 			                              const char *baseSeq, const char *dotData, 
 						      int index = -1);
 
+        /*
+	    The base sequence data shared by all of the structures sampled for 
+	    one sequence. The structures created from it hold a reference in 
+	    place of their own copy of the sequence characters, and copy their 
+	    base array from the all unpaired template.
+        */
+        typedef struct SharedSequence_t {
+             unsigned int seqLength;
+             char *charSeq;
+             BaseData *unpairedBases;
+             SequenceFingerprint_t seqFingerprint;
+
+             SharedSequence_t() : seqLength(0), charSeq(NULL), unpairedBases(NULL) {}
+             ~SharedSequence_t();
+        } SharedSequence_t;
+
+        static std::shared_ptr<SharedSequence_t> CreateSharedSequence(const char *baseSeq);
+
+        /*
+	    Creates a structure directly from a ViennaRNA pair table (where 
+	    pairTable[0] is the length and pairTable[i] is the one-based index 
+	    of the partner of base i, or zero), without the round trip through 
+	    the dot bracket parser. The structure is named by its sample index, 
+	    or by nameSuffix when given (e.g., for the MFE structure). 
+	    Returns 0 if the lengths do not match.
+        */
+        static RNAStructure* CreateFromPairTable(const char *fileName, 
+			                         const std::shared_ptr<SharedSequence_t> &sharedSeq, 
+						 const short *pairTable, int index = -1, 
+						 int recordIndex = 0, const char *nameSuffix = NULL);
+
+        /*
+	    Creates a structure from one dot bracket string which shares the 
+	    sequence with the other structures read for the same sequence. 
+	    The pseudoknot bracket types ([], {}, <>) are matched separately, 
+	    and the string is kept as the dot bracket display data. 
+	    Returns 0 (without printing an error) if the brackets do not 
+	    match up or the length differs from the sequence.
+        */
+        static RNAStructure* CreateFromSharedDotBracket(const char *fileName, 
+			                                const std::shared_ptr<SharedSequence_t> &sharedSeq, 
+							const char *dotData, size_t dotLength, 
+							int index = -1, int recordIndex = 0);
+
         #define RNASTRUCT_ARRAY_SIZE        (16)
 	static RNAStructure** CreateFromBoltzmannFormatFile(const char *filename, int *arrayCount);
 	static RNAStructure** CreateFromHelixTripleFormatFile(const char *filename, int *arrayCount);
 	static RNAStructure** CreateFromFASTAFile(const char *filename, int *arrayCount);
 
+        /*
+	    Reads all of the records in a dot bracket file with any number of 
+	    structures for one or more sequences (e.g., the output of RNAsubopt 
+	    or RNAfold). Each sequence line starts a record, which is named by 
+	    the preceding '>' header line (if any), and the structure lines 
+	    that follow it may give the free energy after the dot bracket 
+	    string. The file is read one line at a time, and the structures 
+	    for the same sequence share its storage.
+        */
+	static RNAStructure** CreateFromDotBracketRecordsFile(const char *filename, int *arrayCount);
+
     private:
 	void GenerateDotFormatDataFromPairings();
+	void CompleteDeferredParse();
+	static char * GetSamplePathname(const char *fileName, int index, int recordIndex = 0, 
+			                const char *nameSuffix = NULL);
+
+    public:
+	/* 
+	 * Completes the parse of a structure created by CreateDeferredFromFile. 
+	 * All of the accessors of the base and pair data call this first. 
+	 * The structure is modified without any locking, so this (and so any 
+	 * of those accessors) must only be called from the main (FLTK) 
+	 * thread once the structure has been handed over by the parsers: 
+	 */
+	inline void EnsureParsed() const {
+	     if(m_deferredParse) {
+	          const_cast<RNAStructure *>(this)->CompleteDeferredParse();
+	     }
+	}
+
+	inline bool IsParseDeferred() const {
+	     return m_deferredParse;
+	}
 
     public:
         /*
@@ -140,11 +227,15 @@ class RNAStructure
         const BaseData* GetBaseAt(unsigned int position) const;
 	BaseData* GetBaseAt(unsigned int position);
         
+        /*
+	    Return the (16S) domain of the base at a given location. The domains 
+	    are classified on the first call (see BranchTypeIdentification.h).
+        */
         #if PERFORM_BRANCH_TYPE_ID
-	RNABranchType_t* GetBranchTypeAt(unsigned int position);
+	BranchID_t GetBranchIDAt(unsigned int position);
         #else
-        inline RNABranchType_t*	GetBranchTypeAt(unsigned int position) {
-	     return NULL;
+        inline BranchID_t GetBranchIDAt(unsigned int position) {
+	     return BRANCH_UNDEFINED;
 	}
         #endif
 
@@ -174,6 +265,28 @@ class RNAStructure
             return charSeqSize;
         }
 
+        /*
+	    Get the 128-bit fingerprint of the full base sequence. This is 
+	    computed once (by the parser threads when the file is loaded) 
+	    and then cached.
+        */
+        inline const SequenceFingerprint_t & GetSequenceFingerprint() const
+        {
+            if (!m_seqFingerprintValid)
+            {
+                m_seqFingerprint = SequenceFingerprint::ComputeFingerprint(charSeq, charSeqSize);
+                m_seqFingerprintValid = true;
+            }
+            return m_seqFingerprint;
+        }
+
+        /*
+	    Get a hash of the pair partner of every base. For the deferred 
+	    structures this is recorded while scanning the file, so comparing 
+	    it does not force the full parse.
+        */
+        uint64_t GetPairListHash() const;
+
         /*
 	 * Get the file name for this sequence.
          *
@@ -187,6 +300,15 @@ class RNAStructure
 	const char* GetInitialFileComment() const;
 	void SetFileCommentLines(std::string commentLineData, InputFileTypeSpec fileType);
 	const char* GetSuggestedStructureFolderName();
+	void SetSuggestedStructureFolderName(const char *folderName);
+
+	/* The free energy (in kcal/mol) given for the structure in its file: */
+	inline bool HasFreeEnergy() const { return m_haveFreeEnergy; }
+	inline double GetFreeEnergy() const { return m_freeEnergy; }
+	inline void SetFreeEnergy(double freeEnergy) {
+	     m_freeEnergy = freeEnergy;
+	     m_haveFreeEnergy = true;
+	}
 
         /*
 	     Display the contents of the file in a window (or bring it to the top if already existing).
@@ -194,9 +316,13 @@ class RNAStructure
         void DisplayFileContents(const char *titleSuffix = NULL);
 
         /*
-         Returns a reference to the local m_sequence BaseData* pointer.
+         Returns a reference to the local m_sequence BaseData* pointer. 
+	 The caller may change the pairs through it, so the data computed 
+	 from the pairs is dropped and recomputed on the next use.
         */
         inline BaseData* & getSequence() {
+            EnsureParsed();
+	    InvalidatePairData();
             return m_sequence;
         }
 
@@ -232,6 +358,33 @@ class RNAStructure
         std::string GetIsolatedPairs(std::string strDelim = RNAStructure::DEFAULT_STRING_LIST_DELIMITER);
         std::string GetNonIsolatedPairs(std::string strDelim = RNAStructure::DEFAULT_STRING_LIST_DELIMITER);
 
+	/* 
+	 * Pseudoknot (crossing pair) data. The pairs are split into pages of 
+	 * non-crossing arcs where page 0 holds the largest nested subset. 
+	 * The page data is computed once on the first call to these functions 
+	 * (and again after InvalidatePairData is called when the pairs change): 
+	 */
+	std::vector<int> GetPairTable() const;
+	std::vector<int> GetNestedPairTable();
+	unsigned int GetCrossingPairsCount();
+	unsigned int GetPseudoknottedPairsCount();
+	int GetPseudoknotPageCount();
+	uint8_t GetPseudoknotPageAt(unsigned int position);
+	
+	inline bool IsPseudoknotted() {
+	     return GetPseudoknotPageCount() > 1;
+	}
+
+	/*
+	 * Returns the loop/helix decomposition tree of the nested (page 0) 
+	 * pairs in the structure. The tree is built on the first call and is 
+	 * owned by this object: 
+	 */
+	const StructureElementTree_t * GetElementTree();
+
+	/* Drops the cached pseudoknot pages, element tree and branch types: */
+	void InvalidatePairData();
+
     private:
         /*
 	     Constructor is private to force use of Create methods.
@@ -246,13 +399,18 @@ class RNAStructure
 	     return GetLength() == rhs.GetLength() && !strcasecmp(GetSequenceString(), rhs.GetSequenceString());
 	}
 
-	/* Additionally, checks that the pairing data for the two structures matches as well: */
+	/* Additionally, checks that the pairing data for the two structures matches as well. 
+	 * The sequence fingerprints and pair hashes are compared first, so the bases of 
+	 * deferred structures are only parsed when these all agree: 
+	 */
 	inline bool operator==(const RNAStructure &rhs) {
-	     if(!(*this ^ rhs)) {
+	     if(GetLength() != rhs.GetLength() || 
+	        GetSequenceFingerprint() != rhs.GetSequenceFingerprint() || 
+		GetPairListHash() != rhs.GetPairListHash() || !(*this ^ rhs)) {
 	          return false;
 	     }
 	     for(int sidx = 0; sidx < GetLength(); sidx++) {
-	          if(GetBaseAt(sidx)->m_index != rhs.GetBaseAt(sidx)->m_pair) {
+	          if(GetBaseAt(sidx)->m_pair != rhs.GetBaseAt(sidx)->m_pair) {
 		       return false;
 		  }
 	     }
@@ -261,6 +419,8 @@ class RNAStructure
 
     private:
         void copyRNAStructure(const RNAStructure &rnaStruct);
+	void ComputePseudoknotData();
+	std::string GetStemPairsList(std::string strDelim, bool isolatedPairs);
 
         /*
 	     Generate the string used for text display of the structure.
@@ -287,6 +447,7 @@ class RNAStructure
 	}
 
 	inline const char * GetDotBracketSequenceString() const {
+	     EnsureParsed();
 	     if(dotFormatCharSeq == NULL) {
 	          return "";
 	     }
@@ -304,12 +465,19 @@ class RNAStructure
         unsigned int m_sequenceLength;
         BaseData* m_sequence;
 
+	// Set while only the base column of the file has been read:
+	bool m_deferredParse, m_deferredIsBPSEQ;
+
         // The full path name of the file from which this sequence came.
         char *m_pathname, *m_pathname_noext, *m_exactPathName;
 	char *m_fileCommentLine, *m_suggestedFolderName;
 	InputFileTypeSpec m_fileType;
+	double m_freeEnergy;
+	bool m_haveFreeEnergy;
 
 	friend class RNAStructViz;
+	friend class StructureCache;
+	friend class StructureArchive;
         inline static InputWindow *m_ctFileSelectionWin = NULL;
 
         // Info for displaying the file contents
@@ -329,6 +497,25 @@ class RNAStructure
         char *m_ctDisplayFormatString, *m_seqDisplayFormatString;
 	char *charSeq, *dotFormatCharSeq;
         unsigned int charSeqSize;
+	// Set when charSeq points into a sequence shared with other structures:
+	std::shared_ptr<SharedSequence_t> m_sharedSequence;
+	mutable SequenceFingerprint_t m_seqFingerprint;
+	mutable bool m_seqFingerprintValid;
+
+	// Cached hash of the pairs (see GetPairListHash):
+	mutable uint64_t m_pairListHash;
+	mutable bool m_pairListHashValid;
+
+	// Lazily computed pseudoknot page data (see GetPseudoknotPageAt):
+	uint8_t *m_pkPageLayers;
+	int m_pkPageCount;
+	unsigned int m_pkCrossingPairsCount, m_pkKnottedPairsCount;
+
+	// Lazily built loop/helix element tree (see GetElementTree):
+	StructureElementTree_t *m_elementTree;
+
+	// Lazily classified branch (domain) IDs, one BranchID_t per base:
+	uint8_t *m_branchIDs;
 
     public:
 	class Util { 
@@ -8,21 +8,206 @@
 #include <string.h>
 #include <limits.h>
 #include <time.h>
+#include <math.h>
+
+#include <unordered_map>
 
 #include <FL/fl_draw.H>
 #include <FL/Fl_Native_File_Chooser.H>
 
 #include "RadialLayoutImage.h"
 #include "RNAStructure.h"
+#include "StructureLayout.h"
 #include "ThemesConfig.h"
 #include "ConfigOptions.h"
 #include "ConfigParser.h"
 #include "TerminalPrinting.h"
 
+RadialLayoutDisplayList_t::RadialLayoutDisplayList_t() : 
+     width(0), height(0), nodeSize(RADIAL_NODE_SIZE), maxEdgeLength(0.0), 
+     gridCols(0), gridRows(0) {}
+
+void RadialLayoutDisplayList_t::Clear() {
+     nodes.clear();
+     edges.clear();
+     nodeGrid.clear();
+     edgeGrid.clear();
+     width = height = 0;
+     gridCols = gridRows = 0;
+     maxEdgeLength = 0.0;
+}
+
+void RadialLayoutDisplayList_t::SetExtents(int w, int h, double nodeSize) {
+     width = w;
+     height = h;
+     this->nodeSize = nodeSize;
+}
+
+int RadialLayoutDisplayList_t::AddNode(float x, float y, char baseCh, int baseIndex, bool highlighted) {
+     LayoutNode_t layoutNode;
+     layoutNode.x = x;
+     layoutNode.y = y;
+     layoutNode.baseCh = baseCh;
+     layoutNode.baseIndex = baseIndex;
+     layoutNode.highlighted = highlighted;
+     nodes.push_back(layoutNode);
+     return nodes.size() - 1;
+}
+
+void RadialLayoutDisplayList_t::AddEdge(int fromNode, int toNode) {
+     if(fromNode < 0 || toNode < 0 || fromNode >= (int) nodes.size() || toNode >= (int) nodes.size()) {
+          return;
+     }
+     LayoutEdge_t layoutEdge;
+     layoutEdge.fromNode = fromNode;
+     layoutEdge.toNode = toNode;
+     edges.push_back(layoutEdge);
+}
+
+void RadialLayoutDisplayList_t::BuildIndex() {
+     gridCols = MAX(1, width / RADIAL_INDEX_CELL_SIZE + 1);
+     gridRows = MAX(1, height / RADIAL_INDEX_CELL_SIZE + 1);
+     nodeGrid.assign(gridCols * gridRows, std::vector<int>());
+     edgeGrid.assign(gridCols * gridRows, std::vector<int>());
+     for(size_t n = 0; n < nodes.size(); n++) {
+          nodeGrid[GetGridCell(nodes[n].x, nodes[n].y)].push_back(n);
+     }
+     // The edges are indexed by their midpoints, and the lookups are padded 
+     // by half of the longest edge so none of the crossing edges are missed:
+     maxEdgeLength = 0.0;
+     for(size_t e = 0; e < edges.size(); e++) {
+          const LayoutNode_t &fromNode = nodes[edges[e].fromNode];
+	  const LayoutNode_t &toNode = nodes[edges[e].toNode];
+	  double edgeLength = sqrt(Square(fromNode.x - toNode.x) + Square(fromNode.y - toNode.y));
+	  maxEdgeLength = MAX(maxEdgeLength, edgeLength);
+	  edgeGrid[GetGridCell((fromNode.x + toNode.x) / 2.0, (fromNode.y + toNode.y) / 2.0)].push_back(e);
+     }
+}
+
+RadialLayoutDisplayList_t::LayoutDetailLevel_t RadialLayoutDisplayList_t::GetDetailLevel(double scale) const {
+     double nodePixels = nodeSize * scale;
+     if(nodePixels < RADIAL_LOD_MIN_NODE_SIZE) {
+          return LOD_BACKBONE_ONLY;
+     }
+     else if(nodePixels < RADIAL_LOD_MIN_LABEL_SIZE) {
+          return LOD_PLAIN_NODES;
+     }
+     return LOD_LABELED_NODES;
+}
+
+void RadialLayoutDisplayList_t::Render(cairo_t *cr, double scale, double clipX, double clipY, 
+		                       double clipWidth, double clipHeight) const {
+
+     if(cr == NULL || nodes.size() == 0 || nodeGrid.size() == 0 || scale <= 0.0) {
+          return;
+     }
+     LayoutDetailLevel_t detailLevel = GetDetailLevel(scale);
+     double nodePixels = nodeSize * scale;
+     cairo_save(cr);
+     cairo_rectangle(cr, clipX, clipY, clipWidth, clipHeight);
+     cairo_clip(cr);
+
+     // Find the grid cells under the clip rectangle (in the unzoomed coordinates):
+     double padding = MAX(nodeSize, maxEdgeLength / 2.0);
+     int minCell = GetGridCell(clipX / scale - padding, clipY / scale - padding);
+     int maxCell = GetGridCell((clipX + clipWidth) / scale + padding, 
+		               (clipY + clipHeight) / scale + padding);
+     int minCol = minCell % gridCols, minRow = minCell / gridCols;
+     int maxCol = maxCell % gridCols, maxRow = maxCell / gridCols;
+
+     cairo_set_line_width(cr, detailLevel == LOD_LABELED_NODES ? MAX(1.0, 2.0 * nodePixels / RADIAL_NODE_SIZE) : 1.0);
+     cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
+     CairoColor_t edgeColor = CairoColor_t::GetCairoColor(CairoColorSpec_t::CR_BLACK).Lighten(0.5).ToOpaque();
+     for(int row = minRow; row <= maxRow; row++) {
+          for(int col = minCol; col <= maxCol; col++) {
+	       const std::vector<int> &cellEdges = edgeGrid[row * gridCols + col];
+	       for(size_t e = 0; e < cellEdges.size(); e++) {
+	            const LayoutNode_t &fromNode = nodes[edges[cellEdges[e]].fromNode];
+		    const LayoutNode_t &toNode = nodes[edges[cellEdges[e]].toNode];
+		    if(detailLevel == LOD_BACKBONE_ONLY) {
+		         // Color the backbone by the bases when the nodes are not drawn:
+		         CairoColor_t lineColor = RadialLayoutDisplayWindow::GetBaseNodeColor(toNode.baseCh);
+			 lineColor = toNode.highlighted ? lineColor.ToOpaque() : lineColor.ToGrayscale().ToOpaque();
+			 lineColor.ApplyRGBAColor(cr);
+		    }
+		    else {
+		         edgeColor.ApplyRGBAColor(cr);
+		    }
+		    cairo_move_to(cr, fromNode.x * scale, fromNode.y * scale);
+		    cairo_line_to(cr, toNode.x * scale, toNode.y * scale);
+		    cairo_stroke(cr);
+	       }
+	  }
+     }
+     if(detailLevel == LOD_BACKBONE_ONLY) {
+          cairo_restore(cr);
+	  return;
+     }
+
+     double nodeRadius = detailLevel == LOD_LABELED_NODES ? 
+	                 MAX(1.0, nodePixels / M_SQRT2 / 2.0 - 3.0 * nodePixels / RADIAL_NODE_SIZE) : 
+			 nodePixels / 2.0;
+     cairo_set_font_size(cr, RADIAL_NODE_FONT_SIZE * nodePixels / RADIAL_NODE_SIZE);
+     CairoColor_t nodeTextColor = CairoColor_t::GetCairoColor(CairoColorSpec_t::CR_SOLID_BLACK);
+     for(int row = minRow; row <= maxRow; row++) {
+          for(int col = minCol; col <= maxCol; col++) {
+	       const std::vector<int> &cellNodes = nodeGrid[row * gridCols + col];
+	       double lastDrawnX = -nodePixels, lastDrawnY = -nodePixels;
+	       for(size_t n = 0; n < cellNodes.size(); n++) {
+	            const LayoutNode_t &layoutNode = nodes[cellNodes[n]];
+		    double nodeX = layoutNode.x * scale, nodeY = layoutNode.y * scale;
+		    if(nodeX + nodePixels < clipX || nodeX - nodePixels > clipX + clipWidth || 
+		       nodeY + nodePixels < clipY || nodeY - nodePixels > clipY + clipHeight) {
+		         continue;
+		    }
+		    CairoColor_t baseNodeColor = RadialLayoutDisplayWindow::GetBaseNodeColor(layoutNode.baseCh);
+		    if(!layoutNode.highlighted) {
+		         baseNodeColor = baseNodeColor.ToGrayscale();
+		    }
+		    baseNodeColor = baseNodeColor.ToOpaque();
+		    if(detailLevel == LOD_PLAIN_NODES) {
+		         // Cull the nodes which land (almost) on top of the last one drawn:
+			 if(ABS(nodeX - lastDrawnX) + ABS(nodeY - lastDrawnY) < nodePixels / 2.0) {
+			      continue;
+			 }
+			 baseNodeColor.ApplyRGBAColor(cr);
+			 cairo_new_sub_path(cr);
+			 cairo_arc(cr, nodeX, nodeY, nodeRadius, 0.0, 2.0 * M_PI);
+			 cairo_fill(cr);
+			 lastDrawnX = nodeX;
+			 lastDrawnY = nodeY;
+			 continue;
+		    }
+		    cairo_new_sub_path(cr);
+		    cairo_arc(cr, nodeX, nodeY, nodeRadius, 0.0, 2.0 * M_PI);
+		    baseNodeColor.Lighten(0.75).ToOpaque().ApplyRGBAColor(cr);
+		    cairo_fill_preserve(cr);
+		    baseNodeColor.Darken(0.1).ToOpaque().ApplyRGBAColor(cr);
+		    cairo_stroke(cr);
+		    char nodeLabel[32];
+		    if(layoutNode.baseIndex % NUMBERING_MODULO == NUMBERING_MODULO - 1) {
+		         snprintf(nodeLabel, 32, "%d", layoutNode.baseIndex + 1);
+		    }
+		    else {
+		         snprintf(nodeLabel, 32, "%c", layoutNode.baseCh);
+		    }
+		    cairo_text_extents_t textExtents;
+		    cairo_text_extents(cr, nodeLabel, &textExtents);
+		    nodeTextColor.ApplyRGBAColor(cr);
+		    cairo_move_to(cr, nodeX - textExtents.width / 2.0 - textExtents.x_bearing, 
+				  nodeY + textExtents.height / 2.0);
+		    cairo_show_text(cr, nodeLabel);
+	       }
+	  }
+     }
+     cairo_restore(cr);
+
+}
+
 RadialLayoutDisplayWindow::RadialLayoutDisplayWindow(size_t width, size_t height) : 
     Fl_Cairo_Window(width, height), RadialLayoutWindowCallbackInterface(), 
     winTitle(NULL), vrnaPlotType(PLOT_TYPE_SIMPLE), 
-    radialLayoutCanvas(NULL), radialLayoutCanvasOrig(NULL), 
+    displayScale(1.0), tileUseCount(0), 
     haveInitVRNAScroller(false), defaultScrollToX(-1), defaultScrollToY(-1),
     scrollerFillBox(NULL), windowScroller(NULL), 
     scalePlusBtn(NULL), scaleMinusBtn(NULL), resetBtn(NULL), 
@@ -98,7 +283,7 @@ RadialLayoutDisplayWindow::RadialLayoutDisplayWindow(size_t width, size_t height
 
 RadialLayoutDisplayWindow::~RadialLayoutDisplayWindow() {
      Free(winTitle);
-     Delete(radialLayoutCanvas, CairoContext_t);
+     ClearTileCache();
      Delete(scalePlusBtn, Fl_Button);
      Delete(scaleMinusBtn, Fl_Button);
      Delete(exportToPNGBtn, Fl_Button);
@@ -157,26 +342,48 @@ bool RadialLayoutDisplayWindow::DisplayRadialDiagram(const char *rnaSeq, size_t
      if(rnaSeq == NULL) {
           return false;
      }
-     Delete(radialLayoutCanvas, CairoContext_t);
-     Delete(radialLayoutCanvasOrig, CairoContext_t);
-     
-     radialLayoutCanvas = GetVRNARadialLayoutData(rnaSeq, startSeqPos, endSeqPos, seqLength, 
-                                               (VRNAPlotType_t) vrnaPlotType);
-     radialLayoutCanvasOrig = new CairoContext_t(*radialLayoutCanvas);
+     ClearTileCache();
+     displayScale = 1.0;
+     if(!GetVRNARadialLayoutData(rnaSeq, startSeqPos, endSeqPos, seqLength, 
+                                 (VRNAPlotType_t) vrnaPlotType)) {
+          return false;
+     }
+     ResizeScrollerFillBox();
+     return true;
+}
+
+bool RadialLayoutDisplayWindow::DisplayRadialDiagram(RNAStructure *rnaStruct, size_t startSeqPos, 
+		                                     size_t endSeqPos) {
+     if(rnaStruct == NULL || rnaStruct->GetLength() == 0) {
+          return false;
+     }
+     ClearTileCache();
+     displayScale = 1.0;
+     std::shared_ptr<LayoutCoordinates_t> layoutCoords = 
+	  GetNativeLayoutCoordinates(rnaStruct, (VRNAPlotType_t) vrnaPlotType);
+     if(!layoutCoords) {
+          return false;
+     }
+     const char *rnaSeq = rnaStruct->GetSequenceString();
+     SetStructureBases(startSeqPos, endSeqPos, rnaSeq);
+     BuildLayoutDisplayList(rnaSeq, *layoutCoords, startSeqPos, endSeqPos, 
+		            displayList, imageWidth, imageHeight);
+     SetDefaultScrollPosition();
      ResizeScrollerFillBox();
      return true;
 }
 
 void RadialLayoutDisplayWindow::ResizeScrollerFillBox() {
-     if(radialLayoutCanvas == NULL || windowScroller == NULL) {
+     if(displayList.IsEmpty() || windowScroller == NULL) {
           return;
      }
      if(scrollerFillBox != NULL) {
           windowScroller->remove(scrollerFillBox);
           Delete(scrollerFillBox, Fl_Box);
      }
-     int nextFillerWidth = MAX(DEFAULT_RLWIN_WIDTH, radialLayoutCanvas->GetWidth());
-     int nextFillerHeight = MAX(DEFAULT_RLWIN_HEIGHT - buttonToolbarHeight, radialLayoutCanvas->GetHeight());
+     int nextFillerWidth = MAX(DEFAULT_RLWIN_WIDTH, (int) (displayList.GetWidth() * displayScale));
+     int nextFillerHeight = MAX(DEFAULT_RLWIN_HEIGHT - buttonToolbarHeight, 
+		                (int) (displayList.GetHeight() * displayScale));
      windowScroller->begin();
      scrollerFillBox = new Fl_Box(0, 0, nextFillerWidth, nextFillerHeight); 
      scrollerFillBox->type(FL_NO_BOX);
@@ -187,7 +394,7 @@ void RadialLayoutDisplayWindow::ResizeScrollerFillBox() {
 
 void RadialLayoutDisplayWindow::Draw(Fl_Cairo_Window *thisCairoWindow, cairo_t *cr) {
      if(thisCairoWindow == NULL || cr == NULL || 
-        ((RadialLayoutDisplayWindow *) thisCairoWindow)->radialLayoutCanvas == NULL) {
+        ((RadialLayoutDisplayWindow *) thisCairoWindow)->displayList.IsEmpty()) {
           return;
      }
      RadialLayoutDisplayWindow *thisWindow = (RadialLayoutDisplayWindow *) thisCairoWindow; 
@@ -204,13 +411,27 @@ void RadialLayoutDisplayWindow::Draw(Fl_Cairo_Window *thisCairoWindow, cairo_t *
      thisWindow->cairoWinTranslateX = thisWindow->windowScroller->xposition();
      thisWindow->cairoWinTranslateY = thisWindow->windowScroller->yposition();
      
-     cairo_surface_t *crSurface = cairo_get_target(thisWindow->radialLayoutCanvas->GetCairoContext());
-     cairo_set_source_surface(cr, crSurface, -thisWindow->cairoWinTranslateX, -thisWindow->cairoWinTranslateY);
-     cairo_rectangle(cr, 0, thisWindow->buttonToolbarHeight, 
-             thisWindow->w() - SCROLL_SIZE - 2, 
-             thisWindow->h() - thisWindow->buttonToolbarHeight - SCROLL_SIZE - 2);
+     // Paint only the tiles of the zoomed layout which cover the viewport:
+     int viewWidth = thisWindow->w() - SCROLL_SIZE - 2;
+     int viewHeight = thisWindow->h() - thisWindow->buttonToolbarHeight - SCROLL_SIZE - 2;
+     int viewX = thisWindow->cairoWinTranslateX;
+     int viewY = thisWindow->cairoWinTranslateY + thisWindow->buttonToolbarHeight;
+     cairo_rectangle(cr, 0, thisWindow->buttonToolbarHeight, viewWidth, viewHeight);
      cairo_clip(cr);
-     cairo_paint(cr);
+     for(int tileRow = MAX(0, viewY) / RADIAL_TILE_SIZE; 
+	 tileRow <= (viewY + viewHeight) / RADIAL_TILE_SIZE; tileRow++) {
+          for(int tileCol = MAX(0, viewX) / RADIAL_TILE_SIZE; 
+	      tileCol <= (viewX + viewWidth) / RADIAL_TILE_SIZE; tileCol++) {
+	       cairo_surface_t *tileSurface = thisWindow->GetLayoutTile(tileCol, tileRow);
+	       if(tileSurface == NULL) {
+	            continue;
+	       }
+	       cairo_set_source_surface(cr, tileSurface, 
+			                tileCol * RADIAL_TILE_SIZE - thisWindow->cairoWinTranslateX, 
+				        tileRow * RADIAL_TILE_SIZE - thisWindow->cairoWinTranslateY);
+	       cairo_paint(cr);
+	  }
+     }
      cairo_reset_clip(cr);
      if(thisWindow->windowScroller != NULL) {
           thisWindow->scalePlusBtn->redraw();
@@ -262,7 +483,7 @@ std::string RadialLayoutDisplayWindow::GetExportToPNGOutputPath() {
 void RadialLayoutDisplayWindow::SaveRadialLayoutToPNGCallback(Fl_Widget *exportBtn, void *udata) {
      
      RadialLayoutDisplayWindow *rlDisplayWin = (RadialLayoutDisplayWindow *) exportBtn->parent();
-     if(rlDisplayWin == NULL || rlDisplayWin->radialLayoutCanvas == NULL) {
+     if(rlDisplayWin == NULL || rlDisplayWin->displayList.IsEmpty()) {
           return;
      }
      std::string pngOutputPath = rlDisplayWin->GetExportToPNGOutputPath();
@@ -271,7 +492,6 @@ void RadialLayoutDisplayWindow::SaveRadialLayoutToPNGCallback(Fl_Widget *exportB
      }
 
      // initialize the image data:
-     cairo_surface_t *pngInitSrc = cairo_get_target(rlDisplayWin->radialLayoutCanvas->GetCairoContext());
      cairo_surface_t *pngSrc = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 
                        rlDisplayWin->imageWidth, 
                    rlDisplayWin->imageHeight + PNG_FOOTER_HEIGHT);
@@ -333,12 +553,14 @@ void RadialLayoutDisplayWindow::SaveRadialLayoutToPNGCallback(Fl_Widget *exportB
           offsetY += 22;
      }
      
-     // draw the source diagram onto the PNG output image:
-     cairo_set_source_surface(crImageOutput, pngInitSrc, 0, 0);
+     // draw the diagram from the display list (at the unzoomed scale) onto the output image:
+     CairoColor_t::FromFLColorType(GUI_WINDOW_BGCOLOR).ApplyRGBAColor(crImageOutput);
      cairo_rectangle(crImageOutput, 0, 0, 
                      rlDisplayWin->imageWidth, 
                      rlDisplayWin->imageHeight); 
      cairo_fill(crImageOutput);
+     rlDisplayWin->displayList.Render(crImageOutput, 1.0, 0, 0, 
+		                      rlDisplayWin->imageWidth, rlDisplayWin->imageHeight);
      
      Delete(rlDisplayWin->imgExportSelectWin, InputWindowExportImage);
      rlDisplayWin->imgExportSelectWin = new InputWindowExportImage(pngOutputPath);
@@ -357,29 +579,98 @@ void RadialLayoutDisplayWindow::SaveRadialLayoutToPNGCallback(Fl_Widget *exportB
 void RadialLayoutDisplayWindow::ScaleRadialLayoutPlusCallback(Fl_Widget *scaleBtn, void *udata) {
      RadialLayoutDisplayWindow *rwin = (RadialLayoutDisplayWindow *) scaleBtn->parent();
      float scalingFactor = 1.0 + DEFAULT_SCALING_PERCENT;
-     rwin->radialLayoutCanvas->Scale(scalingFactor);
-     rwin->ResizeScrollerFillBox();
-     rwin->redraw();
+     rwin->SetDisplayScale(rwin->displayScale * scalingFactor);
 }
 
 void RadialLayoutDisplayWindow::ScaleRadialLayoutMinusCallback(Fl_Widget *scaleBtn, void *udata) {
      RadialLayoutDisplayWindow *rwin = (RadialLayoutDisplayWindow *) scaleBtn->parent();
      float scalingFactor = 1.0 - DEFAULT_SCALING_PERCENT;
-     rwin->radialLayoutCanvas->Scale(scalingFactor);
-     rwin->ResizeScrollerFillBox();
-     rwin->redraw();
+     rwin->SetDisplayScale(rwin->displayScale * scalingFactor);
 }
 
 void RadialLayoutDisplayWindow::RadialLayoutResetCallback(Fl_Widget *resetBtn, void *udata) {
      RadialLayoutDisplayWindow *rwin = (RadialLayoutDisplayWindow *) resetBtn->parent();
-     CairoContext_t *oldRadialLayoutCanvas = rwin->radialLayoutCanvas;
-     rwin->radialLayoutCanvas = new CairoContext_t(*(rwin->radialLayoutCanvasOrig));
-     Delete(oldRadialLayoutCanvas, CairoContext_t);
+     rwin->ClearTileCache();
+     rwin->displayScale = 1.0;
      rwin->haveInitVRNAScroller = false;
      rwin->ResizeScrollerFillBox();
      rwin->redraw();
 }
 
+void RadialLayoutDisplayWindow::SetDisplayScale(double nextScale) {
+     nextScale = MIN(MAX(nextScale, RADIAL_MIN_DISPLAY_SCALE), RADIAL_MAX_DISPLAY_SCALE);
+     if(nextScale == displayScale || windowScroller == NULL) {
+          return;
+     }
+     // Keep the point at the center of the viewport fixed while zooming:
+     int viewWidth = w() - SCROLL_SIZE - 2;
+     int viewHeight = h() - buttonToolbarHeight - SCROLL_SIZE - 2;
+     double centerX = (windowScroller->xposition() + viewWidth / 2.0) / displayScale;
+     double centerY = (windowScroller->yposition() + buttonToolbarHeight + viewHeight / 2.0) / displayScale;
+     ClearTileCache();
+     displayScale = nextScale;
+     ResizeScrollerFillBox();
+     int maxScrollX = MAX(0, scrollerFillBox->w() - viewWidth);
+     int maxScrollY = MAX(0, scrollerFillBox->h() - viewHeight);
+     int scrollX = (int) (centerX * displayScale - viewWidth / 2.0);
+     int scrollY = (int) (centerY * displayScale - buttonToolbarHeight - viewHeight / 2.0);
+     windowScroller->scroll_to(MIN(MAX(0, scrollX), maxScrollX), MIN(MAX(0, scrollY), maxScrollY));
+     cairoWinTranslateX = windowScroller->xposition();
+     cairoWinTranslateY = windowScroller->yposition();
+     redraw();
+}
+
+cairo_surface_t * RadialLayoutDisplayWindow::GetLayoutTile(int tileCol, int tileRow) {
+     
+     std::pair<int, int> tileKey(tileCol, tileRow);
+     std::map<std::pair<int, int>, LayoutTile_t>::iterator tileIter = tileCache.find(tileKey);
+     if(tileIter != tileCache.end()) {
+          tileIter->second.lastUsed = ++tileUseCount;
+	  return tileIter->second.tileSurface;
+     }
+     if(tileCache.size() >= RADIAL_TILE_CACHE_SIZE) {
+          // Evict the least recently used tile:
+	  std::map<std::pair<int, int>, LayoutTile_t>::iterator lruIter = tileCache.begin();
+	  for(tileIter = tileCache.begin(); tileIter != tileCache.end(); tileIter++) {
+	       if(tileIter->second.lastUsed < lruIter->second.lastUsed) {
+	            lruIter = tileIter;
+	       }
+	  }
+	  cairo_surface_destroy(lruIter->second.tileSurface);
+	  tileCache.erase(lruIter);
+     }
+     
+     // Render the tile from the display list at the current zoom level:
+     cairo_surface_t *tileSurface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 
+		                                               RADIAL_TILE_SIZE, RADIAL_TILE_SIZE);
+     if(cairo_surface_status(tileSurface) != CAIRO_STATUS_SUCCESS) {
+          cairo_surface_destroy(tileSurface);
+	  return NULL;
+     }
+     cairo_t *crTile = cairo_create(tileSurface);
+     CairoColor_t::FromFLColorType(GUI_WINDOW_BGCOLOR).ApplyRGBAColor(crTile);
+     cairo_paint(crTile);
+     cairo_translate(crTile, -tileCol * RADIAL_TILE_SIZE, -tileRow * RADIAL_TILE_SIZE);
+     displayList.Render(crTile, displayScale, tileCol * RADIAL_TILE_SIZE, tileRow * RADIAL_TILE_SIZE, 
+		        RADIAL_TILE_SIZE, RADIAL_TILE_SIZE);
+     cairo_destroy(crTile);
+     cairo_surface_flush(tileSurface);
+     LayoutTile_t layoutTile;
+     layoutTile.tileSurface = tileSurface;
+     layoutTile.lastUsed = ++tileUseCount;
+     tileCache[tileKey] = layoutTile;
+     return tileSurface;
+
+}
+
+void RadialLayoutDisplayWindow::ClearTileCache() {
+     std::map<std::pair<int, int>, LayoutTile_t>::iterator tileIter;
+     for(tileIter = tileCache.begin(); tileIter != tileCache.end(); tileIter++) {
+          cairo_surface_destroy(tileIter->second.tileSurface);
+     }
+     tileCache.clear();
+}
+
 void RadialLayoutDisplayWindow::CloseWindowCallback(Fl_Widget *cbtn, void *udata) {
      RadialLayoutDisplayWindow *rlWin = (RadialLayoutDisplayWindow *) cbtn->parent();
      rlWin->hide();
@@ -399,188 +690,403 @@ void RadialLayoutDisplayWindow::HandleWindowScrollCallback(Fl_Widget *scrw, void
      mainWindow->redraw();
 }
 
-CairoContext_t * RadialLayoutDisplayWindow::GetVRNARadialLayoutData(const char *rnaSubseq, 
-                                    size_t startPos, size_t endPos, size_t seqLength, 
-                        VRNAPlotType_t plotType) {
+std::vector<RadialLayoutDisplayWindow::MFEStructureEntry_t> RadialLayoutDisplayWindow::mfeStructureCache;
+std::vector<std::shared_ptr<RadialLayoutDisplayWindow::LayoutCoordinates_t> > 
+     RadialLayoutDisplayWindow::layoutCoordsCache;
+
+std::string RadialLayoutDisplayWindow::GetMFEStructure(const char *rnaSeq) {
      
-     char *effectiveRNASubseq = NULL;
-     int seqIndexOffset = 0;
-     if(seqLength <= MAX_SEQUENCE_DISPLAY_LENGTH) {
-          effectiveRNASubseq = GetSubstringFromRange(rnaSubseq, 0, MAX_SIZET);
+     if(rnaSeq == NULL || rnaSeq[0] == '\0') {
+          return std::string("");
      }
-     else {
-          int seqStartIdx = MAX(0, startPos - 25);
-      int seqEndIdx = MIN(endPos + 25, seqLength);
-      seqIndexOffset = seqStartIdx;
-      effectiveRNASubseq = GetSubstringFromRange(rnaSubseq, seqStartIdx, seqEndIdx);
+     size_t seqLength = strlen(rnaSeq);
+     SequenceFingerprint_t seqFP = SequenceFingerprint::ComputeFingerprint(rnaSeq, seqLength);
+     for(size_t e = 0; e < mfeStructureCache.size(); e++) {
+          if(mfeStructureCache[e].seqFingerprint == seqFP && mfeStructureCache[e].baseSeq == rnaSeq) {
+	       // Move the entry to the back (most recently used) end:
+	       MFEStructureEntry_t mfeEntry = mfeStructureCache[e];
+	       mfeStructureCache.erase(mfeStructureCache.begin() + e);
+	       mfeStructureCache.push_back(mfeEntry);
+	       return mfeEntry.mfeStructure;
+	  }
      }
-     if(effectiveRNASubseq == NULL) {
-          return NULL;
+     vrna_fold_compound_t *vfc = vrna_fold_compound(rnaSeq, NULL, VRNA_OPTION_DEFAULT);
+     if(vfc == NULL) {
+          return std::string("");
      }
-     StringToUppercase(effectiveRNASubseq);
-     SetStructureBases(startPos, endPos, effectiveRNASubseq);
-     size_t startPos2 = 0; 
-     size_t endPos2 = strlen(effectiveRNASubseq);
-     endPos2 = endPos2 ? endPos2 - 1 : 0;
-     unsigned int rnaSubseqLen = endPos2 - startPos2 + 1;
-     vrna_seq_toRNA(effectiveRNASubseq);
+     char *mfeStructure = (char *) vrna_alloc((seqLength + 1) * sizeof(char));
+     vrna_mfe(vfc, mfeStructure);
+     MFEStructureEntry_t mfeEntry;
+     mfeEntry.seqFingerprint = seqFP;
+     mfeEntry.baseSeq = std::string(rnaSeq);
+     mfeEntry.mfeStructure = std::string(mfeStructure);
+     vrna_fold_compound_free(vfc);
+     Free(mfeStructure);
+     if(mfeStructureCache.size() >= RADIAL_LAYOUT_CACHE_SIZE) {
+          mfeStructureCache.erase(mfeStructureCache.begin());
+     }
+     mfeStructureCache.push_back(mfeEntry);
+     return mfeEntry.mfeStructure;
 
-     vrna_fold_compound_t *vfc = vrna_fold_compound(effectiveRNASubseq, NULL, VRNA_OPTION_DEFAULT);
-     vrna_md_t vmdParam = vfc->params->model_details;
-     int length = vfc->length;
-     
-     char *mfeStructure = (char *) vrna_alloc((length + 1) * sizeof(char));
-     double minEnergy = (double) vrna_mfe(vfc, mfeStructure);
-     short *pairTable = vrna_ptable(mfeStructure); 
-     short *pairTableG = vrna_ptable(mfeStructure);
+}
 
-     int ge = 0, ee, gb, Lg, l[3], workingIdx;
-     while( (ee = parse_gquad(mfeStructure + ge, &Lg, l)) > 0) {
+std::shared_ptr<RadialLayoutDisplayWindow::LayoutCoordinates_t> 
+     RadialLayoutDisplayWindow::GetLayoutCoordinates(const char *rnaSeq, const char *dotStructure, 
+		                                     VRNAPlotType_t plotType) {
+
+     if(rnaSeq == NULL || dotStructure == NULL || rnaSeq[0] == '\0' || 
+        strlen(rnaSeq) != strlen(dotStructure)) {
+          return std::shared_ptr<LayoutCoordinates_t>();
+     }
+     size_t seqLength = strlen(rnaSeq);
+     SequenceFingerprint_t seqFP = SequenceFingerprint::ComputeFingerprint(rnaSeq, seqLength);
+     uint64_t pairingHash = SequenceFingerprint::XXH64(dotStructure, seqLength, SEQFP_LOW_SEED);
+     for(size_t e = 0; e < layoutCoordsCache.size(); e++) {
+          if(layoutCoordsCache[e]->seqFingerprint == seqFP && 
+	     layoutCoordsCache[e]->pairingHash == pairingHash && 
+	     layoutCoordsCache[e]->plotType == plotType && !layoutCoordsCache[e]->nativeLayout) {
+	       std::shared_ptr<LayoutCoordinates_t> layoutEntry = layoutCoordsCache[e];
+	       layoutCoordsCache.erase(layoutCoordsCache.begin() + e);
+	       layoutCoordsCache.push_back(layoutEntry);
+	       return layoutEntry;
+	  }
+     }
+
+     short *pairTableG = vrna_ptable(dotStructure);
+     int ge = 0, ee, gb, Lg, l[3];
+     while( (ee = parse_gquad(dotStructure + ge, &Lg, l)) > 0) {
           ge += ee;
-      gb = ge - 4 * Lg - l[0] - l[1] - l[2] + 1;
-      for(int pbpIdx = 0; pbpIdx < Lg; pbpIdx++) {
+	  gb = ge - 4 * Lg - l[0] - l[1] - l[2] + 1;
+	  for(int pbpIdx = 0; pbpIdx < Lg; pbpIdx++) {
                pairTableG[ge - pbpIdx] = gb + pbpIdx;
-           pairTableG[gb + pbpIdx] = ge - pbpIdx;
-      }
+	       pairTableG[gb + pbpIdx] = ge - pbpIdx;
+	  }
      }
-
-     float *xPosArr = (float *) vrna_alloc((rnaSubseqLen + 1) * sizeof(float));
-     float *yPosArr = (float *) vrna_alloc((rnaSubseqLen + 1) * sizeof(float));
+     float *xPosArr = (float *) vrna_alloc((seqLength + 1) * sizeof(float));
+     float *yPosArr = (float *) vrna_alloc((seqLength + 1) * sizeof(float));
      if(plotType == PLOT_TYPE_SIMPLE) { 
-          workingIdx = simple_xy_coordinates(pairTableG, xPosArr, yPosArr);
+          simple_xy_coordinates(pairTableG, xPosArr, yPosArr);
      }
      else if(plotType == PLOT_TYPE_CIRCULAR) {
-          int radius = 2 * rnaSubseqLen;
-      workingIdx = simple_circplot_coordinates(pairTableG, xPosArr, yPosArr);
-      for(int idx = 0; idx < rnaSubseqLen; idx++) {
+          int radius = 2 * seqLength;
+	  simple_circplot_coordinates(pairTableG, xPosArr, yPosArr);
+	  for(size_t idx = 0; idx < seqLength; idx++) {
                xPosArr[idx] *= radius;
-           xPosArr[idx] += radius;
-           yPosArr[idx] *= radius;
-           yPosArr[idx] += radius;
-      }
+	       xPosArr[idx] += radius;
+	       yPosArr[idx] *= radius;
+	       yPosArr[idx] += radius;
+	  }
      }
      else {
-          workingIdx = naview_xy_coordinates(pairTableG, xPosArr, yPosArr);
-     }
-     double xmin, xmax, ymin, ymax, dmin;
-     xmin = xmax = xPosArr[0];
-     ymin = ymax = yPosArr[0];
-     dmin = (double) INT_MAX;
-     const int nodeSize = 38;
-     for(int idx = 1; idx < rnaSubseqLen; idx++) {
-          xmin = xPosArr[idx] < xmin ? xPosArr[idx] : xmin;
-          xmax = xPosArr[idx] > xmax ? xPosArr[idx] : xmax;
-          ymin = yPosArr[idx] < ymin ? yPosArr[idx] : ymin;
-          ymax = yPosArr[idx] > ymax ? yPosArr[idx] : ymax;
-      for(int j = idx + 1; j < rnaSubseqLen; j++) {
-           double edist = Square(xPosArr[idx] - xPosArr[j]) + Square(yPosArr[idx] - yPosArr[j]);
-           edist = sqrt(edist);
-           if(edist < dmin) {
-                dmin = edist;
-           }
-      }
+          naview_xy_coordinates(pairTableG, xPosArr, yPosArr);
+     }
+
+     std::shared_ptr<LayoutCoordinates_t> layoutEntry(new LayoutCoordinates_t());
+     layoutEntry->seqFingerprint = seqFP;
+     layoutEntry->pairingHash = pairingHash;
+     layoutEntry->plotType = plotType;
+     layoutEntry->nativeLayout = false;
+     layoutEntry->xPosArr.assign(xPosArr, xPosArr + seqLength);
+     layoutEntry->yPosArr.assign(yPosArr, yPosArr + seqLength);
+     std::vector<int> pairTable(seqLength);
+     for(size_t idx = 0; idx < seqLength; idx++) {
+          pairTable[idx] = pairTableG[idx + 1] - 1;
+     }
+     ComputeLayoutExtents(*layoutEntry, pairTable);
+     Free(pairTableG);
+     Free(xPosArr);
+     Free(yPosArr);
+
+     if(layoutCoordsCache.size() >= RADIAL_LAYOUT_CACHE_SIZE) {
+          layoutCoordsCache.erase(layoutCoordsCache.begin());
+     }
+     layoutCoordsCache.push_back(layoutEntry);
+     return layoutEntry;
+
+}
+
+void RadialLayoutDisplayWindow::ComputeLayoutExtents(LayoutCoordinates_t &layoutEntry, 
+		                                     const std::vector<int> &pairTable) {
+     const std::vector<float> &xPosArr = layoutEntry.xPosArr, &yPosArr = layoutEntry.yPosArr;
+     int seqLength = xPosArr.size();
+     layoutEntry.xmin = layoutEntry.xmax = seqLength > 0 ? xPosArr[0] : 0.0;
+     layoutEntry.ymin = layoutEntry.ymax = seqLength > 0 ? yPosArr[0] : 0.0;
+     // The distances between the neighbors along the backbone and the paired 
+     // bases give an upper bound on the minimum node distance to start from:
+     double dmin = (double) INT_MAX;
+     for(int idx = 0; idx < seqLength; idx++) {
+          layoutEntry.xmin = MIN(layoutEntry.xmin, xPosArr[idx]);
+          layoutEntry.xmax = MAX(layoutEntry.xmax, xPosArr[idx]);
+          layoutEntry.ymin = MIN(layoutEntry.ymin, yPosArr[idx]);
+          layoutEntry.ymax = MAX(layoutEntry.ymax, yPosArr[idx]);
+	  int neighborIdx[2] = { idx + 1, idx < (int) pairTable.size() ? pairTable[idx] : -1 };
+	  for(int n = 0; n < 2; n++) {
+	       int j = neighborIdx[n];
+	       if(j <= idx || j >= seqLength) {
+	            continue;
+	       }
+	       double edist = sqrt(Square(xPosArr[idx] - xPosArr[j]) + Square(yPosArr[idx] - yPosArr[j]));
+	       if(edist > 0.0 && edist < dmin) {
+	            dmin = edist;
+	       }
+	  }
+     }
+     if(dmin >= (double) INT_MAX) {
+          layoutEntry.minNodeDist = 1.0;
+	  return;
+     }
+     // Any two nodes closer than the bound lie in the same or in adjacent 
+     // cells of a grid with that cell size, so only these are compared. This 
+     // takes (expected) linear time unless many nodes overlap in one cell:
+     double cellSize = dmin, backboneDist = dmin;
+     std::unordered_map<uint64_t, std::vector<int> > gridCells;
+     gridCells.reserve(seqLength);
+     auto GetCellKey = [](int64_t col, int64_t row) -> uint64_t {
+          return ((uint64_t) (uint32_t) col << 32) | (uint64_t) (uint32_t) row;
+     };
+     for(int idx = 0; idx < seqLength; idx++) {
+          int64_t col = (int64_t) floor((xPosArr[idx] - layoutEntry.xmin) / cellSize);
+	  int64_t row = (int64_t) floor((yPosArr[idx] - layoutEntry.ymin) / cellSize);
+	  for(int64_t dc = -1; dc <= 1; dc++) {
+	       for(int64_t dr = -1; dr <= 1; dr++) {
+		    auto cellIt = gridCells.find(GetCellKey(col + dc, row + dr));
+		    if(cellIt == gridCells.end()) {
+		         continue;
+		    }
+		    for(int j : cellIt->second) {
+	                 double edist = sqrt(Square(xPosArr[idx] - xPosArr[j]) + 
+					     Square(yPosArr[idx] - yPosArr[j]));
+			 if(edist > 0.0 && edist < dmin) {
+			      dmin = edist;
+			 }
+		    }
+	       }
+	  }
+	  gridCells[GetCellKey(col, row)].push_back(idx);
+     }
+     // The nodes which (nearly) overlap in the layout itself cannot be pulled 
+     // apart by scaling, so they do not shrink the whole drawing past this:
+     layoutEntry.minNodeDist = MAX(dmin, backboneDist / RADIAL_LAYOUT_MIN_DIST_RATIO);
+}
+
+std::shared_ptr<RadialLayoutDisplayWindow::LayoutCoordinates_t> 
+     RadialLayoutDisplayWindow::GetNativeLayoutCoordinates(RNAStructure *rnaStruct, 
+		                                           VRNAPlotType_t plotType) {
+     
+     if(rnaStruct == NULL || rnaStruct->GetLength() == 0) {
+          return std::shared_ptr<LayoutCoordinates_t>();
+     }
+     SequenceFingerprint_t seqFP = rnaStruct->GetSequenceFingerprint();
+     std::vector<int> nestedPairTable = rnaStruct->GetNestedPairTable();
+     uint64_t pairingHash = SequenceFingerprint::XXH64(nestedPairTable.data(), 
+		                                       nestedPairTable.size() * sizeof(int), 
+						       SEQFP_LOW_SEED);
+     for(size_t e = 0; e < layoutCoordsCache.size(); e++) {
+          if(layoutCoordsCache[e]->seqFingerprint == seqFP && 
+	     layoutCoordsCache[e]->pairingHash == pairingHash && 
+	     layoutCoordsCache[e]->plotType == plotType && layoutCoordsCache[e]->nativeLayout) {
+	       std::shared_ptr<LayoutCoordinates_t> layoutEntry = layoutCoordsCache[e];
+	       layoutCoordsCache.erase(layoutCoordsCache.begin() + e);
+	       layoutCoordsCache.push_back(layoutEntry);
+	       return layoutEntry;
+	  }
+     }
+
+     StructureLayout_t::LayoutStyle_t layoutStyle = StructureLayout_t::LAYOUT_RADIAL;
+     if(plotType == PLOT_TYPE_NAVIEW) {
+          layoutStyle = StructureLayout_t::LAYOUT_NAVIEW;
+     }
+     else if(plotType == PLOT_TYPE_CIRCULAR) {
+          layoutStyle = StructureLayout_t::LAYOUT_CIRCULAR;
+     }
+     StructureLayout_t structLayout(*(rnaStruct->GetElementTree()), nestedPairTable, layoutStyle);
+     std::shared_ptr<LayoutCoordinates_t> layoutEntry(new LayoutCoordinates_t());
+     layoutEntry->seqFingerprint = seqFP;
+     layoutEntry->pairingHash = pairingHash;
+     layoutEntry->plotType = plotType;
+     layoutEntry->nativeLayout = true;
+     layoutEntry->xPosArr.resize(structLayout.GetLength());
+     layoutEntry->yPosArr.resize(structLayout.GetLength());
+     for(int idx = 0; idx < structLayout.GetLength(); idx++) {
+          layoutEntry->xPosArr[idx] = structLayout.GetX(idx);
+	  layoutEntry->yPosArr[idx] = structLayout.GetY(idx);
+     }
+     ComputeLayoutExtents(*layoutEntry, nestedPairTable);
+
+     if(layoutCoordsCache.size() >= RADIAL_LAYOUT_CACHE_SIZE) {
+          layoutCoordsCache.erase(layoutCoordsCache.begin());
      }
+     layoutCoordsCache.push_back(layoutEntry);
+     return layoutEntry;
+
+}
+
+void RadialLayoutDisplayWindow::ClearLayoutCaches() {
+     mfeStructureCache.clear();
+     layoutCoordsCache.clear();
+}
+
+bool RadialLayoutDisplayWindow::GetVRNARadialLayoutData(const char *rnaSubseq, 
+                                    size_t startPos, size_t endPos, size_t seqLength, 
+                        VRNAPlotType_t plotType) {
+     
+     (void) seqLength;
+     // The full sequence is laid out (the bases outside of the highlighted 
+     // range are drawn in grayscale):
+     char *effectiveRNASubseq = GetSubstringFromRange(rnaSubseq, 0, MAX_SIZET);
+     if(effectiveRNASubseq == NULL) {
+          return false;
+     }
+     StringToUppercase(effectiveRNASubseq);
+     SetStructureBases(startPos, endPos, effectiveRNASubseq);
+     vrna_seq_toRNA(effectiveRNASubseq);
+     unsigned int rnaSubseqLen = strlen(effectiveRNASubseq);
+     if(rnaSubseqLen > RADIAL_LAYOUT_MAX_MFE_LENGTH) {
+          TerminalText::PrintWarning("Not folding the %u nt sequence for its radial layout "
+			             "(the limit is %d nt): open the layout from a structure instead.\n", 
+				     rnaSubseqLen, RADIAL_LAYOUT_MAX_MFE_LENGTH);
+          Free(effectiveRNASubseq);
+	  return false;
+     }
+
+     std::string mfeStructure = GetMFEStructure(effectiveRNASubseq);
+     std::shared_ptr<LayoutCoordinates_t> layoutCoords = 
+	  GetLayoutCoordinates(effectiveRNASubseq, mfeStructure.c_str(), plotType);
+     if(!layoutCoords) {
+          Free(effectiveRNASubseq);
+	  return false;
+     }
+     BuildLayoutDisplayList(effectiveRNASubseq, *layoutCoords, startPos, endPos, 
+		            displayList, imageWidth, imageHeight);
+     SetDefaultScrollPosition();
+     Free(effectiveRNASubseq);
+     return true;
+
+}
+
+void RadialLayoutDisplayWindow::BuildLayoutDisplayList(const char *rnaSeq, 
+		                                       const LayoutCoordinates_t &layoutCoords, 
+						       size_t startPos, size_t endPos, 
+						       RadialLayoutDisplayList_t &displayList, 
+						       int &imageWidth, int &imageHeight) {
+     
+     int rnaSubseqLen = layoutCoords.xPosArr.size();
+     std::vector<float> xPosArr(layoutCoords.xPosArr), yPosArr(layoutCoords.yPosArr);
+     double xmin = layoutCoords.xmin, xmax = layoutCoords.xmax;
+     double ymin = layoutCoords.ymin, ymax = layoutCoords.ymax;
+     double dmin = layoutCoords.minNodeDist;
+     const int nodeSize = RADIAL_NODE_SIZE;
      for(int xyPos = 0; xyPos < rnaSubseqLen; xyPos++) {
           if(xmin < 0) {
-           xPosArr[xyPos] += ABS(xmin) + nodeSize;
-      }
-      else {
+	       xPosArr[xyPos] += ABS(xmin) + nodeSize;
+	  }
+	  else {
                xPosArr[xyPos] -= ABS(xmin);
-      }
-      if(ymin < 0) {
-           yPosArr[xyPos] += ABS(ymin) + nodeSize;
-      }
-      else {
-           yPosArr[xyPos] -= ABS(ymin);
-      }
+	  }
+	  if(ymin < 0) {
+	       yPosArr[xyPos] += ABS(ymin) + nodeSize;
+	  }
+	  else {
+	       yPosArr[xyPos] -= ABS(ymin);
+	  }
      }
      if(xmin < 0) {
-      xmax += ABS(xmin) + nodeSize;
+	  xmax += ABS(xmin) + nodeSize;
           xmin = nodeSize;
      }
      if(ymin < 0) {
           ymax += ABS(ymin) + nodeSize;
-      ymin = nodeSize;
+	  ymin = nodeSize;
      }
      float winScale = 1.25 * nodeSize / dmin / M_SQRT2;
      float xScale = (float) (winScale * MAX(xmax / DEFAULT_RLWIN_WIDTH, 1.0));
      float yScale = (float) (winScale * MAX(ymax / DEFAULT_RLWIN_HEIGHT, 1.0));
-     this->winScaleX = xScale;
-     this->winScaleY = yScale;
-
-     CairoContext_t *plotCanvas = new CairoContext_t(MAX(DEFAULT_RLWIN_WIDTH, (xmax - xmin) * xScale + 
-                                             1.5 * nodeSize), 
-                                             MAX(DEFAULT_RLWIN_HEIGHT, (ymax - ymin) * yScale + 
-                             1.5 * nodeSize));
-     imageHeight = ABS(ymax - ymin) * xScale + 1.5 * nodeSize;
-     imageWidth = MAX(PNGOUT_MIN_IMAGE_WIDTH, ABS(xmax - xmin) * yScale + 1.5 * nodeSize);
-     plotCanvas->BlankFillCanvas(CairoColor_t::FromFLColorType(GUI_WINDOW_BGCOLOR));
-     plotCanvas->SetColor(CairoColor_t::GetCairoColor(CairoColorSpec_t::CR_TRANSPARENT));
-     plotCanvas->Translate(2 * nodeSize, 2 * nodeSize);
-     plotCanvas->SetStrokeSize(2);
-     plotCanvas->SetFontFace(CairoContext_t::CairoFontFace_t::MONOSPACE | 
-                     CairoContext_t::CairoFontStyle_t::BOLD | 
-                 CairoContext_t::CairoFontStyle_t::ITALIC);
-     plotCanvas->SetFontSize(3);
-
-     int idx = 0, nodeX = 0, nodeY = 0, lastNodeX, lastNodeY;
-     while(idx < rnaSubseqLen) {
-      lastNodeX = nodeX; 
-      lastNodeY = nodeY;
-          nodeX = (int) ((xPosArr[idx] - xmin) * xScale);
-      nodeY = (int) ((yPosArr[idx] - ymin) * yScale);
-      if(idx > 0) {
-           plotCanvas->SetColor(CairoColor_t::GetCairoColor(CairoColorSpec_t::CR_BLACK).Lighten(0.5).ToOpaque());
-           plotCanvas->DrawLine(nodeX, nodeY, lastNodeX, lastNodeY);
-      }
-          idx++;
-     }
-     idx = 0;
-     while(idx < rnaSubseqLen) {
-      lastNodeX = nodeX; 
-      lastNodeY = nodeY;
-          nodeX = (int) ((xPosArr[idx] - xmin) * xScale);
-      nodeY = (int) ((yPosArr[idx] - ymin) * yScale);
-      CairoColor_t baseNodeColor = GetBaseNodeColor(effectiveRNASubseq[idx]);
-      if(idx + seqIndexOffset < startPos || idx + seqIndexOffset > endPos) {
-           baseNodeColor = baseNodeColor.ToGrayscale();
-      }
-      else {
-               if(defaultScrollToX == -1 || nodeX < defaultScrollToX) {
-                defaultScrollToX = nodeX;
-           }
-           if(defaultScrollToY == -1 || nodeY < defaultScrollToY) {
-            defaultScrollToY = nodeY;
-           }
-      }
-      char nodeLabel[32];
-      if(idx % NUMBERING_MODULO == NUMBERING_MODULO - 1) {
-           snprintf(nodeLabel, 32, "%d\0", idx + seqIndexOffset + 1);
-           plotCanvas->SetFontSize(1);
-      }
-      else {
-           snprintf(nodeLabel, 32, "%c\0", effectiveRNASubseq[idx]);
-      }
-      plotCanvas->DrawBaseNode(nodeX, nodeY, nodeLabel, nodeSize, 
-                     baseNodeColor);
-      idx++;
+
+     // Scale the large layouts down to fit on the maximum size canvas (the 
+     // level of detail is picked from the size of the nodes as they are drawn):
+     double lodScale = 1.0;
+     double fullWidth = (xmax - xmin) * xScale + 4 * nodeSize;
+     double fullHeight = (ymax - ymin) * yScale + 4 * nodeSize;
+     if(fullWidth > RADIAL_LAYOUT_MAX_CANVAS_DIM || fullHeight > RADIAL_LAYOUT_MAX_CANVAS_DIM) {
+          lodScale = MIN(RADIAL_LAYOUT_MAX_CANVAS_DIM / fullWidth, 
+			 RADIAL_LAYOUT_MAX_CANVAS_DIM / fullHeight);
+     }
+     xScale *= lodScale;
+     yScale *= lodScale;
+     double lodNodeSize = nodeSize * lodScale;
+
+     imageHeight = ABS(ymax - ymin) * yScale + 4 * lodNodeSize;
+     imageWidth = MAX(PNGOUT_MIN_IMAGE_WIDTH, ABS(xmax - xmin) * xScale + 4 * lodNodeSize);
+     displayList.Clear();
+     displayList.SetExtents(MAX(DEFAULT_RLWIN_WIDTH, imageWidth), 
+		            MAX(DEFAULT_RLWIN_HEIGHT, imageHeight), lodNodeSize);
+     for(int idx = 0; idx < rnaSubseqLen; idx++) {
+          int nodeX = (int) ((xPosArr[idx] - xmin) * xScale + 2 * lodNodeSize);
+	  int nodeY = (int) ((yPosArr[idx] - ymin) * yScale + 2 * lodNodeSize);
+	  bool highlighted = (size_t) idx >= startPos && (size_t) idx <= endPos;
+	  displayList.AddNode(nodeX, nodeY, rnaSeq[idx], idx, highlighted);
+	  if(idx > 0) {
+	       displayList.AddEdge(idx - 1, idx);
+	  }
+     }
+     displayList.BuildIndex();
+
+}
+
+void RadialLayoutDisplayWindow::SetDefaultScrollPosition() {
+     defaultScrollToX = defaultScrollToY = -1;
+     for(int idx = 0; idx < displayList.GetNodeCount(); idx++) {
+          const RadialLayoutDisplayList_t::LayoutNode_t &node = displayList.GetNode(idx);
+	  if(!node.highlighted) {
+	       continue;
+	  }
+          if(defaultScrollToX == -1 || node.x < defaultScrollToX) {
+	       defaultScrollToX = (int) node.x;
+	  }
+	  if(defaultScrollToY == -1 || node.y < defaultScrollToY) {
+	       defaultScrollToY = (int) node.y;
+	  }
      }
      if(defaultScrollToX + DEFAULT_RLWIN_WIDTH > imageWidth) {
           defaultScrollToX = MAX(0, imageWidth - DEFAULT_RLWIN_WIDTH);
      }
      if(defaultScrollToY + DEFAULT_RLWIN_HEIGHT > imageHeight) {
-      defaultScrollToY = MAX(0, imageHeight - DEFAULT_RLWIN_HEIGHT);
+	  defaultScrollToY = MAX(0, imageHeight - DEFAULT_RLWIN_HEIGHT);
      }
+}
 
-     Free(effectiveRNASubseq);
-     vrna_fold_compound_free(vfc);
-     Free(mfeStructure);
-     Free(pairTable);
-     Free(pairTableG);
-     Free(xPosArr);
-     Free(yPosArr);
+bool RadialLayoutDisplayWindow::WriteLayoutImage(RNAStructure *rnaStruct, const char *pngOutputPath, 
+		                                 VRNAPlotType_t plotType) {
      
-     return plotCanvas;
+     if(rnaStruct == NULL || pngOutputPath == NULL) {
+          return false;
+     }
+     std::shared_ptr<LayoutCoordinates_t> layoutCoords = 
+	  GetNativeLayoutCoordinates(rnaStruct, plotType);
+     if(!layoutCoords) {
+          return false;
+     }
+     RadialLayoutDisplayList_t imageDisplayList;
+     int outWidth = 0, outHeight = 0;
+     BuildLayoutDisplayList(rnaStruct->GetSequenceString(), *layoutCoords, 0, 
+		            rnaStruct->GetLength() - 1, imageDisplayList, 
+			    outWidth, outHeight);
+     cairo_surface_t *pngSrc = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 
+		                                          outWidth, outHeight);
+     if(cairo_surface_status(pngSrc) != CAIRO_STATUS_SUCCESS) {
+          cairo_surface_destroy(pngSrc);
+	  return false;
+     }
+     cairo_t *crImageOutput = cairo_create(pngSrc);
+     CairoColor_t::FromNamedConstant(CairoColorSpec_t::CR_SOLID_WHITE).ApplyRGBAColor(crImageOutput);
+     cairo_rectangle(crImageOutput, 0, 0, outWidth, outHeight);
+     cairo_fill(crImageOutput);
+     imageDisplayList.Render(crImageOutput, 1.0, 0, 0, outWidth, outHeight);
+     cairo_destroy(crImageOutput);
+     cairo_surface_flush(pngSrc);
+     bool writeStatus = cairo_surface_write_to_png(pngSrc, pngOutputPath) == CAIRO_STATUS_SUCCESS;
+     cairo_surface_destroy(pngSrc);
+     return writeStatus;
 
 }
 
@@ -7,6 +7,9 @@
 #define __RADIAL_LAYOUT_IMAGE_H__
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <map>
 
 #include <FL/Fl_Cairo_Window.H>
 #include <FL/Fl_Check_Button.H>
@@ -29,6 +32,9 @@ extern "C" {
 #include "ConfigOptions.h"
 #include "CairoDrawingUtils.h"
 #include "InputWindowExportImage.h"
+#include "SequenceFingerprint.h"
+
+class RNAStructure;
 
 #define DEFAULT_RLWIN_WIDTH           (825)
 #define DEFAULT_RLWIN_HEIGHT          (550)
@@ -45,6 +51,103 @@ extern "C" {
 #define PNG_FOOTER_HEIGHT             (110)
 #define PNGOUT_MIN_IMAGE_WIDTH        (425)
 
+/* The number of folded sequences and computed layouts kept in the caches
+ * (so re-opening the radial view of a structure does not fold it again): */
+#define RADIAL_LAYOUT_CACHE_SIZE      (8)
+
+/* The layouts of a bare sequence are drawn for its MFE structure, which is 
+ * folded on the GUI thread in O(N^3) time, so only sequences up to this 
+ * length are folded. The structures are laid out from their own pairs 
+ * without any limit: */
+#define RADIAL_LAYOUT_MAX_MFE_LENGTH  (1000)
+
+/* The layouts are scaled by the minimum distance between their nodes, but 
+ * by no less than this fraction of the closest backbone neighbors or pairs: */
+#define RADIAL_LAYOUT_MIN_DIST_RATIO  (4.0)
+
+/* Level of detail settings for the large layouts. The canvas is scaled down
+ * to fit in the maximum dimensions, and the nodes are drawn without their
+ * labels (then as plain backbone lines) when they get too small to read: */
+#define RADIAL_LAYOUT_MAX_CANVAS_DIM  (4096)
+#define RADIAL_LOD_MIN_LABEL_SIZE     (16)
+#define RADIAL_LOD_MIN_NODE_SIZE      (3)
+
+#define RADIAL_NODE_SIZE              (38)
+#define RADIAL_NODE_FONT_SIZE         (10)
+
+/* The zoomed layout is drawn in square tiles covering the visible part of 
+ * the window, and the most recently used tiles are kept until the zoom 
+ * level changes: */
+#define RADIAL_TILE_SIZE              (256)
+#define RADIAL_TILE_CACHE_SIZE        (96)
+#define RADIAL_INDEX_CELL_SIZE        (64)
+#define RADIAL_MIN_DISPLAY_SCALE      (0.1)
+#define RADIAL_MAX_DISPLAY_SCALE      (16.0)
+
+/* The retained display list of a radial layout. The nodes and edges are 
+ * stored in the coordinates of the unzoomed image with a grid index over 
+ * them, so any part of the layout is redrawn at any scale without touching 
+ * (or rasterizing) the rest of it: */
+class RadialLayoutDisplayList_t {
+
+     public:
+	  typedef enum {
+	       LOD_LABELED_NODES, 
+	       LOD_PLAIN_NODES, 
+	       LOD_BACKBONE_ONLY
+	  } LayoutDetailLevel_t;
+
+	  typedef struct {
+	       float x, y;
+	       char baseCh;
+	       int baseIndex;
+	       bool highlighted;
+	  } LayoutNode_t;
+
+	  typedef struct {
+	       int fromNode, toNode;
+	  } LayoutEdge_t;
+
+	  RadialLayoutDisplayList_t();
+
+	  void Clear();
+	  void SetExtents(int width, int height, double nodeSize);
+	  int AddNode(float x, float y, char baseCh, int baseIndex, bool highlighted);
+	  void AddEdge(int fromNode, int toNode);
+
+	  /* Builds the grid index (called once all of the nodes and edges are added): */
+	  void BuildIndex();
+
+	  inline int GetWidth() const { return width; }
+	  inline int GetHeight() const { return height; }
+	  inline int GetNodeCount() const { return nodes.size(); }
+	  inline bool IsEmpty() const { return nodes.size() == 0; }
+	  inline const LayoutNode_t & GetNode(int nodeIdx) const { return nodes[nodeIdx]; }
+
+	  LayoutDetailLevel_t GetDetailLevel(double scale) const;
+
+	  /* Draws the nodes and edges inside the clip rectangle (given in the 
+	   * coordinates of the zoomed image) at the scale onto cr: */
+	  void Render(cairo_t *cr, double scale, double clipX, double clipY, 
+		      double clipWidth, double clipHeight) const;
+
+     private:
+	  std::vector<LayoutNode_t> nodes;
+	  std::vector<LayoutEdge_t> edges;
+	  int width, height;
+	  double nodeSize, maxEdgeLength;
+
+	  int gridCols, gridRows;
+	  std::vector<std::vector<int> > nodeGrid, edgeGrid;
+
+	  inline int GetGridCell(double x, double y) const {
+	       int col = MIN(MAX(0, (int) (x / RADIAL_INDEX_CELL_SIZE)), gridCols - 1);
+	       int row = MIN(MAX(0, (int) (y / RADIAL_INDEX_CELL_SIZE)), gridRows - 1);
+	       return row * gridCols + col;
+	  }
+
+};
+
 class RadialLayoutWindowCallbackInterface {
      
      public:
@@ -74,14 +177,25 @@ class RadialLayoutWindowCallbackInterface {
 class RadialLayoutDisplayWindow : public Fl_Cairo_Window, public RadialLayoutWindowCallbackInterface {
 
      public:
-          static const int MAX_SEQUENCE_DISPLAY_LENGTH = 500;
-	  
 	  typedef enum {
                 PLOT_TYPE_SIMPLE   = VRNA_PLOT_TYPE_SIMPLE, 
 		PLOT_TYPE_CIRCULAR = VRNA_PLOT_TYPE_CIRCULAR, 
 		PLOT_TYPE_NAVIEW
 	  } VRNAPlotType_t;
 
+	  /* The (unscaled) coordinates of the bases in a layout, keyed by the 
+	   * sequence fingerprint, a hash of the pairing and the plot type. The 
+	   * native layouts are computed by StructureLayout_t instead of VRNA: */
+	  typedef struct {
+	       SequenceFingerprint_t seqFingerprint;
+	       uint64_t pairingHash;
+	       int plotType;
+	       bool nativeLayout;
+	       std::vector<float> xPosArr, yPosArr;
+	       double xmin, xmax, ymin, ymax;
+	       double minNodeDist;
+	  } LayoutCoordinates_t;
+
           RadialLayoutDisplayWindow(size_t width = DEFAULT_RLWIN_WIDTH, 
 			            size_t height = DEFAULT_RLWIN_HEIGHT);
 	  ~RadialLayoutDisplayWindow();
@@ -97,6 +211,11 @@ class RadialLayoutDisplayWindow : public Fl_Cairo_Window, public RadialLayoutWin
 	  bool DisplayRadialDiagram(const char *rnaSeq, size_t startSeqPos, 
 			            size_t endSeqPos, size_t seqLength);
 
+	  /* Displays the layout of the (nested) pairs of the structure itself
+	   * rather than of the MFE structure of its sequence: */
+	  bool DisplayRadialDiagram(RNAStructure *rnaStruct, size_t startSeqPos, 
+			            size_t endSeqPos);
+
 	  inline void RadialWindowCloseCallback(Fl_Widget *rlWin, void *udata) {}
 
      protected:
@@ -106,9 +225,18 @@ class RadialLayoutDisplayWindow : public Fl_Cairo_Window, public RadialLayoutWin
      private:
 	  char *winTitle;
 	  int vrnaPlotType;
-          CairoContext_t *radialLayoutCanvas, *radialLayoutCanvasOrig;
+	  RadialLayoutDisplayList_t displayList;
+	  double displayScale;
           bool haveInitVRNAScroller;
 
+	  typedef struct {
+	       cairo_surface_t *tileSurface;
+	       unsigned long lastUsed;
+	  } LayoutTile_t;
+
+	  std::map<std::pair<int, int>, LayoutTile_t> tileCache;
+	  unsigned long tileUseCount;
+
 	  Fl_Box *scrollerFillBox;
 	  Fl_Button *scalePlusBtn, *scaleMinusBtn, *resetBtn;
 	  Fl_Button *exportToPNGBtn;
@@ -127,6 +255,23 @@ class RadialLayoutDisplayWindow : public Fl_Cairo_Window, public RadialLayoutWin
 
 	  std::string GetExportToPNGOutputPath();
 
+	  cairo_surface_t * GetLayoutTile(int tileCol, int tileRow);
+	  void ClearTileCache();
+	  void SetDisplayScale(double nextScale);
+	  void SetDefaultScrollPosition();
+
+	  typedef struct {
+	       SequenceFingerprint_t seqFingerprint;
+	       std::string baseSeq;
+	       std::string mfeStructure;
+	  } MFEStructureEntry_t;
+
+	  static std::vector<MFEStructureEntry_t> mfeStructureCache;
+	  static std::vector<std::shared_ptr<LayoutCoordinates_t> > layoutCoordsCache;
+
+	  static void ComputeLayoutExtents(LayoutCoordinates_t &layoutEntry, 
+			                   const std::vector<int> &pairTable);
+
 	  static void SaveRadialLayoutToPNGCallback(Fl_Widget *exportBtn, void *udata);
 	  static void ScaleRadialLayoutPlusCallback(Fl_Widget *scaleBtn, void *udata);
           static void ScaleRadialLayoutMinusCallback(Fl_Widget *scaleBtn, void *udata);
@@ -135,13 +280,37 @@ class RadialLayoutDisplayWindow : public Fl_Cairo_Window, public RadialLayoutWin
           static void HandleWindowScrollCallback(Fl_Widget *scrw, void *udata);
 
      public:
-          CairoContext_t * GetVRNARadialLayoutData(const char *rnaSubseq, 
- 		                                   size_t startPos, 
-		                                   size_t endPos, 
-					           size_t seqLength, 
-						   VRNAPlotType_t plotType = PLOT_TYPE_SIMPLE);
+          bool GetVRNARadialLayoutData(const char *rnaSubseq, 
+ 		                       size_t startPos, 
+		                       size_t endPos, 
+				       size_t seqLength, 
+				       VRNAPlotType_t plotType = PLOT_TYPE_SIMPLE);
           static CairoColor_t GetBaseNodeColor(char baseCh);
 
+	  /* Return the (cached) MFE structure of the sequence, and the (cached)
+	   * layout coordinates of the sequence with the dot bracket pairing: */
+	  static std::string GetMFEStructure(const char *rnaSeq);
+	  static std::shared_ptr<LayoutCoordinates_t> GetLayoutCoordinates(const char *rnaSeq, 
+			                                                   const char *dotStructure, 
+									   VRNAPlotType_t plotType);
+	  static std::shared_ptr<LayoutCoordinates_t> GetNativeLayoutCoordinates(RNAStructure *rnaStruct, 
+			                                                         VRNAPlotType_t plotType);
+	  static void ClearLayoutCaches();
+
+	  /* Scales the layout coordinates of the sequence into the display list
+	   * (the bases in [startPos, endPos] are highlighted), and returns the 
+	   * size of the unzoomed image: */
+	  static void BuildLayoutDisplayList(const char *rnaSeq, const LayoutCoordinates_t &layoutCoords, 
+			                     size_t startPos, size_t endPos, 
+					     RadialLayoutDisplayList_t &displayList, 
+					     int &imageWidth, int &imageHeight);
+
+	  /* Writes the native layout of the structure to a PNG image without 
+	   * opening a window (for the large structures and batch exports, see 
+	   * the --export-layout command line option): */
+	  static bool WriteLayoutImage(RNAStructure *rnaStruct, const char *pngOutputPath, 
+			               VRNAPlotType_t plotType = PLOT_TYPE_SIMPLE);
+
 };
 
 #endif
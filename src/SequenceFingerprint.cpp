@@ -0,0 +1,114 @@
+/* SequenceFingerprint.cpp : Implementation of the XXH64 sequence fingerprints;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <string.h>
+
+#include "SequenceFingerprint.h"
+
+namespace SequenceFingerprint {
+
+     static const uint64_t XXH_PRIME64_1 = 0x9e3779b185ebca87ULL;
+     static const uint64_t XXH_PRIME64_2 = 0xc2b2ae3d27d4eb4fULL;
+     static const uint64_t XXH_PRIME64_3 = 0x165667b19e3779f9ULL;
+     static const uint64_t XXH_PRIME64_4 = 0x85ebca77c2b2ae63ULL;
+     static const uint64_t XXH_PRIME64_5 = 0x27d4eb2f165667c5ULL;
+
+     static inline uint64_t RotateLeft(uint64_t x, int r) {
+          return (x << r) | (x >> (64 - r));
+     }
+
+     // The unaligned loads are done with memcpy, and the hash is defined on
+     // the little endian words (so fingerprints agree across platforms):
+     static inline uint64_t ReadWord64(const uint8_t *p) {
+          uint64_t word;
+          memcpy(&word, p, sizeof(uint64_t));
+          #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+          word = __builtin_bswap64(word);
+          #endif
+          return word;
+     }
+
+     static inline uint32_t ReadWord32(const uint8_t *p) {
+          uint32_t word;
+          memcpy(&word, p, sizeof(uint32_t));
+          #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+          word = __builtin_bswap32(word);
+          #endif
+          return word;
+     }
+
+     static inline uint64_t Round(uint64_t acc, uint64_t input) {
+          acc += input * XXH_PRIME64_2;
+          acc = RotateLeft(acc, 31);
+          return acc * XXH_PRIME64_1;
+     }
+
+     static inline uint64_t MergeRound(uint64_t acc, uint64_t val) {
+          acc ^= Round(0, val);
+          return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+     }
+
+     uint64_t XXH64(const void *data, size_t length, uint64_t seed) {
+          const uint8_t *p = (const uint8_t *) data;
+          const uint8_t *pEnd = p + length;
+          uint64_t h64;
+          if(length >= 32) {
+               uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+               uint64_t v2 = seed + XXH_PRIME64_2;
+               uint64_t v3 = seed;
+               uint64_t v4 = seed - XXH_PRIME64_1;
+               const uint8_t *pLimit = pEnd - 32;
+               do {
+                    v1 = Round(v1, ReadWord64(p));
+                    v2 = Round(v2, ReadWord64(p + 8));
+                    v3 = Round(v3, ReadWord64(p + 16));
+                    v4 = Round(v4, ReadWord64(p + 24));
+                    p += 32;
+               } while(p <= pLimit);
+               h64 = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+               h64 = MergeRound(h64, v1);
+               h64 = MergeRound(h64, v2);
+               h64 = MergeRound(h64, v3);
+               h64 = MergeRound(h64, v4);
+          }
+          else {
+               h64 = seed + XXH_PRIME64_5;
+          }
+          h64 += (uint64_t) length;
+          while(p + 8 <= pEnd) {
+               h64 ^= Round(0, ReadWord64(p));
+               h64 = RotateLeft(h64, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+               p += 8;
+          }
+          if(p + 4 <= pEnd) {
+               h64 ^= (uint64_t) ReadWord32(p) * XXH_PRIME64_1;
+               h64 = RotateLeft(h64, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+               p += 4;
+          }
+          while(p < pEnd) {
+               h64 ^= (*p) * XXH_PRIME64_5;
+               h64 = RotateLeft(h64, 11) * XXH_PRIME64_1;
+               p++;
+          }
+          h64 ^= h64 >> 33;
+          h64 *= XXH_PRIME64_2;
+          h64 ^= h64 >> 29;
+          h64 *= XXH_PRIME64_3;
+          h64 ^= h64 >> 32;
+          return h64;
+     }
+
+     SequenceFingerprint_t ComputeFingerprint(const char *baseSeq, size_t seqLength) {
+          if(baseSeq == NULL) {
+               seqLength = 0;
+               baseSeq = "";
+          }
+          SequenceFingerprint_t seqFP;
+          seqFP.low = XXH64(baseSeq, seqLength, SEQFP_LOW_SEED);
+          seqFP.high = XXH64(baseSeq, seqLength, SEQFP_HIGH_SEED);
+          return seqFP;
+     }
+
+}
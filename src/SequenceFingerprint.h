@@ -0,0 +1,54 @@
+/* SequenceFingerprint.h : Fast (non-cryptographic) 128-bit fingerprints of
+ *                         the full base sequence of a structure, which are
+ *                         used to identify structures with the same sequence;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#ifndef __SEQUENCE_FINGERPRINT_H__
+#define __SEQUENCE_FINGERPRINT_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* The fingerprint is a pair of XXH64 hashes of the whole sequence taken
+ * with two different seeds. The low word alone is used as the key into
+ * the hash indexes in StructureManager. The hash is defined on the little
+ * endian words of the sequence, so the fingerprints are the same on every
+ * platform and are also used as the persisted sticky folder name keys
+ * (see StickyFolderNameKey):
+ */
+typedef struct SequenceFingerprint_t {
+     uint64_t low;
+     uint64_t high;
+
+     inline bool operator==(const struct SequenceFingerprint_t &rhs) const {
+          return low == rhs.low && high == rhs.high;
+     }
+
+     inline bool operator!=(const struct SequenceFingerprint_t &rhs) const {
+          return !(*this == rhs);
+     }
+
+} SequenceFingerprint_t;
+
+#define SEQFP_LOW_SEED                (0x0ULL)
+#define SEQFP_HIGH_SEED               (0x9e3779b97f4a7c15ULL)
+
+namespace SequenceFingerprint {
+
+     /* The standard XXH64 hash of the bytes in data: */
+     uint64_t XXH64(const void *data, size_t length, uint64_t seed);
+
+     SequenceFingerprint_t ComputeFingerprint(const char *baseSeq, size_t seqLength);
+
+     /* Hashes the fingerprint into a single word (for std::unordered_map): */
+     struct Hasher_t {
+          inline size_t operator()(const SequenceFingerprint_t &seqFP) const {
+               return (size_t) (seqFP.low ^ (seqFP.high * SEQFP_HIGH_SEED));
+          }
+     };
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 
 #include <FL/Fl_Box.H>
 #include <FL/Fl_Button.H>
@@ -26,11 +27,28 @@
 #include "InputWindow.h"
 #include "ConfigOptions.h"
 #include "ConfigParser.h"
+#include "TreeEditDistance.h"
+#include "LoadProgressWindow.h"
 
 #include "pixmaps/StatsFormula.c"
 #include "pixmaps/StatsWindowIcon.xbm"
 #include "pixmaps/StatsOverviewLegend.c"
 
+/* The element types reported in the table and the export (the exterior 
+   loop is left out since it is whatever remains outside of the others): */
+static const struct {
+    StructureElementTree_t::ElementType_t elementType;
+    const char *tableHeader;
+    const char *exportHeader;
+} STATS_ELEMENT_COLUMNS[] = {
+    { StructureElementTree_t::ELEMENT_STEM,      "Stem",  "Stem_Agreement" },
+    { StructureElementTree_t::ELEMENT_HAIRPIN,   "Hpin",  "Hairpin_Agreement" },
+    { StructureElementTree_t::ELEMENT_BULGE,     "Bulge", "Bulge_Agreement" },
+    { StructureElementTree_t::ELEMENT_INTERIOR,  "Intr.", "Interior_Loop_Agreement" },
+    { StructureElementTree_t::ELEMENT_MULTILOOP, "Multi", "Multiloop_Agreement" },
+};
+#define STATS_ELEMENT_COLUMN_COUNT    (sizeof(STATS_ELEMENT_COLUMNS) / sizeof(STATS_ELEMENT_COLUMNS[0]))
+
 Fl_RGB_Image * StatsWindow::overviewLegendImage = new Fl_RGB_Image(
                StatsOverviewLegend.pixel_data, 
                StatsOverviewLegend.width, 
@@ -62,6 +80,7 @@ void StatsWindow::Construct(int w, int h, const std::vector<int>& structures)
     folderIndex = -1;
     referenceIndex = -1;
     numStats = 0;
+    slippageTolerance = DEFAULT_STATS_SLIPPAGE;
     statistics = NULL;
     color(GUI_WINDOW_BGCOLOR);
     
@@ -1200,6 +1219,28 @@ void StatsWindow::ClearStats()
     numStats = 0;
 }
 
+/* 
+ * Returns whether the pair (i, j) occurs in the pair table up to a shift of at 
+ * most tolerance bases at one of its two ends, i.e., whether (i +/- d, j) or 
+ * (i, j +/- d) is a pair for some 0 <= d <= tolerance. The indexed pair table 
+ * makes each check O(tolerance) rather than a scan over all of the pairs: 
+ */
+bool StatsWindow::PairMatchesWithSlippage(const std::vector<int> &pairTable, 
+		                          int i, int j, int tolerance)
+{
+    int seqLength = pairTable.size();
+    for (int d = -tolerance; d <= tolerance; d++)
+    {
+        if (i + d >= 0 && i + d < seqLength && pairTable[i + d] == j) {
+            return true;
+        }
+        else if (j + d >= 0 && j + d < seqLength && pairTable[j + d] == i) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void StatsWindow::ComputeStats()
 {
     ClearStats();
@@ -1223,6 +1264,11 @@ void StatsWindow::ComputeStats()
                       structureManager->GetStructure(m_structures[referenceIndex]);
     SetReferenceStructure(referenceIndex);
     
+    // Indexed pair table used for the slippage tolerant comparisons
+    std::vector<int> refPairTable = reference->GetPairTable();
+    slippageTolerance = MAX(0, STATS_SLIPPAGE_TOLERANCE);
+    int slippage = slippageTolerance;
+    
     // Compute the number of base pairs in the reference structure
     unsigned int ref_base_pair_count = 0;
     for (unsigned int i=0; i < reference->GetLength(); i++)
@@ -1235,6 +1281,7 @@ void StatsWindow::ComputeStats()
     }
     
     // Compute statistics for selected structures
+    std::vector<RNAStructure *> statsStructs(comp_pack->children(), (RNAStructure *) NULL);
     int statsIndex;
     int counter = 1; 
     // Use a different counter so statsIndex will be 0 if it's the reference and counter otherwise
@@ -1259,12 +1306,14 @@ void StatsWindow::ComputeStats()
                 statistics[statsIndex].ref = true;
             }
             statistics[statsIndex].isValid = true;
+            statsStructs[statsIndex] = predicted;
 	    statistics[statsIndex].filename = predicted->GetFilenameNoExtension();
             statistics[statsIndex].base_pair_count = 0;
             statistics[statsIndex].gc_count = 0;
             statistics[statsIndex].au_count = 0;
             statistics[statsIndex].gu_count = 0;
             statistics[statsIndex].non_canon_count = 0;
+            statistics[statsIndex].pknot_count = predicted->GetPseudoknottedPairsCount();
             statistics[statsIndex].true_pos_count = 0;
             statistics[statsIndex].false_neg_count = 0;
             statistics[statsIndex].false_pos_count = 0;
@@ -1274,6 +1323,12 @@ void StatsWindow::ComputeStats()
             statistics[statsIndex].sensitivity = 0;
             statistics[statsIndex].selectivity = 0;
             statistics[statsIndex].pos_pred_value = 0;
+            statistics[statsIndex].slip_true_pos_count = 0;
+            statistics[statsIndex].slip_ref_found_count = 0;
+            statistics[statsIndex].slip_sensitivity = 0;
+            statistics[statsIndex].slip_pos_pred_value = 0;
+            std::vector<int> predPairTable = predicted->GetPairTable();
+            ComputeElementAgreement(reference, predicted, statistics[statsIndex].element_agreement);
             
 
             // Compute counts
@@ -1308,6 +1363,19 @@ void StatsWindow::ComputeStats()
                     {
                         statistics[statsIndex].non_canon_count++;
                     }
+                    
+                    if (PairMatchesWithSlippage(refPairTable, uj, 
+                                                predicted->GetBaseAt(uj)->m_pair, slippage))
+                    {
+                        statistics[statsIndex].slip_true_pos_count++;
+                    }
+                }
+                if (reference->GetBaseAt(uj)->m_pair != RNAStructure::UNPAIRED && 
+                    reference->GetBaseAt(uj)->m_pair > uj && 
+                    PairMatchesWithSlippage(predPairTable, uj, 
+                                            reference->GetBaseAt(uj)->m_pair, slippage))
+                {
+                    statistics[statsIndex].slip_ref_found_count++;
                 }
                 
                 // If the base pair in reference & predicted match, increment TP
@@ -1390,6 +1458,17 @@ void StatsWindow::ComputeStats()
                 (float)statistics[statsIndex].true_pos_count /
                 ((float)statistics[statsIndex].true_pos_count + 
                  (float)statistics[statsIndex].false_pos_count);
+                // same denominator as the exact PPV above:
+                statistics[statsIndex].slip_pos_pred_value = 
+                (float)statistics[statsIndex].slip_true_pos_count /
+                ((float)statistics[statsIndex].true_pos_count + 
+                 (float)statistics[statsIndex].false_pos_count);
+            }
+            if (ref_base_pair_count > 0)
+            {
+                statistics[statsIndex].slip_sensitivity = 
+                (float)statistics[statsIndex].slip_ref_found_count /
+                (float)ref_base_pair_count;
             }
             
             // Increment which statistics struct is being accessed
@@ -1398,16 +1477,26 @@ void StatsWindow::ComputeStats()
             }
         }
     }
+    ComputeTreeEditDistances(reference, statsStructs);
     
     buff->append("Reference structure: ");
     buff->append(reference->GetFilenameNoExtension());
-    buff->append("\n\n");
+    buff->append("\n");
+    char slippageNote[MAX_BUFFER_SIZE];
+    snprintf(slippageNote, MAX_BUFFER_SIZE, 
+             "Slippage tolerant (Sens~k, PPV~k) pair matching with k = %d\n\n", slippage);
+    buff->append(slippageNote);
     //buff->append("Comparison structures:\n\n");
     buff->append(
-                     "Filename\t\t\t\tPairs\tTPs\tFPs\tFNs\tSensi.\tSelec.\tPPV\tConfl.\tContr.\tCompa.\tG-C\tA-U\tG-U\tOther\n" 
+                     "Filename\t\t\t\tPairs\tTPs\tFPs\tFNs\tSensi.\tSens~k\tSelec.\tPPV\tPPV~k\tConfl.\tContr.\tCompa.\tG-C\tA-U\tG-U\tOther\tKnots\tTED-F\tTED-C" 
                 );
+    for (unsigned int ecol = 0; ecol < STATS_ELEMENT_COLUMN_COUNT; ecol++)
+    {
+        buff->append("\t");
+        buff->append(STATS_ELEMENT_COLUMNS[ecol].tableHeader);
+    }
+    buff->append("\n");
     
-     unsigned int activeStatsCount = 0;
      for (unsigned int ui=0; ui < comp_pack->children(); ui++)
      {
         
@@ -1462,12 +1551,16 @@ void StatsWindow::ComputeStats()
         sprintf(statistics[ui].sens_char,"%.3f",statistics[ui].sensitivity);
         sprintf(tempc,"%.4f\t",statistics[ui].sensitivity);
         buff->append(tempc);
+        sprintf(tempc,"%.4f\t",statistics[ui].slip_sensitivity);
+        buff->append(tempc);
         sprintf(statistics[ui].sel_char,"%.3f",statistics[ui].selectivity);
         sprintf(tempc,"%.4f\t",statistics[ui].selectivity);
         buff->append(tempc);
         sprintf(statistics[ui].ppv_char,"%.3f",statistics[ui].pos_pred_value);
         sprintf(tempc,"%.4f\t",statistics[ui].pos_pred_value);
         buff->append(tempc);
+        sprintf(tempc,"%.4f\t",statistics[ui].slip_pos_pred_value);
+        buff->append(tempc);
         sprintf(statistics[ui].conf_char,"%d",statistics[ui].conflict_count);
         sprintf(tempc,"%d\t",statistics[ui].conflict_count);
         buff->append(tempc);
@@ -1487,13 +1580,38 @@ void StatsWindow::ComputeStats()
         sprintf(tempc,"%d\t",statistics[ui].gu_count);
         buff->append(tempc);
         sprintf(statistics[ui].nc_char,"%d",statistics[ui].non_canon_count);
-        if (activeStatsCount++ == 0) {
-            sprintf(tempc,"%d\n",statistics[ui].non_canon_count);
+        sprintf(tempc,"%d\t",statistics[ui].non_canon_count);
+        buff->append(tempc);
+        sprintf(tempc,"%d\t",statistics[ui].pknot_count);
+        buff->append(tempc);
+        if (statistics[ui].tree_dist_full == TED_DISTANCE_UNDEFINED) {
+            strcpy(statistics[ui].tedf_char, "N/A");
         }
         else {
-            sprintf(tempc,"%d\n",statistics[ui].non_canon_count);
+            sprintf(statistics[ui].tedf_char,"%d",statistics[ui].tree_dist_full);
         }
+        sprintf(tempc,"%s\t",statistics[ui].tedf_char);
         buff->append(tempc);
+        if (statistics[ui].tree_dist_coarse == TED_DISTANCE_UNDEFINED) {
+            strcpy(statistics[ui].tedc_char, "N/A");
+        }
+        else {
+            sprintf(statistics[ui].tedc_char,"%d",statistics[ui].tree_dist_coarse);
+        }
+        sprintf(tempc,"%s",statistics[ui].tedc_char);
+        buff->append(tempc);
+        for (unsigned int ecol = 0; ecol < STATS_ELEMENT_COLUMN_COUNT; ecol++)
+        {
+            float agreement = statistics[ui].element_agreement[STATS_ELEMENT_COLUMNS[ecol].elementType];
+            if (agreement == STATS_ELEMENT_AGREEMENT_UNDEFINED) {
+                strcpy(tempc, "\tN/A");
+            }
+            else {
+                sprintf(tempc,"\t%.4f",agreement);
+            }
+            buff->append(tempc);
+        }
+        buff->append("\n");
     }
     
     int colors[7] = {
@@ -1531,6 +1649,102 @@ void StatsWindow::ComputeStats()
     redraw();
 }
 
+void StatsWindow::ComputeElementAgreement(RNAStructure *reference, RNAStructure *predicted, 
+		                          float *elementAgreement)
+{
+    const StructureElementTree_t *refTree = reference->GetElementTree();
+    const StructureElementTree_t *predTree = predicted->GetElementTree();
+    unsigned int refTypeCounts[StructureElementTree_t::NUM_ELEMENT_TYPES] = { 0 };
+    unsigned int agreeCounts[StructureElementTree_t::NUM_ELEMENT_TYPES] = { 0 };
+    unsigned int numBases = MIN(reference->GetLength(), predicted->GetLength());
+    for (unsigned int ui = 0; ui < numBases; ui++)
+    {
+        StructureElementTree_t::ElementType_t refType = refTree->GetElementTypeAt(ui);
+        refTypeCounts[refType]++;
+        if (predTree->GetElementTypeAt(ui) == refType) {
+            agreeCounts[refType]++;
+        }
+    }
+    for (int etype = 0; etype < StructureElementTree_t::NUM_ELEMENT_TYPES; etype++)
+    {
+        elementAgreement[etype] = refTypeCounts[etype] == 0 ? STATS_ELEMENT_AGREEMENT_UNDEFINED : 
+                                  (float) agreeCounts[etype] / (float) refTypeCounts[etype];
+    }
+}
+
+/* State for the progress window shown while the tree edit distances are
+ * computed (it is only opened if the computation takes a while):
+ */
+typedef struct {
+    LoadProgressWindow *progressWin;
+    std::chrono::steady_clock::time_point startTime;
+    int numDoneOffset;
+    int numTotal;
+} TreeEditDistanceProgress_t;
+
+static void TreeEditDistanceProgressCallback(int numDone, int numTotal, void *udata)
+{
+    TreeEditDistanceProgress_t *tedProgress = (TreeEditDistanceProgress_t *) udata;
+    if (tedProgress->progressWin == NULL) {
+        int elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - tedProgress->startTime).count();
+        if (elapsedMs < STATS_TED_PROGRESS_DELAY_MS) {
+            return;
+        }
+        // Modal so that no other window callbacks run until the workers
+        // have been joined:
+        tedProgress->progressWin = new LoadProgressWindow(
+            "Computing Tree Edit Distances ...", tedProgress->numTotal, false, true);
+    }
+    tedProgress->progressWin->SetProgress(tedProgress->numDoneOffset + numDone);
+}
+
+void StatsWindow::ComputeTreeEditDistances(RNAStructure *reference, 
+		                           const std::vector<RNAStructure *> &statsStructs)
+{
+    // The tree encodings are built up front on this thread since the element 
+    // trees are cached lazily by the structures; only the distances themselves 
+    // are computed in parallel:
+    std::vector<TreeEditDistance::OrderedTree_t> fullTrees(statsStructs.size());
+    std::vector<TreeEditDistance::OrderedTree_t> coarseTrees(statsStructs.size());
+    std::vector<const TreeEditDistance::OrderedTree_t *> fullTreePtrs(statsStructs.size(), NULL);
+    std::vector<const TreeEditDistance::OrderedTree_t *> coarseTreePtrs(statsStructs.size(), NULL);
+    for (unsigned int si = 0; si < statsStructs.size(); si++)
+    {
+        if (statsStructs[si] == NULL) {
+            continue;
+        }
+        fullTrees[si] = TreeEditDistance::OrderedTree_t::FromPairTable(
+                            statsStructs[si]->GetNestedPairTable());
+        coarseTrees[si] = TreeEditDistance::OrderedTree_t::FromElementTree(
+                              *(statsStructs[si]->GetElementTree()));
+        fullTreePtrs[si] = &fullTrees[si];
+        coarseTreePtrs[si] = &coarseTrees[si];
+    }
+    TreeEditDistance::OrderedTree_t refFullTree = 
+        TreeEditDistance::OrderedTree_t::FromPairTable(reference->GetNestedPairTable());
+    TreeEditDistance::OrderedTree_t refCoarseTree = 
+        TreeEditDistance::OrderedTree_t::FromElementTree(*(reference->GetElementTree()));
+    
+    std::vector<int> fullDists, coarseDists;
+    TreeEditDistanceProgress_t tedProgress;
+    tedProgress.progressWin = NULL;
+    tedProgress.startTime = std::chrono::steady_clock::now();
+    tedProgress.numDoneOffset = 0;
+    tedProgress.numTotal = 2 * statsStructs.size();
+    TreeEditDistance::ComputeDistancesParallel(refFullTree, fullTreePtrs, fullDists, 0, 
+                                               TreeEditDistanceProgressCallback, &tedProgress);
+    tedProgress.numDoneOffset = statsStructs.size();
+    TreeEditDistance::ComputeDistancesParallel(refCoarseTree, coarseTreePtrs, coarseDists, 0, 
+                                               TreeEditDistanceProgressCallback, &tedProgress);
+    Delete(tedProgress.progressWin, LoadProgressWindow);
+    for (unsigned int si = 0; si < statsStructs.size(); si++)
+    {
+        statistics[si].tree_dist_full = fullDists[si];
+        statistics[si].tree_dist_coarse = coarseDists[si];
+    }
+}
+
 void StatsWindow::DrawHistograms()
 {
     bp_chart->clear();
@@ -2265,17 +2479,28 @@ void StatsWindow::ExportTable()
                     "Filename,Reference,Base_Pairs,True_Positive,False_Positive,");
             fprintf(expFile,
                     "False_Negative,Conflict,Contradict,Compatible,Sensitivity,");
+            fprintf(expFile,
+                    "Sensitivity_Slippage_%d,", slippageTolerance);
             fprintf(expFile,
                     "Selectivity,Positive_Predictive_Value,");
             fprintf(expFile,
-                    "G-C_Pairs,A-U_Pairs,G-U_Pairs,Non-Canonical_Pairs\n"); 
+                    "Positive_Predictive_Value_Slippage_%d,", slippageTolerance);
+            fprintf(expFile,
+                    "G-C_Pairs,A-U_Pairs,G-U_Pairs,Non-Canonical_Pairs,");
+            fprintf(expFile,
+                    "Pseudoknotted_Pairs,Tree_Edit_Distance_Full,Tree_Edit_Distance_Coarse"); 
+            for (unsigned int ecol = 0; ecol < STATS_ELEMENT_COLUMN_COUNT; ecol++)
+            {
+                fprintf(expFile, ",%s", STATS_ELEMENT_COLUMNS[ecol].exportHeader);
+            }
+            fprintf(expFile, "\n");
             
             for (int ui = comp_pack->children() - 1; ui >= 0; ui--)
             {
 		if(!statistics[ui].isValid) continue;
                 // print the row of statistics for each structure
                 fprintf(expFile,
-                        "%s,%d,%d,%d,%d,%d,%d,%d,%d,%.10f,%.10f,%.10f,%d,%d,%d,%d\n",
+                        "%s,%d,%d,%d,%d,%d,%d,%d,%d,%.10f,%.10f,%.10f,%.10f,%.10f,%d,%d,%d,%d,%d",
                         statistics[ui].filename,
                         statistics[ui].ref,
                         statistics[ui].base_pair_count,
@@ -2286,12 +2511,38 @@ void StatsWindow::ExportTable()
                         statistics[ui].contradict_count,
                         statistics[ui].compatible_count,
                         statistics[ui].sensitivity,
+                        statistics[ui].slip_sensitivity,
                         statistics[ui].selectivity,
                         statistics[ui].pos_pred_value,
+                        statistics[ui].slip_pos_pred_value,
                         statistics[ui].gc_count,
                         statistics[ui].au_count,
                         statistics[ui].gu_count,
-                        statistics[ui].non_canon_count);
+                        statistics[ui].non_canon_count,
+                        statistics[ui].pknot_count);
+                // undefined tree edit distances are left as NA:
+                int treeDists[2] = { statistics[ui].tree_dist_full, 
+                                     statistics[ui].tree_dist_coarse };
+                for (int tdi = 0; tdi < 2; tdi++)
+                {
+                    if (treeDists[tdi] == TED_DISTANCE_UNDEFINED) {
+                        fprintf(expFile, ",NA");
+                    }
+                    else {
+                        fprintf(expFile, ",%d", treeDists[tdi]);
+                    }
+                }
+                for (unsigned int ecol = 0; ecol < STATS_ELEMENT_COLUMN_COUNT; ecol++)
+                {
+                    float agreement = statistics[ui].element_agreement[STATS_ELEMENT_COLUMNS[ecol].elementType];
+                    if (agreement == STATS_ELEMENT_AGREEMENT_UNDEFINED) {
+                        fprintf(expFile, ",NA");
+                    }
+                    else {
+                        fprintf(expFile, ",%.10f", agreement);
+                    }
+                }
+                fprintf(expFile, "\n");
             }
             fclose(expFile);
         }
@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "RNAStructure.h"
+#include "StructureElementTree.h"
 #include "StructureManager.h"
 #include "InputWindow.h"
 #include "ConfigOptions.h"
@@ -38,6 +39,12 @@
 #define DEFAULT_STATSWIN_WIDTH        (1400)
 #define DEFAULT_STATSWIN_HEIGHT       (700)
 
+/* The element agreement when the reference has no bases of that type: */
+#define STATS_ELEMENT_AGREEMENT_UNDEFINED    (-1.0f)
+
+/* Only show the progress window if the tree edit distances take longer than this: */
+#define STATS_TED_PROGRESS_DELAY_MS          (300)
+
 
 namespace RocBoxPlot {
 
@@ -59,6 +66,12 @@ public:
     	const std::vector<int>& structures);
     
     virtual ~StatsWindow();
+
+    /* Whether the pair (i, j) occurs in the pair table (as returned by 
+       RNAStructure::GetPairTable) with one of its ends shifted by at most 
+       tolerance bases */
+    static bool PairMatchesWithSlippage(const std::vector<int> &pairTable, 
+		                        int i, int j, int tolerance);
     
 private:
     static void Draw(Fl_Cairo_Window *crWin, cairo_t *cr);
@@ -139,6 +152,9 @@ public:
         unsigned int au_count; // Number of A-U base pairs
         unsigned int gu_count; // Number of G-U base pairs
         unsigned int non_canon_count; // Number of non-canonical base pairs
+        unsigned int pknot_count; // Number of pseudoknotted (crossing) base pairs
+        int tree_dist_full; // Full tree edit distance to the reference (-1 if not computed)
+        int tree_dist_coarse; // Coarse (loop/helix) tree edit distance to the reference
         unsigned int true_pos_count; // Number of true positive base pairs
         unsigned int false_neg_count; // Number of false negative base pairs 
         unsigned int false_pos_count; // Number of false positive base pairs (discounting compatible)
@@ -148,6 +164,13 @@ public:
         float sensitivity; // Sensitivity = TP/(TP+FN)
         float selectivity; // Selectivity = TP/(TP+FP) discounting compatible
         float pos_pred_value; // Positive predictive value, TP/(TP+FP) including 
+        unsigned int slip_true_pos_count; // Number of predicted pairs matching the reference up to slippage
+        unsigned int slip_ref_found_count; // Number of reference pairs matched by the prediction up to slippage
+        float slip_sensitivity; // Sensitivity allowing +/- STATS_SLIPPAGE_TOLERANCE base slippage
+        float slip_pos_pred_value; // Positive predictive value allowing slippage
+        // Fraction of the reference bases in each type of loop/helix element that 
+        // are in the same type of element in this structure:
+        float element_agreement[StructureElementTree_t::NUM_ELEMENT_TYPES];
     	
 	// compatible char* versions of each value:
         char bp_char [12]; // base_pair_count
@@ -164,6 +187,8 @@ public:
         char au_char [12]; // au_count
         char gu_char [12]; // gu_count
         char nc_char [12]; // non_canon_count
+        char tedf_char [12]; // tree_dist_full
+        char tedc_char [12]; // tree_dist_coarse
     };
     
 protected:
@@ -180,6 +205,16 @@ private:
     
     void ComputeStats();
     
+    /* Fills in the tree edit distances from the reference structure to the 
+       structures in statsStructs (indexed as the statistics array) */
+    void ComputeTreeEditDistances(RNAStructure *reference, 
+		                  const std::vector<RNAStructure *> &statsStructs);
+    
+    /* Fills in the per-element-type agreement of the predicted structure with 
+       the reference in one linear pass over the bases */
+    static void ComputeElementAgreement(RNAStructure *reference, RNAStructure *predicted, 
+		                        float *elementAgreement);
+    
     void DrawHistograms();
     
     void DrawRoc();
@@ -255,6 +290,7 @@ private:
     // Holds the calculated statistics for the window
     StatData* statistics;
     unsigned int numStats; // Number of structures for which there are stat
+    int slippageTolerance; // The +/- base slippage used for the last computed stats
     
     // Text display for statistics
     Fl_Text_Display *text_display;
@@ -0,0 +1,404 @@
+/* StructureArchive.cpp : Implementation of the binary folder archives;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "StructureArchive.h"
+#include "CompressedInput.h"
+#include "ConfigOptions.h"
+#include "TerminalPrinting.h"
+
+StructureArchive::StructureArchive() :
+     archiveData(NULL), archiveSize(0), recordsStart(0), recordsEnd(0),
+     structCount(0), sequenceLength(0), archiveIndex(NULL) {}
+
+StructureArchive::~StructureArchive() {
+     Close();
+}
+
+bool StructureArchive::IsArchiveFile(const char *filePath) {
+     if(filePath == NULL) {
+          return false;
+     }
+     const char *extPos = strrchr(filePath, '.');
+     return extPos != NULL && !strcasecmp(extPos, STRUCTURE_ARCHIVE_FILEEXT);
+}
+
+void StructureArchive::AppendVarint(std::vector<char> &archiveData, uint32_t value) {
+     while(value >= 0x80) {
+          archiveData.push_back((char) ((value & 0x7f) | 0x80));
+          value >>= 7;
+     }
+     archiveData.push_back((char) value);
+}
+
+bool StructureArchive::ReadVarint(const char *&dataPos, const char *dataEnd, uint32_t &value) {
+     value = 0;
+     for(int shift = 0; shift < 35 && dataPos < dataEnd; shift += 7) {
+          uint8_t nextByte = (uint8_t) *(dataPos++);
+          value |= ((uint32_t) (nextByte & 0x7f)) << shift;
+          if((nextByte & 0x80) == 0) {
+               return true;
+          }
+     }
+     return false;
+}
+
+bool StructureArchive::ReadCompressedArchive(const char *archivePath) {
+     FILE *fpArchive = CompressedInput::OpenInputFile(archivePath, "rb");
+     if(fpArchive == NULL) {
+          TerminalText::PrintError("Unable to open the structure archive \"%s\": %s\n",
+                                   archivePath, strerror(errno));
+          return false;
+     }
+     std::vector<char> readBuf(COMPRESSED_INPUT_BUFSIZE);
+     size_t readCount;
+     while((readCount = fread(readBuf.data(), 1, readBuf.size(), fpArchive)) > 0) {
+          inflatedData.insert(inflatedData.end(), readBuf.begin(), readBuf.begin() + readCount);
+     }
+     bool readError = ferror(fpArchive) != 0;
+     fclose(fpArchive);
+     if(readError) {
+          inflatedData.clear();
+          TerminalText::PrintError("Unable to read the compressed structure archive \"%s\"\n",
+                                   archivePath);
+          return false;
+     }
+     return true;
+}
+
+void StructureArchive::ReleaseArchiveData(const void *mappedData, size_t mappedSize) {
+     if(!inflatedData.empty()) {
+          std::vector<char>().swap(inflatedData);
+     }
+     else if(mappedData != NULL) {
+          munmap((void *) mappedData, mappedSize);
+     }
+}
+
+bool StructureArchive::Open(const char *archivePath) {
+
+     Close();
+     if(archivePath == NULL) {
+          return false;
+     }
+     // The compressed archives cannot be mapped, so they are inflated into
+     // memory instead:
+     void *mappedData = NULL;
+     size_t mappedSize = 0;
+     if(CompressedInput::GetCompressionType(archivePath) != CompressedInput::COMPRESSION_NONE) {
+          if(!ReadCompressedArchive(archivePath)) {
+               return false;
+          }
+          else if(inflatedData.size() < sizeof(ArchiveHeader_t)) {
+               ReleaseArchiveData(NULL, 0);
+               TerminalText::PrintError("The structure archive \"%s\" is truncated\n", archivePath);
+               return false;
+          }
+          mappedData = inflatedData.data();
+          mappedSize = inflatedData.size();
+     }
+     else {
+          int fd = open(archivePath, O_RDONLY);
+          if(fd < 0) {
+               TerminalText::PrintError("Unable to open the structure archive \"%s\": %s\n",
+                                        archivePath, strerror(errno));
+               return false;
+          }
+          struct stat archiveStat;
+          if(fstat(fd, &archiveStat) != 0 || (size_t) archiveStat.st_size < sizeof(ArchiveHeader_t)) {
+               close(fd);
+               TerminalText::PrintError("The structure archive \"%s\" is truncated\n", archivePath);
+               return false;
+          }
+          mappedSize = archiveStat.st_size;
+          mappedData = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+          close(fd);
+          if(mappedData == MAP_FAILED) {
+               TerminalText::PrintError("Unable to map the structure archive \"%s\": %s\n",
+                                        archivePath, strerror(errno));
+               return false;
+          }
+     }
+
+     // Check the header and that the index lies inside of the file:
+     ArchiveHeader_t header;
+     memcpy(&header, mappedData, sizeof(ArchiveHeader_t));
+     size_t dataStart = sizeof(ArchiveHeader_t) + (size_t) header.folderNameLength +
+                        header.sequenceLength;
+     size_t indexSize = (size_t) header.structCount * sizeof(ArchiveIndexEntry_t);
+     bool validArchive = header.magic == STRUCTURE_ARCHIVE_MAGIC &&
+                         header.version == STRUCTURE_ARCHIVE_VERSION &&
+                         header.sequenceLength > 0 &&
+                         dataStart <= header.indexOffset &&
+                         header.indexOffset % sizeof(uint64_t) == 0 &&
+                         header.indexOffset <= mappedSize &&
+                         indexSize == mappedSize - header.indexOffset;
+     const char *archivePos = (const char *) mappedData + sizeof(ArchiveHeader_t);
+     std::string seqChars;
+     if(validArchive) {
+          folderName = std::string(archivePos, header.folderNameLength);
+          archivePos += header.folderNameLength;
+          seqChars = std::string(archivePos, header.sequenceLength);
+          sharedSeq = RNAStructure::CreateSharedSequence(seqChars.c_str());
+          validArchive = sharedSeq && sharedSeq->seqLength == header.sequenceLength;
+     }
+     if(!validArchive) {
+          ReleaseArchiveData(mappedData, mappedSize);
+          sharedSeq.reset();
+          folderName = "";
+          TerminalText::PrintError("The file \"%s\" is not a valid structure archive\n", archivePath);
+          return false;
+     }
+     this->archivePath = std::string(archivePath);
+     archiveData = (const char *) mappedData;
+     archiveSize = mappedSize;
+     structCount = header.structCount;
+     sequenceLength = header.sequenceLength;
+     recordsStart = dataStart;
+     recordsEnd = header.indexOffset;
+     archiveIndex = (const ArchiveIndexEntry_t *) (archiveData + header.indexOffset);
+     return true;
+
+}
+
+void StructureArchive::Close() {
+     ReleaseArchiveData(archiveData, archiveSize);
+     archiveData = NULL;
+     archiveSize = 0;
+     archiveIndex = NULL;
+     recordsStart = recordsEnd = 0;
+     structCount = 0;
+     sequenceLength = 0;
+     folderName = "";
+     sharedSeq.reset();
+}
+
+RNAStructure * StructureArchive::LoadStructureAt(int structIndex) {
+
+     if(archiveData == NULL || structIndex < 0 || structIndex >= structCount) {
+          return NULL;
+     }
+     // The record has to lie between the sequence and the index (the checks
+     // are ordered so that none of them can overflow):
+     const ArchiveIndexEntry_t &indexEntry = archiveIndex[structIndex];
+     if(indexEntry.recordOffset < recordsStart || indexEntry.recordOffset > recordsEnd ||
+        indexEntry.recordLength > recordsEnd - indexEntry.recordOffset) {
+          return NULL;
+     }
+     const char *recordPos = archiveData + indexEntry.recordOffset;
+     const char *recordEnd = recordPos + indexEntry.recordLength;
+     uint32_t nameLength = 0, pairCount = 0;
+     if(!ReadVarint(recordPos, recordEnd, nameLength) || nameLength > recordEnd - recordPos) {
+          return NULL;
+     }
+     std::string structName(recordPos, nameLength);
+     recordPos += nameLength;
+     if(!ReadVarint(recordPos, recordEnd, pairCount) || pairCount != indexEntry.pairCount ||
+        2 * pairCount > sequenceLength) {
+          return NULL;
+     }
+
+     RNAStructure *rnaStruct = new RNAStructure();
+     rnaStruct->m_sharedSequence = sharedSeq;
+     rnaStruct->charSeq = sharedSeq->charSeq;
+     rnaStruct->charSeqSize = sequenceLength;
+     rnaStruct->m_sequenceLength = sequenceLength;
+     rnaStruct->m_sequence = (RNAStructure::BaseData *)
+                             malloc(sequenceLength * sizeof(RNAStructure::BaseData));
+     memcpy(rnaStruct->m_sequence, sharedSeq->unpairedBases,
+            sequenceLength * sizeof(RNAStructure::BaseData));
+     rnaStruct->dotFormatCharSeq = (char *) malloc((sequenceLength + 1) * sizeof(char));
+     memset(rnaStruct->dotFormatCharSeq, '.', sequenceLength);
+     rnaStruct->dotFormatCharSeq[sequenceLength] = '\0';
+     uint32_t prevIdx = 0;
+     for(uint32_t pidx = 0; pidx < pairCount; pidx++) {
+          uint32_t idxGap, pairSpan;
+          if(!ReadVarint(recordPos, recordEnd, idxGap) || !ReadVarint(recordPos, recordEnd, pairSpan) ||
+             pairSpan == 0 || (uint64_t) prevIdx + idxGap + pairSpan >= sequenceLength) {
+               Delete(rnaStruct, RNAStructure);
+               return NULL;
+          }
+          uint32_t baseIdx = prevIdx + idxGap, pairIdx = baseIdx + pairSpan;
+          if(rnaStruct->m_sequence[baseIdx].m_pair != RNAStructure::UNPAIRED ||
+             rnaStruct->m_sequence[pairIdx].m_pair != RNAStructure::UNPAIRED) {
+               Delete(rnaStruct, RNAStructure);
+               return NULL;
+          }
+          rnaStruct->m_sequence[baseIdx].m_pair = pairIdx;
+          rnaStruct->m_sequence[pairIdx].m_pair = baseIdx;
+          rnaStruct->dotFormatCharSeq[baseIdx] = '(';
+          rnaStruct->dotFormatCharSeq[pairIdx] = ')';
+          prevIdx = baseIdx;
+     }
+     rnaStruct->m_seqFingerprint = sharedSeq->seqFingerprint;
+     rnaStruct->m_seqFingerprintValid = true;
+     rnaStruct->m_exactPathName = strdup(archivePath.c_str());
+     rnaStruct->m_pathname = strdup(structName.c_str());
+     // Hash the pairs now (since the loaders run off the main thread) for
+     // the duplicate checks when the structure is inserted:
+     rnaStruct->GetPairListHash();
+     return rnaStruct;
+
+}
+
+RNAStructure ** StructureArchive::LoadArchiveFile(const char *archivePath, int *arrayCount) {
+
+     if(arrayCount == NULL) {
+          return NULL;
+     }
+     *arrayCount = 0;
+     StructureArchive structArchive;
+     if(!structArchive.Open(archivePath) || structArchive.GetStructureCount() == 0) {
+          return NULL;
+     }
+     // The records are independent, so they are decoded by a pool of workers
+     // (the archive is only read, and each of them writes its own slots):
+     int numStructs = structArchive.GetStructureCount();
+     std::vector<RNAStructure *> decodedStructs(numStructs, NULL);
+     std::atomic<int> nextStructIdx(0);
+     auto decodeWorker = [&]() {
+          int sidx;
+          while((sidx = nextStructIdx.fetch_add(1)) < numStructs) {
+               decodedStructs[sidx] = structArchive.LoadStructureAt(sidx);
+          }
+     };
+     int numThreads = std::min(std::max(1, (int) std::thread::hardware_concurrency()),
+                               numStructs / STRUCTURE_ARCHIVE_RECORDS_PER_THREAD);
+     std::vector<std::thread> workers;
+     for(int t = 0; numThreads > 1 && t < numThreads; t++) {
+          workers.push_back(std::thread(decodeWorker));
+     }
+     if(workers.empty()) {
+          decodeWorker();
+     }
+     for(unsigned int t = 0; t < workers.size(); t++) {
+          workers[t].join();
+     }
+     RNAStructure **rnaStructs = (RNAStructure **) malloc(numStructs * sizeof(RNAStructure *));
+     for(int sidx = 0; sidx < numStructs; sidx++) {
+          if(decodedStructs[sidx] == NULL) {
+               TerminalText::PrintWarning("Skipping the malformed structure #%d in archive \"%s\"\n",
+                                          sidx + 1, archivePath);
+               continue;
+          }
+          rnaStructs[(*arrayCount)++] = decodedStructs[sidx];
+     }
+     if(*arrayCount == 0) {
+          Free(rnaStructs);
+          return NULL;
+     }
+     rnaStructs[0]->SetSuggestedStructureFolderName(structArchive.GetFolderName().c_str());
+     return rnaStructs;
+
+}
+
+bool StructureArchive::WriteArchive(const char *archivePath, const char *folderName,
+                                    const std::vector<RNAStructure *> &structs) {
+
+     if(archivePath == NULL || structs.size() == 0 || structs[0] == NULL) {
+          return false;
+     }
+     folderName = folderName != NULL ? folderName : "";
+     const char *seqChars = structs[0]->GetSequenceString();
+     unsigned int seqLength = structs[0]->GetLength();
+     if(seqChars == NULL || seqLength == 0 || strlen(seqChars) != seqLength) {
+          return false;
+     }
+
+     ArchiveHeader_t header;
+     memset(&header, 0, sizeof(ArchiveHeader_t));
+     header.magic = STRUCTURE_ARCHIVE_MAGIC;
+     header.version = STRUCTURE_ARCHIVE_VERSION;
+     header.sequenceLength = seqLength;
+     header.folderNameLength = strlen(folderName);
+
+     // Pack the whole archive in memory so it is written out with one call:
+     std::vector<char> archiveData(sizeof(ArchiveHeader_t));
+     archiveData.insert(archiveData.end(), folderName, folderName + header.folderNameLength);
+     archiveData.insert(archiveData.end(), seqChars, seqChars + seqLength);
+     std::vector<ArchiveIndexEntry_t> archiveIndex;
+     archiveIndex.reserve(structs.size());
+     for(unsigned int sidx = 0; sidx < structs.size(); sidx++) {
+          RNAStructure *rnaStruct = structs[sidx];
+          if(rnaStruct == NULL) {
+               continue;
+          }
+          else if(rnaStruct->GetLength() != seqLength ||
+                  strcasecmp(rnaStruct->GetSequenceString(), seqChars)) {
+               TerminalText::PrintWarning("Skipping structure \"%s\" in archive \"%s\": %s\n",
+                                          rnaStruct->GetFilename(), archivePath,
+                                          "The sequence does not match the folder.");
+               continue;
+          }
+          ArchiveIndexEntry_t indexEntry;
+          indexEntry.recordOffset = archiveData.size();
+          const char *structName = rnaStruct->GetFilename();
+          uint32_t nameLength = strlen(structName);
+          AppendVarint(archiveData, nameLength);
+          archiveData.insert(archiveData.end(), structName, structName + nameLength);
+          // The pair table is scanned in order, so the pairs come out sorted:
+          std::vector<int> pairTable = rnaStruct->GetPairTable();
+          uint32_t pairCount = 0;
+          for(unsigned int bidx = 0; bidx < seqLength; bidx++) {
+               if(pairTable[bidx] > (int) bidx) {
+                    pairCount++;
+               }
+          }
+          AppendVarint(archiveData, pairCount);
+          uint32_t prevIdx = 0;
+          for(unsigned int bidx = 0; bidx < seqLength; bidx++) {
+               if(pairTable[bidx] > (int) bidx) {
+                    AppendVarint(archiveData, bidx - prevIdx);
+                    AppendVarint(archiveData, pairTable[bidx] - bidx);
+                    prevIdx = bidx;
+               }
+          }
+          indexEntry.recordLength = archiveData.size() - indexEntry.recordOffset;
+          indexEntry.pairCount = pairCount;
+          archiveIndex.push_back(indexEntry);
+     }
+     // The index is aligned so it can be read in place from the mapped file:
+     archiveData.resize((archiveData.size() + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1), '\0');
+     header.structCount = archiveIndex.size();
+     header.indexOffset = archiveData.size();
+     const char *indexData = (const char *) archiveIndex.data();
+     archiveData.insert(archiveData.end(), indexData,
+                        indexData + archiveIndex.size() * sizeof(ArchiveIndexEntry_t));
+     memcpy(archiveData.data(), &header, sizeof(ArchiveHeader_t));
+
+     char tempPathSuffix[MAX_BUFFER_SIZE];
+     snprintf(tempPathSuffix, MAX_BUFFER_SIZE, ".%d.%lx", (int) getpid(),
+              (unsigned long) pthread_self());
+     std::string tempArchivePath = std::string(archivePath) + std::string(tempPathSuffix);
+     FILE *fpArchive = fopen(tempArchivePath.c_str(), "wb");
+     if(fpArchive == NULL) {
+          TerminalText::PrintError("Unable to write the structure archive \"%s\": %s\n",
+                                   archivePath, strerror(errno));
+          return false;
+     }
+     bool writeOK = fwrite(archiveData.data(), 1, archiveData.size(), fpArchive) == archiveData.size();
+     writeOK = (fclose(fpArchive) == 0) && writeOK;
+     if(!writeOK || rename(tempArchivePath.c_str(), archivePath) != 0) {
+          TerminalText::PrintError("Unable to write the structure archive \"%s\"\n", archivePath);
+          unlink(tempArchivePath.c_str());
+          return false;
+     }
+     return true;
+
+}
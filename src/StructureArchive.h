@@ -0,0 +1,115 @@
+/* StructureArchive.h : A compact single file binary archive of all of the
+ *                      structures in a folder (which share one sequence),
+ *                      with a seekable index for random access on load;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#ifndef __STRUCTURE_ARCHIVE_H__
+#define __STRUCTURE_ARCHIVE_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "RNAStructure.h"
+
+#define STRUCTURE_ARCHIVE_FILEEXT             (".rsvarchive")
+#define STRUCTURE_ARCHIVE_MAGIC               (0x41565352)     /* "RSVA" */
+#define STRUCTURE_ARCHIVE_VERSION             (1)
+
+/* The archives with at least twice this many structures are decoded on
+ * more than one thread: */
+#define STRUCTURE_ARCHIVE_RECORDS_PER_THREAD  (256)
+
+class StructureArchive {
+
+     public:
+          StructureArchive();
+          ~StructureArchive();
+
+          /* Returns whether the file has the archive extension (the callers 
+           * strip any compression extension first): */
+          static bool IsArchiveFile(const char *filePath);
+
+          /* Maps the archive into memory and checks its header and index.
+           * None of the structures are decoded until they are requested by
+           * LoadStructureAt, so opening a large archive only costs the
+           * checks on the index. The compressed archives (e.g., ".rsvarchive.gz") 
+           * are inflated into memory through CompressedInput instead:
+           */
+          bool Open(const char *archivePath);
+          void Close();
+
+          inline bool IsOpen() const { return archiveData != NULL; }
+          inline int GetStructureCount() const { return structCount; }
+          inline unsigned int GetSequenceLength() const { return sequenceLength; }
+          inline const std::string & GetFolderName() const { return folderName; }
+
+          /* Decodes one structure from the archive. The structures from the
+           * same archive all share the storage for the sequence. Returns NULL
+           * when the record is malformed:
+           */
+          RNAStructure * LoadStructureAt(int structIndex);
+
+          /* Loads all of the structures from the archive (like the other
+           * multi-structure file formats). The records of large archives are
+           * decoded in parallel. The first structure suggests the folder name
+           * stored in the archive:
+           */
+          static RNAStructure ** LoadArchiveFile(const char *archivePath, int *arrayCount);
+
+          /* Writes the structures into a new archive. All of the structures
+           * need to have the same sequence (the ones which do not are skipped
+           * with a warning). The archive is written to a temporary file and
+           * renamed into place:
+           */
+          static bool WriteArchive(const char *archivePath, const char *folderName,
+                                   const std::vector<RNAStructure *> &structs);
+
+     private:
+          /* The archive is this header, the folder name and the sequence
+           * characters, then one record per structure, and finally the index
+           * (at indexOffset) with an entry per record. Each record is the
+           * length of its name, the name, the number of pairs, and the pairs
+           * (i, j) with i < j sorted by i. The pairs are stored as the
+           * unsigned LEB128 varints of the gap from the last i and of j - i:
+           */
+          typedef struct {
+               uint32_t magic;
+               uint32_t version;
+               uint32_t sequenceLength;
+               uint32_t structCount;
+               uint32_t folderNameLength;
+               uint32_t reserved;
+               uint64_t indexOffset;
+          } ArchiveHeader_t;
+
+          typedef struct {
+               uint64_t recordOffset;
+               uint32_t recordLength;
+               uint32_t pairCount;
+          } ArchiveIndexEntry_t;
+
+          bool ReadCompressedArchive(const char *archivePath);
+          void ReleaseArchiveData(const void *mappedData, size_t mappedSize);
+
+          static void AppendVarint(std::vector<char> &archiveData, uint32_t value);
+          static bool ReadVarint(const char *&dataPos, const char *dataEnd, uint32_t &value);
+
+          std::string archivePath;
+          const char *archiveData;
+          size_t archiveSize;
+          std::vector<char> inflatedData;     // empty unless archiveData is inflated
+          size_t recordsStart, recordsEnd;
+          int structCount;
+          unsigned int sequenceLength;
+          std::string folderName;
+          const ArchiveIndexEntry_t *archiveIndex;
+          std::shared_ptr<RNAStructure::SharedSequence_t> sharedSeq;
+
+};
+
+#endif
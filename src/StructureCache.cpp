@@ -0,0 +1,347 @@
+/* StructureCache.cpp : Implementation of the on-disk parsed structure cache;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <openssl/evp.h>
+
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include "StructureCache.h"
+#include "RNAStructure.h"
+#include "SequenceFingerprint.h"
+#include "BaseSequenceIDs.h"
+#include "ConfigOptions.h"
+#include "TerminalPrinting.h"
+
+#ifdef __APPLE__
+     #define StatMtimeSec(st)                 ((st).st_mtimespec.tv_sec)
+     #define StatMtimeNsec(st)                ((st).st_mtimespec.tv_nsec)
+#else
+     #define StatMtimeSec(st)                 ((st).st_mtim.tv_sec)
+     #define StatMtimeNsec(st)                ((st).st_mtim.tv_nsec)
+#endif
+
+bool StructureCache::IsCacheableFile(const char *filePath) {
+     switch(ClassifyInputFileType(filePath)) {
+          case FILETYPE_CT:
+          case FILETYPE_NOPCT:
+          case FILETYPE_BPSEQ:
+          case FILETYPE_HLXTRIPLE:
+               return true;
+          default:
+               return false;
+     }
+}
+
+std::string StructureCache::GetCacheDirectory() {
+     return std::string(USER_CONFIG_DIR) + std::string(STRUCTURE_CACHE_SUBDIR);
+}
+
+std::string StructureCache::GetCacheEntryPath(const char *filePath) {
+     // Entries are named by the SHA-256 hash of the source path:
+     unsigned char pathHash[STRUCTURE_CACHE_HASH_BYTES];
+     if(!EVP_Digest(filePath, strlen(filePath), pathHash, NULL, EVP_sha256(), NULL)) {
+          return std::string();
+     }
+     char entryName[2 * STRUCTURE_CACHE_HASH_BYTES + 1];
+     for(int hidx = 0; hidx < STRUCTURE_CACHE_HASH_BYTES; hidx++) {
+          snprintf(entryName + 2 * hidx, 3, "%02x", pathHash[hidx]);
+     }
+     return GetCacheDirectory() + std::string(entryName) + std::string(STRUCTURE_CACHE_FILEEXT);
+}
+
+bool StructureCache::HashFileContents(const char *filePath, uint8_t *hashBuf) {
+     int fd = open(filePath, O_RDONLY);
+     if(fd < 0) {
+          return false;
+     }
+     EVP_MD_CTX *sha256Ctx = EVP_MD_CTX_new();
+     bool hashOK = sha256Ctx != NULL && EVP_DigestInit_ex(sha256Ctx, EVP_sha256(), NULL);
+     char readBuf[16384];
+     ssize_t bytesRead = 0;
+     while(hashOK && (bytesRead = read(fd, readBuf, sizeof(readBuf))) > 0) {
+          hashOK = EVP_DigestUpdate(sha256Ctx, readBuf, bytesRead);
+     }
+     close(fd);
+     hashOK = hashOK && bytesRead == 0 && EVP_DigestFinal_ex(sha256Ctx, hashBuf, NULL);
+     EVP_MD_CTX_free(sha256Ctx);
+     return hashOK;
+}
+
+RNAStructure * StructureCache::LoadStructure(const char *filePath) {
+
+     if(filePath == NULL || !IsCacheableFile(filePath)) {
+          return NULL;
+     }
+     struct stat srcStat;
+     if(stat(filePath, &srcStat) != 0) {
+          return NULL;
+     }
+     std::string entryPath = GetCacheEntryPath(filePath);
+     int fd = entryPath.empty() ? -1 : open(entryPath.c_str(), O_RDONLY);
+     if(fd < 0) {
+          return NULL;
+     }
+     struct stat entryStat;
+     if(fstat(fd, &entryStat) != 0 || entryStat.st_size < (off_t) sizeof(CacheEntryHeader_t)) {
+          close(fd);
+          return NULL;
+     }
+     size_t entrySize = entryStat.st_size;
+     void *entryData = mmap(NULL, entrySize, PROT_READ, MAP_PRIVATE, fd, 0);
+     // Mark the entry as recently used for PruneCacheEntries:
+     futimens(fd, NULL);
+     close(fd);
+     if(entryData == MAP_FAILED) {
+          return NULL;
+     }
+
+     // Check the header and the key before trusting the payload:
+     CacheEntryHeader_t header;
+     memcpy(&header, entryData, sizeof(CacheEntryHeader_t));
+     const char *entryPos = (const char *) entryData + sizeof(CacheEntryHeader_t);
+     size_t payloadSize = (size_t) header.pathLength + header.commentLength +
+                          (size_t) header.sequenceLength * (2 + sizeof(RNAStructure::BasePair));
+     bool validEntry = header.magic == STRUCTURE_CACHE_MAGIC &&
+                       header.version == STRUCTURE_CACHE_VERSION &&
+                       header.sequenceLength > 0 &&
+                       sizeof(CacheEntryHeader_t) + payloadSize == entrySize &&
+                       header.pathLength == strlen(filePath) &&
+                       !strncmp(entryPos, filePath, header.pathLength) &&
+                       header.fileSize == (uint64_t) srcStat.st_size &&
+                       header.payloadHash == SequenceFingerprint::XXH64(entryPos, payloadSize, 0);
+     bool restoreEntry = false;
+     if(validEntry && (header.mtimeSec != StatMtimeSec(srcStat) ||
+                       header.mtimeNsec != StatMtimeNsec(srcStat))) {
+          // The file was touched or copied over, so only reuse the entry when
+          // its contents are unchanged (and then refresh the stored mtime):
+          uint8_t contentHash[STRUCTURE_CACHE_HASH_BYTES];
+          validEntry = HashFileContents(filePath, contentHash) &&
+                       !memcmp(contentHash, header.contentHash, STRUCTURE_CACHE_HASH_BYTES);
+          restoreEntry = validEntry;
+     }
+     if(!validEntry) {
+          munmap(entryData, entrySize);
+          return NULL;
+     }
+
+     entryPos += header.pathLength;
+     std::string commentLines(entryPos, header.commentLength);
+     entryPos += header.commentLength;
+     const char *baseCodes = entryPos;
+     const char *seqChars = baseCodes + header.sequenceLength;
+     const char *pairData = seqChars + header.sequenceLength;
+
+     RNAStructure *rnaStruct = new RNAStructure();
+     rnaStruct->m_sequenceLength = header.sequenceLength;
+     rnaStruct->m_sequence = (RNAStructure::BaseData *)
+                             malloc(header.sequenceLength * sizeof(RNAStructure::BaseData));
+     for(unsigned int bidx = 0; bidx < header.sequenceLength; bidx++) {
+          RNAStructure::BaseData *curBaseData = &(rnaStruct->m_sequence[bidx]);
+          curBaseData->m_index = bidx;
+          curBaseData->m_base = (RNAStructure::Base) baseCodes[bidx];
+          memcpy(&(curBaseData->m_pair), pairData + bidx * sizeof(RNAStructure::BasePair),
+                 sizeof(RNAStructure::BasePair));
+          switch(curBaseData->m_base) {
+               case RNAStructure::A:
+               case RNAStructure::C:
+               case RNAStructure::G:
+               case RNAStructure::U:
+               case RNAStructure::X:
+                    break;
+               default:
+                    validEntry = false;
+                    break;
+          }
+          if(curBaseData->m_pair != RNAStructure::UNPAIRED && 
+             curBaseData->m_pair >= header.sequenceLength) {
+               validEntry = false;
+          }
+     }
+     // The pairs must be symmetric:
+     for(unsigned int bidx = 0; validEntry && bidx < header.sequenceLength; bidx++) {
+          RNAStructure::BasePair pairIdx = rnaStruct->m_sequence[bidx].m_pair;
+          if(pairIdx != RNAStructure::UNPAIRED && 
+             (pairIdx == bidx || rnaStruct->m_sequence[pairIdx].m_pair != bidx)) {
+               validEntry = false;
+          }
+     }
+     if(!validEntry) {
+          TerminalText::PrintWarning("Ignoring the malformed structure cache entry for \"%s\"\n", filePath);
+          Delete(rnaStruct, RNAStructure);
+          munmap(entryData, entrySize);
+          unlink(entryPath.c_str());
+          return NULL;
+     }
+     rnaStruct->m_pathname = strdup(filePath);
+     rnaStruct->charSeqSize = header.sequenceLength;
+     rnaStruct->charSeq = (char *) malloc((header.sequenceLength + 1) * sizeof(char));
+     memcpy(rnaStruct->charSeq, seqChars, header.sequenceLength);
+     rnaStruct->charSeq[header.sequenceLength] = '\0';
+     rnaStruct->GenerateDotFormatDataFromPairings();
+     if(header.commentLength > 0) {
+          rnaStruct->SetFileCommentLines(commentLines, (InputFileTypeSpec) header.fileType);
+     }
+     munmap(entryData, entrySize);
+
+     if(restoreEntry) {
+          StoreStructure(filePath, rnaStruct);
+     }
+     return rnaStruct;
+
+}
+
+bool StructureCache::StoreStructure(const char *filePath, RNAStructure *rnaStruct) {
+
+     if(filePath == NULL || rnaStruct == NULL || rnaStruct->IsParseDeferred() ||
+        rnaStruct->m_sequence == NULL || rnaStruct->m_sequenceLength == 0 ||
+        rnaStruct->charSeqSize != rnaStruct->m_sequenceLength || !IsCacheableFile(filePath)) {
+          return false;
+     }
+     struct stat srcStat;
+     if(stat(filePath, &srcStat) != 0) {
+          return false;
+     }
+
+     CacheEntryHeader_t header;
+     memset(&header, 0, sizeof(CacheEntryHeader_t));
+     header.magic = STRUCTURE_CACHE_MAGIC;
+     header.version = STRUCTURE_CACHE_VERSION;
+     header.fileSize = srcStat.st_size;
+     header.mtimeSec = StatMtimeSec(srcStat);
+     header.mtimeNsec = StatMtimeNsec(srcStat);
+     if(!HashFileContents(filePath, header.contentHash)) {
+          return false;
+     }
+     const char *commentLines = rnaStruct->GetInitialFileComment();
+     commentLines = commentLines != NULL ? commentLines : "";
+     header.pathLength = strlen(filePath);
+     header.commentLength = strlen(commentLines);
+     header.sequenceLength = rnaStruct->m_sequenceLength;
+     header.fileType = rnaStruct->m_fileType;
+
+     // Pack the entry in memory so it is written out with a single call:
+     unsigned int seqLength = header.sequenceLength;
+     std::vector<char> entryData(sizeof(CacheEntryHeader_t) + header.pathLength +
+                                 header.commentLength +
+                                 seqLength * (2 + sizeof(RNAStructure::BasePair)));
+     char *entryPos = entryData.data();
+     memcpy(entryPos, &header, sizeof(CacheEntryHeader_t));
+     entryPos += sizeof(CacheEntryHeader_t);
+     memcpy(entryPos, filePath, header.pathLength);
+     entryPos += header.pathLength;
+     memcpy(entryPos, commentLines, header.commentLength);
+     entryPos += header.commentLength;
+     for(unsigned int bidx = 0; bidx < seqLength; bidx++) {
+          entryPos[bidx] = (char) rnaStruct->m_sequence[bidx].m_base;
+     }
+     entryPos += seqLength;
+     memcpy(entryPos, rnaStruct->charSeq, seqLength);
+     entryPos += seqLength;
+     for(unsigned int bidx = 0; bidx < seqLength; bidx++) {
+          memcpy(entryPos, &(rnaStruct->m_sequence[bidx].m_pair), sizeof(RNAStructure::BasePair));
+          entryPos += sizeof(RNAStructure::BasePair);
+     }
+     char *payloadStart = entryData.data() + sizeof(CacheEntryHeader_t);
+     header.payloadHash = SequenceFingerprint::XXH64(payloadStart, entryPos - payloadStart, 0);
+     memcpy(entryData.data(), &header, sizeof(CacheEntryHeader_t));
+
+     // The parser threads may store entries at the same time:
+     static std::mutex cacheWriteMutex;
+     static unsigned int storeCount = 0;
+     std::lock_guard<std::mutex> cacheWriteLock(cacheWriteMutex);
+     std::string cacheDir = GetCacheDirectory();
+     boost::system::error_code fsError;
+     fs::create_directories(fs::path(cacheDir), fsError);
+     if(fsError) {
+          TerminalText::PrintWarning("Unable to create the structure cache directory \"%s\": %s\n",
+                                     cacheDir.c_str(), fsError.message().c_str());
+          return false;
+     }
+     std::string entryPath = GetCacheEntryPath(filePath);
+     if(entryPath.empty()) {
+          return false;
+     }
+     char tempPathSuffix[MAX_BUFFER_SIZE];
+     snprintf(tempPathSuffix, MAX_BUFFER_SIZE, ".%d.%lx", (int) getpid(),
+              (unsigned long) pthread_self());
+     std::string tempEntryPath = entryPath + std::string(tempPathSuffix);
+     FILE *fpEntry = fopen(tempEntryPath.c_str(), "wb");
+     if(fpEntry == NULL) {
+          return false;
+     }
+     bool writeOK = fwrite(entryData.data(), 1, entryData.size(), fpEntry) == entryData.size();
+     writeOK = (fclose(fpEntry) == 0) && writeOK;
+     if(!writeOK || rename(tempEntryPath.c_str(), entryPath.c_str()) != 0) {
+          TerminalText::PrintWarning("Unable to write the structure cache entry for \"%s\"\n", filePath);
+          unlink(tempEntryPath.c_str());
+          return false;
+     }
+     if(storeCount++ % STRUCTURE_CACHE_PRUNE_INTERVAL == 0) {
+          PruneCacheEntries();
+     }
+     return true;
+
+}
+
+void StructureCache::PruneCacheEntries() {
+
+     typedef struct {
+          std::string entryPath;
+          std::time_t lastUsed;
+          uintmax_t entrySize;
+     } CacheEntryInfo_t;
+     std::vector<CacheEntryInfo_t> cacheEntries;
+     uintmax_t totalSize = 0;
+     boost::system::error_code fsError;
+     fs::directory_iterator dirIter(fs::path(GetCacheDirectory()), fsError), dirEnd;
+     for(; !fsError && dirIter != dirEnd; dirIter.increment(fsError)) {
+          const fs::path &entryPath = dirIter->path();
+          if(entryPath.extension().string() != STRUCTURE_CACHE_FILEEXT) {
+               continue;
+          }
+          boost::system::error_code statError;
+          CacheEntryInfo_t entryInfo;
+          entryInfo.entryPath = entryPath.string();
+          entryInfo.lastUsed = fs::last_write_time(entryPath, statError);
+          entryInfo.entrySize = fs::file_size(entryPath, statError);
+          if(!statError) {
+               cacheEntries.push_back(entryInfo);
+               totalSize += entryInfo.entrySize;
+          }
+     }
+     if(cacheEntries.size() <= STRUCTURE_CACHE_MAX_ENTRIES && totalSize <= STRUCTURE_CACHE_MAX_BYTES) {
+          return;
+     }
+     std::sort(cacheEntries.begin(), cacheEntries.end(), 
+               [](const CacheEntryInfo_t &e1, const CacheEntryInfo_t &e2) {
+                    return e1.lastUsed < e2.lastUsed;
+               });
+     size_t numEntries = cacheEntries.size();
+     for(unsigned int eidx = 0; eidx < cacheEntries.size(); eidx++) {
+          if(numEntries <= STRUCTURE_CACHE_MAX_ENTRIES && totalSize <= STRUCTURE_CACHE_MAX_BYTES) {
+               break;
+          }
+          else if(unlink(cacheEntries[eidx].entryPath.c_str()) == 0) {
+               numEntries--;
+               totalSize -= cacheEntries[eidx].entrySize;
+          }
+     }
+     TerminalText::PrintDebug("Pruned the structure cache down to %d entries\n", (int) numEntries);
+
+}
@@ -0,0 +1,92 @@
+/* StructureCache.h : A persistent on-disk cache of the parsed structure files
+ *                    (CT, NOPCT, BPSEQ and helix) in a compact binary form,
+ *                    so they do not need to be re-parsed on every launch;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#ifndef __STRUCTURE_CACHE_H__
+#define __STRUCTURE_CACHE_H__
+
+#include <stdint.h>
+
+#include <string>
+
+class RNAStructure;
+
+#define STRUCTURE_CACHE_SUBDIR                ("StructureCache/")
+#define STRUCTURE_CACHE_FILEEXT               (".rsvcache")
+#define STRUCTURE_CACHE_MAGIC                 (0x43565352)     /* "RSVC" */
+#define STRUCTURE_CACHE_VERSION               (2)
+#define STRUCTURE_CACHE_HASH_BYTES            (32)             /* SHA-256 */
+
+/* The least recently used entries are removed once the cache holds more than
+ * this many entries or bytes. The directory is only scanned for this on every
+ * STRUCTURE_CACHE_PRUNE_INTERVAL-th store (starting with the first one):
+ */
+#define STRUCTURE_CACHE_MAX_ENTRIES           (4096)
+#define STRUCTURE_CACHE_MAX_BYTES             (128 * 1024 * 1024)
+#define STRUCTURE_CACHE_PRUNE_INTERVAL        (64)
+
+class StructureCache {
+
+     public:
+          /* Returns whether the file extension names one of the single
+           * structure formats that are kept in the cache:
+           */
+          static bool IsCacheableFile(const char *filePath);
+
+          /* Loads the structure for the file from its cache entry (which is
+           * read through mmap). The entry is keyed by the full path, and is
+           * only used when the size of the file on disk still matches and
+           * either its mtime or its SHA-256 content hash does too. The
+           * payload checksum, base codes and pairs are checked before the
+           * entry is used.
+           * Returns NULL when there is no valid entry, in which case the
+           * caller should parse the text file as usual:
+           */
+          static RNAStructure * LoadStructure(const char *filePath);
+
+          /* Writes (or replaces) the cache entry for a fully parsed structure
+           * loaded from filePath. Safe to call from the parser threads: the
+           * entries are written one at a time (under a lock) to a temporary
+           * file which is then renamed into place:
+           */
+          static bool StoreStructure(const char *filePath, RNAStructure *rnaStruct);
+
+     private:
+          /* The on-disk entry is this header followed by the source path,
+           * the file comment lines, the base codes, the sequence characters,
+           * and finally the pair array (BasePair per base). The payloadHash
+           * is the XXH64 hash of everything after the header.
+           * The entries are written in the native byte order, and are only
+           * meant to be read back on the machine which wrote them (an entry
+           * with the other byte order fails the magic number check). The
+           * fields are laid out so that the header has no padding:
+           */
+          typedef struct {
+               uint32_t magic;
+               uint32_t version;
+               uint64_t fileSize;
+               int64_t mtimeSec;
+               int64_t mtimeNsec;
+               uint64_t payloadHash;
+               uint8_t contentHash[STRUCTURE_CACHE_HASH_BYTES];
+               uint32_t pathLength;
+               uint32_t commentLength;
+               uint32_t sequenceLength;
+               uint32_t fileType;
+          } CacheEntryHeader_t;
+          static_assert(sizeof(CacheEntryHeader_t) == 88, "The cache entry header has padding");
+
+          static std::string GetCacheDirectory();
+          static std::string GetCacheEntryPath(const char *filePath);
+          static bool HashFileContents(const char *filePath, uint8_t *hashBuf);
+
+          /* Removes the least recently used entries (by mtime, which
+           * LoadStructure refreshes) down to the limits above: */
+          static void PruneCacheEntries();
+
+};
+
+#endif
@@ -0,0 +1,206 @@
+/* StructureElementTree.cpp : Implementation of the loop/helix decomposition;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.13
+ */
+
+#include <string.h>
+
+#include "StructureElementTree.h"
+
+typedef struct {
+     int frameID;     // the 5' index of the pair closing the loop (N for the exterior loop)
+     int closeIdx;
+     int unpaired;
+     int numBranches;
+     int firstStem;
+     int lastStem;
+} LoopFrame_t;
+
+static int ResolveFrameAlias(std::vector<int> &frameAlias, int frameID) {
+     int rootID = frameID;
+     while(frameAlias[rootID] != rootID) {
+          rootID = frameAlias[rootID];
+     }
+     while(frameAlias[frameID] != rootID) {
+          int nextID = frameAlias[frameID];
+          frameAlias[frameID] = rootID;
+          frameID = nextID;
+     }
+     return rootID;
+}
+
+static void MergeLoopFrame(LoopFrame_t &parent, const LoopFrame_t &child,
+		           std::vector<StructureElementTree_t::ElementNode_t> &nodes) {
+     parent.unpaired += child.unpaired + 1;
+     parent.numBranches += child.numBranches;
+     if(child.firstStem == ELEMENT_NONE) {
+          return;
+     }
+     if(parent.lastStem == ELEMENT_NONE) {
+          parent.firstStem = child.firstStem;
+     }
+     else {
+          nodes[parent.lastStem].nextSibling = child.firstStem;
+     }
+     parent.lastStem = child.lastStem;
+}
+
+StructureElementTree_t::StructureElementTree_t(const std::vector<int> &pairTable) {
+
+     int seqLength = pairTable.size();
+     memset(elementTypeCounts, 0x00, NUM_ELEMENT_TYPES * sizeof(int));
+     nodes.reserve(seqLength / 2 + 1);
+     baseElements.assign(seqLength, ELEMENT_NONE);
+
+     // Unpaired bases are first labeled by the frame of the loop they lie in,
+     // and frames of pairs that are discarded as crossing are aliased to
+     // the frame of their enclosing loop:
+     std::vector<int> baseFrameOwner(seqLength, ELEMENT_NONE);
+     std::vector<int> frameAlias(seqLength + 1);
+     std::vector<int> frameLoopNode(seqLength + 1, ELEMENT_NONE);
+     std::vector<bool> frameOnStack(seqLength + 1, false);
+     for(int f = 0; f <= seqLength; f++) {
+          frameAlias[f] = f;
+     }
+
+     std::vector<LoopFrame_t> loopStack;
+     loopStack.reserve(64);
+     LoopFrame_t exteriorFrame = { seqLength, seqLength, 0, 0, ELEMENT_NONE, ELEMENT_NONE };
+     loopStack.push_back(exteriorFrame);
+     frameOnStack[seqLength] = true;
+
+     for(int pos = 0; pos < seqLength; pos++) {
+          int partner = pairTable[pos];
+          bool validPair = partner >= 0 && partner < seqLength && partner != pos &&
+                           pairTable[partner] == pos;
+          if(validPair && partner > pos) {
+               LoopFrame_t openFrame = { pos, partner, 0, 0, ELEMENT_NONE, ELEMENT_NONE };
+               loopStack.push_back(openFrame);
+               frameOnStack[pos] = true;
+               continue;
+          }
+          else if(!validPair || !frameOnStack[partner]) {
+               baseFrameOwner[pos] = loopStack.back().frameID;
+               loopStack.back().unpaired++;
+               continue;
+          }
+          // Discard the arcs left open inside of (partner, pos) -- these cross it:
+          while(loopStack.back().frameID != partner) {
+               LoopFrame_t crossingFrame = loopStack.back();
+               loopStack.pop_back();
+               frameOnStack[crossingFrame.frameID] = false;
+               frameAlias[crossingFrame.frameID] = loopStack.back().frameID;
+               baseFrameOwner[crossingFrame.frameID] = loopStack.back().frameID;
+               MergeLoopFrame(loopStack.back(), crossingFrame, nodes);
+          }
+          LoopFrame_t loopFrame = loopStack.back();
+          loopStack.pop_back();
+          frameOnStack[partner] = false;
+
+          int stemIdx = ELEMENT_NONE;
+          if(loopFrame.numBranches == 1 && loopFrame.unpaired == 0) {
+               // (partner, pos) stacks directly on the stem enclosed by it:
+               stemIdx = loopFrame.firstStem;
+               nodes[stemIdx].openIdx = partner;
+               nodes[stemIdx].closeIdx = pos;
+               nodes[stemIdx].length++;
+          }
+          else {
+               ElementType_t loopType = ELEMENT_MULTILOOP;
+               if(loopFrame.numBranches == 0) {
+                    loopType = ELEMENT_HAIRPIN;
+               }
+               else if(loopFrame.numBranches == 1) {
+                    const ElementNode_t &innerStem = nodes[loopFrame.firstStem];
+                    int leftUnpaired = innerStem.openIdx - partner - 1;
+                    int rightUnpaired = pos - innerStem.closeIdx - 1;
+                    loopType = (leftUnpaired == 0 || rightUnpaired == 0) ?
+                               ELEMENT_BULGE : ELEMENT_INTERIOR;
+               }
+               int loopIdx = AppendNode(loopType, partner, pos);
+               nodes[loopIdx].length = loopFrame.unpaired;
+               nodes[loopIdx].numBranches = loopFrame.numBranches;
+               nodes[loopIdx].firstChild = loopFrame.firstStem;
+               for(int c = loopFrame.firstStem; c != ELEMENT_NONE; c = nodes[c].nextSibling) {
+                    nodes[c].parent = loopIdx;
+               }
+               frameLoopNode[partner] = loopIdx;
+               stemIdx = AppendNode(ELEMENT_STEM, partner, pos);
+               nodes[stemIdx].length = 1;
+               nodes[stemIdx].firstChild = loopIdx;
+               nodes[loopIdx].parent = stemIdx;
+          }
+          baseElements[partner] = baseElements[pos] = stemIdx;
+
+          LoopFrame_t &parentFrame = loopStack.back();
+          if(parentFrame.lastStem == ELEMENT_NONE) {
+               parentFrame.firstStem = stemIdx;
+          }
+          else {
+               nodes[parentFrame.lastStem].nextSibling = stemIdx;
+          }
+          parentFrame.lastStem = stemIdx;
+          parentFrame.numBranches++;
+     }
+     while(loopStack.size() > 1) {
+          LoopFrame_t crossingFrame = loopStack.back();
+          loopStack.pop_back();
+          frameAlias[crossingFrame.frameID] = loopStack.back().frameID;
+          baseFrameOwner[crossingFrame.frameID] = loopStack.back().frameID;
+          MergeLoopFrame(loopStack.back(), crossingFrame, nodes);
+     }
+
+     LoopFrame_t &extFrame = loopStack.back();
+     int rootIdx = AppendNode(ELEMENT_EXTERIOR, -1, seqLength);
+     nodes[rootIdx].length = extFrame.unpaired;
+     nodes[rootIdx].numBranches = extFrame.numBranches;
+     nodes[rootIdx].firstChild = extFrame.firstStem;
+     for(int c = extFrame.firstStem; c != ELEMENT_NONE; c = nodes[c].nextSibling) {
+          nodes[c].parent = rootIdx;
+     }
+     frameLoopNode[seqLength] = rootIdx;
+
+     for(int pos = 0; pos < seqLength; pos++) {
+          if(baseFrameOwner[pos] != ELEMENT_NONE) {
+               int frameID = ResolveFrameAlias(frameAlias, baseFrameOwner[pos]);
+               baseElements[pos] = frameLoopNode[frameID];
+          }
+     }
+     for(unsigned int n = 0; n < nodes.size(); n++) {
+          elementTypeCounts[nodes[n].elementType]++;
+     }
+
+}
+
+const char * StructureElementTree_t::GetElementTypeName(ElementType_t etype) {
+     switch(etype) {
+          case ELEMENT_EXTERIOR:
+               return "Exterior";
+          case ELEMENT_STEM:
+               return "Stem";
+          case ELEMENT_HAIRPIN:
+               return "Hairpin";
+          case ELEMENT_BULGE:
+               return "Bulge";
+          case ELEMENT_INTERIOR:
+               return "Interior";
+          case ELEMENT_MULTILOOP:
+               return "Multiloop";
+          default:
+               return "Unknown";
+     }
+}
+
+int StructureElementTree_t::AppendNode(ElementType_t etype, int openIdx, int closeIdx) {
+     ElementNode_t elementNode;
+     elementNode.elementType = (uint8_t) etype;
+     elementNode.parent = ELEMENT_NONE;
+     elementNode.firstChild = ELEMENT_NONE;
+     elementNode.nextSibling = ELEMENT_NONE;
+     elementNode.openIdx = openIdx;
+     elementNode.closeIdx = closeIdx;
+     elementNode.length = 0;
+     elementNode.numBranches = 0;
+     nodes.push_back(elementNode);
+     return nodes.size() - 1;
+}
@@ -0,0 +1,102 @@
+/* StructureElementTree.h : Decomposition of a (nested) secondary structure
+ *                          into its helices (stems) and loops -- hairpins,
+ *                          bulges, interior loops and multiloops -- stored
+ *                          as a tree in a compact array of nodes;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.13
+ */
+
+#ifndef __STRUCTURE_ELEMENT_TREE_H__
+#define __STRUCTURE_ELEMENT_TREE_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <vector>
+
+class StructureElementTree_t {
+
+     public:
+          typedef enum {
+               ELEMENT_EXTERIOR  = 0,
+               ELEMENT_STEM      = 1,
+               ELEMENT_HAIRPIN   = 2,
+               ELEMENT_BULGE     = 3,
+               ELEMENT_INTERIOR  = 4,
+               ELEMENT_MULTILOOP = 5,
+               NUM_ELEMENT_TYPES = 6,
+          } ElementType_t;
+
+          #define ELEMENT_NONE         (-1)
+
+          /* The nodes are stored in post-order, so that the children of a
+           * node always precede it in the array and the exterior loop is the
+           * last node. The children of a stem are the loop closed by its
+           * innermost pair, and the children of a loop are the stems that
+           * branch off of it (in 5' to 3' order).
+           * For a stem, (openIdx, closeIdx) is its outermost pair and
+           * length is the number of stacked pairs; for a loop, it is the
+           * pair closing the loop (or (-1, N) for the exterior loop) and
+           * length is the number of unpaired bases in the loop:
+           */
+          typedef struct {
+               uint8_t elementType;
+               int parent;
+               int firstChild;
+               int nextSibling;
+               int openIdx;
+               int closeIdx;
+               int length;
+               int numBranches;
+          } ElementNode_t;
+
+          /* The pair table is indexed from zero with pairTable[i] = j when
+           * bases i and j pair and negative when base i is unpaired.
+           * Pairs which cross a pair already on the stack (pseudoknots) are
+           * treated as unpaired, so callers should pass a pseudoknot-free
+           * subset of the pairs. The tree is built in a single O(N)
+           * stack-based pass over the table:
+           */
+          StructureElementTree_t(const std::vector<int> &pairTable);
+
+          inline int GetNodeCount() const {
+               return nodes.size();
+          }
+
+          inline int GetRootIndex() const {
+               return nodes.size() - 1;
+          }
+
+          inline const ElementNode_t & GetNode(int nodeIdx) const {
+               return nodes[nodeIdx];
+          }
+
+          inline int GetElementIndexAt(int basePos) const {
+               if(basePos < 0 || basePos >= (int) baseElements.size()) {
+                    return ELEMENT_NONE;
+               }
+               return baseElements[basePos];
+          }
+
+          inline ElementType_t GetElementTypeAt(int basePos) const {
+               int nodeIdx = GetElementIndexAt(basePos);
+               return nodeIdx == ELEMENT_NONE ? ELEMENT_EXTERIOR :
+                      (ElementType_t) nodes[nodeIdx].elementType;
+          }
+
+          inline int GetElementTypeCount(ElementType_t etype) const {
+               return elementTypeCounts[etype];
+          }
+
+          static const char * GetElementTypeName(ElementType_t etype);
+
+     private:
+          int AppendNode(ElementType_t etype, int openIdx, int closeIdx);
+
+          std::vector<ElementNode_t> nodes;
+          std::vector<int> baseElements;
+          int elementTypeCounts[NUM_ELEMENT_TYPES];
+
+};
+
+#endif
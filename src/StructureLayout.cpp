@@ -0,0 +1,274 @@
+/* StructureLayout.cpp : Implementation of the radial structure layouts;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <math.h>
+
+#include "StructureLayout.h"
+
+StructureLayout_t::StructureLayout_t(const StructureElementTree_t &elementTree,
+                                     const std::vector<int> &pairTable,
+                                     LayoutStyle_t layoutStyle) :
+     elementTree(elementTree), xmin(0.0), xmax(0.0), ymin(0.0), ymax(0.0), 
+     endGapExcess(0.0) {
+
+     int seqLength = pairTable.size();
+     coords.assign(2 * seqLength, 0.0);
+     if(seqLength == 0) {
+          return;
+     }
+     if(layoutStyle == LAYOUT_CIRCULAR) {
+          LayoutCircular();
+     }
+     else {
+          int numNodes = elementTree.GetNodeCount();
+          subtreeWidths.assign(numNodes, 1.0);
+          loopRadii.assign(numNodes, 0.0);
+          stemDirX.assign(numNodes, 0.0);
+          stemDirY.assign(numNodes, -1.0);
+          ComputeSubtreeWidths();
+          // The nodes are in post-order, so walking the array backwards
+          // places every element after the one it hangs off of:
+          for(int n = numNodes - 1; n >= 0; n--) {
+               switch(elementTree.GetNode(n).elementType) {
+                    case StructureElementTree_t::ELEMENT_EXTERIOR:
+                         LayoutExteriorLoop(layoutStyle);
+                         break;
+                    case StructureElementTree_t::ELEMENT_STEM:
+                         LayoutStem(n);
+                         break;
+                    default:
+                         LayoutInteriorLoop(n);
+                         break;
+               }
+          }
+     }
+     xmin = xmax = coords[0];
+     ymin = ymax = coords[1];
+     for(int bidx = 1; bidx < seqLength; bidx++) {
+          xmin = coords[2 * bidx] < xmin ? coords[2 * bidx] : xmin;
+          xmax = coords[2 * bidx] > xmax ? coords[2 * bidx] : xmax;
+          ymin = coords[2 * bidx + 1] < ymin ? coords[2 * bidx + 1] : ymin;
+          ymax = coords[2 * bidx + 1] > ymax ? coords[2 * bidx + 1] : ymax;
+     }
+
+}
+
+double StructureLayout_t::GetPolygonRadius(int numVertices) {
+     numVertices = numVertices < 3 ? 3 : numVertices;
+     return 0.5 / sin(M_PI / numVertices);
+}
+
+int StructureLayout_t::CountLoopVertices(int nodeIdx) const {
+     const StructureElementTree_t::ElementNode_t &loopNode = elementTree.GetNode(nodeIdx);
+     int numVertices = loopNode.closeIdx - loopNode.openIdx + 1;
+     if(loopNode.elementType == StructureElementTree_t::ELEMENT_EXTERIOR) {
+          numVertices = GetLength();
+     }
+     // Each branch keeps only its outermost pair on the loop:
+     for(int c = loopNode.firstChild; c != ELEMENT_NONE; c = elementTree.GetNode(c).nextSibling) {
+          const StructureElementTree_t::ElementNode_t &stemNode = elementTree.GetNode(c);
+          numVertices -= stemNode.closeIdx - stemNode.openIdx - 1;
+     }
+     return numVertices;
+}
+
+void StructureLayout_t::ComputeSubtreeWidths() {
+     for(int n = 0; n < elementTree.GetNodeCount(); n++) {
+          const StructureElementTree_t::ElementNode_t &node = elementTree.GetNode(n);
+          if(node.elementType == StructureElementTree_t::ELEMENT_STEM) {
+               subtreeWidths[n] = node.firstChild != ELEMENT_NONE ? subtreeWidths[node.firstChild] : 1.0;
+               continue;
+          }
+          int numVertices = CountLoopVertices(n);
+          double excessWidth = 0.0;
+          for(int c = node.firstChild; c != ELEMENT_NONE; c = elementTree.GetNode(c).nextSibling) {
+               excessWidth += subtreeWidths[c] > 1.0 ? subtreeWidths[c] - 1.0 : 0.0;
+          }
+          // There is one gap per vertex around the circle (including the
+          // closing pair, or the gap between the 5' and 3' ends):
+          double circumference = numVertices + excessWidth;
+          double loopRadius = GetPolygonRadius(numVertices);
+          if(circumference / (2.0 * M_PI) > loopRadius) {
+               loopRadius = circumference / (2.0 * M_PI);
+          }
+          loopRadii[n] = loopRadius;
+          // The subtree reaches out past the loop by its longest branch (the
+          // stem plus half of the width of the subtree under it):
+          double maxBranchReach = 0.0;
+          for(int c = node.firstChild; c != ELEMENT_NONE; c = elementTree.GetNode(c).nextSibling) {
+               double branchReach = elementTree.GetNode(c).length + subtreeWidths[c] / 2.0;
+               maxBranchReach = branchReach > maxBranchReach ? branchReach : maxBranchReach;
+          }
+          subtreeWidths[n] = 2.0 * (loopRadius + maxBranchReach);
+     }
+}
+
+double StructureLayout_t::CollectLoopVertices(int nodeIdx, int firstPos, int lastPos) {
+     const StructureElementTree_t::ElementNode_t &loopNode = elementTree.GetNode(nodeIdx);
+     bool isExterior = loopNode.elementType == StructureElementTree_t::ELEMENT_EXTERIOR;
+     loopVertices.clear();
+     gapWeights.clear();
+     branchVertices.clear();
+     endGapExcess = 0.0;
+     int childIdx = loopNode.firstChild;
+     int pos = firstPos;
+     while(pos <= lastPos) {
+          const StructureElementTree_t::ElementNode_t *stemNode = childIdx == ELEMENT_NONE ?
+                                                                   NULL : &(elementTree.GetNode(childIdx));
+          if(stemNode == NULL || pos != stemNode->openIdx || (!isExterior && pos == firstPos)) {
+               loopVertices.push_back(pos++);
+               gapWeights.push_back(1.0);
+               continue;
+          }
+          // Widen the gaps on either side of the branch by half of the extra
+          // room its subtree takes up:
+          double halfExcess = subtreeWidths[childIdx] > 1.0 ? (subtreeWidths[childIdx] - 1.0) / 2.0 : 0.0;
+          if(gapWeights.size() > 0) {
+               gapWeights.back() += halfExcess;
+          }
+          else {
+               endGapExcess += halfExcess;
+          }
+          branchVertices.push_back(loopVertices.size());
+          loopVertices.push_back(stemNode->openIdx);
+          gapWeights.push_back(1.0);
+          loopVertices.push_back(stemNode->closeIdx);
+          gapWeights.push_back(1.0 + halfExcess);
+          pos = stemNode->closeIdx + 1;
+          childIdx = stemNode->nextSibling;
+     }
+     // The gap after the last vertex is the gap back to the first one (the 
+     // closing pair, or the 5' and 3' ends), which the caller places:
+     if(gapWeights.size() > 0) {
+          endGapExcess += gapWeights.back() - 1.0;
+          gapWeights.pop_back();
+     }
+     double totalWeight = 0.0;
+     for(size_t g = 0; g < gapWeights.size(); g++) {
+          totalWeight += gapWeights[g];
+     }
+     return totalWeight;
+}
+
+void StructureLayout_t::PlaceLoopVertices(double centerX, double centerY, double radius,
+                                          double startAngle, double arcSpan, int orientation) {
+     double totalWeight = 0.0;
+     for(size_t g = 0; g < gapWeights.size(); g++) {
+          totalWeight += gapWeights[g];
+     }
+     double weightSum = 0.0;
+     for(size_t v = 0; v < loopVertices.size(); v++) {
+          double vertexAngle = startAngle;
+          if(totalWeight > 0.0) {
+               vertexAngle += orientation * arcSpan * weightSum / totalWeight;
+          }
+          SetBasePosition(loopVertices[v], centerX + radius * cos(vertexAngle),
+                          centerY + radius * sin(vertexAngle));
+          if(v < gapWeights.size()) {
+               weightSum += gapWeights[v];
+          }
+     }
+}
+
+void StructureLayout_t::LayoutExteriorLoop(LayoutStyle_t layoutStyle) {
+     int rootIdx = elementTree.GetRootIndex();
+     double totalWeight = CollectLoopVertices(rootIdx, 0, GetLength() - 1);
+     double centerX = 0.0, centerY = 0.0;
+     if(layoutStyle == LAYOUT_NAVIEW) {
+          // Lay the exterior loop out left to right with its stems pointing up:
+          double xpos = 0.0;
+          for(size_t v = 0; v < loopVertices.size(); v++) {
+               SetBasePosition(loopVertices[v], xpos, 0.0);
+               xpos += v < gapWeights.size() ? gapWeights[v] : 0.0;
+          }
+     }
+     else {
+          // Leave a one unit gap between the 5' and 3' ends at the bottom, 
+          // widened for the branches which start or end the sequence:
+          double endGapWeight = 1.0 + endGapExcess;
+          double endGapAngle = 2.0 * M_PI * endGapWeight / (totalWeight + endGapWeight);
+          PlaceLoopVertices(centerX, centerY, loopRadii[rootIdx], M_PI / 2.0 + endGapAngle / 2.0,
+                            2.0 * M_PI - endGapAngle, 1);
+     }
+     int childIdx = elementTree.GetNode(rootIdx).firstChild;
+     for(size_t b = 0; b < branchVertices.size() && childIdx != ELEMENT_NONE; b++) {
+          if(layoutStyle == LAYOUT_NAVIEW) {
+               stemDirX[childIdx] = 0.0;
+               stemDirY[childIdx] = -1.0;
+          }
+          else {
+               int openIdx = loopVertices[branchVertices[b]], closeIdx = loopVertices[branchVertices[b] + 1];
+               double midX = (GetX(openIdx) + GetX(closeIdx)) / 2.0 - centerX;
+               double midY = (GetY(openIdx) + GetY(closeIdx)) / 2.0 - centerY;
+               double midNorm = sqrt(midX * midX + midY * midY);
+               stemDirX[childIdx] = midNorm > 0.0 ? midX / midNorm : 0.0;
+               stemDirY[childIdx] = midNorm > 0.0 ? midY / midNorm : -1.0;
+          }
+          childIdx = elementTree.GetNode(childIdx).nextSibling;
+     }
+}
+
+void StructureLayout_t::LayoutInteriorLoop(int nodeIdx) {
+
+     const StructureElementTree_t::ElementNode_t &loopNode = elementTree.GetNode(nodeIdx);
+     int stemIdx = loopNode.parent;
+     double dirX = stemIdx != ELEMENT_NONE ? stemDirX[stemIdx] : 0.0;
+     double dirY = stemIdx != ELEMENT_NONE ? stemDirY[stemIdx] : -1.0;
+     double ax = GetX(loopNode.openIdx), ay = GetY(loopNode.openIdx);
+     double bx = GetX(loopNode.closeIdx), by = GetY(loopNode.closeIdx);
+     double chordLength = sqrt((ax - bx) * (ax - bx) + (ay - by) * (ay - by));
+     double loopRadius = loopRadii[nodeIdx];
+     if(loopRadius < chordLength / 2.0) {
+          loopRadius = chordLength / 2.0;
+     }
+
+     // The closing pair is a chord of the circle, and the center lies past
+     // it in the direction of the stem:
+     double apothem = sqrt(fmax(0.0, loopRadius * loopRadius - chordLength * chordLength / 4.0));
+     double centerX = (ax + bx) / 2.0 + dirX * apothem;
+     double centerY = (ay + by) / 2.0 + dirY * apothem;
+     double closingAngle = 2.0 * asin(fmin(1.0, chordLength / (2.0 * loopRadius)));
+     double startAngle = atan2(ay - centerY, ax - centerX);
+     double crossProd = (ax - centerX) * (by - centerY) - (ay - centerY) * (bx - centerX);
+     int orientation = crossProd > 0.0 ? -1 : 1;
+     CollectLoopVertices(nodeIdx, loopNode.openIdx, loopNode.closeIdx);
+     PlaceLoopVertices(centerX, centerY, loopRadius, startAngle, 2.0 * M_PI - closingAngle, orientation);
+     // Keep the closing pair exactly where the stem put it:
+     SetBasePosition(loopNode.openIdx, ax, ay);
+     SetBasePosition(loopNode.closeIdx, bx, by);
+
+     int childIdx = loopNode.firstChild;
+     for(size_t b = 0; b < branchVertices.size() && childIdx != ELEMENT_NONE; b++) {
+          int openIdx = loopVertices[branchVertices[b]], closeIdx = loopVertices[branchVertices[b] + 1];
+          double midX = (GetX(openIdx) + GetX(closeIdx)) / 2.0 - centerX;
+          double midY = (GetY(openIdx) + GetY(closeIdx)) / 2.0 - centerY;
+          double midNorm = sqrt(midX * midX + midY * midY);
+          stemDirX[childIdx] = midNorm > 0.0 ? midX / midNorm : dirX;
+          stemDirY[childIdx] = midNorm > 0.0 ? midY / midNorm : dirY;
+          childIdx = elementTree.GetNode(childIdx).nextSibling;
+     }
+
+}
+
+void StructureLayout_t::LayoutStem(int nodeIdx) {
+     // The outermost pair was placed by the enclosing loop, and the stacked
+     // pairs follow it one unit apart:
+     const StructureElementTree_t::ElementNode_t &stemNode = elementTree.GetNode(nodeIdx);
+     double openX = GetX(stemNode.openIdx), openY = GetY(stemNode.openIdx);
+     double closeX = GetX(stemNode.closeIdx), closeY = GetY(stemNode.closeIdx);
+     for(int k = 1; k < stemNode.length; k++) {
+          SetBasePosition(stemNode.openIdx + k, openX + k * stemDirX[nodeIdx], openY + k * stemDirY[nodeIdx]);
+          SetBasePosition(stemNode.closeIdx - k, closeX + k * stemDirX[nodeIdx], closeY + k * stemDirY[nodeIdx]);
+     }
+}
+
+void StructureLayout_t::LayoutCircular() {
+     int seqLength = GetLength();
+     double circleRadius = GetPolygonRadius(seqLength);
+     for(int bidx = 0; bidx < seqLength; bidx++) {
+          double baseAngle = M_PI / 2.0 + 2.0 * M_PI * (bidx + 0.5) / seqLength;
+          SetBasePosition(bidx, circleRadius * cos(baseAngle), circleRadius * sin(baseAngle));
+     }
+}
@@ -0,0 +1,107 @@
+/* StructureLayout.h : A linear time radial (and NAView-like) layout of a
+ *                     secondary structure computed from its loop/helix
+ *                     decomposition (see StructureElementTree.h);
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#ifndef __STRUCTURE_LAYOUT_H__
+#define __STRUCTURE_LAYOUT_H__
+
+#include <stdlib.h>
+
+#include <vector>
+
+#include "StructureElementTree.h"
+
+class StructureLayout_t {
+
+     public:
+          typedef enum {
+               LAYOUT_RADIAL   = 0,
+               LAYOUT_NAVIEW   = 1,
+               LAYOUT_CIRCULAR = 2,
+          } LayoutStyle_t;
+
+          /* The loops are drawn on circles with their stems pointing out of
+           * them. The stacked pairs, the two bases of a pair and the unpaired
+           * bases of a loop are (about) one unit apart, but the gaps on either
+           * side of a branch are widened by the room its subtree takes up, so
+           * the bases next to a large branch are much further apart. The
+           * subtree widths are estimated from circles around the loops, so a
+           * subtree that bends back past its own loop can still touch its
+           * neighbors in very large structures (mostly the unpaired exterior
+           * bases in the NAView-like style). The exterior loop is a circle in
+           * the radial style and a straight line in the NAView-like style. The
+           * circular style puts all of the bases on one circle. The pair table
+           * is indexed from zero (negative when unpaired), and should be the
+           * pseudoknot-free table the element tree was built from. Both passes
+           * over the tree are iterative and take O(N) time:
+           */
+          StructureLayout_t(const StructureElementTree_t &elementTree,
+                            const std::vector<int> &pairTable,
+                            LayoutStyle_t layoutStyle = LAYOUT_RADIAL);
+
+          inline int GetLength() const {
+               return coords.size() / 2;
+          }
+
+          inline float GetX(int basePos) const {
+               return coords[2 * basePos];
+          }
+
+          inline float GetY(int basePos) const {
+               return coords[2 * basePos + 1];
+          }
+
+          /* The interleaved (x, y) coordinates of the bases: */
+          inline const std::vector<float> & GetCoordinates() const {
+               return coords;
+          }
+
+          inline float GetMinX() const { return xmin; }
+          inline float GetMaxX() const { return xmax; }
+          inline float GetMinY() const { return ymin; }
+          inline float GetMaxY() const { return ymax; }
+
+     private:
+          void ComputeSubtreeWidths();
+          void LayoutExteriorLoop(LayoutStyle_t layoutStyle);
+          void LayoutInteriorLoop(int nodeIdx);
+          void LayoutStem(int nodeIdx);
+          void LayoutCircular();
+
+          /* Fills in the (base index) vertices of the loop and the weights of
+           * the gaps between them (without the closing gap from the last
+           * vertex back to the first), and returns the total weight: */
+          double CollectLoopVertices(int nodeIdx, int firstPos, int lastPos);
+          void PlaceLoopVertices(double centerX, double centerY, double radius,
+                                 double startAngle, double arcSpan, int orientation);
+          int CountLoopVertices(int nodeIdx) const;
+
+          static double GetPolygonRadius(int numVertices);
+
+          inline void SetBasePosition(int basePos, double x, double y) {
+               coords[2 * basePos] = (float) x;
+               coords[2 * basePos + 1] = (float) y;
+          }
+
+          const StructureElementTree_t &elementTree;
+          std::vector<float> coords;
+          float xmin, xmax, ymin, ymax;
+
+          // Per element: the subtree widths, the loop radii and the directions
+          // the stems point in:
+          std::vector<float> subtreeWidths, loopRadii;
+          std::vector<float> stemDirX, stemDirY;
+
+          // Scratch space for the loop being placed (the extra weight of the
+          // closing gap is the room taken up by the branches next to it):
+          std::vector<int> loopVertices;
+          std::vector<double> gapWeights;
+          std::vector<int> branchVertices;
+          double endGapExcess;
+
+};
+
+#endif
@@ -3,6 +3,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
 #include <FL/fl_ask.H>
 
 #include "StructureManager.h"
@@ -13,17 +21,22 @@
 #include "InputWindow.h"
 #include "BaseSequenceIDs.h"
 #include "TerminalPrinting.h"
+#include "LoadProgressWindow.h"
+#include "StructureCache.h"
+#include "StructureArchive.h"
+#include "CompressedInput.h"
+#include "BoltzmannSamplingJob.h"
 
 StructureManager::StructureManager()
-    : m_structureCount(0), m_structures(NULL), m_inputWindow(NULL) {}
+    : m_samplingTimerActive(false), m_inputWindow(NULL) {}
 
 StructureManager::~StructureManager()
 {
-    for (int i = m_structureCount; i > 0; --i)
+    StopSamplingJobs();
+    while (m_structures.GetLiveCount() > 0)
     {
-        RemoveStructure(i - 1);
+        RemoveStructure(m_structures.GetLiveSlots().back());
     }
-    Free(m_structures); 
     for(int i = 0; i < (int)folders.size(); i++)
     {
          folders[i]->SetPerformWidgetDeletion(false);
@@ -32,79 +45,202 @@ StructureManager::~StructureManager()
     Delete(m_inputWindow, InputWindow);
 }
 
-void StructureManager::AddFile(const char* filename, bool removeDuplicateStructs, bool guiQuiet)
+void StructureManager::AddFile(const char* filename, bool removeDuplicateStructs, 
+		               bool guiQuiet, bool deferPairs)
 {
     if (!filename)
         return;
 
-    char* localCopy = strdup(filename);
-    if (!localCopy) {
+    // Don't load if it shares a filename with another loaded structure
+    const char* basename = strrchr(filename, '/');
+    basename = basename ? basename + 1 : filename;
+    if (StructureFilenameExists(basename))
+    {
+        TerminalText::PrintInfo("Skipping ... Already have a structure loaded with filename: %s\n", 
+                                basename);
         return;
     }
 
-    // Get the base file name
-    const char* basename = strrchr(localCopy, '/');
-    if (!basename)
-        basename = localCopy;
-    else
-        basename++;
+    ParsedStructureFile_t parsedFile;
+    ParseStructureFile(filename, parsedFile, deferPairs);
+    InsertParsedStructures(parsedFile, removeDuplicateStructs, guiQuiet);
+}
 
-    // Don't load if it shares a filename with another loaded structure
-    for (int i = 0; i < m_structureCount; ++i)
+void StructureManager::AddFiles(const std::vector<std::string> &filenames, 
+		                bool removeDuplicateStructs, bool guiQuiet, bool deferPairs)
+{
+    int numFiles = filenames.size();
+    if (numFiles == 0)
+        return;
+    else if (numFiles == 1) {
+        AddFile(filenames[0].c_str(), removeDuplicateStructs, guiQuiet, deferPairs);
+        return;
+    }
+
+    // Phase one: a pool of workers parses the files in the background while 
+    // this thread only redraws the (modal) progress window. No FLTK events 
+    // are dispatched until the workers are joined, so none of the callbacks 
+    // can run (or quit the application) in the meantime:
+    std::vector<ParsedStructureFile_t> parsedFiles(numFiles);
+    std::mutex parseMutex;
+    std::condition_variable fileParsed;
+    int numParsed = 0;
+    std::atomic<int> nextFileIdx(0);
+    auto parseWorker = [&]() {
+        int fidx;
+        while ((fidx = nextFileIdx.fetch_add(1)) < numFiles) {
+            ParseStructureFile(filenames[fidx].c_str(), parsedFiles[fidx], deferPairs);
+            std::lock_guard<std::mutex> parseLock(parseMutex);
+            numParsed++;
+            fileParsed.notify_one();
+        }
+    };
+    LoadProgressWindow *progressWin = new LoadProgressWindow("Loading Structure Files ...", 
+                                                             numFiles, false, true);
+    int numThreads = MIN(MAX(1, (int) std::thread::hardware_concurrency()), numFiles);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < numThreads; t++)
+        workers.push_back(std::thread(parseWorker));
     {
-        if (m_structures[i])
-        {
-            if (!strcmp(m_structures[i]->GetFilename(true), basename))
-            {
-                TerminalText::PrintInfo("Skipping ... Already have a structure loaded with filename: %s\n", 
-                                        basename);
-                Free(localCopy);
-                return;
-            }
+        std::unique_lock<std::mutex> parseLock(parseMutex);
+        while (numParsed < numFiles) {
+            int numDone = numParsed;
+            parseLock.unlock();
+            progressWin->SetProgressNoEvents(numDone);
+            parseLock.lock();
+            fileParsed.wait_for(parseLock, std::chrono::milliseconds(50), 
+                                [&]() { return numParsed != numDone; });
         }
     }
-    
+    for (int t = 0; t < numThreads; t++)
+        workers[t].join();
+
+    // Phase two: insert them into folders on this (FLTK) thread in the 
+    // original order (which may prompt the user about duplicates):
+    for (int fidx = 0; fidx < numFiles; fidx++)
+    {
+        progressWin->SetProgress(fidx, filenames[fidx].c_str());
+        InsertParsedStructures(parsedFiles[fidx], removeDuplicateStructs, guiQuiet);
+    }
+    Delete(progressWin, LoadProgressWindow);
+}
+
+static RNAStructure * CreateFromCTFormatFile(const char *filename, bool isBPSEQ, bool deferPairs)
+{
+    RNAStructure *rnaStruct = deferPairs ? RNAStructure::CreateDeferredFromFile(filename, isBPSEQ) : NULL;
+    if (rnaStruct == NULL)
+        rnaStruct = RNAStructure::CreateFromFile(filename, isBPSEQ);
+    return rnaStruct;
+}
+
+void StructureManager::ParseStructureFile(const char *filename, ParsedStructureFile_t &parsedFile, 
+		                          bool deferPairs)
+{
+    parsedFile.filePath = std::string(filename);
+    parsedFile.structures = NULL;
+    parsedFile.structCount = 0;
+    parsedFile.isFASTAFile = false;
+    parsedFile.unknownFileType = false;
+
+    // The compressed files are read through the same parsers, so look at 
+    // the extension under the compression extension:
+    std::string uncompressedPath = CompressedInput::GetUncompressedFilePath(filename);
+    const char* basename = strrchr(uncompressedPath.c_str(), '/');
+    basename = basename ? basename + 1 : uncompressedPath.c_str();
+
     // Figure out what kind of file we have and try to load it.
     const char* extension = strrchr(basename, '.');
     extension = extension ? extension : "";
     RNAStructure **structures = (RNAStructure **) malloc(sizeof(RNAStructure *));
     int newStructCount = 0;
-    bool isFASTAFile = false;
+    bool cacheableFile = StructureCache::IsCacheableFile(filename);
+    if (cacheableFile && (*structures = StructureCache::LoadStructure(filename)) != NULL) {
+        (*structures)->GetSequenceFingerprint();
+        parsedFile.structures = structures;
+        parsedFile.structCount = 1;
+        return;
+    }
     if (extension && !strncasecmp(extension, ".bpseq", 6)) {
-        *structures = RNAStructure::CreateFromFile(localCopy, true);
+        *structures = CreateFromCTFormatFile(filename, true, deferPairs);
         newStructCount = 1;
     }
     else if (extension && !strncasecmp(extension, ".ct", 3)) {
-        *structures = RNAStructure::CreateFromFile(localCopy, false);
+        *structures = CreateFromCTFormatFile(filename, false, deferPairs);
         newStructCount = 1;
     }
     else if (extension && !strncasecmp(extension, ".nopct", 6)) {
-        *structures = RNAStructure::CreateFromFile(localCopy, false);
+        *structures = CreateFromCTFormatFile(filename, false, deferPairs);
         newStructCount = 1;
     }
     else if(extension && (!strncasecmp(extension, ".dot", 4) || 
               !strncasecmp(extension, ".bracket", 8) || 
-              !strncasecmp(extension, ".dbn", 4))) {
-        *structures = RNAStructure::CreateFromDotBracketFile(localCopy);
-        newStructCount = 1;
+              !strncasecmp(extension, ".dbn", 4) || 
+              !strncasecmp(extension, ".subopt", 7))) {
+        // The dot bracket files may hold any number of structures:
+        Free(structures);
+	structures = RNAStructure::CreateFromDotBracketRecordsFile(filename, &newStructCount);
     }
     else if(extension && !strncasecmp(extension, ".boltz", 6)) {
         Free(structures);
-	structures = RNAStructure::CreateFromBoltzmannFormatFile(localCopy, &newStructCount);
+	structures = RNAStructure::CreateFromBoltzmannFormatFile(filename, &newStructCount);
+    }
+    else if(extension && StructureArchive::IsArchiveFile(uncompressedPath.c_str())) {
+        Free(structures);
+	structures = StructureArchive::LoadArchiveFile(filename, &newStructCount);
     }
     else if(extension && (!strncasecmp(extension, ".helix", 6) || 
               !strncasecmp(extension, ".hlx", 4))) {
         Free(structures);
-	structures = RNAStructure::CreateFromHelixTripleFormatFile(localCopy, &newStructCount);
+	structures = RNAStructure::CreateFromHelixTripleFormatFile(filename, &newStructCount);
     }
     #if WITH_FASTA_FORMAT_SUPPORT > 0
     else if(extension && !strncasecmp(extension, ".fasta", 6)) {
+        // The samples are drawn by a background job which is started when 
+        // the (empty) result is inserted on the main thread:
         Free(structures);
-	structures = RNAStructure::CreateFromFASTAFile(localCopy, &newStructCount);
-	isFASTAFile = true;
+	parsedFile.isFASTAFile = true;
+	return;
     }
     #endif
     else {
+        Free(structures);
+        parsedFile.unknownFileType = true;
+        return;
+    }
+    if (cacheableFile && structures != NULL && newStructCount == 1 && 
+        structures[0] != NULL && !structures[0]->IsParseDeferred()) {
+        StructureCache::StoreStructure(filename, structures[0]);
+    }
+    // Compute the sequence fingerprints here (off the main thread):
+    for (int s = 0; structures != NULL && s < newStructCount; s++) {
+        if (structures[s] != NULL)
+            structures[s]->GetSequenceFingerprint();
+    }
+    parsedFile.structures = structures;
+    parsedFile.structCount = newStructCount;
+}
+
+void StructureManager::InsertParsedStructures(ParsedStructureFile_t &parsedFile, 
+		                              bool removeDuplicateStructs, bool guiQuiet, 
+					      bool continuesFile)
+{
+    const char *filename = parsedFile.filePath.c_str();
+    char* localCopy = strdup(filename);
+    if (!localCopy) {
+        return;
+    }
+    const char* basename = strrchr(localCopy, '/');
+    basename = basename ? basename + 1 : localCopy;
+    const char* extension = strrchr(basename, '.');
+    extension = extension ? extension : "";
+
+    RNAStructure **structures = parsedFile.structures;
+    int newStructCount = parsedFile.structCount;
+    bool isFASTAFile = parsedFile.isFASTAFile;
+    parsedFile.structures = NULL;
+    parsedFile.structCount = 0;
+
+    if (parsedFile.unknownFileType) {
         if (strlen(filename) > 1000) {
 	    if(!guiQuiet) {
                  fl_message("Unknown file type: <file name too long>");
@@ -121,10 +257,26 @@ void StructureManager::AddFile(const char* filename, bool removeDuplicateStructs
 		 TerminalText::PrintWarning("Unknown file type: %s . %s [%s]", filename, extension, basename);
 	    }
 	}
-        Free(structures);
 	Free(localCopy);
 	return;
     }
+    else if (isFASTAFile && structures == NULL) {
+        StartSamplingJob(filename, removeDuplicateStructs, guiQuiet);
+        Free(localCopy);
+        return;
+    }
+    else if (!continuesFile && StructureFilenameExists(basename))
+    {
+        // Another file in the same batch may have been loaded under this name:
+        TerminalText::PrintInfo("Skipping ... Already have a structure loaded with filename: %s\n", 
+                                basename);
+        for(int j = 0; structures != NULL && j < newStructCount; j++) {
+            Delete(structures[j], RNAStructure);
+        }
+        Free(structures);
+        Free(localCopy);
+        return;
+    }
 
     int s = -1;
     if(structures != NULL && newStructCount > 0)
@@ -140,11 +292,11 @@ void StructureManager::AddFile(const char* filename, bool removeDuplicateStructs
            if(count == (int) folders.size() - 1) // we added a new folder ... 
            {
                  
-              off_t stickyFolderExists = FolderNameForSequenceExists(
+              size_t stickyFolderExists = FolderNameForSequenceExists(
                                       DEFAULT_STICKY_FOLDERNAME_CFGFILE, 
                                       structure
                      );
-                 if(stickyFolderExists != LSEEK_NOT_FOUND && GUI_KEEP_STICKY_FOLDER_NAMES) {
+                 if(stickyFolderExists != STICKY_ENTRY_NOT_FOUND && GUI_KEEP_STICKY_FOLDER_NAMES) {
                     char *stickyFolderName = LookupStickyFolderNameForSequence(
                                     DEFAULT_STICKY_FOLDERNAME_CFGFILE, 
                                     stickyFolderExists
@@ -225,7 +377,7 @@ void StructureManager::AddFile(const char* filename, bool removeDuplicateStructs
                            DEFAULT_STICKY_FOLDERNAME_CFGFILE, 
                            std::string(baseSeq), 
                            std::string(folders[count]->folderName), 
-                           LSEEK_NOT_FOUND
+                           STICKY_ENTRY_NOT_FOUND
                         );
                         if(saveStatus) {
                              TerminalText::PrintWarning("Unable to save sticky folder name \"%s\"\n", 
@@ -240,11 +392,8 @@ void StructureManager::AddFile(const char* filename, bool removeDuplicateStructs
            bool haveDuplicateStruct = false;
 	   Folder *nextFolder = GetFolderAt(count);
 	   if(nextFolder != NULL) {
-                for(int si = 0; si < nextFolder->structCount; si++) {
-                     int structIdx = nextFolder->folderStructs[si];
-		     RNAStructure *compStruct = structIdx != -1 ? 
-			                        GetStructure(structIdx) : 
-						NULL;
+                for(unsigned int si = 0; si < nextFolder->folderStructs.size(); si++) {
+		     RNAStructure *compStruct = GetStructure(nextFolder->folderStructs[si]);
 		     if(compStruct == NULL) {
 		          continue;
 		     }
@@ -261,8 +410,13 @@ void StructureManager::AddFile(const char* filename, bool removeDuplicateStructs
               Delete(m_inputWindow, InputWindow);
            }
 	   else if(firstEmptyIdx != -1) {
-                m_structures[firstEmptyIdx] = NULL;
-		m_structureCount -= 1;
+                for(unsigned int fi = 0; fi < folders.size(); fi++) {
+                     if(folders[fi]->RemoveStructure(firstEmptyIdx)) {
+                          break;
+                     }
+                }
+                UnindexStructure(structure, firstEmptyIdx);
+                m_structures.RemoveAt(firstEmptyIdx);
 		Delete(structure, RNAStructure);
 	   }
 	   else {
@@ -272,10 +426,6 @@ void StructureManager::AddFile(const char* filename, bool removeDuplicateStructs
 
       }
     }
-    else if(isFASTAFile) {
-	 TerminalText::PrintWarning("Skipping loading of FASTA / TXT file data from \"%s\" ...", localCopy);
-    
-    }
     else {
          fl_alert("Error adding structure \"%s\"! Could not parse the specified format for this file.\n", 
                   localCopy);
@@ -290,37 +440,194 @@ void StructureManager::AddFile(const char* filename, bool removeDuplicateStructs
 
 }
 
-void StructureManager::RemoveStructure(const int index)
+void StructureManager::StartSamplingJob(const char *fastaFilePath, 
+		                        bool removeDuplicateStructs, bool guiQuiet)
+{
+    if (fastaFilePath == NULL)
+        return;
+    for (int j = 0; j < (int)m_samplingJobs.size(); j++)
+    {
+        if (!strcmp(m_samplingJobs[j].samplingJob->GetFilePath(), fastaFilePath))
+        {
+            TerminalText::PrintInfo("Skipping ... Already sampling structures for: %s\n", 
+                                    fastaFilePath);
+            return;
+        }
+    }
+    const char* basename = strrchr(fastaFilePath, '/');
+    basename = basename ? basename + 1 : fastaFilePath;
+    char progressTitle[MAX_BUFFER_SIZE];
+    snprintf(progressTitle, MAX_BUFFER_SIZE, "Sampling Structures: %s", basename);
+
+    ActiveSamplingJob_t activeJob;
+    activeJob.samplingJob = new BoltzmannSamplingJob_t(fastaFilePath);
+    activeJob.progressWindow = new LoadProgressWindow(progressTitle, 
+		                                      activeJob.samplingJob->GetTotalSampleCount(), true);
+    activeJob.removeDuplicateStructs = removeDuplicateStructs;
+    activeJob.guiQuiet = guiQuiet;
+    activeJob.haveInsertedStructs = false;
+    m_samplingJobs.push_back(activeJob);
+    activeJob.samplingJob->Start();
+    if (!m_samplingTimerActive)
+    {
+        m_samplingTimerActive = true;
+        Fl::add_timeout(SAMPLING_JOB_POLL_INTERVAL, SamplingJobTimerCallback, this);
+    }
+}
+
+void StructureManager::CancelSamplingJobs()
+{
+    for (int j = 0; j < (int)m_samplingJobs.size(); j++)
+    {
+        m_samplingJobs[j].samplingJob->Cancel();
+    }
+}
+
+void StructureManager::StopSamplingJobs()
+{
+    Fl::remove_timeout(SamplingJobTimerCallback, this);
+    m_samplingTimerActive = false;
+    for (int j = 0; j < (int)m_samplingJobs.size(); j++)
+    {
+        BoltzmannSamplingJob_t::Abandon(m_samplingJobs[j].samplingJob);
+        m_samplingJobs[j].samplingJob = NULL;
+        Delete(m_samplingJobs[j].progressWindow, LoadProgressWindow);
+    }
+    m_samplingJobs.clear();
+}
+
+bool StructureManager::WriteFolderArchive(const int folderIndex, const char *archivePath)
+{
+    Folder *folder = GetFolderAt(folderIndex);
+    if (folder == NULL || archivePath == NULL)
+    {
+        return false;
+    }
+    std::vector<RNAStructure *> folderStructs;
+    folder->CollectStructures(m_structures, folderStructs);
+    return StructureArchive::WriteArchive(archivePath, folder->folderName, folderStructs);
+}
+
+void StructureManager::GetFolderStructures(const int folderIndex, std::vector<RNAStructure*> &folderStructs)
+{
+    Folder *folder = GetFolderAt(folderIndex);
+    if (folder != NULL)
+    {
+        folder->CollectStructures(m_structures, folderStructs);
+    }
+}
+
+void StructureManager::SamplingJobTimerCallback(void *smPtr)
+{
+    StructureManager *structManager = (StructureManager *) smPtr;
+    structManager->PollSamplingJobs();
+    if (structManager->m_samplingJobs.empty())
+    {
+        structManager->m_samplingTimerActive = false;
+    }
+    else if (!Fl::has_timeout(SamplingJobTimerCallback, smPtr))
+    {
+        Fl::add_timeout(SAMPLING_JOB_POLL_INTERVAL, SamplingJobTimerCallback, smPtr);
+    }
+}
+
+void StructureManager::PollSamplingJobs()
 {
-    if(index < 0 || index >= m_structureCount) {
+    // Work on copies of the records, since inserting the structures may 
+    // prompt for a folder name (and so run the event loop, which can start 
+    // other jobs or stop all of them):
+    std::vector<ActiveSamplingJob_t> activeJobs(m_samplingJobs);
+    for (int j = 0; j < (int)activeJobs.size(); j++)
+    {
+        BoltzmannSamplingJob_t *samplingJob = activeJobs[j].samplingJob;
+        if (FindSamplingJob(samplingJob) < 0)
+        {
+            continue;
+        }
+        else if (activeJobs[j].progressWindow->CancelRequested())
+        {
+            samplingJob->Cancel();
+        }
+        // Check this first, so no structures are left behind in the queue:
+        bool jobFinished = samplingJob->IsFinished();
+        std::vector<RNAStructure *> readyStructs;
+        if (samplingJob->TakeReadyStructures(readyStructs) > 0)
+        {
+            ParsedStructureFile_t parsedChunk;
+            parsedChunk.filePath = std::string(samplingJob->GetFilePath());
+            parsedChunk.structCount = readyStructs.size();
+            parsedChunk.structures = (RNAStructure **) malloc(readyStructs.size() * 
+			                                      sizeof(RNAStructure *));
+            std::copy(readyStructs.begin(), readyStructs.end(), parsedChunk.structures);
+            parsedChunk.isFASTAFile = false;
+            parsedChunk.unknownFileType = false;
+            // The folders for the records of a multi-record file are named 
+            // from the record IDs, rather than prompting for each of them:
+            bool guiQuiet = activeJobs[j].guiQuiet || samplingJob->GetRecordCount() > 1;
+            InsertParsedStructures(parsedChunk, activeJobs[j].removeDuplicateStructs, 
+                                   guiQuiet, activeJobs[j].haveInsertedStructs);
+        }
+        int jobIndex = FindSamplingJob(samplingJob);
+        if (jobIndex < 0)
+        {
+            continue;
+        }
+        m_samplingJobs[jobIndex].haveInsertedStructs |= !readyStructs.empty();
+        if (jobFinished)
+        {
+            FinishSamplingJob(samplingJob);
+        }
+        else
+        {
+            std::string statusMsg = samplingJob->GetStatusMessage();
+            LoadProgressWindow *progressWin = m_samplingJobs[jobIndex].progressWindow;
+            progressWin->SetTotalItems(samplingJob->GetTotalSampleCount());
+            progressWin->SetProgress(samplingJob->GetSamplesDone(), statusMsg.c_str());
+        }
+    }
+}
+
+int StructureManager::FindSamplingJob(const BoltzmannSamplingJob_t *samplingJob) const
+{
+    for (int j = 0; j < (int)m_samplingJobs.size(); j++)
+    {
+        if (m_samplingJobs[j].samplingJob == samplingJob)
+            return j;
+    }
+    return -1;
+}
+
+void StructureManager::FinishSamplingJob(BoltzmannSamplingJob_t *samplingJob)
+{
+    for (int j = 0; j < (int)m_samplingJobs.size(); j++)
+    {
+        if (m_samplingJobs[j].samplingJob != samplingJob)
+            continue;
+        if (samplingJob->IsCancelled())
+        {
+            TerminalText::PrintInfo("Cancelled sampling the structures for \"%s\" after %d samples.\n", 
+                                    samplingJob->GetFilePath(), samplingJob->GetSamplesDone());
+        }
+        Delete(m_samplingJobs[j].progressWindow, LoadProgressWindow);
+        Delete(m_samplingJobs[j].samplingJob, BoltzmannSamplingJob_t);
+        m_samplingJobs.erase(m_samplingJobs.begin() + j);
         return;
     }
+}
 
-    RNAStructure* structure = m_structures[index];
-    m_structures[index] = NULL;
+void StructureManager::RemoveStructure(const int index)
+{
+    RNAStructure* structure = m_structures.GetAt(index);
     if(structure == NULL) {
         return;
     }
+    UnindexStructure(structure, index);
+    m_structures.RemoveAt(index);
     
-    bool found = false;
     int folderIndex = -1;
     for(int i = 0; i < (int)folders.size(); i++)
     {
-        int shift = 0;
-        for(int j = 0; j < folders[i]->structCount; j++)
-        {   
-            if(folders[i]->folderStructs[(j+shift)] == -1)
-            {
-                shift++;
-            }
-            if(folders[i]->folderStructs[(j+shift)] == index)
-            {
-                folders[i]->folderStructs[(j+shift)] = -1;                
-                found = true;
-                break;
-            }
-        }
-        if(found) {
+        if(folders[i]->RemoveStructure(index)) {
 	    folderIndex = i;
             break;
 	}
@@ -348,20 +655,6 @@ void StructureManager::RemoveStructure(const int index)
     
 }
 
-void StructureManager::DecreaseStructCount(const int index)
-{
-    folders[index]->structCount = folders[index]->structCount - 1;
-    if (folders[index]->structCount == 0) 
-    {
-        MainWindow::RemoveFolderByIndex(index);
-    }
-    else {
-        folders[index]->SetTooltipTextData();
-	folders[index]->SetFolderLabel();
-	Fl::redraw();
-    }
-}
-
 void StructureManager::RemoveFolder(const int index) {
     TerminalText::PrintDebug("Removing folder at index #%d\n", index);
     if(index < 0 || index >= folders.size()) {
@@ -370,6 +663,16 @@ void StructureManager::RemoveFolder(const int index) {
     RNAStructViz::GetInstance()->RemoveFolderData(index);
     Folder *folderStruct = folders[index];
     folders.erase(folders.begin() + index);
+    for(int fi = index; fi < (int) folders.size(); fi++) {
+        folders[fi]->folderIndex = fi;
+    }
+    auto folderRange = m_folderFingerprintIndex.equal_range(folderStruct->sequenceFingerprint);
+    for(auto it = folderRange.first; it != folderRange.second; ++it) {
+        if(it->second == folderStruct) {
+            m_folderFingerprintIndex.erase(it);
+            break;
+        }
+    }
     folderStruct->MarkForDeletion();
     if(USE_SCHEDULED_DELETION) {
 	 RNAStructViz::ScheduledDeletion::AddFolder(folderStruct);
@@ -380,8 +683,11 @@ void StructureManager::RemoveFolder(const int index) {
     }
 }
 
-void StructureManager::AddFolder(RNAStructure* structure, const int index) {
-     Folder *nextFolder = Folder::AddNewFolderFromData(structure, index, false);
+void StructureManager::AddFolder(RNAStructure* structure, const StructureHandle_t &handle) {
+     Folder *nextFolder = Folder::AddNewFolderFromData(structure, handle, false);
+     nextFolder->sequenceFingerprint = SequenceFingerprint(structure);
+     m_folderFingerprintIndex.emplace(nextFolder->sequenceFingerprint, nextFolder);
+     nextFolder->folderIndex = folders.size();
      folders.push_back(nextFolder);
      //if(folders.size() == 1) {
      //     MainWindow::SetFolderSelected(0);
@@ -391,84 +697,48 @@ void StructureManager::AddFolder(RNAStructure* structure, const int index) {
 
 int StructureManager::AddFirstEmpty(RNAStructure* structure, bool excludeDuplicateStructs)
 {
-    int index;
-    bool added = false;
     bool found = false;
-    if (!m_structures && folders.empty())
+    if (m_structures.GetSlotCount() == 0 && folders.empty())
     {
-        m_structures = (RNAStructure**) malloc(sizeof(RNAStructure*));
-        m_structures[0] = structure;
-        m_structureCount = 1;
-        added = true;
-        AddFolder(structure, 0);
-        found = true;
-        return 0;
+        StructureHandle_t handle = m_structures.Insert(structure);
+        IndexStructure(structure, handle.slotIndex);
+        AddFolder(structure, handle);
+        return handle.slotIndex;
     }
     if(excludeDuplicateStructs && DuplicateStructureExistsInFolder(structure)) {
          return -1;
     }
     
-    for (int i = 0; i < m_structureCount; ++i)
-    {
-        if (!m_structures[i])
-        {
-            m_structures[i] = structure;
-            index = i;
-            added = true;
-            break;
-        }
-    }
-    if(!added)
-    {
-        m_structureCount++;
-        m_structures = (RNAStructure **) realloc(m_structures, sizeof(RNAStructure*) * m_structureCount);
-        m_structures[m_structureCount - 1] = structure;
-        index = m_structureCount - 1;
-    }
+    StructureHandle_t handle = m_structures.Insert(structure);
+    int index = handle.slotIndex;
+    IndexStructure(structure, index);
     
-    for(unsigned int ui = 0; ui < folders.size(); ui++)
+    // Only the folders whose sequence fingerprint matches need a full compare:
+    uint64_t seqFingerprint = SequenceFingerprint(structure);
+    auto folderRange = m_folderFingerprintIndex.equal_range(seqFingerprint);
+    for(auto it = folderRange.first; it != folderRange.second; ++it)
     {
-        for(int j = 0; j < folders[ui]->structCount; j++)
+        RNAStructure *folderStruct = GetFolderRepresentative(it->second);
+        if(folderStruct == NULL || folderStruct == structure || 
+           !SequenceCompare(folderStruct, structure))
         {
+            continue;
+        }
+        int ui = it->second->folderIndex;
 
-            if(folders[ui]->folderStructs[j] > -1 &&
-               SequenceCompare(m_structures[folders[ui]->folderStructs[j]], structure))
-            {
-
-                folders[ui]->structCount++;
-                if(folders[ui]->structCount > folders[ui]->capacity + 1) {
-		    folders[ui]->capacity *= 2;
-                    folders[ui]->folderStructs = (int *) realloc(folders[ui]->folderStructs, 
-                                                                 sizeof(int) * folders[ui]->capacity);
-                }
-                bool emptySlot = false;
-                for(int i = 0; i < folders[ui]->structCount-1; i++)
-                {
-                    if(folders[ui]->folderStructs[i] == -1)
-                    {
-                        folders[ui]->folderStructs[i] = index;
-                        emptySlot = true;
-                        break;
-                    }
-                }
-                if(!emptySlot)
-                    folders[ui]->folderStructs[folders[ui]->structCount - 1] = index;
-                AddNewStructure(ui, index);
-                
-                if (folders[ui]->folderNameFileCount != NULL) {
-                    folders[ui]->SetTooltipTextData();
-	            folders[ui]->SetFolderLabel();
-		}
-                found = true;
-                break;
-            }
+        folders[ui]->AddStructure(handle);
+        AddNewStructure(ui, index);
+        
+        if (folders[ui]->folderNameFileCount != NULL) {
+            folders[ui]->SetTooltipTextData();
+            folders[ui]->SetFolderLabel();
         }
-        if(found)
-            break;
+        found = true;
+        break;
     }
     if(!found)
     {
-        AddFolder(structure, index);
+        AddFolder(structure, handle);
     }
     return index;
 
@@ -493,9 +763,115 @@ void StructureManager::AddNewStructure(const int folderIndex, const int index)
     MainWindow::ShowFolderSelected();
 }
 
+void StructureManager::IndexStructure(RNAStructure *structure, const int index)
+{
+    m_filenameIndex.emplace(std::string(structure->GetFilename()), index);
+    m_exactFilenameCounts[std::string(structure->GetFilename(true))]++;
+    m_sequenceIndex.emplace(SequenceFingerprint(structure), index);
+    m_structureIndex.emplace(StructureFingerprint(structure), index);
+}
+
+void StructureManager::UnindexStructure(RNAStructure *structure, const int index)
+{
+    auto nameRange = m_filenameIndex.equal_range(std::string(structure->GetFilename()));
+    for(auto it = nameRange.first; it != nameRange.second; ++it) {
+        if(it->second == index) {
+            m_filenameIndex.erase(it);
+            break;
+        }
+    }
+    auto exactNameIt = m_exactFilenameCounts.find(std::string(structure->GetFilename(true)));
+    if(exactNameIt != m_exactFilenameCounts.end() && --(exactNameIt->second) <= 0) {
+        m_exactFilenameCounts.erase(exactNameIt);
+    }
+    auto seqRange = m_sequenceIndex.equal_range(SequenceFingerprint(structure));
+    for(auto it = seqRange.first; it != seqRange.second; ++it) {
+        if(it->second == index) {
+            m_sequenceIndex.erase(it);
+            break;
+        }
+    }
+    auto structRange = m_structureIndex.equal_range(StructureFingerprint(structure));
+    for(auto it = structRange.first; it != structRange.second; ++it) {
+        if(it->second == index) {
+            m_structureIndex.erase(it);
+            break;
+        }
+    }
+}
+
+uint64_t StructureManager::SequenceFingerprint(RNAStructure *structure)
+{
+    // The low word of the cached full sequence fingerprint:
+    return structure->GetSequenceFingerprint().low;
+}
+
+uint64_t StructureManager::StructureFingerprint(RNAStructure *structure)
+{
+    // The pair hash is cached by the structure (and is computed by the 
+    // loaders, even for the deferred structures, when they read the pairs):
+    return StructureFingerprint(structure, structure->GetPairListHash());
+}
+
+uint64_t StructureManager::StructureFingerprint(RNAStructure *structure, uint64_t pairListHash)
+{
+    return structure->GetSequenceFingerprint().low ^ (pairListHash * 0x9e3779b97f4a7c15ULL);
+}
+
+void StructureManager::ReindexStructurePairs(RNAStructure *structure, uint64_t prevPairListHash)
+{
+    auto structRange = m_structureIndex.equal_range(StructureFingerprint(structure, prevPairListHash));
+    for(auto it = structRange.first; it != structRange.second; ++it) {
+        if(m_structures.GetAt(it->second) == structure) {
+            int index = it->second;
+            m_structureIndex.erase(it);
+            m_structureIndex.emplace(StructureFingerprint(structure), index);
+            return;
+        }
+    }
+}
+
+bool StructureManager::DuplicateStructureExistsInFolder(RNAStructure *structToLoad)
+{
+    if(structToLoad == NULL) {
+        return false;
+    }
+    // Comparing the pairs may complete a deferred parse, which can re-index 
+    // that structure, so the candidates are copied out of the index first:
+    std::vector<int> candidateIndices;
+    auto structRange = m_structureIndex.equal_range(StructureFingerprint(structToLoad));
+    for(auto it = structRange.first; it != structRange.second; ++it) {
+        candidateIndices.push_back(it->second);
+    }
+    for(unsigned int ci = 0; ci < candidateIndices.size(); ci++) {
+        RNAStructure *compStruct = m_structures.GetAt(candidateIndices[ci]);
+        if(compStruct != NULL && *compStruct == *structToLoad) {
+            return true;
+        }
+    }
+    return false;
+}
+
+RNAStructure* StructureManager::GetFolderRepresentative(Folder *folder)
+{
+    if(folder == NULL) {
+        return NULL;
+    }
+    for(unsigned int i = 0; i < folder->folderStructs.size(); i++)
+    {
+        RNAStructure *folderStruct = m_structures.Get(folder->folderStructs[i]);
+        if(folderStruct != NULL)
+        {
+            return folderStruct;
+        }
+    }
+    return NULL;
+}
+
 bool StructureManager::SequenceCompare(RNAStructure* struct1, RNAStructure* struct2) const
 {
-    if(struct1->GetCharSeqSize() != struct2->GetCharSeqSize())
+    if(struct1->GetCharSeqSize() != struct2->GetCharSeqSize() || 
+       struct1->GetSequenceFingerprint() != struct2->GetSequenceFingerprint())
         return false;
     const char* ptr1 = struct1->GetCharSeq();
     const char* ptr2 = struct2->GetCharSeq();
@@ -510,23 +886,24 @@ bool StructureManager::SequenceCompare(RNAStructure* struct1, RNAStructure* stru
 void StructureManager::DisplayFileContents(const int index, 
                                    const char *displaySuffix)
 {
-    m_structures[index]->DisplayFileContents(displaySuffix);
+    RNAStructure *structure = m_structures.GetAt(index);
+    if(structure != NULL)
+    {
+        structure->DisplayFileContents(displaySuffix);
+    }
 }
 
 void StructureManager::PrintFolders()
 {
     for(int i = 0; i < (int)folders.size(); i++)
     {
-        int shift = 0;
         printf("folder: %s\n", folders[i]->folderName);
-        for(int j = 0; j < folders[i]->structCount; j++)
+        for(unsigned int j = 0; j < folders[i]->folderStructs.size(); j++)
         {
-            if(folders[i]->folderStructs[(j+shift)] == -1)
-            {
-                shift++;
-            }
-            if(m_structures[folders[i]->folderStructs[(j+shift)]])
-                printf("\tstruct %d: %s\n", (j+shift), m_structures[folders[i]->folderStructs[(j+shift)]]->GetFilename());
+            RNAStructure *structure = m_structures.Get(folders[i]->folderStructs[j]);
+            if(structure)
+                printf("\tstruct %d: %s\n", folders[i]->folderStructs[j].slotIndex, 
+                       structure->GetFilename());
         }
     }
 }
@@ -6,6 +6,9 @@
 #define STRUCTUREMANAGER_H
 
 #include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 #include <FL/Fl_Double_Window.H>
 #include <FL/Fl_Pack.H>
@@ -13,6 +16,14 @@
 
 #include "RNAStructure.h"
 #include "FolderStructure.h"
+#include "StructureSlotMap.h"
+
+class BoltzmannSamplingJob_t;
+class LoadProgressWindow;
+
+/* How often (in seconds) the FLTK thread collects the structures computed 
+ * by the running Boltzmann sampling jobs: */
+#define SAMPLING_JOB_POLL_INTERVAL             (0.25)
 
 class StructureManager
 {
@@ -21,9 +32,77 @@ class StructureManager
         ~StructureManager();
 
         /*
-	    Add a new structure, given as a file name to load.
+	    Add a new structure, given as a file name to load. When 
+	    deferPairs is set, the pairs in CT/NOPCT/BPSEQ files are not 
+	    parsed until the structure is first viewed.
+        */
+        void AddFile(const char* filename, bool removeDuplicateStructs = true, 
+		     bool guiQuiet = false, bool deferPairs = false);
+
+        /*
+	    Add the structures from several files. The files are parsed 
+	    concurrently by a pool of worker threads, and the parsed structures 
+	    are inserted into folders on the calling (FLTK) thread in the order 
+	    the files are given, with a progress indicator shown meanwhile.
+        */
+        void AddFiles(const std::vector<std::string> &filenames, 
+		      bool removeDuplicateStructs = true, bool guiQuiet = false, 
+		      bool deferPairs = false);
+
+        /*
+	    The structures parsed from one file, which are owned by this 
+	    record until they are handed to InsertParsedStructures.
         */
-        void AddFile(const char* filename, bool removeDuplicateStructs = true, bool guiQuiet = false);
+        typedef struct {
+             std::string filePath;
+             RNAStructure **structures;
+             int structCount;
+             bool isFASTAFile;
+             bool unknownFileType;
+        } ParsedStructureFile_t;
+
+        /*
+	    Parses a structure file by its extension. This does not touch 
+	    the GUI or the manager state, so it is safe to call off the 
+	    main thread.
+        */
+        static void ParseStructureFile(const char *filename, ParsedStructureFile_t &parsedFile, 
+			               bool deferPairs = false);
+
+        /*
+	    Start sampling the structures for a FASTA file in the background. 
+	    The samples are added to the folder for the sequence in chunks as 
+	    they are drawn, and the job can be cancelled from its progress 
+	    window (or by CancelSamplingJobs).
+        */
+        void StartSamplingJob(const char *fastaFilePath, 
+			      bool removeDuplicateStructs = true, bool guiQuiet = false);
+        void CancelSamplingJobs();
+
+        /*
+	    Stop polling the sampling jobs and drop them (with the structures 
+	    they have not handed back yet) without waiting for their workers. 
+	    This is called before the teardown, so no structures are inserted 
+	    (or folder names prompted for) while the program shuts down.
+        */
+        void StopSamplingJobs();
+
+        /*
+	    Write all of the structures in a folder to a single binary archive 
+	    file (see StructureArchive.h), which loads back as one folder.
+        */
+        bool WriteFolderArchive(const int folderIndex, const char *archivePath);
+
+        /*
+	    The structures in a folder which are still loaded (in the order 
+	    they were added to the folder).
+        */
+        void GetFolderStructures(const int folderIndex, std::vector<RNAStructure*> &folderStructs);
+
+        inline bool HaveActiveSamplingJobs() const
+        {
+	        return !m_samplingJobs.empty();
+        }
 
         /*
 	    Remove a structure.
@@ -36,45 +115,63 @@ class StructureManager
         void RemoveFolder(const int index);
 
         /*
-	    Get the number of structures. Some may be NULL.
+	    Get the number of structure slots. Some may be NULL.
         */
         inline int GetStructureCount() const
         {
-	        return m_structureCount;
+	        return m_structures.GetSlotCount();
         }
 
         /*
-	     Get a structure.
+	     Get a structure by its slot index (NULL if the slot is empty).
         */
         inline RNAStructure* GetStructure(const int index)
         {
-	        return m_structures[index];
+	        return m_structures.GetAt(index);
+        }
+
+        /*
+	     Stable handles to the loaded structures (as kept by the folders). 
+	     A handle to a structure which has since been removed resolves to 
+	     NULL, even if its slot index has been reused by a newer structure.
+        */
+        inline StructureHandle_t GetStructureHandle(const int index) const
+        {
+	        return m_structures.GetHandleAt(index);
+        }
+
+        inline RNAStructure* GetStructure(const StructureHandle_t &handle) const
+        {
+	        return m_structures.Get(handle);
         }
 
 	inline RNAStructure* LookupStructureByCTPath(const char *ctPath) {
-	     if(ctPath == NULL) {
-	          return NULL;
-	     }
-	     for(int sidx = 0; sidx < m_structureCount; sidx++) {
-	          RNAStructure *rnaStruct = GetStructure(sidx);
-		  if((rnaStruct != NULL) && !strcmp(rnaStruct->GetFilename(), ctPath)) {
-	               return rnaStruct;
-		  }
-	     }
-	     return NULL;
+	     int sidx = LookupStructureIndexByCTPath(ctPath);
+	     return sidx >= 0 ? GetStructure(sidx) : NULL;
 	}
 
 	inline int LookupStructureIndexByCTPath(const char *ctPath) {
 	     if(ctPath == NULL) {
 	          return -1;
 	     }
-	     for(int sidx = 0; sidx < m_structureCount; sidx++) {
-	          RNAStructure *rnaStruct = GetStructure(sidx);
-		  if((rnaStruct != NULL) && !strcmp(rnaStruct->GetFilename(), ctPath)) {
-	               return sidx;
+	     // Return the lowest index among any structures sharing the name:
+	     int firstIdx = -1;
+	     auto nameRange = m_filenameIndex.equal_range(std::string(ctPath));
+	     for(auto it = nameRange.first; it != nameRange.second; ++it) {
+	          if(firstIdx < 0 || it->second < firstIdx) {
+		       firstIdx = it->second;
 		  }
 	     }
-	     return -1;
+	     return firstIdx;
+	}
+
+	/* 
+	 * Check if a structure was already loaded from a file with this 
+	 * (base) file name: 
+	 */
+	inline bool StructureFilenameExists(const char *basename) {
+	     return basename != NULL && 
+		    m_exactFilenameCounts.find(std::string(basename)) != m_exactFilenameCounts.end();
 	}
 
 	/* 
@@ -93,22 +190,18 @@ class StructureManager
 	}
 
 	/* 
-	 * Check if a duplicate structure already exists in the folder: 
+	 * Check if a duplicate structure (with the same sequence and pairs) 
+	 * is already loaded. Only the structures in the same bucket of the 
+	 * structure index need a full compare: 
 	 */
-	inline bool DuplicateStructureExistsInFolder(RNAStructure *structToLoad) {
-	     if(structToLoad == NULL) {
-	          return false;
-	     }
-	     for(unsigned int fi = 0; fi < folders.size(); fi++) {
-	          for(int j = 0; j < folders[fi]->structCount; j++) {
-	               RNAStructure *compStruct = m_structures[folders[fi]->folderStructs[j]];
-		       if(compStruct != NULL && SequenceCompare(compStruct, structToLoad)) {
-	                    return true;
-		       }
-		  }
-	     }
-	     return false;
-	}
+	bool DuplicateStructureExistsInFolder(RNAStructure *structToLoad);
+
+	/* 
+	 * Moves a structure to its new bucket of the structure index once a 
+	 * deferred parse finds pairs other than those hashed by the first scan 
+	 * of its file (see RNAStructure::CompleteDeferredParse): 
+	 */
+	void ReindexStructurePairs(RNAStructure *structure, uint64_t prevPairListHash);
 
         /*
 	    Popup (or bring to front) a window displaying the file contents.
@@ -137,11 +230,6 @@ class StructureManager
             return folders;
         }
     
-        /*
-         Decrease the structCount of a folder by 1;
-         */
-        void DecreaseStructCount(const int index);
-    
         /*
          Function for testing purposes.
          */
@@ -153,18 +241,63 @@ class StructureManager
          Initializes folders and m_structures on the first occurance
          */
         int AddFirstEmpty(RNAStructure* structure, bool excludeDuplicateStructs = false);
+
+        // Inserts the structures parsed from a file into folders (and prompts 
+        // for new folder names unless guiQuiet is set). The later chunks from 
+        // a sampling job set continuesFile, since structures were already 
+        // loaded under the same file name:
+        void InsertParsedStructures(ParsedStructureFile_t &parsedFile, 
+			            bool removeDuplicateStructs, bool guiQuiet, 
+				    bool continuesFile = false);
+
+        // The running Boltzmann sampling jobs, which are polled from an 
+        // FLTK timeout on the main thread:
+        typedef struct {
+             BoltzmannSamplingJob_t *samplingJob;
+             LoadProgressWindow *progressWindow;
+             bool removeDuplicateStructs;
+             bool guiQuiet;
+             bool haveInsertedStructs;
+        } ActiveSamplingJob_t;
+        std::vector<ActiveSamplingJob_t> m_samplingJobs;
+        bool m_samplingTimerActive;
+
+        static void SamplingJobTimerCallback(void *smPtr);
+        void PollSamplingJobs();
+        int FindSamplingJob(const BoltzmannSamplingJob_t *samplingJob) const;
+        void FinishSamplingJob(BoltzmannSamplingJob_t *samplingJob);
     
         // Creates a new folder for that structure
-        void AddFolder(RNAStructure* structure, const int index);
+        void AddFolder(RNAStructure* structure, const StructureHandle_t &handle);
     
-        // The allocated size of m_structures
-        int m_structureCount;
-
-        // A non-packed array of pointers to structures. Can have 0 entries.
-        RNAStructure** m_structures;
+        // The loaded structures, indexed by slot (the slots of removed 
+        // structures are reused by later ones).
+        StructureSlotMap_t m_structures;
     
         // Vector of folders
         std::vector<Folder*> folders;
+
+        // Hash indexes over the live entries of m_structures, keyed by 
+        // GetFilename(), by GetFilename(true) (with a count of the structures 
+        // loaded from each file), by the sequence fingerprint and by the 
+        // sequence fingerprint combined with the pair hash. 
+        // These are kept current by AddFirstEmpty and RemoveStructure:
+        std::unordered_multimap<std::string, int> m_filenameIndex;
+        std::unordered_map<std::string, int> m_exactFilenameCounts;
+        std::unordered_multimap<uint64_t, int> m_sequenceIndex;
+        std::unordered_multimap<uint64_t, int> m_structureIndex;
+
+        // Maps the sequence fingerprint of each folder to the folder (kept 
+        // current by AddFolder and RemoveFolder). The folders are stored by 
+        // pointer, and each one keeps its own index into folders:
+        std::unordered_multimap<uint64_t, Folder*> m_folderFingerprintIndex;
+
+        void IndexStructure(RNAStructure *structure, const int index);
+        void UnindexStructure(RNAStructure *structure, const int index);
+        static uint64_t SequenceFingerprint(RNAStructure *structure);
+        static uint64_t StructureFingerprint(RNAStructure *structure);
+        static uint64_t StructureFingerprint(RNAStructure *structure, uint64_t pairListHash);
+        RNAStructure* GetFolderRepresentative(Folder *folder);
     
 	// Keep track of the InputWindow used to fetch input folder name input from the user:
 	InputWindow *m_inputWindow;
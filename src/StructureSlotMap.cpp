@@ -0,0 +1,70 @@
+/* StructureSlotMap.cpp : Implementation of the generational slot map;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.18
+ */
+
+#include "StructureSlotMap.h"
+
+const StructureHandle_t STRUCTURE_HANDLE_NONE = { SLOTMAP_NO_SLOT, 0 };
+
+StructureHandle_t StructureSlotMap_t::Insert(RNAStructure *rnaStruct) {
+     if(rnaStruct == NULL) {
+          return STRUCTURE_HANDLE_NONE;
+     }
+     int slotIndex;
+     if(!freeSlots.empty()) {
+          slotIndex = freeSlots.back();
+          freeSlots.pop_back();
+     }
+     else {
+          Slot_t emptySlot = { NULL, 0, SLOTMAP_NO_SLOT };
+          slots.push_back(emptySlot);
+          slotIndex = slots.size() - 1;
+     }
+     Slot_t &slot = slots[slotIndex];
+     slot.rnaStruct = rnaStruct;
+     slot.densePos = liveSlots.size();
+     liveSlots.push_back(slotIndex);
+     StructureHandle_t handle = { slotIndex, slot.generation };
+     return handle;
+}
+
+RNAStructure * StructureSlotMap_t::Remove(const StructureHandle_t &handle) {
+     if(Get(handle) == NULL) {
+          return NULL;
+     }
+     return RemoveAt(handle.slotIndex);
+}
+
+RNAStructure * StructureSlotMap_t::RemoveAt(int slotIndex) {
+     if(GetAt(slotIndex) == NULL) {
+          return NULL;
+     }
+     Slot_t &slot = slots[slotIndex];
+     RNAStructure *rnaStruct = slot.rnaStruct;
+     int lastLiveSlot = liveSlots.back();
+     liveSlots[slot.densePos] = lastLiveSlot;
+     slots[lastLiveSlot].densePos = slot.densePos;
+     liveSlots.pop_back();
+     slot.rnaStruct = NULL;
+     slot.densePos = SLOTMAP_NO_SLOT;
+     slot.generation++;
+     freeSlots.push_back(slotIndex);
+     return rnaStruct;
+}
+
+RNAStructure * StructureSlotMap_t::Get(const StructureHandle_t &handle) const {
+     if(handle.slotIndex < 0 || handle.slotIndex >= (int) slots.size()) {
+          return NULL;
+     }
+     const Slot_t &slot = slots[handle.slotIndex];
+     return slot.generation == handle.generation ? slot.rnaStruct : NULL;
+}
+
+StructureHandle_t StructureSlotMap_t::GetHandleAt(int slotIndex) const {
+     if(GetAt(slotIndex) == NULL) {
+          return STRUCTURE_HANDLE_NONE;
+     }
+     StructureHandle_t handle = { slotIndex, slots[slotIndex].generation };
+     return handle;
+}
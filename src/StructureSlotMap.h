@@ -0,0 +1,97 @@
+/* StructureSlotMap.h : A generational slot map holding the loaded structures,
+ *                      which hands out stable handles that can be checked
+ *                      for staleness after the structure is removed;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.18
+ */
+
+#ifndef __STRUCTURE_SLOT_MAP_H__
+#define __STRUCTURE_SLOT_MAP_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <vector>
+
+class RNAStructure;
+
+#define SLOTMAP_NO_SLOT              (-1)
+
+/* A handle names a slot together with the generation of the slot at the
+ * time the structure was inserted. Removing a structure bumps the
+ * generation of its slot, so handles to it are detectably stale even after
+ * the slot is reused:
+ */
+typedef struct StructureHandle_t {
+     int slotIndex;
+     uint32_t generation;
+
+     inline bool IsNone() const {
+          return slotIndex == SLOTMAP_NO_SLOT;
+     }
+
+     inline bool operator==(const struct StructureHandle_t &rhs) const {
+          return slotIndex == rhs.slotIndex && generation == rhs.generation;
+     }
+
+     inline bool operator!=(const struct StructureHandle_t &rhs) const {
+          return !(*this == rhs);
+     }
+
+} StructureHandle_t;
+
+extern const StructureHandle_t STRUCTURE_HANDLE_NONE;
+
+class StructureSlotMap_t {
+
+     public:
+          StructureSlotMap_t() {}
+
+          /* Insertion and removal are O(1): freed slots are reused in LIFO
+           * order and the live slots are kept packed in a dense array
+           * (removal swaps the last live slot into the hole):
+           */
+          StructureHandle_t Insert(RNAStructure *rnaStruct);
+          RNAStructure * Remove(const StructureHandle_t &handle);
+          RNAStructure * RemoveAt(int slotIndex);
+
+          /* Returns NULL for a stale handle or an empty slot: */
+          RNAStructure * Get(const StructureHandle_t &handle) const;
+
+          inline RNAStructure * GetAt(int slotIndex) const {
+               if(slotIndex < 0 || slotIndex >= (int) slots.size()) {
+                    return NULL;
+               }
+               return slots[slotIndex].rnaStruct;
+          }
+
+          StructureHandle_t GetHandleAt(int slotIndex) const;
+
+          /* The number of slots ever allocated (some may be empty): */
+          inline int GetSlotCount() const {
+               return slots.size();
+          }
+
+          inline int GetLiveCount() const {
+               return liveSlots.size();
+          }
+
+          /* The slot indices of the live structures in no particular order: */
+          inline const std::vector<int> & GetLiveSlots() const {
+               return liveSlots;
+          }
+
+     private:
+          typedef struct {
+               RNAStructure *rnaStruct;
+               uint32_t generation;
+               int densePos;     // position in liveSlots, or SLOTMAP_NO_SLOT when empty
+          } Slot_t;
+
+          std::vector<Slot_t> slots;
+          std::vector<int> freeSlots;
+          std::vector<int> liveSlots;
+
+};
+
+#endif
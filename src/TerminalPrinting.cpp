@@ -8,6 +8,8 @@
 #include <stdarg.h>
 #include <locale.h>
 
+#include <mutex>
+
 #include "ConfigOptions.h"
 #include "ConfigExterns.h"
 #include "TerminalPrinting.h"
@@ -29,7 +31,13 @@ wchar_t TerminalText::GetUnicodeIconString(UnicodeTerminalChars::UnicodeSymbolTy
      return UnicodeTerminalChars::UNICODE_SYMBOL_LOOKUP[iconType][ TerminalText::SelectUnicodeIconIndex(iconType, randomize) ];
 }
 
+/* The messages may be printed from the background parsing and sampling
+ * threads, so each one is written out whole under this lock:
+ */
+static std::mutex terminalPrintMutex;
+
 void TerminalText::PrintNoColor(const char *msgFmt, ...) {
+     std::lock_guard<std::mutex> printLock(terminalPrintMutex);
      va_list argLst;
      va_start(argLst, msgFmt);
      vfprintf(PRINTFP, msgFmt, argLst);
@@ -42,18 +50,20 @@ void TerminalText::PrintANSITerminalMessage(const char *prefixText,
                         ANSIColor::ANSIColorCode msgTextColor, 
                         bool randomizeUnicodeIdx, const char *msgFmt, 
                         va_list printArgs) {
+     std::lock_guard<std::mutex> printLock(terminalPrintMutex);
      if(!PRINT_ANSI_COLOR) {
-          TerminalText::PrintNoColor(msgFmt, printArgs);
+          vfprintf(PRINTFP, msgFmt, printArgs);
           return;
      }
      wchar_t unicodeLeadingIcon = PRINT_TERMINAL_UNICODE ? 
                                   TerminalText::GetUnicodeIconString(iconType, randomizeUnicodeIdx) : 0x00;
-     setlocale(LC_CTYPE, "UTF-8");
+     // (the locale is not switched to print the wide character icon since
+     //  setlocale is process wide and other threads may be running):
      fprintf(PRINTFP, "%s%s", prefixColor, ANSIColor::BOLD);
      //fwprintf(PRINTFP, L" %lc ", unicodeLeadingIcon != 0x00 ? unicodeLeadingIcon : L' ');
      //fflush(PRINTFP);
      //freopen(NULL, "w", PRINTFP);
-     setlocale(LC_CTYPE, "");
+     (void) unicodeLeadingIcon;
      fprintf(PRINTFP, "%s%s:%s ", ANSIColor::UNDERLINE, prefixText, ANSIColor::END);
      fprintf(PRINTFP, "%s%s", msgTextColor, ANSIColor::ITALIC);
      vfprintf(PRINTFP, msgFmt, printArgs);
@@ -0,0 +1,229 @@
+/* TreeEditDistance.cpp : Implementation of the tree encodings and distances;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.16
+ */
+
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+#include "TreeEditDistance.h"
+
+namespace TreeEditDistance {
+
+     OrderedTree_t OrderedTree_t::FromPairTable(const std::vector<int> &pairTable) {
+          // Nodes are emitted in post-order as the pairs close, so the leftmost
+          // leaf of the subtree under a pair is the first node emitted after
+          // its 5' base was seen:
+          OrderedTree_t tree;
+          int seqLength = pairTable.size();
+          tree.labels.reserve(seqLength + 1);
+          tree.weights.reserve(seqLength + 1);
+          tree.leftmostLeaves.reserve(seqLength + 1);
+          std::vector<int> openStack, openFirstNode;
+          for(int pos = 0; pos < seqLength; pos++) {
+               int partner = pairTable[pos];
+               bool validPair = partner >= 0 && partner < seqLength && partner != pos &&
+                                pairTable[partner] == pos;
+               if(validPair && partner > pos) {
+                    openStack.push_back(pos);
+                    openFirstNode.push_back(tree.labels.size());
+                    continue;
+               }
+               else if(validPair && !openStack.empty() && openStack.back() == partner) {
+                    int firstNode = openFirstNode.back();
+                    openStack.pop_back();
+                    openFirstNode.pop_back();
+                    int nodeIdx = tree.labels.size();
+                    tree.labels.push_back(TED_FULL_PAIR_LABEL);
+                    tree.weights.push_back(2);
+                    tree.leftmostLeaves.push_back(firstNode < nodeIdx ?
+                                                  tree.leftmostLeaves[firstNode] : nodeIdx);
+                    continue;
+               }
+               int nodeIdx = tree.labels.size();
+               tree.labels.push_back(TED_FULL_UNPAIRED_LABEL);
+               tree.weights.push_back(1);
+               tree.leftmostLeaves.push_back(nodeIdx);
+          }
+          // Any pairs left open cross a later pair (the callers pass the nested
+          // pairs, so this only happens for knotted tables). Their 5' bases are
+          // appended to the end of the forest as unpaired leaves:
+          while(!openStack.empty()) {
+               int nodeIdx = tree.labels.size();
+               tree.labels.push_back(TED_FULL_UNPAIRED_LABEL);
+               tree.weights.push_back(1);
+               tree.leftmostLeaves.push_back(nodeIdx);
+               openStack.pop_back();
+          }
+          int rootIdx = tree.labels.size();
+          tree.labels.push_back(TED_FULL_ROOT_LABEL);
+          tree.weights.push_back(0);
+          tree.leftmostLeaves.push_back(rootIdx > 0 ? tree.leftmostLeaves[0] : 0);
+          tree.ComputeKeyroots();
+          return tree;
+     }
+
+     OrderedTree_t OrderedTree_t::FromElementTree(const StructureElementTree_t &elementTree) {
+          OrderedTree_t tree;
+          int numNodes = elementTree.GetNodeCount();
+          tree.labels.resize(numNodes);
+          tree.weights.resize(numNodes);
+          tree.leftmostLeaves.resize(numNodes);
+          for(int n = 0; n < numNodes; n++) {
+               const StructureElementTree_t::ElementNode_t &enode = elementTree.GetNode(n);
+               tree.labels[n] = enode.elementType;
+               tree.weights[n] = enode.length;
+               tree.leftmostLeaves[n] = (enode.firstChild == ELEMENT_NONE) ? n :
+                                        tree.leftmostLeaves[enode.firstChild];
+          }
+          tree.ComputeKeyroots();
+          return tree;
+     }
+
+     void OrderedTree_t::ComputeKeyroots() {
+          // The keyroots are the highest numbered nodes with each leftmost leaf:
+          int numNodes = labels.size();
+          std::vector<bool> leafSeen(numNodes, false);
+          keyroots.clear();
+          for(int n = numNodes - 1; n >= 0; n--) {
+               if(!leafSeen[leftmostLeaves[n]]) {
+                    leafSeen[leftmostLeaves[n]] = true;
+                    keyroots.push_back(n);
+               }
+          }
+          std::reverse(keyroots.begin(), keyroots.end());
+     }
+
+     static inline int RelabelCost(const OrderedTree_t &t1, int n1,
+                                   const OrderedTree_t &t2, int n2) {
+          if(t1.labels[n1] == t2.labels[n2]) {
+               return abs(t1.weights[n1] - t2.weights[n2]);
+          }
+          return t1.weights[n1] + t2.weights[n2];
+     }
+
+     size_t GetDPTableCells(const OrderedTree_t &tree1, const OrderedTree_t &tree2) {
+          size_t n1 = tree1.GetNodeCount(), n2 = tree2.GetNodeCount();
+          if(n1 == 0 || n2 == 0) {
+               return 0;
+          }
+          return n1 * n2 + (n1 + 1) * (n2 + 1);
+     }
+
+     int ComputeDistance(const OrderedTree_t &tree1, const OrderedTree_t &tree2) {
+          int n1 = tree1.GetNodeCount(), n2 = tree2.GetNodeCount();
+          if(n1 == 0 || n2 == 0) {
+               int distance = 0;
+               for(int n = 0; n < n1; n++) distance += tree1.weights[n];
+               for(int n = 0; n < n2; n++) distance += tree2.weights[n];
+               return distance;
+          }
+          else if(GetDPTableCells(tree1, tree2) > TED_MAX_DP_TABLE_CELLS) {
+               return TED_DISTANCE_UNDEFINED;
+          }
+          std::vector<int> treeDist((size_t) n1 * n2, 0);
+          std::vector<int> forestDist((size_t) (n1 + 1) * (n2 + 1), 0);
+          const int *l1 = tree1.leftmostLeaves.data(), *l2 = tree2.leftmostLeaves.data();
+          const int *w1 = tree1.weights.data(), *w2 = tree2.weights.data();
+
+          for(unsigned int k1 = 0; k1 < tree1.keyroots.size(); k1++) {
+               int i = tree1.keyroots[k1], li = l1[i];
+               int rows = i - li + 2;
+               for(unsigned int k2 = 0; k2 < tree2.keyroots.size(); k2++) {
+                    int j = tree2.keyroots[k2], lj = l2[j];
+                    int cols = j - lj + 2;
+                    // forestDist is reused as a rows x cols table for each keyroot pair:
+                    int *fd = forestDist.data();
+                    fd[0] = 0;
+                    for(int di = 1; di < rows; di++) {
+                         fd[di * cols] = fd[(di - 1) * cols] + w1[li + di - 1];
+                    }
+                    for(int dj = 1; dj < cols; dj++) {
+                         fd[dj] = fd[dj - 1] + w2[lj + dj - 1];
+                    }
+                    for(int di = 1; di < rows; di++) {
+                         int x = li + di - 1;
+                         int *fdRow = fd + di * cols, *fdPrevRow = fd + (di - 1) * cols;
+                         for(int dj = 1; dj < cols; dj++) {
+                              int y = lj + dj - 1;
+                              int delCost = fdPrevRow[dj] + w1[x];
+                              int insCost = fdRow[dj - 1] + w2[y];
+                              int bestCost = std::min(delCost, insCost);
+                              if(l1[x] == li && l2[y] == lj) {
+                                   int subCost = fdPrevRow[dj - 1] + RelabelCost(tree1, x, tree2, y);
+                                   bestCost = std::min(bestCost, subCost);
+                                   treeDist[(size_t) x * n2 + y] = bestCost;
+                              }
+                              else {
+                                   int p = l1[x] - li, q = l2[y] - lj;
+                                   int subCost = fd[p * cols + q] + treeDist[(size_t) x * n2 + y];
+                                   bestCost = std::min(bestCost, subCost);
+                              }
+                              fdRow[dj] = bestCost;
+                         }
+                    }
+               }
+          }
+          return treeDist[(size_t) (n1 - 1) * n2 + (n2 - 1)];
+     }
+
+     void ComputeDistancesParallel(const OrderedTree_t &refTree,
+		                   const std::vector<const OrderedTree_t *> &cmpTrees,
+		                   std::vector<int> &distances, int numThreads,
+				   DistanceProgressFunc_t progressFunc, void *progressData) {
+          int numTrees = cmpTrees.size();
+          distances.assign(numTrees, TED_DISTANCE_UNDEFINED);
+          if(numThreads <= 0) {
+               numThreads = std::max(1, (int) std::thread::hardware_concurrency());
+          }
+          numThreads = std::min(numThreads, numTrees);
+          // The DP table cells in use by the running computations, which the
+          // workers reserve before they start one (and wait for otherwise):
+          std::mutex stateMutex;
+          std::condition_variable cellsReleased, treeFinished;
+          size_t cellsInUse = 0;
+          std::atomic<int> nextTreeIdx(0), numDone(0);
+          auto distanceWorker = [&]() {
+               int treeIdx;
+               while((treeIdx = nextTreeIdx.fetch_add(1)) < numTrees) {
+                    size_t treeCells = cmpTrees[treeIdx] == NULL ? 0 :
+                                       GetDPTableCells(refTree, *(cmpTrees[treeIdx]));
+                    if(cmpTrees[treeIdx] != NULL && treeCells <= TED_MAX_DP_TABLE_CELLS) {
+                         {
+                              std::unique_lock<std::mutex> stateLock(stateMutex);
+                              cellsReleased.wait(stateLock, [&]() {
+                                   return cellsInUse + treeCells <= TED_MAX_DP_TABLE_CELLS;
+                              });
+                              cellsInUse += treeCells;
+                         }
+                         distances[treeIdx] = ComputeDistance(refTree, *(cmpTrees[treeIdx]));
+                         std::lock_guard<std::mutex> stateLock(stateMutex);
+                         cellsInUse -= treeCells;
+                    }
+                    cellsReleased.notify_all();
+                    numDone++;
+                    treeFinished.notify_all();
+               }
+          };
+          std::vector<std::thread> workers;
+          for(int t = 0; numThreads > 1 && t < numThreads; t++) {
+               workers.push_back(std::thread(distanceWorker));
+          }
+          if(workers.empty()) {
+               distanceWorker();
+          }
+          while(progressFunc != NULL && numDone < numTrees) {
+               progressFunc(numDone, numTrees, progressData);
+               std::unique_lock<std::mutex> stateLock(stateMutex);
+               treeFinished.wait_for(stateLock, std::chrono::milliseconds(TED_PROGRESS_INTERVAL_MS));
+          }
+          for(unsigned int t = 0; t < workers.size(); t++) {
+               workers[t].join();
+          }
+     }
+
+}
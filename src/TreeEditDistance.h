@@ -0,0 +1,108 @@
+/* TreeEditDistance.h : Ordered tree encodings of secondary structures and the
+ *                      (Zhang-Shasha) tree edit distance between them, in the
+ *                      spirit of the full and coarse grained tree distances
+ *                      computed by the ViennaRNA RNAdistance utility;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.16
+ */
+
+#ifndef __TREE_EDIT_DISTANCE_H__
+#define __TREE_EDIT_DISTANCE_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "StructureElementTree.h"
+
+/* Upper bound on the total number of (int) cells in the DP tables of all of
+ * the distance computations running at once, i.e., 64 MiB no matter how many
+ * threads are used. The distance is not computed for a pair of trees whose
+ * two tables alone exceed it:
+ */
+#define TED_MAX_DP_TABLE_CELLS            (1 << 24)
+#define TED_DISTANCE_UNDEFINED            (-1)
+
+/* How often (in milliseconds) the progress function is called: */
+#define TED_PROGRESS_INTERVAL_MS          (50)
+
+namespace TreeEditDistance {
+
+     typedef enum {
+          TREE_FULL   = 0,
+          TREE_COARSE = 1,
+     } TreeEncoding_t;
+
+     /* Node labels for the full tree encoding (the coarse trees are labeled
+      * by the StructureElementTree_t::ElementType_t of each node):
+      */
+     #define TED_FULL_ROOT_LABEL          (0xf0)
+     #define TED_FULL_PAIR_LABEL          (0xf1)
+     #define TED_FULL_UNPAIRED_LABEL      (0xf2)
+
+     /* The nodes of an ordered tree in post-order, together with the index
+      * of the leftmost leaf of the subtree rooted at each node and the
+      * keyroots used by the Zhang-Shasha algorithm. Deleting or inserting a
+      * node costs its weight, and relabeling a node costs the difference in
+      * weights when the labels agree and the sum of the weights otherwise:
+      */
+     class OrderedTree_t {
+
+          public:
+               OrderedTree_t() {}
+
+               /* Full tree: each base pair is an internal node, each unpaired
+                * base is a leaf and the root joins the exterior loop.
+                * Only the nested pairs are considered (see
+                * StructureElementTree_t for how crossing pairs are handled):
+                */
+               static OrderedTree_t FromPairTable(const std::vector<int> &pairTable);
+
+               /* Coarse tree: one node per stem or loop weighted by the
+                * number of pairs, or unpaired bases, it contains:
+                */
+               static OrderedTree_t FromElementTree(const StructureElementTree_t &elementTree);
+
+               inline int GetNodeCount() const {
+                    return labels.size();
+               }
+
+               std::vector<uint8_t> labels;
+               std::vector<int> weights;
+               std::vector<int> leftmostLeaves;
+               std::vector<int> keyroots;
+
+          private:
+               void ComputeKeyroots();
+
+     };
+
+     /* The number of cells in the two DP tables for the pair of trees: */
+     size_t GetDPTableCells(const OrderedTree_t &tree1, const OrderedTree_t &tree2);
+
+     /* Returns the tree edit distance, or TED_DISTANCE_UNDEFINED if the DP
+      * tables would exceed TED_MAX_DP_TABLE_CELLS:
+      */
+     int ComputeDistance(const OrderedTree_t &tree1, const OrderedTree_t &tree2);
+
+     /* Called on the thread which started the computation with the number of
+      * distances computed so far: */
+     typedef void (*DistanceProgressFunc_t)(int numDone, int numTotal, void *udata);
+
+     /* Computes the distances from the reference tree to each of the others
+      * on a pool of worker threads (zero selects the hardware concurrency).
+      * The workers only start as many computations at once as fit into
+      * TED_MAX_DP_TABLE_CELLS. The calling thread waits for them, calling the
+      * progress function (if any) periodically. The trees must not be
+      * modified while this runs:
+      */
+     void ComputeDistancesParallel(const OrderedTree_t &refTree,
+		                   const std::vector<const OrderedTree_t *> &cmpTrees,
+		                   std::vector<int> &distances, int numThreads = 0,
+				   DistanceProgressFunc_t progressFunc = NULL,
+				   void *progressData = NULL);
+
+}
+
+#endif
@@ -3,60 +3,148 @@
  * Created: 2019.12.04
  */
 
+#include <stdio.h>
+#include <ctype.h>
+
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
 #include "ViennaBoltzmannSampling.h"
 #include "RNAStructure.h"
 #include "ConfigOptions.h"
 #include "TerminalPrinting.h"
+#include "CompressedInput.h"
 
 extern "C" {
+     #include <ViennaRNA/vrna_config.h>
      #include <ViennaRNA/utils/basic.h>
      #include <ViennaRNA/params/basic.h>
      #include <ViennaRNA/datastructures/basic.h>
      #include <ViennaRNA/utils/strings.h>
+     #include <ViennaRNA/utils/structures.h>
      #include <ViennaRNA/fold.h>
      #include <ViennaRNA/fold_compound.h>
      #include <ViennaRNA/gquad.h>
      #include <ViennaRNA/part_func.h>
      #include <ViennaRNA/boltzmann_sampling.h>
+     #include <ViennaRNA/mfe.h>
+     #include <ViennaRNA/centroid.h>
+     #include <ViennaRNA/MEA.h>
 }
 
-vector<string> ViennaBoltzmannSampling::ParseFASTAFileFromPath(const char *fastaFilePath) {
-     
-     FILE *fpFastaFile = fopen(fastaFilePath, "r");
+ViennaBoltzmannSampling::FASTARecordReader_t::FASTARecordReader_t(const char *fastaFilePath) : 
+     fpFastaFile(NULL), lineBuf(NULL), lineBufSize(0), nextRecordIdx(0) {
+     fpFastaFile = fastaFilePath != NULL ? CompressedInput::OpenInputFile(fastaFilePath, "r") : NULL;
      if(fpFastaFile == NULL) {
-          throw string(strerror(errno));
-     }
-     char lineBuf[MAX_SEQUENCE_SIZE + 1];
-     char commentsBuf[MAX_SEQUENCE_SIZE + 1], baseDataBuf[MAX_SEQUENCE_SIZE + 1];
-     commentsBuf[0] = baseDataBuf[0] = '\0';
-     while(true) {
-          char *lineReturn = fgets(lineBuf, MAX_SEQUENCE_SIZE, fpFastaFile);
-	  if(lineReturn == NULL && feof(fpFastaFile)) {
-               break;
-	  }
-	  else if(lineReturn == NULL) {
+          throw string(fastaFilePath != NULL ? strerror(errno) : "Invalid FASTA file path.");
+     }
+}
+
+ViennaBoltzmannSampling::FASTARecordReader_t::~FASTARecordReader_t() {
+     if(fpFastaFile != NULL) {
+          fclose(fpFastaFile);
+	  fpFastaFile = NULL;
+     }
+     Free(lineBuf);
+}
+
+const char * ViennaBoltzmannSampling::FASTARecordReader_t::ReadLine() {
+     ssize_t lineLength = getline(&lineBuf, &lineBufSize, fpFastaFile);
+     if(lineLength < 0) {
+          if(ferror(fpFastaFile)) {
 	       throw string(strerror(errno));
 	  }
-	  else if(lineBuf[0] == '\n') {
-	       continue;
+	  return NULL;
+     }
+     while(lineLength > 0 && (lineBuf[lineLength - 1] == '\n' || lineBuf[lineLength - 1] == '\r')) {
+          lineBuf[--lineLength] = '\0';
+     }
+     return lineBuf;
+}
+
+bool ViennaBoltzmannSampling::FASTARecordReader_t::NextRecord(FASTARecord_t &record) {
+     
+     record.commentLines = pendingHeader;
+     record.baseSeq.clear();
+     record.recordIndex = nextRecordIdx;
+     pendingHeader.clear();
+     bool haveRecordData = record.commentLines.length() > 0;
+     const char *nextLine;
+     while((nextLine = ReadLine()) != NULL) {
+          if(nextLine[0] == '>') {
+	       if(record.baseSeq.length() > 0) {
+	            // This header starts the next record:
+		    pendingHeader = string(nextLine);
+		    break;
+	       }
+	       record.commentLines += string(nextLine);
+	       haveRecordData = true;
 	  }
-	  int lineLength = strlen(lineBuf);
-	  if(lineBuf[lineLength - 1] == '\n') {
-               lineBuf[lineLength - 1] = '\0';
+	  else if(nextLine[0] != ';') {
+	       for(const char *lpos = nextLine; *lpos != '\0'; lpos++) {
+	            if(!isspace(*lpos)) {
+		         record.baseSeq.push_back(*lpos);
+		    }
+	       }
+	       haveRecordData = haveRecordData || record.baseSeq.length() > 0;
 	  }
-	  if(lineBuf[0] == '>') {
-               strcat(commentsBuf, lineBuf);
+     }
+     if(!haveRecordData) {
+          return false;
+     }
+     nextRecordIdx++;
+     return true;
+
+}
+
+unsigned int ViennaBoltzmannSampling::FASTARecordReader_t::CountRecords(const char *fastaFilePath) {
+     FASTARecordReader_t fastaReader(fastaFilePath);
+     unsigned int numRecords = 0;
+     bool inHeaderLines = false, haveRecord = false;
+     const char *nextLine;
+     while((nextLine = fastaReader.ReadLine()) != NULL) {
+          // Consecutive header lines belong to the same record:
+          if(nextLine[0] == '>' && !inHeaderLines) {
+	       numRecords++;
+	       haveRecord = true;
 	  }
-	  else {
-               strcpy(baseDataBuf, lineBuf);
-	       break;
+	  else if(nextLine[0] != '>' && nextLine[0] != ';' && !haveRecord) {
+	       // Sequence data before the first header is a record of its own 
+	       // (as in NextRecord), and blank lines are skipped:
+	       for(const char *lpos = nextLine; *lpos != '\0' && !haveRecord; lpos++) {
+	            haveRecord = !isspace(*lpos);
+	       }
+	       numRecords += haveRecord ? 1 : 0;
 	  }
+	  inHeaderLines = nextLine[0] == '>';
      }
-     fclose(fpFastaFile);
+     return numRecords;
+}
+
+string ViennaBoltzmannSampling::FASTARecordReader_t::GetRecordID(const FASTARecord_t &record) {
+     const string &header = record.commentLines;
+     size_t idStart = header.find_first_not_of("> \t");
+     if(idStart == string::npos) {
+          return string("");
+     }
+     size_t idEnd = header.find_first_of(" \t|>", idStart);
+     return header.substr(idStart, idEnd == string::npos ? string::npos : idEnd - idStart);
+}
 
+vector<string> ViennaBoltzmannSampling::ParseFASTAFileFromPath(const char *fastaFilePath) {
+     
+     FASTARecordReader_t fastaReader(fastaFilePath);
+     FASTARecord_t fastaRecord;
      vector<string> fastaDataResults;
-     fastaDataResults.push_back(commentsBuf);
-     fastaDataResults.push_back(baseDataBuf);
+     if(fastaReader.NextRecord(fastaRecord)) {
+          fastaDataResults.push_back(fastaRecord.commentLines);
+	  fastaDataResults.push_back(fastaRecord.baseSeq);
+     }
+     else {
+          fastaDataResults.push_back(string(""));
+	  fastaDataResults.push_back(string(""));
+     }
      return fastaDataResults;
 
 }
@@ -76,80 +164,321 @@ unsigned int ViennaBoltzmannSampling::CountVRNASampleSize(char **sampleDotDataAr
      return sampleCount;
 }
 
-char ** ViennaBoltzmannSampling::ComputeVRNABoltzmannSamples(vector<string> &fastaParseResults, 
-		                                             unsigned int sampleSize) {
+ViennaBoltzmannSampling::PartitionFunction_t::~PartitionFunction_t() {
+     if(vfc != NULL) {
+          vrna_fold_compound_free(vfc);
+	  vfc = NULL;
+     }
+}
+
+static void SetSamplingModelDetails(vrna_md_t *vmd) {
+     // Zero the padding too, since the model details are hashed bytewise:
+     memset(vmd, 0, sizeof(vrna_md_t));
+     vrna_md_set_default(vmd);
+     vmd->uniq_ML = 1;
+}
+
+/* The cache is never destroyed, since an abandoned sampling job can still 
+ * be folding (and then add its entry) while the program exits: */
+static std::mutex pfCacheLock;
+static std::vector<std::shared_ptr<ViennaBoltzmannSampling::PartitionFunction_t> > &pfCacheEntries = 
+     *(new std::vector<std::shared_ptr<ViennaBoltzmannSampling::PartitionFunction_t> >());
+
+std::shared_ptr<ViennaBoltzmannSampling::PartitionFunction_t> 
+     ViennaBoltzmannSampling::GetPartitionFunction(const string &baseSeq) {
      
-     if(!ViennaBoltzmannSampling::FASTAFileIsValid(fastaParseResults)) {
-          return NULL;
+     if(baseSeq.length() == 0) {
+          return std::shared_ptr<PartitionFunction_t>();
+     }
+     vrna_md_t vmd;
+     SetSamplingModelDetails(&vmd);
+     SequenceFingerprint_t seqFP = SequenceFingerprint::ComputeFingerprint(baseSeq.c_str(), 
+		                                                           baseSeq.length());
+     uint64_t modelDetailsHash = SequenceFingerprint::XXH64(&vmd, sizeof(vrna_md_t), 0);
+     {
+          std::lock_guard<std::mutex> cacheGuard(pfCacheLock);
+          for(size_t e = 0; e < pfCacheEntries.size(); e++) {
+               if(pfCacheEntries[e]->seqFingerprint == seqFP && 
+	          pfCacheEntries[e]->modelDetailsHash == modelDetailsHash && 
+		  pfCacheEntries[e]->baseSeq == baseSeq) {
+	            // Move the entry to the back (most recently used) end:
+	            std::shared_ptr<PartitionFunction_t> pfEntry = pfCacheEntries[e];
+		    pfCacheEntries.erase(pfCacheEntries.begin() + e);
+		    pfCacheEntries.push_back(pfEntry);
+		    return pfEntry;
+	       }
+	  }
+     }
+
+     // Fold outside of the cache lock, since vrna_pf takes O(N^3) time:
+     std::shared_ptr<PartitionFunction_t> pfEntry(new PartitionFunction_t());
+     pfEntry->baseSeq = baseSeq;
+     pfEntry->seqFingerprint = seqFP;
+     pfEntry->modelDetailsHash = modelDetailsHash;
+     pfEntry->vfc = vrna_fold_compound(baseSeq.c_str(), &vmd, VRNA_OPTION_DEFAULT | VRNA_OPTION_PF);
+     if(pfEntry->vfc == NULL) {
+          return std::shared_ptr<PartitionFunction_t>();
+     }
+     char *pfStructure = (char *) malloc((baseSeq.length() + 1) * sizeof(char));
+     pfEntry->ensembleEnergy = vrna_pf(pfEntry->vfc, pfStructure);
+     Free(pfStructure);
+
+     std::lock_guard<std::mutex> cacheGuard(pfCacheLock);
+     if(pfCacheEntries.size() >= VRNA_PF_CACHE_SIZE) {
+          pfCacheEntries.erase(pfCacheEntries.begin());
+     }
+     pfCacheEntries.push_back(pfEntry);
+     return pfEntry;
+
+}
+
+void ViennaBoltzmannSampling::ClearPartitionFunctionCache() {
+     std::lock_guard<std::mutex> cacheGuard(pfCacheLock);
+     pfCacheEntries.clear();
+}
+
+/* The workers only run in parallel when the random state is thread local, 
+ * and otherwise the blocks are drawn one after another on the calling thread: 
+ */
+bool ViennaBoltzmannSampling::VRNARandomStateIsThreadLocal() {
+     // Probed once (the initialization of the static is thread safe):
+     static const bool threadLocalState = []() {
+          unsigned short *workerState = NULL;
+          std::thread stateProbe([&workerState]() { workerState = xsubi; });
+	  stateProbe.join();
+	  return workerState != xsubi;
+     }();
+     return threadLocalState;
+}
+
+/* The backtracking workers share one fold compound, which is only safe when 
+ * vrna_pbacktrack reads the fold compound without modifying it. This was 
+ * checked for the RNAlib releases 2.4.14 through 2.6.x, where the sampling 
+ * keeps its state in memory local to the call and the only lazily filled 
+ * arrays (for the exterior loop) are created by the first backtrack. With 
+ * any other version the blocks are drawn one after another: 
+ */
+#if defined(VRNA_VERSION_MAJOR) && defined(VRNA_VERSION_MINOR) && defined(VRNA_VERSION_PATCH) && \
+    VRNA_VERSION_MAJOR == 2 && ((VRNA_VERSION_MINOR == 4 && VRNA_VERSION_PATCH >= 14) || \
+		                (VRNA_VERSION_MINOR >= 5 && VRNA_VERSION_MINOR <= 6))
+     #define VRNA_SHARED_PBACKTRACK_VERIFIED         (true)
+#else
+     #define VRNA_SHARED_PBACKTRACK_VERIFIED         (false)
+#endif
+
+static void SeedVRNARandomStream(uint64_t seed) {
+     seed = SequenceFingerprint::XXH64(&seed, sizeof(uint64_t), SEQFP_HIGH_SEED);
+     xsubi[0] = (unsigned short) (seed & 0xffff);
+     xsubi[1] = (unsigned short) ((seed >> 16) & 0xffff);
+     xsubi[2] = (unsigned short) ((seed >> 32) & 0xffff);
+}
+
+/* Draws the redundant samples with (global) indices in [rangeStart, rangeEnd) 
+ * into dotSampleData. Sample zero is drawn on the calling thread, so any of 
+ * the helper arrays that RNAlib fills on the first backtrack exist before the 
+ * workers start, and the rest are drawn in blocks starting from index one. 
+ * The caller must hold the accessLock of the partition function: 
+ */
+static void DrawRedundantSampleRange(ViennaBoltzmannSampling::PartitionFunction_t &pfEntry, 
+		                     uint64_t sampleSeed, unsigned int rangeStart, 
+				     unsigned int rangeEnd, char **dotSampleData) {
+     unsigned int firstBlockSample = rangeStart;
+     if(rangeStart == 0 && rangeEnd > 0) {
+          SeedVRNARandomStream(sampleSeed);
+	  dotSampleData[0] = vrna_pbacktrack(pfEntry.vfc);
+	  firstBlockSample = 1;
+     }
+     if(firstBlockSample >= rangeEnd) {
+          return;
+     }
+     int firstBlockIdx = (firstBlockSample - 1) / VRNA_SAMPLE_BLOCK_SIZE;
+     int numBlocks = (rangeEnd - 1 + VRNA_SAMPLE_BLOCK_SIZE - 1) / VRNA_SAMPLE_BLOCK_SIZE - firstBlockIdx;
+     std::atomic<int> nextBlockIdx(firstBlockIdx);
+     auto sampleWorker = [&]() {
+          int blockIdx;
+	  while((blockIdx = nextBlockIdx.fetch_add(1)) < firstBlockIdx + numBlocks) {
+	       SeedVRNARandomStream(sampleSeed + blockIdx + 1);
+	       int firstSample = 1 + blockIdx * VRNA_SAMPLE_BLOCK_SIZE;
+	       int lastSample = std::min(firstSample + VRNA_SAMPLE_BLOCK_SIZE, (int) rangeEnd);
+	       for(int s = std::max(firstSample, (int) firstBlockSample); s < lastSample; s++) {
+	            dotSampleData[s - rangeStart] = vrna_pbacktrack(pfEntry.vfc);
+	       }
+	  }
+     };
+     int numThreads = std::min(std::max(1, (int) std::thread::hardware_concurrency()), numBlocks);
+     if(numThreads <= 1 || !VRNA_SHARED_PBACKTRACK_VERIFIED || 
+        !ViennaBoltzmannSampling::VRNARandomStateIsThreadLocal()) {
+          sampleWorker();
      }
-     vrna_init_rand();
+     else {
+          std::vector<std::thread> workers;
+          for(int t = 0; t < numThreads; t++) {
+               workers.push_back(std::thread(sampleWorker));
+          }
+          for(int t = 0; t < numThreads; t++) {
+               workers[t].join();
+          }
+     }
+}
+
+ViennaBoltzmannSampling::SampleStream_t::SampleStream_t(std::shared_ptr<PartitionFunction_t> pf, 
+		                                        bool nonRedundant) : 
+     pfEntry(pf), nonRedundant(nonRedundant), sampleSeed(0), numDrawn(0), 
+     exhausted(!pf), nrMemory(NULL) {
+     if(pfEntry) {
+          sampleSeed = pfEntry->seqFingerprint.low ^ pfEntry->modelDetailsHash;
+     }
+}
+
+ViennaBoltzmannSampling::SampleStream_t::~SampleStream_t() {
+     if(nrMemory != NULL) {
+          vrna_pbacktrack_mem_free(nrMemory);
+	  nrMemory = NULL;
+     }
+}
+
+char ** ViennaBoltzmannSampling::SampleStream_t::DrawSamples(unsigned int numSamples) {
      
-     char *baseSeq = strdup(fastaParseResults[INDEX_BASESEQ_DATA].c_str());
-     vrna_md_t vmd; 
-     vrna_md_set_default(&vmd);
-     vmd.uniq_ML = 1;
-     vrna_fold_compound_t *vfc = vrna_fold_compound(baseSeq, &vmd, VRNA_OPTION_DEFAULT | VRNA_OPTION_PF);
-     vrna_pf(vfc, baseSeq);
-     char **dotSampleData = vrna_pbacktrack_num(vfc, sampleSize, VRNA_PBACKTRACK_NON_REDUNDANT);
-
-     vrna_mx_pf_free(vfc);
-     vrna_fold_compound_free(vfc);
-     Free(baseSeq);
+     if(exhausted || numSamples == 0) {
+          return NULL;
+     }
+     std::lock_guard<std::mutex> pfGuard(pfEntry->accessLock);
+     char **dotSampleData = NULL;
+     if(nonRedundant) {
+	  // Reseed for each chunk, since another stream may have drawn 
+	  // from the (possibly shared) random state in the meantime:
+	  SeedVRNARandomStream(sampleSeed + numDrawn);
+	  dotSampleData = vrna_pbacktrack_resume(pfEntry->vfc, numSamples, &nrMemory, 
+			                         VRNA_PBACKTRACK_NON_REDUNDANT);
+	  unsigned int chunkSize = CountVRNASampleSize(dotSampleData);
+	  exhausted = chunkSize < numSamples;
+	  numDrawn += chunkSize;
+	  return dotSampleData;
+     }
+     dotSampleData = (char **) malloc((numSamples + 1) * sizeof(char *));
+     for(unsigned int s = 0; s <= numSamples; s++) {
+          dotSampleData[s] = NULL;
+     }
+     DrawRedundantSampleRange(*pfEntry, sampleSeed, numDrawn, numDrawn + numSamples, dotSampleData);
+     numDrawn += numSamples;
+     // Compact the array in case any backtracks failed:
+     unsigned int numValid = 0;
+     for(unsigned int s = 0; s < numSamples; s++) {
+          if(dotSampleData[s] != NULL) {
+	       dotSampleData[numValid++] = dotSampleData[s];
+	  }
+     }
+     dotSampleData[numValid] = NULL;
      return dotSampleData;
 
 }
 
-vector<ViennaBoltzmannSampling::StructureData_t> ViennaBoltzmannSampling::GetBoltzmannSamples( 
-		const char *inputFastaFile, unsigned int sampleSize) {
+char ** ViennaBoltzmannSampling::ComputeVRNABoltzmannSamples(vector<string> &fastaParseResults, 
+		                                             unsigned int sampleSize, 
+							     bool nonRedundant) {
+     
+     if(!ViennaBoltzmannSampling::FASTAFileIsValid(fastaParseResults) || sampleSize == 0) {
+          return NULL;
+     }
+     std::shared_ptr<PartitionFunction_t> pfEntry = 
+	  GetPartitionFunction(fastaParseResults[INDEX_BASESEQ_DATA]);
+     if(!pfEntry) {
+          return NULL;
+     }
+     SampleStream_t sampleStream(pfEntry, nonRedundant);
+     return sampleStream.DrawSamples(sampleSize);
+
+}
+
+unsigned int ViennaBoltzmannSampling::GenerateStructuresFromSamples(const char *filePath, 
+		const std::shared_ptr<RNAStructure::SharedSequence_t> &sharedSeq, 
+		char **dotSampleData, unsigned int firstSampleIdx, 
+		vector<RNAStructure *> &structsOut, unsigned int recordIndex) {
      
-     if(inputFastaFile == NULL) {
-          throw string("Unable to get Boltzmann samples: Invalid FASTA file parameters.");
-     }
-     vector<string> fastaParseResults = ViennaBoltzmannSampling::ParseFASTAFileFromPath(inputFastaFile);
-     char **dotSampleData = ViennaBoltzmannSampling::ComputeVRNABoltzmannSamples(fastaParseResults, sampleSize);
-     unsigned int actualSampleSize = ViennaBoltzmannSampling::CountVRNASampleSize(dotSampleData);
-     if(sampleSize == 0) {
-          throw string("VRNA returned no samples.");
-     }
-     else if(actualSampleSize < sampleSize) {
-          TerminalText::PrintWarning("Actual computed sample size for \"%s\" is %d < %d\n", 
-			             inputFastaFile, actualSampleSize, sampleSize);
-     }
-     vector<ViennaBoltzmannSampling::StructureData_t> sdv;
-     ViennaBoltzmannSampling::StructureData_t sd;
-     sd.commentLines = fastaParseResults[INDEX_COMMENT_LINES];
-     sd.baseSeqData = fastaParseResults[INDEX_BASESEQ_DATA];
-     for(int s = 0; s < actualSampleSize; s++) {
-          sd.dotPairingData = string(dotSampleData[s]);
-	  sdv.push_back(sd);
+     unsigned int numSamples = CountVRNASampleSize(dotSampleData);
+     unsigned int numAdded = 0;
+     for(unsigned int s = 0; s < numSamples; s++) {
+          RNAStructure *rnaStruct = NULL;
+	  if(sharedSeq) {
+	       short *pairTable = vrna_ptable(dotSampleData[s]);
+	       rnaStruct = RNAStructure::CreateFromPairTable(filePath, sharedSeq, pairTable, 
+			                                     firstSampleIdx + s, recordIndex);
+	       Free(pairTable);
+	  }
+	  if(rnaStruct != NULL) {
+	       structsOut.push_back(rnaStruct);
+	       numAdded++;
+	  }
 	  Free(dotSampleData[s]);
      }
      Free(dotSampleData);
-     return sdv;
+     return numAdded;
 
 }
 
-RNAStructure ** ViennaBoltzmannSampling::GenerateStructuresFromSampleData(
-		const char *filePath, const vector<ViennaBoltzmannSampling::StructureData_t> &sdv) {
+unsigned int ViennaBoltzmannSampling::GeneratePredictedStructures(PartitionFunction_t &pfEntry, 
+		const char *filePath, const std::shared_ptr<RNAStructure::SharedSequence_t> &sharedSeq, 
+		vector<RNAStructure *> &structsOut, unsigned int recordIndex) {
      
-     if(sdv.size() == 0) {
-          return NULL;
+     if(!sharedSeq || pfEntry.vfc == NULL) {
+          return 0;
      }
-     RNAStructure **rnaStructsArr = (RNAStructure **) malloc(sdv.size() * sizeof(RNAStructure *));
-     for(unsigned int si = 0; si < sdv.size(); si++) {
-          RNAStructure *rnaStruct = RNAStructure::CreateFromDotBracketData(
-			                 filePath, sdv[si].baseSeqData.c_str(), 
-			                 sdv[si].dotPairingData.c_str(), si
-				    );
+     std::lock_guard<std::mutex> pfGuard(pfEntry.accessLock);
+     if(!pfEntry.havePredictions) {
+          // The centroid and MEA structures use the base pair probabilities 
+	  // which vrna_pf already filled in, so only the MFE needs more folding:
+	  char *mfeStructure = (char *) malloc((pfEntry.baseSeq.length() + 1) * sizeof(char));
+	  pfEntry.predictionScores[PREDICTION_MFE] = vrna_mfe(pfEntry.vfc, mfeStructure);
+	  pfEntry.predictionDotData[PREDICTION_MFE] = string(mfeStructure);
+	  Free(mfeStructure);
+	  double centroidDist = 0.0;
+	  char *centroidStructure = vrna_centroid(pfEntry.vfc, &centroidDist);
+	  pfEntry.predictionDotData[PREDICTION_CENTROID] = 
+	       centroidStructure != NULL ? string(centroidStructure) : string("");
+	  pfEntry.predictionScores[PREDICTION_CENTROID] = centroidDist;
+	  Free(centroidStructure);
+	  float meaValue = 0.0;
+	  char *meaStructure = vrna_MEA(pfEntry.vfc, VRNA_MEA_GAMMA, &meaValue);
+	  pfEntry.predictionDotData[PREDICTION_MEA] = 
+	       meaStructure != NULL ? string(meaStructure) : string("");
+	  pfEntry.predictionScores[PREDICTION_MEA] = meaValue;
+	  Free(meaStructure);
+	  pfEntry.havePredictions = true;
+     }
+
+     static const char *predictionNames[NUM_PREDICTION_TYPES] = { 
+	  "MFE", "Centroid", "MEA" 
+     };
+     static const char *predictionScoreFormats[NUM_PREDICTION_TYPES] = { 
+          "MFE structure (ViennaRNA): free energy %1.2f kcal/mol", 
+	  "Centroid structure (ViennaRNA): mean base pair distance %1.2f", 
+	  "MEA structure (ViennaRNA, gamma = %g): expected accuracy %1.2f"
+     };
+     unsigned int numAdded = 0;
+     for(int pt = 0; pt < NUM_PREDICTION_TYPES; pt++) {
+          if(pfEntry.predictionDotData[pt].length() == 0) {
+	       continue;
+	  }
+	  short *pairTable = vrna_ptable(pfEntry.predictionDotData[pt].c_str());
+	  RNAStructure *rnaStruct = RNAStructure::CreateFromPairTable(filePath, sharedSeq, pairTable, 
+			                                              -1, recordIndex, predictionNames[pt]);
+	  Free(pairTable);
 	  if(rnaStruct == NULL) {
-               for(int j = 0; j < si; j++) {
-	            Delete(rnaStructsArr[j], RNAStructure);
-	       }
-	       Free(rnaStructsArr);
-	       return NULL;
+	       continue;
+	  }
+	  char scoreComment[MAX_BUFFER_SIZE];
+	  if(pt == PREDICTION_MEA) {
+	       snprintf(scoreComment, MAX_BUFFER_SIZE, predictionScoreFormats[pt], 
+			(double) VRNA_MEA_GAMMA, pfEntry.predictionScores[pt]);
+	  }
+	  else {
+	       snprintf(scoreComment, MAX_BUFFER_SIZE, predictionScoreFormats[pt], 
+			pfEntry.predictionScores[pt]);
 	  }
-	  rnaStructsArr[si] = rnaStruct;
+	  rnaStruct->SetFileCommentLines(string(scoreComment), FILETYPE_FASTA_ONLY);
+	  structsOut.push_back(rnaStruct);
+	  numAdded++;
      }
-     return rnaStructsArr;
+     return numAdded;
 
 }
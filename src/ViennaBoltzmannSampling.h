@@ -13,12 +13,31 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <mutex>
 using namespace std;
 
 #include "RNAStructVizTypes.h"
+#include "RNAStructure.h"
+#include "SequenceFingerprint.h"
 
 #define DEFAULT_SAMPLE_SIZE             (16)
 
+/* The number of partition functions (fold compounds with their pf matrices 
+ * filled) kept in the cache, which take O(N^2) memory each: */
+#define VRNA_PF_CACHE_SIZE              (4)
+
+/* Redundant samples are drawn in blocks of this many structures, each with 
+ * its own random number stream seeded from the sequence and the block 
+ * index, so the samples do not depend on the number of worker threads: */
+#define VRNA_SAMPLE_BLOCK_SIZE          (128)
+
+/* The weight of the paired bases in the MEA structure (as in RNAfold --MEA): */
+#define VRNA_MEA_GAMMA                  (1.0)
+
+struct vrna_fc_s;
+struct vrna_pbacktrack_memory_s;
+
 namespace ViennaBoltzmannSampling {
 
      typedef enum {
@@ -27,23 +46,147 @@ namespace ViennaBoltzmannSampling {
 	  INDEX_DOTBRACKET_DATA  = 2,
      } StructureDataIndex_t;
 
+     /* One record of a (multi-record) FASTA file. The header lines are kept 
+      * as in the file, and the sequence lines are joined without whitespace: 
+      */
+     typedef struct {
+          string commentLines;
+	  string baseSeq;
+	  unsigned int recordIndex;
+     } FASTARecord_t;
+
+     /* Reads the records of a FASTA file one at a time, so only the current 
+      * record is held in memory. Lines of any length are supported: 
+      */
+     class FASTARecordReader_t {
+          public:
+	       FASTARecordReader_t(const char *fastaFilePath);   // throws string on error
+	       ~FASTARecordReader_t();
+
+	       /* Returns false once there are no more records: */
+	       bool NextRecord(FASTARecord_t &record);
+
+	       /* The number of records in the file, which are started by the header 
+	        * lines (or by the sequence data before the first header). This is 
+		* zero when the file has neither: */
+	       static unsigned int CountRecords(const char *fastaFilePath);
+
+	       /* The record ID (first word of the header line, without the '>'): */
+	       static string GetRecordID(const FASTARecord_t &record);
+
+	  private:
+	       FILE *fpFastaFile;
+	       char *lineBuf;
+	       size_t lineBufSize;
+	       string pendingHeader;
+	       unsigned int nextRecordIdx;
+
+	       // Reads the next line without its line ending (NULL at EOF):
+	       const char * ReadLine();
+     };
+
+     /* The comment lines and the sequence of the first record in the file: */
      vector<string> ParseFASTAFileFromPath(const char *fastaFilePath);
      bool FASTAFileIsValid(const vector<string> &parseResults);
 
-     typedef struct {
-          string commentLines;
-	  string baseSeqData;
-	  string dotPairingData;
-     } StructureData_t;
+     /* The reference-free predictions computed from the fold compound: */
+     typedef enum {
+          PREDICTION_MFE         = 0, 
+	  PREDICTION_CENTROID    = 1, 
+	  PREDICTION_MEA         = 2, 
+	  NUM_PREDICTION_TYPES   = 3, 
+     } PredictionType_t;
+
+     /* A fold compound for one sequence and set of model details with its 
+      * partition function computed. Anything that modifies the fold compound 
+      * (non-redundant sampling, MFE) must hold the accessLock, which also 
+      * guards the cached predictions: 
+      */
+     typedef struct PartitionFunction_t {
+          struct vrna_fc_s *vfc;
+	  string baseSeq;
+	  SequenceFingerprint_t seqFingerprint;
+	  uint64_t modelDetailsHash;
+	  double ensembleEnergy;
+	  std::mutex accessLock;
+
+	  bool havePredictions;
+	  string predictionDotData[NUM_PREDICTION_TYPES];
+	  double predictionScores[NUM_PREDICTION_TYPES];
+
+	  PartitionFunction_t() : vfc(NULL), modelDetailsHash(0), ensembleEnergy(0.0), 
+	                          havePredictions(false) {}
+	  ~PartitionFunction_t();
+     } PartitionFunction_t;
+
+     /* Returns the cached partition function for the sequence (with the 
+      * default model details used for sampling), computing it first if 
+      * needed. Returns an empty pointer if the sequence cannot be folded: 
+      */
+     std::shared_ptr<PartitionFunction_t> GetPartitionFunction(const string &baseSeq);
+     void ClearPartitionFunctionCache();
+
+     /* Draws the samples for one partition function a chunk at a time 
+      * (for the background sampling jobs). Redundant chunks that start on 
+      * a block boundary give the same samples as one larger draw, and the 
+      * non-redundant chunks resume from the structures drawn so far, so 
+      * no structure is repeated across the chunks: 
+      */
+     typedef struct SampleStream_t {
+          std::shared_ptr<PartitionFunction_t> pfEntry;
+	  bool nonRedundant;
+	  uint64_t sampleSeed;
+	  unsigned int numDrawn;
+	  bool exhausted;
+	  struct vrna_pbacktrack_memory_s *nrMemory;
+
+	  SampleStream_t(std::shared_ptr<PartitionFunction_t> pf, bool nonRedundant);
+	  ~SampleStream_t();
+
+	  /* Returns a NULL terminated array of at most numSamples dot bracket 
+	   * strings (fewer once the non-redundant samples run out): */
+	  char ** DrawSamples(unsigned int numSamples);
+     } SampleStream_t;
 
      unsigned int CountVRNASampleSize(char **sampleDotDataArr);
+
+     /* RNAlib draws its random numbers with erand48 from the state in xsubi, 
+      * which is thread local when the library is built with OpenMP (the 
+      * default). Otherwise only one thread at a time may draw samples, or 
+      * the samples would depend on the thread timing: 
+      */
+     bool VRNARandomStateIsThreadLocal();
+
+     /* The non-redundant samples are drawn sequentially (in a fixed order 
+      * from a seed determined by the sequence), and otherwise the samples 
+      * are drawn in blocks by a pool of backtracking workers. Either way 
+      * the returned samples are the same on every run: 
+      */
      char ** ComputeVRNABoltzmannSamples(vector<string> &fastaParseResults, 
-		                         unsigned int sampleSize = DEFAULT_SAMPLE_SIZE);
-     vector<StructureData_t> GetBoltzmannSamples(const char *inputFastaFile, 
-		                                 unsigned int sampleSize = DEFAULT_SAMPLE_SIZE); 
+		                         unsigned int sampleSize = DEFAULT_SAMPLE_SIZE, 
+					 bool nonRedundant = true);
+
+     /* Computes the MFE, centroid and MEA structures of the sequence from 
+      * the fold compound (once per cached partition function) and appends 
+      * them to structsOut as structures named by the predictor, with their 
+      * energy (or distance / expected accuracy) in the comment lines. 
+      * Returns the number of structures added: 
+      */
+     unsigned int GeneratePredictedStructures(PartitionFunction_t &pfEntry, const char *filePath, 
+		          const std::shared_ptr<RNAStructure::SharedSequence_t> &sharedSeq, 
+			  vector<RNAStructure *> &structsOut, unsigned int recordIndex = 0);
 
-     RNAStructure ** GenerateStructuresFromSampleData(const char *filePath, 
-		                                      const vector<StructureData_t> &sdv);
+     /* Converts the samples to structures through their pair tables (the 
+      * structures share the sequence data), appending them to structsOut. 
+      * The sample strings and the array are freed. The first sample is 
+      * numbered firstSampleIdx in the structure names (with a record number 
+      * for records past the first in the file). Returns the number 
+      * of structures added: 
+      */
+     unsigned int GenerateStructuresFromSamples(const char *filePath, 
+		          const std::shared_ptr<RNAStructure::SharedSequence_t> &sharedSeq, 
+			  char **dotSampleData, unsigned int firstSampleIdx, 
+			  vector<RNAStructure *> &structsOut, unsigned int recordIndex = 0);
 
 }
 
@@ -0,0 +1,443 @@
+/* XMLExportWriter.cpp : Implementation of the streaming XML export writers;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2019.12.03
+ */
+
+#include <unistd.h>
+#include <strings.h>
+
+#include "XMLExportWriter.h"
+#include "RNAStructure.h"
+#include "RNAStructViz.h"
+#include "StructureManager.h"
+#include "FolderStructure.h"
+#include "TerminalPrinting.h"
+
+namespace XMLExport {
+
+int ExportStructureToXML(std::string outFilePath, XMLExportFormat_t xmlExportFmt,
+		         unsigned int dataIndex, unsigned int optionFlags) {
+     XMLExportWriter *xmlWriter = XMLExportWriter::GetXMLExportWriterByType(xmlExportFmt);
+     if(xmlWriter == NULL) {
+          return -1;
+     }
+     int exportStatus = xmlWriter->OpenFile(outFilePath, optionFlags);
+     if(exportStatus == 0) {
+          exportStatus = xmlWriter->WriteXMLFile(dataIndex, optionFlags);
+	  int closeStatus = xmlWriter->CloseFile();
+	  exportStatus = exportStatus != 0 ? exportStatus : closeStatus;
+     }
+     delete xmlWriter;
+     return exportStatus;
+}
+
+XMLOutputSink_t::XMLOutputSink_t() :
+     fpOutput(NULL), gzOutput(NULL), outputBuffer(XMLEXPORT_SINK_BUFSIZE),
+     bufferPos(0), writeError(false) {}
+
+XMLOutputSink_t::~XMLOutputSink_t() {
+     Close();
+}
+
+bool XMLOutputSink_t::Open(const char *outputPath, bool gzipOutput) {
+     Close();
+     writeError = false;
+     if(outputPath == NULL) {
+          return false;
+     }
+     if(gzipOutput) {
+          gzOutput = gzopen(outputPath, XMLEXPORT_GZIP_LEVEL);
+     }
+     else {
+          fpOutput = fopen(outputPath, "wb");
+     }
+     return IsOpen();
+}
+
+bool XMLOutputSink_t::Close() {
+     if(!IsOpen()) {
+          return false;
+     }
+     Flush();
+     if(gzOutput != NULL) {
+          writeError = (gzclose(gzOutput) != Z_OK) || writeError;
+	  gzOutput = NULL;
+     }
+     if(fpOutput != NULL) {
+          writeError = (fclose(fpOutput) != 0) || writeError;
+	  fpOutput = NULL;
+     }
+     return !writeError;
+}
+
+void XMLOutputSink_t::WriteThrough(const char *data, size_t dataLength) {
+     if(dataLength == 0 || writeError) {
+          return;
+     }
+     else if(gzOutput != NULL) {
+          writeError = gzwrite(gzOutput, data, dataLength) != (int) dataLength;
+     }
+     else if(fpOutput != NULL) {
+          writeError = fwrite(data, 1, dataLength, fpOutput) != dataLength;
+     }
+     else {
+          writeError = true;
+     }
+}
+
+bool XMLOutputSink_t::Flush() {
+     WriteThrough(outputBuffer.data(), bufferPos);
+     bufferPos = 0;
+     return !writeError;
+}
+
+void XMLOutputSink_t::WriteInt(long value) {
+     char intBuf[24];
+     int intLength = snprintf(intBuf, sizeof(intBuf), "%ld", value);
+     Write(intBuf, intLength);
+}
+
+void XMLOutputSink_t::WriteFloat(double value) {
+     char floatBuf[32];
+     int floatLength = snprintf(floatBuf, sizeof(floatBuf), "%g", value);
+     Write(floatBuf, floatLength);
+}
+
+void XMLOutputSink_t::WriteIndent(int numSpaces) {
+     for(int sp = 0; sp < numSpaces; sp++) {
+          WriteChar(' ');
+     }
+}
+
+void XMLOutputSink_t::WriteEscaped(const char *text) {
+     if(text == NULL) {
+          return;
+     }
+     // Copy the runs of plain characters between the escaped ones at once:
+     const char *runStart = text;
+     for(const char *textPos = text; *textPos != '\0'; textPos++) {
+          const char *entityStr = NULL;
+	  switch(*textPos) {
+	       case '&':
+	            entityStr = "&amp;";
+		    break;
+	       case '<':
+	            entityStr = "&lt;";
+		    break;
+	       case '>':
+	            entityStr = "&gt;";
+		    break;
+	       case '"':
+	            entityStr = "&quot;";
+		    break;
+	       case '\'':
+	            entityStr = "&apos;";
+		    break;
+	       default:
+	            continue;
+	  }
+	  Write(runStart, textPos - runStart);
+	  Write(entityStr);
+	  runStart = textPos + 1;
+     }
+     Write(runStart);
+}
+
+XMLExportWriter::XMLExportWriter(XMLExportFormat_t xmlFmtType) :
+     outputFileOpen(false), xmlFormatType(xmlFmtType), exportOptions(0x00),
+     openTagDepth(0), droppedTagDepth(0), tagDepthExceeded(false),
+     startTagPending(false) {}
+
+XMLExportWriter::~XMLExportWriter() {
+     CloseFile();
+}
+
+int XMLExportWriter::OpenFile(std::string outputFile, unsigned int optionFlags) {
+     if(outputFileOpen) {
+          CloseFile();
+     }
+     const char *outputPath = outputFile.c_str();
+     if(!XMLExportOptionSet(optionFlags, XMLEXPORT_ALLOW_OVERWRITES) && !access(outputPath, F_OK)) {
+          TerminalText::PrintError("Will not overwrite the existing XML file \"%s\"\n", outputPath);
+	  return EEXIST;
+     }
+     size_t pathLength = outputFile.length(), extLength = strlen(XMLEXPORT_GZIP_FILEEXT);
+     bool gzipOutput = XMLExportOptionSet(optionFlags, XMLEXPORT_GZIP_OUTPUT) ||
+	               (pathLength > extLength &&
+			!strcasecmp(outputPath + pathLength - extLength, XMLEXPORT_GZIP_FILEEXT));
+     if(!outputSink.Open(outputPath, gzipOutput)) {
+          int openErrno = errno != 0 ? errno : EIO;
+          TerminalText::PrintError("Unable to open the XML file \"%s\" for writing: %s\n",
+			           outputPath, strerror(openErrno));
+	  return openErrno;
+     }
+     outputFileOpen = true;
+     exportOptions = optionFlags;
+     openTagDepth = droppedTagDepth = 0;
+     tagDepthExceeded = false;
+     startTagPending = false;
+     return 0;
+}
+
+int XMLExportWriter::CloseFile() {
+     if(!outputFileOpen) {
+          return 0;
+     }
+     while(openTagDepth > 0 || droppedTagDepth > 0) {
+          EndElement();
+     }
+     outputSink.Write(TAG_LINE_SPACING);
+     outputFileOpen = false;
+     if(!outputSink.Close()) {
+          return EIO;
+     }
+     return tagDepthExceeded ? EOVERFLOW : 0;
+}
+
+void XMLExportWriter::FinishStartTag() {
+     if(startTagPending) {
+          outputSink.WriteChar('>');
+	  startTagPending = false;
+     }
+}
+
+void XMLExportWriter::StartElement(const char *tagName) {
+     if(!outputFileOpen || tagName == NULL) {
+          return;
+     }
+     else if(droppedTagDepth > 0 || openTagDepth >= XMLEXPORT_MAX_TAG_DEPTH) {
+          if(!tagDepthExceeded) {
+               TerminalText::PrintError("Dropping the XML tags nested deeper than %d levels (at <%s>)\n",
+                                        XMLEXPORT_MAX_TAG_DEPTH, tagName);
+          }
+          tagDepthExceeded = true;
+          droppedTagDepth++;
+          return;
+     }
+     FinishStartTag();
+     if(openTagDepth > 0) {
+          openTagHasChildren[openTagDepth - 1] = true;
+     }
+     outputSink.Write(TAG_LINE_SPACING);
+     outputSink.WriteIndent(openTagDepth * LEVEL_INDENT);
+     outputSink.WriteChar('<');
+     outputSink.Write(tagName);
+     openTagNames[openTagDepth] = tagName;
+     openTagHasChildren[openTagDepth] = false;
+     openTagDepth++;
+     startTagPending = true;
+}
+
+void XMLExportWriter::WriteAttribute(const char *attrName, const char *attrValue) {
+     if(!startTagPending || droppedTagDepth > 0 || attrName == NULL) {
+          return;
+     }
+     outputSink.WriteChar(' ');
+     outputSink.Write(attrName);
+     outputSink.Write("=\"", 2);
+     outputSink.WriteEscaped(attrValue);
+     outputSink.WriteChar('"');
+}
+
+void XMLExportWriter::WriteAttribute(const char *attrName, long attrValue) {
+     if(!startTagPending || droppedTagDepth > 0 || attrName == NULL) {
+          return;
+     }
+     outputSink.WriteChar(' ');
+     outputSink.Write(attrName);
+     outputSink.Write("=\"", 2);
+     outputSink.WriteInt(attrValue);
+     outputSink.WriteChar('"');
+}
+
+void XMLExportWriter::WriteAttribute(const char *attrName, double attrValue) {
+     if(!startTagPending || droppedTagDepth > 0 || attrName == NULL) {
+          return;
+     }
+     outputSink.WriteChar(' ');
+     outputSink.Write(attrName);
+     outputSink.Write("=\"", 2);
+     outputSink.WriteFloat(attrValue);
+     outputSink.WriteChar('"');
+}
+
+void XMLExportWriter::WriteText(const char *textData) {
+     if(!outputFileOpen || openTagDepth == 0 || droppedTagDepth > 0) {
+          return;
+     }
+     FinishStartTag();
+     outputSink.WriteEscaped(textData);
+}
+
+void XMLExportWriter::EndElement() {
+     if(!outputFileOpen) {
+          return;
+     }
+     else if(droppedTagDepth > 0) {
+          droppedTagDepth--;
+          return;
+     }
+     else if(openTagDepth == 0) {
+          return;
+     }
+     openTagDepth--;
+     if(startTagPending) {
+          outputSink.Write("/>", 2);
+	  startTagPending = false;
+	  return;
+     }
+     if(openTagHasChildren[openTagDepth]) {
+          outputSink.Write(TAG_LINE_SPACING);
+	  outputSink.WriteIndent(openTagDepth * LEVEL_INDENT);
+     }
+     outputSink.Write("</", 2);
+     outputSink.Write(openTagNames[openTagDepth]);
+     outputSink.WriteChar('>');
+}
+
+int XMLExportWriter::WriteXMLHeaderData(int level) {
+     if(!outputFileOpen) {
+          return EBADF;
+     }
+     outputSink.WriteIndent(level * LEVEL_INDENT);
+     outputSink.Write(GLOBAL_META_TAG);
+     return 0;
+}
+
+int XMLExportWriter::WriteXMLTag(XMLDataElement_t tagData, int level, bool tagOpenStatus) {
+     // The tags are indented by their depth in the open tags instead:
+     (void) level;
+     if(!outputFileOpen) {
+          return EBADF;
+     }
+     else if(!tagOpenStatus) {
+          EndElement();
+	  return outputSink.HaveWriteError() ? EIO : 0;
+     }
+     StartElement(tagData.elementTagName);
+     for(unsigned int attr = 0; attr < tagData.mdataAttrCount; attr++) {
+          WriteAttribute(tagData.tagMetaAttrs[attr].attrName, tagData.tagMetaAttrs[attr].attrValue);
+     }
+     if(tagData.isSingletonTag) {
+          EndElement();
+     }
+     else if(droppedTagDepth > 0) {
+          return EOVERFLOW;
+     }
+     return outputSink.HaveWriteError() ? EIO : 0;
+}
+
+int XMLExportWriter::WriteXMLFooterData(int level) {
+     if(!outputFileOpen) {
+          return EBADF;
+     }
+     while(droppedTagDepth > 0 || openTagDepth > level) {
+          EndElement();
+     }
+     return outputSink.Flush() ? 0 : EIO;
+}
+
+int XMLExportWriter::WriteXMLComment(std::string commentField, bool multiLine) {
+     if(!outputFileOpen) {
+          return EBADF;
+     }
+     FinishStartTag();
+     if(openTagDepth > 0) {
+          openTagHasChildren[openTagDepth - 1] = true;
+     }
+     outputSink.Write(TAG_LINE_SPACING);
+     outputSink.WriteIndent(openTagDepth * LEVEL_INDENT);
+     outputSink.Write("<!-- ", 5);
+     if(multiLine) {
+          outputSink.Write(TAG_LINE_SPACING);
+     }
+     outputSink.Write(commentField.c_str(), commentField.length());
+     if(multiLine) {
+          outputSink.Write(TAG_LINE_SPACING);
+	  outputSink.WriteIndent(openTagDepth * LEVEL_INDENT);
+     }
+     outputSink.Write(" -->", 4);
+     return 0;
+}
+
+int XMLExportWriter::WriteXMLFile(unsigned int dataIndex, unsigned int optionFlags) {
+     (void) dataIndex;
+     (void) optionFlags;
+     TerminalText::PrintError("The XML export format #%d is not supported yet\n", xmlFormatType);
+     return ENOTSUP;
+}
+
+XMLExportWriter* XMLExportWriter::GetXMLExportWriterByType(XMLExportFormat_t xmldocFmtType) {
+     switch(xmldocFmtType) {
+          case XMLEXPORTFMT_RNASTRUCTVIZ:
+	       return new XMLExportWriter_RNAStructViz();
+	  case XMLEXPORTFMT_STRUCTURE_ONLY:
+	       return new XMLExportWriter_StructureOnly();
+	  case XMLEXPORTFMT_FULL_FOLDER:
+	       return new XMLExportWriter_FullSequenceFolder();
+	  default:
+	       return NULL;
+     }
+}
+
+int XMLExportWriter_FullSequenceFolder::WriteXMLFile(unsigned int dataIndex, unsigned int optionFlags) {
+     StructureManager *structManager = RNAStructViz::GetInstance()->GetStructureManager();
+     Folder *folder = structManager->GetFolderAt(dataIndex);
+     if(folder == NULL) {
+          return EINVAL;
+     }
+     std::vector<RNAStructure *> folderStructs;
+     structManager->GetFolderStructures(dataIndex, folderStructs);
+     return WriteFolder(folder->folderName, folderStructs, optionFlags);
+}
+
+int XMLExportWriter_FullSequenceFolder::WriteFolder(const char *folderName,
+		                                    const std::vector<RNAStructure *> &folderStructs,
+						    unsigned int optionFlags) {
+     if(!outputFileOpen) {
+          return EBADF;
+     }
+     else if(folderStructs.size() == 0) {
+          return EINVAL;
+     }
+     bool writePairs = XMLExportOptionSet(optionFlags, XMLEXPORT_STRUCTURE_FULL);
+     WriteXMLHeaderData(0);
+     StartElement("RNAStructVizFolder");
+     WriteAttribute("name", folderName != NULL ? folderName : "");
+     WriteAttribute("structureCount", (long) folderStructs.size());
+     WriteAttribute("sequenceLength", (long) folderStructs[0]->GetLength());
+     StartElement("Sequence");
+     WriteText(folderStructs[0]->GetSequenceString());
+     EndElement();
+     for(unsigned int sidx = 0; sidx < folderStructs.size(); sidx++) {
+          RNAStructure *rnaStruct = folderStructs[sidx];
+	  StartElement("Structure");
+	  WriteAttribute("index", (long) sidx);
+	  WriteAttribute("name", rnaStruct->GetFilename());
+	  WriteAttribute("length", (long) rnaStruct->GetLength());
+	  StartElement("DotBracket");
+	  WriteText(rnaStruct->GetDotBracketSequenceString());
+	  EndElement();
+	  if(writePairs) {
+	       StartElement("Pairs");
+	       for(unsigned int bidx = 0; bidx < rnaStruct->GetLength(); bidx++) {
+	            unsigned int pairIdx = rnaStruct->GetBaseAt(bidx)->m_pair;
+		    if(pairIdx == RNAStructure::UNPAIRED || pairIdx < bidx) {
+		         continue;
+		    }
+		    StartElement("Pair");
+		    WriteAttribute("i", (long) bidx + 1);
+		    WriteAttribute("j", (long) pairIdx + 1);
+		    EndElement();
+	       }
+	       EndElement();
+	  }
+	  EndElement();
+	  if(outputSink.HaveWriteError()) {
+	       return EIO;
+	  }
+     }
+     return WriteXMLFooterData(0);
+}
+
+}
@@ -0,0 +1,224 @@
+/* XMLExportWriter.h : Streaming writers for the XML export formats, which
+ *                     write the tags through a buffered (and optionally
+ *                     gzip compressed) output sink as they are generated;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2019.12.03
+ */
+
+#ifndef __XMLEXPORT_WRITER_H__
+#define __XMLEXPORT_WRITER_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+class RNAStructure;
+
+/* The size of the output buffer, and the deepest nesting of tags: */
+#define XMLEXPORT_SINK_BUFSIZE             (64 * 1024)
+#define XMLEXPORT_MAX_TAG_DEPTH            (32)
+
+/* The output is gzip compressed when the file name has this extension
+ * (or when the XMLEXPORT_GZIP_OUTPUT option is set): */
+#define XMLEXPORT_GZIP_FILEEXT             (".gz")
+#define XMLEXPORT_GZIP_LEVEL               ("wb6")
+
+namespace XMLExport {
+
+     typedef enum {
+	  XMLEXPORT_OPTIONS_NONE         = 0x00,
+          XMLEXPORT_STRUCTURE_FULL       = 0x01,
+	  XMLEXPORT_STRUCTURE_STANDARD   = 0x02,
+	  XMLEXPORT_STRUCTURE_MINIMAL    = 0x04,
+	  XMLEXPORT_VERBOSE              = 0x08,
+	  XMLEXPORT_ALLOW_OVERWRITES     = 0x10,
+	  XMLEXPORT_INCLUDE_EXPERIMENTAL = 0x20,
+	  XMLEXPORT_GZIP_OUTPUT          = 0x40,
+     } XMLExportOption_t;
+
+     inline bool XMLExportOptionSet(int optionSet, XMLExportOption_t optionFlag) {
+          return (optionSet & optionFlag) != 0;
+     }
+
+     typedef enum {
+          XMLEXPORTFMT_RNASTRUCTVIZ    = 0,
+	  XMLEXPORTFMT_STRUCTURE_ONLY  = 1,
+	  XMLEXPORTFMT_FULL_FOLDER     = 2,
+     } XMLExportFormat_t;
+
+     /* Writes the structure (or the folder for XMLEXPORTFMT_FULL_FOLDER)
+      * with the index to the file. Returns zero on success: */
+     int ExportStructureToXML(std::string outFilePath, XMLExportFormat_t xmlExportFmt,
+		              unsigned int dataIndex = -1, unsigned int optionFlags = 0x00);
+
+     /* A buffered output sink for the writers. The output is only copied
+      * into the buffer until it fills, so writing the tags does not need
+      * any heap allocation: */
+     class XMLOutputSink_t {
+
+          public:
+	       XMLOutputSink_t();
+	       ~XMLOutputSink_t();
+
+	       bool Open(const char *outputPath, bool gzipOutput);
+	       bool Close();
+
+	       inline bool IsOpen() const { return fpOutput != NULL || gzOutput != NULL; }
+	       inline bool HaveWriteError() const { return writeError; }
+
+	       inline void Write(const char *data, size_t dataLength) {
+	            if(bufferPos + dataLength > outputBuffer.size()) {
+		         Flush();
+			 if(dataLength > outputBuffer.size()) {
+			      WriteThrough(data, dataLength);
+			      return;
+			 }
+		    }
+		    memcpy(outputBuffer.data() + bufferPos, data, dataLength);
+		    bufferPos += dataLength;
+	       }
+
+	       inline void Write(const char *str) {
+	            Write(str, strlen(str));
+	       }
+
+	       inline void WriteChar(char ch) {
+	            if(bufferPos == outputBuffer.size()) {
+		         Flush();
+		    }
+		    outputBuffer[bufferPos++] = ch;
+	       }
+
+	       void WriteInt(long value);
+	       void WriteFloat(double value);
+	       void WriteIndent(int numSpaces);
+
+	       /* Writes the text with the XML special characters escaped: */
+	       void WriteEscaped(const char *text);
+
+	       bool Flush();
+
+	  private:
+	       void WriteThrough(const char *data, size_t dataLength);
+
+	       FILE *fpOutput;
+	       gzFile gzOutput;
+	       std::vector<char> outputBuffer;
+	       size_t bufferPos;
+	       bool writeError;
+
+     };
+
+     class XMLExportWriter {
+
+	  public:
+	       static inline unsigned int LEVEL_INDENT = 5;
+	       static inline const char *TAG_LINE_SPACING = "\n";
+	       static inline const char *GLOBAL_META_TAG = "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>";
+
+	  protected:
+               typedef enum {
+	            XMLDATAELM_DATATYPE_INT,
+		    XMLDATAELM_DATATYPE_FLOAT,
+		    XMLDATAELM_DATATYPE_STRING,
+		    XMLDATAELM_DATATYPE_HEXBUF,
+		    XMLDATAELM_DATATYPE_UNICODE,
+		    XMLDATAELM_DATATYPE_TEXT,
+		    XMLDATAELM_DATATYPE_POSTSCRIPT,
+		    XMLDATAELM_DATATYPE_MIXED,
+		    XMLDATAELM_DATATYPE_NESTED_TAG
+	       } XMLElementDataType_t;
+
+	       /* The attributes point at storage owned by the caller (usually
+		* string literals or a stack array), so nothing is copied: */
+	       typedef struct {
+	            const char *attrName;
+		    const char *attrValue;
+	       } XMLTagAttribute_t;
+
+	       typedef struct {
+                    const char *elementTagName;
+                    bool isSingletonTag;
+                    const XMLTagAttribute_t *tagMetaAttrs;
+		    unsigned int mdataAttrCount;
+		    XMLElementDataType_t tagDataType;
+	       } XMLDataElement_t;
+
+	       bool outputFileOpen;
+	       XMLOutputSink_t outputSink;
+               XMLExportFormat_t xmlFormatType;
+	       unsigned int exportOptions;
+
+	       // The names of the open tags (which are not copied either). The 
+	       // tags nested deeper than XMLEXPORT_MAX_TAG_DEPTH are dropped 
+	       // (with their attributes and text), and only counted so that 
+	       // their EndElement calls are matched up:
+	       const char *openTagNames[XMLEXPORT_MAX_TAG_DEPTH];
+	       bool openTagHasChildren[XMLEXPORT_MAX_TAG_DEPTH];
+	       int openTagDepth;
+	       int droppedTagDepth;
+	       bool tagDepthExceeded;
+	       bool startTagPending;
+
+	       void FinishStartTag();
+
+          public:
+               XMLExportWriter(XMLExportFormat_t xmlFmtType = XMLEXPORTFMT_RNASTRUCTVIZ);
+	       virtual ~XMLExportWriter();
+
+	       int OpenFile(std::string outputFile, unsigned int optionFlags);
+
+	       /* Returns EOVERFLOW if any of the tags were nested too deep: */
+	       int CloseFile();
+
+	       /* The streaming interface: the attributes are written after
+		* StartElement and before any of the content of the element: */
+	       void StartElement(const char *tagName);
+	       void WriteAttribute(const char *attrName, const char *attrValue);
+	       void WriteAttribute(const char *attrName, long attrValue);
+	       void WriteAttribute(const char *attrName, double attrValue);
+	       void WriteText(const char *textData);
+	       void EndElement();
+
+	       int WriteXMLHeaderData(int level = 0);
+	       int WriteXMLTag(XMLDataElement_t tagData, int level = 1, bool tagOpenStatus = true);
+	       int WriteXMLFooterData(int level = 0);
+	       int WriteXMLComment(std::string commentField, bool multiLine = false);
+               virtual int WriteXMLFile(unsigned int dataIndex = -1, unsigned int optionFlags = 0x00);
+
+	       static XMLExportWriter* GetXMLExportWriterByType(XMLExportFormat_t xmldocFmtType);
+
+     };
+
+     class XMLExportWriter_RNAStructViz : public XMLExportWriter {
+          public:
+	       XMLExportWriter_RNAStructViz() : XMLExportWriter(XMLEXPORTFMT_RNASTRUCTVIZ) {}
+     };
+
+     class XMLExportWriter_StructureOnly : public XMLExportWriter {
+          public:
+	       XMLExportWriter_StructureOnly() : XMLExportWriter(XMLEXPORTFMT_STRUCTURE_ONLY) {}
+     };
+
+     /* Writes all of the structures in a folder (the dataIndex is the index
+      * of the folder). The sequence is written once for the folder, and each
+      * structure is written as its dot bracket string (and also as its list
+      * of pairs with the XMLEXPORT_STRUCTURE_FULL option): */
+     class XMLExportWriter_FullSequenceFolder : public XMLExportWriter {
+          public:
+	       XMLExportWriter_FullSequenceFolder() : XMLExportWriter(XMLEXPORTFMT_FULL_FOLDER) {}
+
+	       int WriteXMLFile(unsigned int dataIndex = -1, unsigned int optionFlags = 0x00);
+	       int WriteFolder(const char *folderName, const std::vector<RNAStructure *> &folderStructs,
+			       unsigned int optionFlags = 0x00);
+     };
+
+}
+
+#endif
@@ -0,0 +1,112 @@
+/* TestBranchTypeIdentification.cpp : Checks which outermost arcs are picked
+ *                                    as the four branches and the three
+ *                                    nubbins, and the labels of the bases;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "ConfigOptions.h"
+#include "BranchTypeIdentification.h"
+#include "UnitTest.h"
+
+#if PERFORM_BRANCH_TYPE_ID
+
+static void AddPair(std::vector<int> &pairTable, int openIdx, int closeIdx) {
+     pairTable[openIdx] = closeIdx;
+     pairTable[closeIdx] = openIdx;
+}
+
+static bool HasBranchID(const std::vector<uint8_t> &branchIDs, int lowIdx, int highIdx, BranchID_t branchID) {
+     for(int pos = lowIdx; pos <= highIdx; pos++) {
+          if(branchIDs[pos] != branchID) {
+               return false;
+          }
+     }
+     return true;
+}
+
+UNIT_TEST(BranchTopSevenOuterArcs) {
+     // Eight outermost arcs with one unpaired base before each of them, and
+     // with the lengths (closeIdx - openIdx) 10, 3, 8, 12, 2, 6, 9 and 4:
+     const int arcLengths[] = { 10, 3, 8, 12, 2, 6, 9, 4 };
+     int arcOpen[8], arcClose[8];
+     std::vector<int> pairTable(71, -1);
+     int pos = 1;
+     for(int a = 0; a < 8; a++) {
+          arcOpen[a] = pos;
+          arcClose[a] = pos + arcLengths[a];
+          AddPair(pairTable, arcOpen[a], arcClose[a]);
+          pos = arcClose[a] + 2;
+     }
+     AddPair(pairTable, 3, 8);
+     std::vector<uint8_t> branchIDs(pairTable.size());
+     REQUIRE(RNABranchType_t::PerformBranchClassification(pairTable, branchIDs.data()));
+
+     // The four longest are the branches (in 5' to 3' order), and the next
+     // three are the nubbins of branches 1, 2 and 4:
+     CHECK(HasBranchID(branchIDs, arcOpen[0], arcClose[0], BRANCH1));
+     CHECK(HasBranchID(branchIDs, arcOpen[2], arcClose[2], BRANCH2));
+     CHECK(HasBranchID(branchIDs, arcOpen[3], arcClose[3], BRANCH3));
+     CHECK(HasBranchID(branchIDs, arcOpen[6], arcClose[6], BRANCH4));
+     CHECK(HasBranchID(branchIDs, arcOpen[1], arcClose[1], BRANCH1));
+     CHECK(HasBranchID(branchIDs, arcOpen[5], arcClose[5], BRANCH2));
+     CHECK(HasBranchID(branchIDs, arcOpen[7], arcClose[7], BRANCH4));
+     // The shortest arc is not labeled, though its unpaired bases are:
+     CHECK(branchIDs[arcOpen[4]] == BRANCH_UNDEFINED);
+     CHECK(branchIDs[arcClose[4]] == BRANCH_UNDEFINED);
+     CHECK(branchIDs[arcOpen[4] + 1] == BRANCH3);
+
+     // The unpaired bases before the first branch and after the last one, and
+     // those split between the third and the fourth branches:
+     CHECK(branchIDs[0] == BRANCH1);
+     CHECK(branchIDs[pairTable.size() - 1] == BRANCH4);
+     CHECK(branchIDs[arcClose[3] + 1] == BRANCH3);
+     CHECK(branchIDs[arcOpen[6] - 1] == BRANCH4);
+}
+
+UNIT_TEST(BranchOuterArcTies) {
+     // Eight outermost arcs of the same length: the ties go to the arcs
+     // nearest the 5' end, so the last arc is the one left out:
+     std::vector<int> pairTable(40, -1);
+     for(int a = 0; a < 8; a++) {
+          AddPair(pairTable, 5 * a, 5 * a + 4);
+     }
+     std::vector<uint8_t> branchIDs(pairTable.size());
+     REQUIRE(RNABranchType_t::PerformBranchClassification(pairTable, branchIDs.data()));
+     const BranchID_t arcBranchIDs[] = { BRANCH1, BRANCH2, BRANCH3, BRANCH4, 
+                                         BRANCH1, BRANCH2, BRANCH4 };
+     for(int a = 0; a < 7; a++) {
+          CHECK(HasBranchID(branchIDs, 5 * a, 5 * a + 4, arcBranchIDs[a]));
+     }
+     CHECK(branchIDs[35] == BRANCH_UNDEFINED && branchIDs[39] == BRANCH_UNDEFINED);
+     CHECK(HasBranchID(branchIDs, 36, 38, BRANCH4));
+}
+
+UNIT_TEST(BranchFewerThanSevenArcs) {
+     // Six outermost arcs, each enclosing two more arcs which do not count:
+     std::vector<int> pairTable(60, -1);
+     for(int a = 0; a < 6; a++) {
+          AddPair(pairTable, 10 * a, 10 * a + 9);
+          AddPair(pairTable, 10 * a + 1, 10 * a + 4);
+          AddPair(pairTable, 10 * a + 5, 10 * a + 8);
+     }
+     std::vector<uint8_t> branchIDs(pairTable.size(), BRANCH1);
+     CHECK(!RNABranchType_t::PerformBranchClassification(pairTable, branchIDs.data()));
+     CHECK(HasBranchID(branchIDs, 0, pairTable.size() - 1, BRANCH_UNDEFINED));
+
+     // A seventh arc which crosses the last one is dropped as well:
+     pairTable.resize(70, -1);
+     AddPair(pairTable, 57, 65);
+     branchIDs.assign(pairTable.size(), BRANCH1);
+     CHECK(!RNABranchType_t::PerformBranchClassification(pairTable, branchIDs.data()));
+     CHECK(HasBranchID(branchIDs, 0, pairTable.size() - 1, BRANCH_UNDEFINED));
+
+     std::vector<int> shortTable(3, -1);
+     CHECK(!RNABranchType_t::PerformBranchClassification(shortTable, branchIDs.data()));
+}
+
+#endif
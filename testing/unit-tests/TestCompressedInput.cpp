@@ -0,0 +1,174 @@
+/* TestCompressedInput.cpp : Checks reading the gzip compressed files through
+ *                           the stdio and the C++ input streams, and the
+ *                           errors for damaged and unsupported files;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <string>
+
+#include <zlib.h>
+
+#include "CompressedInput.h"
+#include "UnitTest.h"
+
+using namespace CompressedInput;
+
+/* More lines than fit in one COMPRESSED_INPUT_BUFSIZE read buffer: */
+static std::string TestFileData() {
+     std::string fileData = "12000 test structure\n";
+     for(int bidx = 0; bidx < 12000; bidx++) {
+          char ctLine[64];
+          snprintf(ctLine, sizeof(ctLine), "%d %c %d %d 0 %d\n", bidx + 1, "ACGU"[bidx % 4],
+                   bidx, bidx + 2, bidx + 1);
+          fileData += ctLine;
+     }
+     return fileData;
+}
+
+static std::string WriteGzipScratchFile(const char *fileName, const std::string &fileData) {
+     std::string filePath = UnitTest::GetScratchPath(fileName);
+     gzFile gzOutput = gzopen(filePath.c_str(), "wb");
+     if(gzOutput != NULL) {
+          gzwrite(gzOutput, fileData.data(), fileData.length());
+          gzclose(gzOutput);
+     }
+     return filePath;
+}
+
+static std::string ReadFileData(const std::string &filePath) {
+     std::string fileData;
+     FILE *fpInput = fopen(filePath.c_str(), "rb");
+     if(fpInput == NULL) {
+          return fileData;
+     }
+     char readBuf[4096];
+     size_t readCount;
+     while((readCount = fread(readBuf, 1, sizeof(readBuf), fpInput)) > 0) {
+          fileData.append(readBuf, readCount);
+     }
+     fclose(fpInput);
+     return fileData;
+}
+
+/* Reads the file by lines with OpenInputFile, and returns whether the
+ * stream had an error (so the lines read until then are in fileData): */
+static bool ReadInputLines(const std::string &filePath, std::string &fileData) {
+     fileData.clear();
+     FILE *fpInput = OpenInputFile(filePath.c_str(), "r");
+     if(fpInput == NULL) {
+          return false;
+     }
+     char *lineBuf = NULL;
+     size_t lineBufSize = 0;
+     ssize_t lineLength;
+     while((lineLength = getline(&lineBuf, &lineBufSize, fpInput)) != -1) {
+          fileData.append(lineBuf, lineLength);
+     }
+     bool readOK = !ferror(fpInput);
+     free(lineBuf);
+     fclose(fpInput);
+     return readOK;
+}
+
+static std::string ReadInputStream(const std::string &filePath) {
+     std::string fileData, fileLine;
+     InputFileStream_t inStream(filePath.c_str());
+     while(std::getline(inStream, fileLine)) {
+          fileData += fileLine + "\n";
+     }
+     return fileData;
+}
+
+UNIT_TEST(CompressionExtensions) {
+     CHECK(GetCompressionTypeByExtension("sample.ct.gz") == COMPRESSION_GZIP);
+     CHECK(GetCompressionTypeByExtension("sample.ct.GZIP") == COMPRESSION_GZIP);
+     CHECK(GetCompressionTypeByExtension("sample.ct.zst") == COMPRESSION_ZSTD);
+     CHECK(GetCompressionTypeByExtension("sample.ct") == COMPRESSION_NONE);
+     CHECK(GetCompressionTypeByExtension("archive.gz/sample") == COMPRESSION_NONE);
+     CHECK(GetCompressionTypeByExtension(NULL) == COMPRESSION_NONE);
+     CHECK(GetUncompressedFilePath("sample.ct.gz") == "sample.ct");
+     CHECK(GetUncompressedFilePath("sample.bpseq.zstd") == "sample.bpseq");
+     CHECK(GetUncompressedFilePath("sample.ct") == "sample.ct");
+     CHECK(GetUncompressedFilePath(NULL) == "");
+     CHECK(IsSupportedCompression(COMPRESSION_NONE));
+     CHECK(IsSupportedCompression(COMPRESSION_GZIP));
+     CHECK(IsSupportedCompression(COMPRESSION_ZSTD) == (BUILD_WITH_ZSTD_SUPPORT > 0));
+}
+
+UNIT_TEST(GzipRoundTrip) {
+     std::string fileData = TestFileData();
+     REQUIRE(fileData.length() > 2 * COMPRESSED_INPUT_BUFSIZE);
+     std::string gzipPath = WriteGzipScratchFile("round-trip.ct.gz", fileData);
+     CHECK(GetCompressionType(gzipPath.c_str()) == COMPRESSION_GZIP);
+     std::string readData;
+     CHECK(ReadInputLines(gzipPath, readData));
+     CHECK(readData == fileData);
+     CHECK(ReadInputStream(gzipPath) == fileData);
+
+     // The plain files are read as they are:
+     std::string plainPath = UnitTest::WriteScratchFile("round-trip.ct", fileData);
+     CHECK(GetCompressionType(plainPath.c_str()) == COMPRESSION_NONE);
+     CHECK(ReadInputLines(plainPath, readData));
+     CHECK(readData == fileData);
+     CHECK(ReadInputStream(plainPath) == fileData);
+}
+
+UNIT_TEST(GzipDetectedByMagic) {
+     std::string fileData = "3 no extension\n1 G 0 2 3 1\n2 A 1 3 0 2\n3 C 2 0 1 3\n";
+     std::string gzipPath = WriteGzipScratchFile("sniffed.ct", fileData);
+     CHECK(GetCompressionTypeByExtension(gzipPath.c_str()) == COMPRESSION_NONE);
+     CHECK(GetCompressionType(gzipPath.c_str()) == COMPRESSION_GZIP);
+     CHECK(ReadInputStream(gzipPath) == fileData);
+
+     // A plain file with the gzip extension is still read as it is:
+     std::string plainPath = UnitTest::WriteScratchFile("mislabeled.ct.gz", fileData);
+     CHECK(ReadInputStream(plainPath) == fileData);
+}
+
+UNIT_TEST(GzipDamagedFiles) {
+     std::string fileData = TestFileData();
+     std::string gzipData = ReadFileData(WriteGzipScratchFile("complete.ct.gz", fileData));
+     REQUIRE(gzipData.length() > 64);
+
+     // A truncated file is an error after the data which could be inflated:
+     std::string damagedPath = UnitTest::WriteScratchFile("truncated.ct.gz",
+                                                          gzipData.substr(0, gzipData.length() / 2));
+     std::string readData;
+     CHECK(!ReadInputLines(damagedPath, readData));
+     CHECK(readData.length() < fileData.length());
+     CHECK(fileData.compare(0, readData.length(), readData) == 0);
+
+     // The deflate data after the header is overwritten:
+     std::string damagedData = gzipData;
+     for(size_t bidx = 20; bidx < 60; bidx++) {
+          damagedData[bidx] = (char) 0xff;
+     }
+     damagedPath = UnitTest::WriteScratchFile("corrupt.ct.gz", damagedData);
+     CHECK(!ReadInputLines(damagedPath, readData));
+     CHECK(ReadInputStream(damagedPath).length() < fileData.length());
+}
+
+UNIT_TEST(CompressedInputOpenErrors) {
+     std::string missingPath = UnitTest::GetScratchPath("missing.ct.gz");
+     errno = 0;
+     CHECK(OpenInputFile(missingPath.c_str(), "r") == NULL);
+     CHECK(errno != 0);
+     errno = 0;
+     CHECK(OpenInputFile(NULL, "r") == NULL);
+     CHECK(errno == EINVAL);
+     InputFileStream_t missingStream(missingPath.c_str());
+     CHECK(!missingStream.is_open());
+     CHECK(!missingStream.good());
+#if BUILD_WITH_ZSTD_SUPPORT == 0
+     std::string zstdPath = UnitTest::WriteScratchFile("unsupported.ct.zst", "(((...)))\n");
+     errno = 0;
+     CHECK(OpenInputFile(zstdPath.c_str(), "r") == NULL);
+     CHECK(errno == ENOTSUP);
+#endif
+}
@@ -0,0 +1,128 @@
+/* TestDotBracketRecords.cpp : Checks the reader for the multi-record dot
+ *                             bracket files (RNAfold / RNAsubopt output);
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <string>
+#include <vector>
+
+#include "RNAStructure.h"
+#include "UnitTest.h"
+
+static std::vector<RNAStructure *> LoadRecords(const char *fileName, const char *fileData) {
+     std::string dbPath = UnitTest::WriteScratchFile(fileName, fileData);
+     int numStructs = -1;
+     RNAStructure **rnaStructs = RNAStructure::CreateFromDotBracketRecordsFile(dbPath.c_str(), &numStructs);
+     std::vector<RNAStructure *> loadedStructs;
+     if(rnaStructs != NULL) {
+          loadedStructs.assign(rnaStructs, rnaStructs + numStructs);
+     }
+     free(rnaStructs);
+     return loadedStructs;
+}
+
+static void DeleteStructures(std::vector<RNAStructure *> &rnaStructs) {
+     for(unsigned int sidx = 0; sidx < rnaStructs.size(); sidx++) {
+          delete rnaStructs[sidx];
+     }
+     rnaStructs.clear();
+}
+
+static const char *MULTI_RECORD_DATA =
+     "# RNAsubopt output for two sequences\n"
+     ">first record\n"
+     "GGGAAACCC  -3.40   1.00\n"
+     "(((...))) -3.40\n"
+     "((.....))  ( -1.20)\n"
+     "   # an indented comment\n"
+     ".........\n"
+     "((((.....   0.00\n"
+     "\n"
+     ">second\n"
+     "gxa-&uuuc\n"
+     ".(.....).\n"
+     " frequency of mfe structure in ensemble 0.25; ensemble diversity 1.20\n"
+     ">first again\n"
+     "GGGAAACCC\n"
+     ".((...)).\n";
+
+UNIT_TEST(DotBracketMultipleRecords) {
+     std::vector<RNAStructure *> rnaStructs = LoadRecords("records.dbn", MULTI_RECORD_DATA);
+     // The unbalanced structure and the frequency line are skipped:
+     REQUIRE(rnaStructs.size() == 5);
+     CHECK(!strcmp(rnaStructs[0]->GetDotBracketSequenceString(), "(((...)))"));
+     CHECK(!strcmp(rnaStructs[1]->GetDotBracketSequenceString(), "((.....))"));
+     CHECK(!strcmp(rnaStructs[2]->GetDotBracketSequenceString(), "........."));
+     CHECK(!strcmp(rnaStructs[3]->GetDotBracketSequenceString(), ".(.....)."));
+     CHECK(!strcmp(rnaStructs[4]->GetDotBracketSequenceString(), ".((...))."));
+
+     CHECK(!strcmp(rnaStructs[0]->GetFilename(), "records-S000001.dbn"));
+     CHECK(!strcmp(rnaStructs[2]->GetFilename(), "records-S000003.dbn"));
+     CHECK(!strcmp(rnaStructs[3]->GetFilename(), "records-R0002-S000001.dbn"));
+     CHECK(!strcmp(rnaStructs[0]->GetSuggestedStructureFolderName(), "first record"));
+     CHECK(!strcmp(rnaStructs[3]->GetSuggestedStructureFolderName(), "second"));
+
+     CHECK(rnaStructs[0]->HasFreeEnergy() && fabs(rnaStructs[0]->GetFreeEnergy() + 3.40) < 1.0e-6);
+     CHECK(rnaStructs[1]->HasFreeEnergy() && fabs(rnaStructs[1]->GetFreeEnergy() + 1.20) < 1.0e-6);
+     CHECK(!rnaStructs[2]->HasFreeEnergy());
+     DeleteStructures(rnaStructs);
+}
+
+UNIT_TEST(DotBracketRepeatedSequence) {
+     std::vector<RNAStructure *> rnaStructs = LoadRecords("repeated.dbn", MULTI_RECORD_DATA);
+     REQUIRE(rnaStructs.size() == 5);
+     // The repeated sequence adds its structure to the first record (and
+     // shares the sequence data with it):
+     CHECK(rnaStructs[4]->GetSequenceString() == rnaStructs[0]->GetSequenceString());
+     CHECK(!strcmp(rnaStructs[4]->GetFilename(), "repeated-S000004.dbn"));
+     CHECK(!(*(rnaStructs[4]) == *(rnaStructs[0])));
+     DeleteStructures(rnaStructs);
+}
+
+UNIT_TEST(DotBracketOtherSequenceSymbols) {
+     std::vector<RNAStructure *> rnaStructs = LoadRecords("symbols.dbn", MULTI_RECORD_DATA);
+     REQUIRE(rnaStructs.size() == 5);
+     RNAStructure *rnaStruct = rnaStructs[3];
+     CHECK(!strcmp(rnaStruct->GetSequenceString(), "GXA-&UUUC"));
+     REQUIRE(rnaStruct->GetLength() == 9);
+     CHECK(rnaStruct->GetBaseAt(0)->m_base == RNAStructure::G);
+     CHECK(rnaStruct->GetBaseAt(1)->m_base == RNAStructure::X);
+     CHECK(rnaStruct->GetBaseAt(3)->m_base == RNAStructure::X);
+     CHECK(rnaStruct->GetBaseAt(4)->m_base == RNAStructure::X);
+     CHECK(rnaStruct->GetBaseAt(1)->m_pair == 7);
+     DeleteStructures(rnaStructs);
+}
+
+UNIT_TEST(DotBracketSingleStructure) {
+     std::vector<RNAStructure *> rnaStructs = LoadRecords("single.dbn",
+                                                          "# one structure\n"
+                                                          "GGGAAACCC\n"
+                                                          "(((...)))\n");
+     REQUIRE(rnaStructs.size() == 1);
+     CHECK(!strcmp(rnaStructs[0]->GetFilename(), "single.dbn"));
+     DeleteStructures(rnaStructs);
+}
+
+UNIT_TEST(DotBracketMalformedFiles) {
+     // A structure before any sequence, and one of the wrong length:
+     std::vector<RNAStructure *> rnaStructs = LoadRecords("malformed.dbn",
+                                                          "(((...)))\n"
+                                                          "GGGAAACCC\n"
+                                                          "(((....)))\n");
+     CHECK(rnaStructs.empty());
+     rnaStructs = LoadRecords("comments.dbn", "# only\n# comments\n");
+     CHECK(rnaStructs.empty());
+     std::string emptyPath = UnitTest::WriteScratchFile("empty.dbn", "");
+     int numStructs = -1;
+     CHECK(RNAStructure::CreateFromDotBracketRecordsFile(emptyPath.c_str(), &numStructs) == NULL);
+     CHECK(numStructs == 0);
+     numStructs = -1;
+     CHECK(RNAStructure::CreateFromDotBracketRecordsFile(UnitTest::GetScratchPath("missing.dbn").c_str(),
+                                                        &numStructs) == NULL);
+     CHECK(numStructs == 0);
+}
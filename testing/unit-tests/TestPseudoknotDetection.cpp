@@ -0,0 +1,135 @@
+/* TestPseudoknotDetection.cpp : Checks the crossing pair counts and the page
+ *                               decomposition against brute force results;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdlib.h>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "PseudoknotDetection.h"
+#include "UnitTest.h"
+
+using namespace PseudoknotDetection;
+
+static std::vector<int> PairTableFromArcs(int seqLength, const std::vector<std::pair<int, int> > &arcs) {
+     std::vector<int> pairTable(seqLength, PKPT_UNPAIRED);
+     for(unsigned int aidx = 0; aidx < arcs.size(); aidx++) {
+          pairTable[arcs[aidx].first] = arcs[aidx].second;
+          pairTable[arcs[aidx].second] = arcs[aidx].first;
+     }
+     return pairTable;
+}
+
+/* A random (possibly knotted) matching of some of the bases: */
+static std::vector<int> RandomPairTable(std::mt19937 &rng, int seqLength) {
+     std::vector<int> basePerm(seqLength);
+     for(int bidx = 0; bidx < seqLength; bidx++) {
+          basePerm[bidx] = bidx;
+     }
+     std::shuffle(basePerm.begin(), basePerm.end(), rng);
+     std::vector<std::pair<int, int> > arcs;
+     for(int pidx = 0; pidx + 1 < seqLength / 2; pidx += 2) {
+          int i = basePerm[pidx], j = basePerm[pidx + 1];
+          arcs.push_back(std::make_pair(std::min(i, j), std::max(i, j)));
+     }
+     return PairTableFromArcs(seqLength, arcs);
+}
+
+static inline bool ArcsCross(int i, int j, int k, int l) {
+     return (i < k && k < j && j < l) || (k < i && i < l && l < j);
+}
+
+static size_t BruteForceCrossings(const std::vector<int> &pairTable, std::vector<int> &perBase) {
+     int seqLength = pairTable.size();
+     perBase.assign(seqLength, 0);
+     size_t crossingCount = 0;
+     for(int i = 0; i < seqLength; i++) {
+          if(pairTable[i] <= i) {
+               continue;
+          }
+          for(int k = i + 1; k < seqLength; k++) {
+               if(pairTable[k] <= k || !ArcsCross(i, pairTable[i], k, pairTable[k])) {
+                    continue;
+               }
+               crossingCount++;
+               perBase[i]++;
+               perBase[pairTable[i]]++;
+               perBase[k]++;
+               perBase[pairTable[k]]++;
+          }
+     }
+     return crossingCount;
+}
+
+UNIT_TEST(PseudoknotDetection_NestedHasNoCrossings) {
+     // ((..))..((...))
+     std::vector<std::pair<int, int> > arcs = { {0, 5}, {1, 4}, {8, 14}, {9, 13} };
+     std::vector<int> pairTable = PairTableFromArcs(15, arcs);
+     CHECK(CountCrossingPairs(pairTable) == 0);
+     std::vector<uint8_t> pageLayers;
+     CHECK(ComputePageDecomposition(pairTable, pageLayers) == 1);
+     CHECK(pageLayers[0] == 0 && pageLayers[14] == 0);
+     CHECK(pageLayers[6] == PKPAGE_UNPAIRED);
+}
+
+UNIT_TEST(PseudoknotDetection_SimpleHType) {
+     // ((..[[..))..]] : the two stems cross in 2 * 2 arc pairs
+     std::vector<std::pair<int, int> > arcs = { {0, 9}, {1, 8}, {4, 13}, {5, 12} };
+     std::vector<int> pairTable = PairTableFromArcs(14, arcs);
+     std::vector<int> perBase;
+     CHECK(CountCrossingPairs(pairTable, &perBase) == 4);
+     CHECK(perBase[0] == 2 && perBase[13] == 2);
+     std::vector<uint8_t> pageLayers;
+     CHECK(ComputePageDecomposition(pairTable, pageLayers) == 2);
+     CHECK(pageLayers[0] == pageLayers[1]);
+     CHECK(pageLayers[4] == pageLayers[5]);
+     CHECK(pageLayers[0] != pageLayers[4]);
+}
+
+UNIT_TEST(PseudoknotDetection_MatchesBruteForce) {
+     std::mt19937 rng(20200219);
+     for(int trial = 0; trial < 200; trial++) {
+          int seqLength = 2 + (int) (rng() % 120);
+          std::vector<int> pairTable = RandomPairTable(rng, seqLength);
+          std::vector<int> perBase, expectedPerBase;
+          size_t expectedCount = BruteForceCrossings(pairTable, expectedPerBase);
+          CHECK(CountCrossingPairs(pairTable) == expectedCount);
+          CHECK(CountCrossingPairs(pairTable, &perBase) == expectedCount);
+          CHECK(perBase == expectedPerBase);
+     }
+}
+
+UNIT_TEST(PseudoknotDetection_PagesAreNonCrossing) {
+     std::mt19937 rng(1234);
+     for(int trial = 0; trial < 200; trial++) {
+          int seqLength = 2 + (int) (rng() % 120);
+          std::vector<int> pairTable = RandomPairTable(rng, seqLength);
+          std::vector<uint8_t> pageLayers;
+          int numPages = ComputePageDecomposition(pairTable, pageLayers);
+          std::vector<int> pagePairCounts(numPages, 0);
+          for(int i = 0; i < seqLength; i++) {
+               if(pairTable[i] < 0) {
+                    CHECK(pageLayers[i] == PKPAGE_UNPAIRED);
+                    continue;
+               }
+               CHECK(pageLayers[i] == pageLayers[pairTable[i]]);
+               REQUIRE(pageLayers[i] < numPages);
+               if(pairTable[i] < i) {
+                    continue;
+               }
+               pagePairCounts[pageLayers[i]]++;
+               for(int k = i + 1; k < seqLength; k++) {
+                    if(pairTable[k] > k && pageLayers[k] == pageLayers[i]) {
+                         CHECK(!ArcsCross(i, pairTable[i], k, pairTable[k]));
+                    }
+               }
+          }
+          for(int p = 1; p < numPages; p++) {
+               CHECK(pagePairCounts[0] >= pagePairCounts[p]);
+          }
+     }
+}
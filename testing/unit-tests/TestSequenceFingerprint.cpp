@@ -0,0 +1,61 @@
+/* TestSequenceFingerprint.cpp : Checks the XXH64 hash against the reference
+ *                               vectors (the fingerprints are persisted);
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "SequenceFingerprint.h"
+#include "UnitTest.h"
+
+using namespace SequenceFingerprint;
+
+UNIT_TEST(XXH64ReferenceVectors) {
+     CHECK(XXH64("", 0, 0) == 0xef46db3751d8e999ULL);
+     CHECK(XXH64("a", 1, 0) == 0xd24ec4f1a98c6e5bULL);
+     CHECK(XXH64("abc", 3, 0) == 0x44bc2cf5ad770999ULL);
+     const char *longInput = "Nobody inspects the spammish repetition";
+     CHECK(XXH64(longInput, strlen(longInput), 0) == 0xfbcea83c8a378bf1ULL);
+     CHECK(XXH64("xxhash", 6, 20141025) == 0xb559b98d844e0635ULL);
+}
+
+static std::string TestBaseSequence(size_t seqLength) {
+     std::string baseSeq(seqLength, 'A');
+     for(size_t pos = 0; pos < seqLength; pos++) {
+          baseSeq[pos] = "ACGU"[(pos * 7 + pos / 3) % 4];
+     }
+     return baseSeq;
+}
+
+UNIT_TEST(XXH64LongSequence) {
+     std::string baseSeq = TestBaseSequence(5000);
+     CHECK(XXH64(baseSeq.c_str(), baseSeq.length(), 0) == 0x57f52a24ba2d5241ULL);
+}
+
+UNIT_TEST(XXH64UnalignedInput) {
+     std::string baseSeq = TestBaseSequence(257);
+     for(size_t offset = 1; offset < 8; offset++) {
+          std::vector<char> shiftedBuf(offset + baseSeq.length());
+          memcpy(shiftedBuf.data() + offset, baseSeq.c_str(), baseSeq.length());
+          for(size_t length = 0; length <= baseSeq.length(); length += 13) {
+               CHECK(XXH64(shiftedBuf.data() + offset, length, 0) == XXH64(baseSeq.c_str(), length, 0));
+          }
+     }
+}
+
+UNIT_TEST(FingerprintWords) {
+     std::string baseSeq = TestBaseSequence(3000);
+     SequenceFingerprint_t seqFP = ComputeFingerprint(baseSeq.c_str(), baseSeq.length());
+     CHECK(seqFP.low == XXH64(baseSeq.c_str(), baseSeq.length(), SEQFP_LOW_SEED));
+     CHECK(seqFP.high == XXH64(baseSeq.c_str(), baseSeq.length(), SEQFP_HIGH_SEED));
+     // Sequences that only differ past the first 2048 bases get different fingerprints:
+     std::string otherSeq = baseSeq;
+     otherSeq[2999] = otherSeq[2999] == 'A' ? 'C' : 'A';
+     SequenceFingerprint_t otherFP = ComputeFingerprint(otherSeq.c_str(), otherSeq.length());
+     CHECK(seqFP.low != otherFP.low || seqFP.high != otherFP.high);
+}
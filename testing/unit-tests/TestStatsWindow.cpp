@@ -0,0 +1,60 @@
+/* TestStatsWindow.cpp : Checks the slippage tolerant pair matching used by 
+ *                       the comparison statistics;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <vector>
+
+#include "StatsWindow.h"
+#include "PseudoknotDetection.h"
+#include "UnitTest.h"
+
+/* The pairs (0, 9), (1, 8) and (3, 6) of a ten base sequence, so that the 
+ * outer pair has its ends on the first and the last bases: */
+static std::vector<int> TestPairTable() {
+     std::vector<int> pairTable(10, PKPT_UNPAIRED);
+     int pairs[][2] = { { 0, 9 }, { 1, 8 }, { 3, 6 } };
+     for(int pidx = 0; pidx < 3; pidx++) {
+          pairTable[pairs[pidx][0]] = pairs[pidx][1];
+          pairTable[pairs[pidx][1]] = pairs[pidx][0];
+     }
+     return pairTable;
+}
+
+UNIT_TEST(SlippageExactMatches) {
+     std::vector<int> pairTable = TestPairTable();
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 0, 9, 0));
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 1, 8, 0));
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 3, 6, 0));
+     CHECK(!StatsWindow::PairMatchesWithSlippage(pairTable, 0, 8, 0));
+     CHECK(!StatsWindow::PairMatchesWithSlippage(pairTable, 1, 9, 0));
+     CHECK(!StatsWindow::PairMatchesWithSlippage(pairTable, 2, 7, 0));
+     CHECK(!StatsWindow::PairMatchesWithSlippage(pairTable, 4, 6, 0));
+}
+
+UNIT_TEST(SlippageShiftedByOne) {
+     std::vector<int> pairTable = TestPairTable();
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 0, 9, 1));
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 4, 6, 1));
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 3, 5, 1));
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 2, 6, 1));
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 3, 7, 1));
+     // Only one of the two ends may be shifted:
+     CHECK(!StatsWindow::PairMatchesWithSlippage(pairTable, 4, 7, 1));
+     CHECK(!StatsWindow::PairMatchesWithSlippage(pairTable, 2, 5, 1));
+     CHECK(!StatsWindow::PairMatchesWithSlippage(pairTable, 3, 4, 1));
+}
+
+UNIT_TEST(SlippageAtSequenceEnds) {
+     std::vector<int> pairTable = TestPairTable();
+     // Shifts of the pair on base 0 (the shift to base -1 is not looked up):
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 0, 8, 1));
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 1, 9, 1));
+     CHECK(!StatsWindow::PairMatchesWithSlippage(pairTable, 0, 7, 1));
+     // Shifts of the pair on base N - 1 (the shift to base N is not looked up):
+     CHECK(!StatsWindow::PairMatchesWithSlippage(pairTable, 2, 9, 1));
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 0, 7, 2));
+     CHECK(StatsWindow::PairMatchesWithSlippage(pairTable, 2, 9, 2));
+     CHECK(!StatsWindow::PairMatchesWithSlippage(std::vector<int>(), 0, 1, 1));
+}
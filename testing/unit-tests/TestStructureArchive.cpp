@@ -0,0 +1,285 @@
+/* TestStructureArchive.cpp : Round trips through the binary folder archives,
+ *                            and checks that damaged archives are rejected;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "RNAStructure.h"
+#include "StructureArchive.h"
+#include "StructureSlotMap.h"
+#include "FolderStructure.h"
+#include "StructureManager.h"
+#include "UnitTest.h"
+
+static const char *TEST_SEQUENCE = "GGGAAACCCUUAGCGCAAAGCGCUAAGG";
+static const char *TEST_STRUCTURES[] = {
+     "(((...)))..((((...))))......",
+     "............................",
+     "((((..[[[..))))..]]]........",
+};
+#define NUM_TEST_STRUCTURES        (3)
+
+/* The byte offsets of the header fields and the size of the index entries: */
+#define ARCHIVE_MAGIC_OFFSET       (0)
+#define ARCHIVE_COUNT_OFFSET       (12)
+#define ARCHIVE_INDEX_OFFSET       (24)
+#define ARCHIVE_INDEX_ENTRY_SIZE   (16)
+
+static std::vector<RNAStructure *> CreateTestStructures(int numStructs) {
+     std::shared_ptr<RNAStructure::SharedSequence_t> sharedSeq =
+          RNAStructure::CreateSharedSequence(TEST_SEQUENCE);
+     std::vector<RNAStructure *> rnaStructs;
+     for(int sidx = 0; sidx < numStructs; sidx++) {
+          char structName[32];
+          snprintf(structName, sizeof(structName), "structure-%04d.dbn", sidx + 1);
+          const char *dotData = TEST_STRUCTURES[sidx % NUM_TEST_STRUCTURES];
+          rnaStructs.push_back(RNAStructure::CreateFromSharedDotBracket(structName, sharedSeq,
+                                                                        dotData, strlen(dotData)));
+     }
+     return rnaStructs;
+}
+
+static void DeleteStructures(std::vector<RNAStructure *> &rnaStructs) {
+     for(unsigned int sidx = 0; sidx < rnaStructs.size(); sidx++) {
+          delete rnaStructs[sidx];
+     }
+     rnaStructs.clear();
+}
+
+static std::vector<RNAStructure *> LoadStructures(const std::string &archivePath) {
+     int numStructs = 0;
+     RNAStructure **rnaStructs = StructureArchive::LoadArchiveFile(archivePath.c_str(), &numStructs);
+     std::vector<RNAStructure *> loadedStructs(rnaStructs, rnaStructs + numStructs);
+     free(rnaStructs);
+     return loadedStructs;
+}
+
+static std::string ReadArchiveData(const std::string &archivePath) {
+     std::string archiveData;
+     FILE *fpArchive = fopen(archivePath.c_str(), "rb");
+     if(fpArchive == NULL) {
+          return archiveData;
+     }
+     char readBuf[4096];
+     size_t readCount;
+     while((readCount = fread(readBuf, 1, sizeof(readBuf), fpArchive)) > 0) {
+          archiveData.append(readBuf, readCount);
+     }
+     fclose(fpArchive);
+     return archiveData;
+}
+
+static std::string WriteGzipScratchFile(const char *fileName, const std::string &fileData) {
+     std::string filePath = UnitTest::GetScratchPath(fileName);
+     gzFile gzOutput = gzopen(filePath.c_str(), "wb");
+     if(gzOutput != NULL) {
+          gzwrite(gzOutput, fileData.data(), fileData.length());
+          gzclose(gzOutput);
+     }
+     return filePath;
+}
+
+template<typename FieldType_t>
+static void PatchField(std::string &archiveData, size_t fieldOffset, FieldType_t fieldValue) {
+     memcpy(&archiveData[fieldOffset], &fieldValue, sizeof(FieldType_t));
+}
+
+static size_t GetIndexOffset(const std::string &archiveData) {
+     uint64_t indexOffset = 0;
+     memcpy(&indexOffset, archiveData.data() + ARCHIVE_INDEX_OFFSET, sizeof(uint64_t));
+     return indexOffset;
+}
+
+UNIT_TEST(ArchiveRoundTrip) {
+     std::vector<RNAStructure *> rnaStructs = CreateTestStructures(NUM_TEST_STRUCTURES);
+     std::string archivePath = UnitTest::GetScratchPath("round-trip.rsvarchive");
+     REQUIRE(StructureArchive::WriteArchive(archivePath.c_str(), "Test Folder", rnaStructs));
+     StructureArchive structArchive;
+     REQUIRE(structArchive.Open(archivePath.c_str()));
+     CHECK(structArchive.GetStructureCount() == NUM_TEST_STRUCTURES);
+     CHECK(structArchive.GetSequenceLength() == strlen(TEST_SEQUENCE));
+     CHECK(structArchive.GetFolderName() == "Test Folder");
+     structArchive.Close();
+
+     std::vector<RNAStructure *> loadedStructs = LoadStructures(archivePath);
+     REQUIRE(loadedStructs.size() == rnaStructs.size());
+     CHECK(!strcmp(loadedStructs[0]->GetSuggestedStructureFolderName(), "Test Folder"));
+     CHECK(!strcmp(loadedStructs[0]->GetDotBracketSequenceString(), TEST_STRUCTURES[0]));
+     for(unsigned int sidx = 0; sidx < rnaStructs.size(); sidx++) {
+          CHECK(!strcmp(loadedStructs[sidx]->GetFilename(), rnaStructs[sidx]->GetFilename()));
+          CHECK(!strcmp(loadedStructs[sidx]->GetSequenceString(), TEST_SEQUENCE));
+          CHECK(loadedStructs[sidx]->GetPairTable() == rnaStructs[sidx]->GetPairTable());
+          CHECK(loadedStructs[sidx]->GetPairListHash() == rnaStructs[sidx]->GetPairListHash());
+          CHECK(*(loadedStructs[sidx]) == *(rnaStructs[sidx]));
+     }
+     DeleteStructures(loadedStructs);
+     DeleteStructures(rnaStructs);
+}
+
+UNIT_TEST(ArchiveParallelDecode) {
+     // Enough records that they are decoded by more than one thread:
+     int numStructs = 8 * STRUCTURE_ARCHIVE_RECORDS_PER_THREAD + 5;
+     std::vector<RNAStructure *> rnaStructs = CreateTestStructures(numStructs);
+     std::string archivePath = UnitTest::GetScratchPath("parallel.rsvarchive");
+     REQUIRE(StructureArchive::WriteArchive(archivePath.c_str(), "Parallel", rnaStructs));
+     std::vector<RNAStructure *> loadedStructs = LoadStructures(archivePath);
+     REQUIRE(loadedStructs.size() == rnaStructs.size());
+     for(unsigned int sidx = 0; sidx < rnaStructs.size(); sidx++) {
+          CHECK(!strcmp(loadedStructs[sidx]->GetFilename(), rnaStructs[sidx]->GetFilename()));
+          CHECK(loadedStructs[sidx]->GetPairTable() == rnaStructs[sidx]->GetPairTable());
+     }
+     DeleteStructures(loadedStructs);
+     DeleteStructures(rnaStructs);
+}
+
+UNIT_TEST(ArchiveRejectsDamagedHeaders) {
+     std::vector<RNAStructure *> rnaStructs = CreateTestStructures(NUM_TEST_STRUCTURES);
+     std::string archivePath = UnitTest::GetScratchPath("headers.rsvarchive");
+     REQUIRE(StructureArchive::WriteArchive(archivePath.c_str(), "Headers", rnaStructs));
+     DeleteStructures(rnaStructs);
+     std::string archiveData = ReadArchiveData(archivePath);
+     REQUIRE(archiveData.length() > ARCHIVE_INDEX_OFFSET + sizeof(uint64_t));
+
+     StructureArchive structArchive;
+     std::string damagedPath = UnitTest::WriteScratchFile("truncated.rsvarchive",
+                                                          archiveData.substr(0, 20));
+     CHECK(!structArchive.Open(damagedPath.c_str()));
+     damagedPath = UnitTest::WriteScratchFile("short-index.rsvarchive",
+                                              archiveData.substr(0, archiveData.length() - 1));
+     CHECK(!structArchive.Open(damagedPath.c_str()));
+
+     std::string damagedData = archiveData;
+     PatchField<uint32_t>(damagedData, ARCHIVE_MAGIC_OFFSET, 0x12345678);
+     damagedPath = UnitTest::WriteScratchFile("bad-magic.rsvarchive", damagedData);
+     CHECK(!structArchive.Open(damagedPath.c_str()));
+
+     // The index offset plus the size of the index wraps around to the file size:
+     damagedData = archiveData;
+     uint32_t wrappedCount = 0x10000000;
+     PatchField<uint32_t>(damagedData, ARCHIVE_COUNT_OFFSET, wrappedCount);
+     PatchField<uint64_t>(damagedData, ARCHIVE_INDEX_OFFSET, (uint64_t) archiveData.length() -
+                          (uint64_t) wrappedCount * ARCHIVE_INDEX_ENTRY_SIZE);
+     damagedPath = UnitTest::WriteScratchFile("wrapped-index.rsvarchive", damagedData);
+     CHECK(!structArchive.Open(damagedPath.c_str()));
+
+     damagedData = archiveData;
+     PatchField<uint32_t>(damagedData, ARCHIVE_COUNT_OFFSET, 0xffffffff);
+     damagedPath = UnitTest::WriteScratchFile("bad-count.rsvarchive", damagedData);
+     CHECK(!structArchive.Open(damagedPath.c_str()));
+
+     int numStructs = -1;
+     CHECK(StructureArchive::LoadArchiveFile(damagedPath.c_str(), &numStructs) == NULL);
+     CHECK(numStructs == 0);
+     CHECK(StructureArchive::LoadArchiveFile(UnitTest::GetScratchPath("missing.rsvarchive").c_str(),
+                                             &numStructs) == NULL);
+}
+
+UNIT_TEST(ArchiveSkipsDamagedRecords) {
+     std::vector<RNAStructure *> rnaStructs = CreateTestStructures(NUM_TEST_STRUCTURES);
+     std::string archivePath = UnitTest::GetScratchPath("records.rsvarchive");
+     REQUIRE(StructureArchive::WriteArchive(archivePath.c_str(), "Records", rnaStructs));
+     std::string archiveData = ReadArchiveData(archivePath);
+     size_t indexOffset = GetIndexOffset(archiveData);
+     REQUIRE(indexOffset + NUM_TEST_STRUCTURES * ARCHIVE_INDEX_ENTRY_SIZE == archiveData.length());
+
+     // The second record points into the header, and the third one runs
+     // past the end of the file (with an offset plus length that wraps):
+     PatchField<uint64_t>(archiveData, indexOffset + ARCHIVE_INDEX_ENTRY_SIZE, 4);
+     PatchField<uint64_t>(archiveData, indexOffset + 2 * ARCHIVE_INDEX_ENTRY_SIZE, ~((uint64_t) 0));
+     std::string damagedPath = UnitTest::WriteScratchFile("damaged-records.rsvarchive", archiveData);
+     StructureArchive structArchive;
+     REQUIRE(structArchive.Open(damagedPath.c_str()));
+     CHECK(structArchive.LoadStructureAt(1) == NULL);
+     CHECK(structArchive.LoadStructureAt(2) == NULL);
+     CHECK(structArchive.LoadStructureAt(3) == NULL);
+     CHECK(structArchive.LoadStructureAt(-1) == NULL);
+     RNAStructure *firstStruct = structArchive.LoadStructureAt(0);
+     REQUIRE(firstStruct != NULL);
+     CHECK(firstStruct->GetPairTable() == rnaStructs[0]->GetPairTable());
+     delete firstStruct;
+     structArchive.Close();
+
+     // A record length that runs into the index is rejected too:
+     PatchField<uint64_t>(archiveData, indexOffset + 2 * ARCHIVE_INDEX_ENTRY_SIZE, indexOffset - 2);
+     damagedPath = UnitTest::WriteScratchFile("long-record.rsvarchive", archiveData);
+     std::vector<RNAStructure *> loadedStructs = LoadStructures(damagedPath);
+     REQUIRE(loadedStructs.size() == 1);
+     CHECK(!strcmp(loadedStructs[0]->GetFilename(), rnaStructs[0]->GetFilename()));
+     DeleteStructures(loadedStructs);
+     DeleteStructures(rnaStructs);
+}
+
+UNIT_TEST(ArchiveFolderWithRemovedStructure) {
+     std::vector<RNAStructure *> rnaStructs = CreateTestStructures(NUM_TEST_STRUCTURES + 1);
+     StructureSlotMap_t structSlots;
+     Folder testFolder;
+     testFolder.SetPerformWidgetDeletion(false);
+     testFolder.folderName = strdup("Removed");
+     for(unsigned int sidx = 0; sidx < rnaStructs.size(); sidx++) {
+          testFolder.AddStructure(structSlots.Insert(rnaStructs[sidx]));
+     }
+     // Remove the second structure (as in StructureManager::RemoveStructure):
+     int removedSlot = testFolder.folderStructs[1].slotIndex;
+     CHECK(testFolder.RemoveStructure(removedSlot));
+     CHECK(!testFolder.RemoveStructure(removedSlot));
+     delete structSlots.RemoveAt(removedSlot);
+     rnaStructs.erase(rnaStructs.begin() + 1);
+     CHECK(testFolder.GetSize() == rnaStructs.size());
+
+     std::vector<RNAStructure *> folderStructs;
+     testFolder.CollectStructures(structSlots, folderStructs);
+     REQUIRE(folderStructs.size() == rnaStructs.size());
+     std::string archivePath = UnitTest::GetScratchPath("removed.rsvarchive");
+     REQUIRE(StructureArchive::WriteArchive(archivePath.c_str(), testFolder.folderName, folderStructs));
+     std::vector<RNAStructure *> loadedStructs = LoadStructures(archivePath);
+     REQUIRE(loadedStructs.size() == rnaStructs.size());
+     for(unsigned int sidx = 0; sidx < rnaStructs.size(); sidx++) {
+          // The structures after the removed one are exported too:
+          CHECK(!strcmp(loadedStructs[sidx]->GetFilename(), rnaStructs[sidx]->GetFilename()));
+          CHECK(*(loadedStructs[sidx]) == *(rnaStructs[sidx]));
+     }
+     DeleteStructures(loadedStructs);
+     DeleteStructures(rnaStructs);
+}
+
+UNIT_TEST(ArchiveGzipCompressed) {
+     std::vector<RNAStructure *> rnaStructs = CreateTestStructures(NUM_TEST_STRUCTURES);
+     std::string archivePath = UnitTest::GetScratchPath("compressed.rsvarchive");
+     REQUIRE(StructureArchive::WriteArchive(archivePath.c_str(), "Compressed", rnaStructs));
+     std::string archiveData = ReadArchiveData(archivePath);
+     std::string gzipPath = WriteGzipScratchFile("compressed.rsvarchive.gz", archiveData);
+
+     // The compressed archive is recognized by the extension under ".gz":
+     StructureManager::ParsedStructureFile_t parsedFile;
+     StructureManager::ParseStructureFile(gzipPath.c_str(), parsedFile);
+     CHECK(!parsedFile.unknownFileType);
+     REQUIRE(parsedFile.structures != NULL && parsedFile.structCount == NUM_TEST_STRUCTURES);
+     std::vector<RNAStructure *> loadedStructs(parsedFile.structures,
+                                               parsedFile.structures + parsedFile.structCount);
+     free(parsedFile.structures);
+     CHECK(!strcmp(loadedStructs[0]->GetSuggestedStructureFolderName(), "Compressed"));
+     for(unsigned int sidx = 0; sidx < rnaStructs.size(); sidx++) {
+          CHECK(!strcmp(loadedStructs[sidx]->GetFilename(), rnaStructs[sidx]->GetFilename()));
+          CHECK(loadedStructs[sidx]->GetPairTable() == rnaStructs[sidx]->GetPairTable());
+     }
+     DeleteStructures(loadedStructs);
+
+     // A truncated compressed archive is rejected:
+     std::string gzipData = ReadArchiveData(gzipPath);
+     std::string truncatedPath = UnitTest::WriteScratchFile("truncated.rsvarchive.gz",
+                                                            gzipData.substr(0, gzipData.length() / 2));
+     StructureArchive structArchive;
+     CHECK(!structArchive.Open(truncatedPath.c_str()));
+     CHECK(LoadStructures(truncatedPath).empty());
+     DeleteStructures(rnaStructs);
+}
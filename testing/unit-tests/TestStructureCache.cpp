@@ -0,0 +1,302 @@
+/* TestStructureCache.cpp : Round trips through the on-disk structure cache,
+ *                          and checks that stale or damaged entries are
+ *                          not used;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <string>
+
+#include "RNAStructure.h"
+#include "StructureCache.h"
+#include "SequenceFingerprint.h"
+#include "UnitTest.h"
+
+/* The byte offsets of the entry header fields (see CacheEntryHeader_t): */
+#define CACHE_MAGIC_OFFSET          (0)
+#define CACHE_VERSION_OFFSET        (4)
+#define CACHE_MTIME_OFFSET          (16)
+#define CACHE_PAYLOAD_HASH_OFFSET   (32)
+#define CACHE_HEADER_SIZE           (88)
+
+static const char *TEST_SEQUENCE = "GGGAAACCC";
+static const int TEST_PAIRS[] = { 9, 8, 7, 0, 0, 0, 3, 2, 1 };
+#define TEST_SEQUENCE_LENGTH        (9)
+
+static std::string HairpinCTData(const char *baseSeq, const int *basePairs = TEST_PAIRS) {
+     std::string ctData = "9 hairpin\n";
+     for(int bidx = 0; bidx < TEST_SEQUENCE_LENGTH; bidx++) {
+          char ctLine[64];
+          snprintf(ctLine, sizeof(ctLine), "%d %c %d %d %d %d\n", bidx + 1, baseSeq[bidx], bidx,
+                   bidx + 1 < TEST_SEQUENCE_LENGTH ? bidx + 2 : 0, basePairs[bidx], bidx + 1);
+          ctData += ctLine;
+     }
+     return ctData;
+}
+
+/* The cache lives under $HOME/.RNAStructViz, so each test points HOME at
+ * its own scratch directory (which then holds only the entries it stores): */
+static std::string UseScratchCacheDirectory(const char *homeName) {
+     std::string homeDir = UnitTest::GetScratchPath(homeName);
+     mkdir(homeDir.c_str(), 0700);
+     setenv("HOME", homeDir.c_str(), 1);
+     return homeDir + "/.RNAStructViz/" + STRUCTURE_CACHE_SUBDIR;
+}
+
+static std::string FindCacheEntry(const std::string &cacheDir) {
+     std::string entryPath;
+     DIR *dirHandle = opendir(cacheDir.c_str());
+     struct dirent *dirEntry;
+     while(dirHandle != NULL && (dirEntry = readdir(dirHandle)) != NULL) {
+          const char *extPos = strrchr(dirEntry->d_name, '.');
+          if(extPos != NULL && !strcmp(extPos, STRUCTURE_CACHE_FILEEXT)) {
+               entryPath = cacheDir + dirEntry->d_name;
+          }
+     }
+     if(dirHandle != NULL) {
+          closedir(dirHandle);
+     }
+     return entryPath;
+}
+
+static std::string ReadFileData(const std::string &filePath) {
+     std::string fileData;
+     FILE *fpInput = fopen(filePath.c_str(), "rb");
+     if(fpInput == NULL) {
+          return fileData;
+     }
+     char readBuf[4096];
+     size_t readCount;
+     while((readCount = fread(readBuf, 1, sizeof(readBuf), fpInput)) > 0) {
+          fileData.append(readBuf, readCount);
+     }
+     fclose(fpInput);
+     return fileData;
+}
+
+static void WriteFileData(const std::string &filePath, const std::string &fileData) {
+     FILE *fpOutput = fopen(filePath.c_str(), "wb");
+     if(fpOutput != NULL) {
+          fwrite(fileData.data(), 1, fileData.length(), fpOutput);
+          fclose(fpOutput);
+     }
+}
+
+/* The mtimes are set explicitly, since a file rewritten within the
+ * resolution of the file system timestamps keeps the same one: */
+static void SetFileMtime(const std::string &filePath, time_t mtimeSec) {
+     struct timespec fileTimes[2] = { { mtimeSec, 0 }, { mtimeSec, 0 } };
+     utimensat(AT_FDCWD, filePath.c_str(), fileTimes, 0);
+}
+
+template<typename FieldType_t>
+static void PatchField(std::string &entryData, size_t fieldOffset, FieldType_t fieldValue) {
+     memcpy(&entryData[fieldOffset], &fieldValue, sizeof(FieldType_t));
+}
+
+static void UpdatePayloadHash(std::string &entryData) {
+     PatchField<uint64_t>(entryData, CACHE_PAYLOAD_HASH_OFFSET,
+                          SequenceFingerprint::XXH64(entryData.data() + CACHE_HEADER_SIZE,
+                                                     entryData.length() - CACHE_HEADER_SIZE, 0));
+}
+
+/* Parses the CT file, and stores it in the cache: */
+static bool StoreTestStructure(const std::string &ctPath) {
+     RNAStructure *rnaStruct = RNAStructure::CreateFromFile(ctPath.c_str(), false);
+     if(rnaStruct == NULL) {
+          return false;
+     }
+     bool storeOK = StructureCache::StoreStructure(ctPath.c_str(), rnaStruct);
+     delete rnaStruct;
+     return storeOK;
+}
+
+static bool LoadsFromCache(const std::string &ctPath) {
+     RNAStructure *cachedStruct = StructureCache::LoadStructure(ctPath.c_str());
+     bool loadedOK = cachedStruct != NULL;
+     delete cachedStruct;
+     return loadedOK;
+}
+
+UNIT_TEST(CacheRoundTrip) {
+     UseScratchCacheDirectory("home-round-trip");
+     std::string ctPath = UnitTest::WriteScratchFile("round-trip.ct", HairpinCTData(TEST_SEQUENCE));
+     CHECK(StructureCache::LoadStructure(ctPath.c_str()) == NULL);
+     RNAStructure *rnaStruct = RNAStructure::CreateFromFile(ctPath.c_str(), false);
+     REQUIRE(rnaStruct != NULL);
+     rnaStruct->SetFileCommentLines("Organism: Test hairpin", FILETYPE_CT);
+     REQUIRE(StructureCache::StoreStructure(ctPath.c_str(), rnaStruct));
+
+     RNAStructure *cachedStruct = StructureCache::LoadStructure(ctPath.c_str());
+     REQUIRE(cachedStruct != NULL);
+     CHECK(!strcmp(cachedStruct->GetFilename(), "round-trip.ct"));
+     CHECK(!strcmp(cachedStruct->GetSequenceString(), TEST_SEQUENCE));
+     CHECK(!strcmp(cachedStruct->GetDotBracketSequenceString(), "(((...)))"));
+     CHECK(!strcmp(cachedStruct->GetInitialFileComment(), "Organism: Test hairpin"));
+     CHECK(cachedStruct->GetLength() == rnaStruct->GetLength());
+     CHECK(*cachedStruct == *rnaStruct);
+     delete cachedStruct;
+     delete rnaStruct;
+}
+
+UNIT_TEST(CacheableFileTypes) {
+     CHECK(StructureCache::IsCacheableFile("sample.ct"));
+     CHECK(StructureCache::IsCacheableFile("sample.NOPCT"));
+     CHECK(StructureCache::IsCacheableFile("sample.bpseq"));
+     CHECK(StructureCache::IsCacheableFile("sample.ct.gz"));
+     CHECK(!StructureCache::IsCacheableFile("sample.dbn"));
+     CHECK(!StructureCache::IsCacheableFile("sample.fasta"));
+     CHECK(!StructureCache::IsCacheableFile("sample"));
+     CHECK(!StructureCache::IsCacheableFile(NULL));
+
+     UseScratchCacheDirectory("home-file-types");
+     std::string ctPath = UnitTest::WriteScratchFile("file-types.ct", HairpinCTData(TEST_SEQUENCE));
+     std::string dbPath = UnitTest::WriteScratchFile("file-types.dbn", "GGGAAACCC\n(((...)))\n");
+     RNAStructure *rnaStruct = RNAStructure::CreateFromFile(ctPath.c_str(), false);
+     REQUIRE(rnaStruct != NULL);
+     CHECK(!StructureCache::StoreStructure(dbPath.c_str(), rnaStruct));
+     CHECK(!StructureCache::StoreStructure(UnitTest::GetScratchPath("missing.ct").c_str(), rnaStruct));
+     CHECK(!StructureCache::StoreStructure(ctPath.c_str(), NULL));
+     CHECK(StructureCache::LoadStructure(dbPath.c_str()) == NULL);
+     CHECK(StructureCache::LoadStructure(NULL) == NULL);
+     delete rnaStruct;
+}
+
+UNIT_TEST(CacheChangedSourceFile) {
+     std::string cacheDir = UseScratchCacheDirectory("home-changed");
+     std::string ctPath = UnitTest::WriteScratchFile("changed.ct", HairpinCTData(TEST_SEQUENCE));
+     SetFileMtime(ctPath, 1000000000);
+     REQUIRE(StoreTestStructure(ctPath));
+     CHECK(LoadsFromCache(ctPath));
+
+     // Only the mtime changed, so the entry is still used (and refreshed):
+     SetFileMtime(ctPath, 1000000100);
+     CHECK(LoadsFromCache(ctPath));
+     std::string entryData = ReadFileData(FindCacheEntry(cacheDir));
+     REQUIRE(entryData.length() > CACHE_HEADER_SIZE);
+     int64_t entryMtime = 0;
+     memcpy(&entryMtime, entryData.data() + CACHE_MTIME_OFFSET, sizeof(int64_t));
+     CHECK(entryMtime == 1000000100);
+
+     // The same size with other contents:
+     WriteFileData(ctPath, HairpinCTData("GGGAAACCU"));
+     SetFileMtime(ctPath, 1000000200);
+     CHECK(!LoadsFromCache(ctPath));
+
+     // The stored mtime with another size:
+     WriteFileData(ctPath, HairpinCTData(TEST_SEQUENCE) + "\n");
+     SetFileMtime(ctPath, 1000000100);
+     CHECK(!LoadsFromCache(ctPath));
+}
+
+UNIT_TEST(CacheRejectsDamagedEntries) {
+     std::string cacheDir = UseScratchCacheDirectory("home-damaged");
+     std::string ctPath = UnitTest::WriteScratchFile("damaged.ct", HairpinCTData(TEST_SEQUENCE));
+     REQUIRE(StoreTestStructure(ctPath));
+     std::string entryPath = FindCacheEntry(cacheDir);
+     std::string entryData = ReadFileData(entryPath);
+     REQUIRE(entryData.length() > CACHE_HEADER_SIZE + 4 * TEST_SEQUENCE_LENGTH);
+
+     WriteFileData(entryPath, entryData.substr(0, CACHE_HEADER_SIZE / 2));
+     CHECK(!LoadsFromCache(ctPath));
+     WriteFileData(entryPath, entryData.substr(0, entryData.length() - 1));
+     CHECK(!LoadsFromCache(ctPath));
+
+     std::string damagedData = entryData;
+     PatchField<uint32_t>(damagedData, CACHE_MAGIC_OFFSET, 0x12345678);
+     WriteFileData(entryPath, damagedData);
+     CHECK(!LoadsFromCache(ctPath));
+     damagedData = entryData;
+     PatchField<uint32_t>(damagedData, CACHE_VERSION_OFFSET, STRUCTURE_CACHE_VERSION + 1);
+     WriteFileData(entryPath, damagedData);
+     CHECK(!LoadsFromCache(ctPath));
+     damagedData = entryData;
+     damagedData[damagedData.length() - 1] ^= 0x01;
+     WriteFileData(entryPath, damagedData);
+     CHECK(!LoadsFromCache(ctPath));
+
+     // The pairs come last, and these entries have valid checksums, so the
+     // pairs themselves are checked (and the entries are removed):
+     size_t pairsOffset = entryData.length() - TEST_SEQUENCE_LENGTH * sizeof(RNAStructure::BasePair);
+     damagedData = entryData;
+     PatchField<RNAStructure::BasePair>(damagedData, pairsOffset, 200);
+     UpdatePayloadHash(damagedData);
+     WriteFileData(entryPath, damagedData);
+     CHECK(!LoadsFromCache(ctPath));
+     CHECK(access(entryPath.c_str(), F_OK) != 0);
+     damagedData = entryData;
+     PatchField<RNAStructure::BasePair>(damagedData, pairsOffset + 3 * sizeof(RNAStructure::BasePair), 0);
+     UpdatePayloadHash(damagedData);
+     WriteFileData(entryPath, damagedData);
+     CHECK(!LoadsFromCache(ctPath));
+     CHECK(access(entryPath.c_str(), F_OK) != 0);
+
+     // The undamaged entry is still used:
+     WriteFileData(entryPath, entryData);
+     CHECK(LoadsFromCache(ctPath));
+}
+
+UNIT_TEST(DeferredParseChangedFile) {
+     UseScratchCacheDirectory("home-deferred");
+     std::string ctPath = UnitTest::WriteScratchFile("deferred.ct", HairpinCTData(TEST_SEQUENCE));
+     SetFileMtime(ctPath, 1000000000);
+     RNAStructure *deferredStruct = RNAStructure::CreateDeferredFromFile(ctPath.c_str(), false);
+     REQUIRE(deferredStruct != NULL);
+     CHECK(deferredStruct->IsParseDeferred());
+     uint64_t scanPairHash = deferredStruct->GetPairListHash();
+     CHECK(deferredStruct->IsParseDeferred());
+
+     // The pairs in the file change before the structure is first viewed:
+     static const int CHANGED_PAIRS[] = { 9, 8, 0, 0, 0, 0, 0, 2, 1 };
+     WriteFileData(ctPath, HairpinCTData(TEST_SEQUENCE, CHANGED_PAIRS));
+     SetFileMtime(ctPath, 1000000100);
+     RNAStructure *changedStruct = RNAStructure::CreateFromFile(ctPath.c_str(), false);
+     REQUIRE(changedStruct != NULL);
+     deferredStruct->EnsureParsed();
+     CHECK(!deferredStruct->IsParseDeferred());
+     CHECK(!strcmp(deferredStruct->GetDotBracketSequenceString(), "((.....))"));
+     CHECK(deferredStruct->GetPairListHash() != scanPairHash);
+     CHECK(deferredStruct->GetPairListHash() == changedStruct->GetPairListHash());
+     CHECK(*deferredStruct == *changedStruct);
+     delete changedStruct;
+     delete deferredStruct;
+}
+
+UNIT_TEST(CacheHelixTripleRoundTrip) {
+     UseScratchCacheDirectory("home-helix");
+     std::string ctPath = UnitTest::WriteScratchFile("helix.ct", HairpinCTData(TEST_SEQUENCE));
+     std::string hlxPath = UnitTest::WriteScratchFile("helix.hlx", "GGGAAACCC\n1 9 3\n");
+     RNAStructure *ctStruct = RNAStructure::CreateFromFile(ctPath.c_str(), false);
+     REQUIRE(ctStruct != NULL);
+     int structCount = 0;
+     RNAStructure **helixStructs = RNAStructure::CreateFromHelixTripleFormatFile(hlxPath.c_str(), &structCount);
+     REQUIRE(helixStructs != NULL && structCount == 1);
+     RNAStructure *helixStruct = helixStructs[0];
+     free(helixStructs);
+
+     // The helix triples give 1-based base positions, and the pairs are stored 0-based:
+     CHECK(!strcmp(helixStruct->GetDotBracketSequenceString(), "(((...)))"));
+     for(int bidx = 0; bidx < TEST_SEQUENCE_LENGTH; bidx++) {
+          RNAStructure::BasePair expectedPair = TEST_PAIRS[bidx] > 0 ? TEST_PAIRS[bidx] - 1 : RNAStructure::UNPAIRED;
+          CHECK(helixStruct->GetBaseAt(bidx)->m_pair == expectedPair);
+     }
+     CHECK(*helixStruct == *ctStruct);
+
+     REQUIRE(StructureCache::StoreStructure(hlxPath.c_str(), helixStruct));
+     RNAStructure *cachedStruct = StructureCache::LoadStructure(hlxPath.c_str());
+     REQUIRE(cachedStruct != NULL);
+     CHECK(!strcmp(cachedStruct->GetDotBracketSequenceString(), "(((...)))"));
+     CHECK(*cachedStruct == *helixStruct);
+     delete cachedStruct;
+     delete helixStruct;
+     delete ctStruct;
+}
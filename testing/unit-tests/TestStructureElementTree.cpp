@@ -0,0 +1,162 @@
+/* TestStructureElementTree.cpp : Checks the loop/helix decomposition of small
+ *                                nested structures, and that crossing pairs
+ *                                are treated as unpaired;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <string.h>
+
+#include <vector>
+
+#include "StructureElementTree.h"
+#include "UnitTest.h"
+
+typedef StructureElementTree_t ElementTree_t;
+
+/* The pair table of a dot bracket string, where the "[]" pairs may cross
+ * the "()" pairs: */
+static std::vector<int> PairTableFromDotBracket(const char *dotBracket) {
+     int seqLength = strlen(dotBracket);
+     std::vector<int> pairTable(seqLength, -1);
+     std::vector<int> roundStack, squareStack;
+     for(int pos = 0; pos < seqLength; pos++) {
+          std::vector<int> &openStack = (dotBracket[pos] == '[' || dotBracket[pos] == ']') ?
+                                        squareStack : roundStack;
+          if(dotBracket[pos] == '(' || dotBracket[pos] == '[') {
+               openStack.push_back(pos);
+          }
+          else if(dotBracket[pos] == ')' || dotBracket[pos] == ']') {
+               pairTable[pos] = openStack.back();
+               pairTable[openStack.back()] = pos;
+               openStack.pop_back();
+          }
+     }
+     return pairTable;
+}
+
+/* Finds the node of the given type closed by the pair (openIdx, closeIdx): */
+static int FindNode(const ElementTree_t &elementTree, ElementTree_t::ElementType_t etype,
+                    int openIdx, int closeIdx) {
+     for(int n = 0; n < elementTree.GetNodeCount(); n++) {
+          const ElementTree_t::ElementNode_t &node = elementTree.GetNode(n);
+          if(node.elementType == etype && node.openIdx == openIdx && node.closeIdx == closeIdx) {
+               return n;
+          }
+     }
+     return ELEMENT_NONE;
+}
+
+/* The nodes are stored in post-order, and the children of each node link
+ * back to it: */
+static bool CheckTreeLinks(const ElementTree_t &elementTree) {
+     for(int n = 0; n < elementTree.GetNodeCount(); n++) {
+          const ElementTree_t::ElementNode_t &node = elementTree.GetNode(n);
+          if(n != elementTree.GetRootIndex() && (node.parent <= n || node.parent == ELEMENT_NONE)) {
+               return false;
+          }
+          for(int c = node.firstChild; c != ELEMENT_NONE; c = elementTree.GetNode(c).nextSibling) {
+               if(elementTree.GetNode(c).parent != n) {
+                    return false;
+               }
+          }
+     }
+     return elementTree.GetNode(elementTree.GetRootIndex()).elementType == ElementTree_t::ELEMENT_EXTERIOR;
+}
+
+UNIT_TEST(ElementTreeHairpin) {
+     ElementTree_t elementTree(PairTableFromDotBracket("((...))"));
+     REQUIRE(elementTree.GetNodeCount() == 3);
+     CHECK(CheckTreeLinks(elementTree));
+     int hairpinIdx = FindNode(elementTree, ElementTree_t::ELEMENT_HAIRPIN, 1, 5);
+     int stemIdx = FindNode(elementTree, ElementTree_t::ELEMENT_STEM, 0, 6);
+     REQUIRE(hairpinIdx != ELEMENT_NONE && stemIdx != ELEMENT_NONE);
+     CHECK(elementTree.GetNode(hairpinIdx).length == 3);
+     CHECK(elementTree.GetNode(stemIdx).length == 2);
+     CHECK(elementTree.GetNode(stemIdx).firstChild == hairpinIdx);
+     CHECK(elementTree.GetElementTypeAt(3) == ElementTree_t::ELEMENT_HAIRPIN);
+     CHECK(elementTree.GetElementTypeAt(1) == ElementTree_t::ELEMENT_STEM);
+     CHECK(elementTree.GetElementIndexAt(6) == stemIdx);
+     CHECK(elementTree.GetElementIndexAt(7) == ELEMENT_NONE);
+     CHECK(elementTree.GetElementTypeCount(ElementTree_t::ELEMENT_STEM) == 1);
+     CHECK(elementTree.GetElementTypeCount(ElementTree_t::ELEMENT_HAIRPIN) == 1);
+}
+
+UNIT_TEST(ElementTreeBulgeAndInteriorLoops) {
+     ElementTree_t bulgeTree(PairTableFromDotBracket("((.((...))))"));
+     CHECK(CheckTreeLinks(bulgeTree));
+     int bulgeIdx = FindNode(bulgeTree, ElementTree_t::ELEMENT_BULGE, 1, 10);
+     REQUIRE(bulgeIdx != ELEMENT_NONE);
+     CHECK(bulgeTree.GetNode(bulgeIdx).length == 1);
+     CHECK(bulgeTree.GetNode(bulgeIdx).numBranches == 1);
+     CHECK(bulgeTree.GetElementTypeAt(2) == ElementTree_t::ELEMENT_BULGE);
+     CHECK(bulgeTree.GetElementTypeCount(ElementTree_t::ELEMENT_STEM) == 2);
+     CHECK(bulgeTree.GetElementTypeCount(ElementTree_t::ELEMENT_INTERIOR) == 0);
+
+     ElementTree_t interiorTree(PairTableFromDotBracket("((.((...)).))"));
+     CHECK(CheckTreeLinks(interiorTree));
+     int interiorIdx = FindNode(interiorTree, ElementTree_t::ELEMENT_INTERIOR, 1, 11);
+     REQUIRE(interiorIdx != ELEMENT_NONE);
+     CHECK(interiorTree.GetNode(interiorIdx).length == 2);
+     CHECK(interiorTree.GetElementIndexAt(2) == interiorIdx);
+     CHECK(interiorTree.GetElementIndexAt(10) == interiorIdx);
+     CHECK(interiorTree.GetElementTypeAt(6) == ElementTree_t::ELEMENT_HAIRPIN);
+     CHECK(interiorTree.GetElementTypeCount(ElementTree_t::ELEMENT_BULGE) == 0);
+}
+
+UNIT_TEST(ElementTreeMultiloop) {
+     ElementTree_t elementTree(PairTableFromDotBracket("((...).(...))"));
+     CHECK(CheckTreeLinks(elementTree));
+     int multiloopIdx = FindNode(elementTree, ElementTree_t::ELEMENT_MULTILOOP, 0, 12);
+     REQUIRE(multiloopIdx != ELEMENT_NONE);
+     const ElementTree_t::ElementNode_t &multiloop = elementTree.GetNode(multiloopIdx);
+     CHECK(multiloop.length == 1);
+     CHECK(multiloop.numBranches == 2);
+     // The branches are linked in 5' to 3' order:
+     REQUIRE(multiloop.firstChild != ELEMENT_NONE);
+     const ElementTree_t::ElementNode_t &firstBranch = elementTree.GetNode(multiloop.firstChild);
+     CHECK(firstBranch.openIdx == 1 && firstBranch.closeIdx == 5);
+     REQUIRE(firstBranch.nextSibling != ELEMENT_NONE);
+     CHECK(elementTree.GetNode(firstBranch.nextSibling).openIdx == 7);
+     CHECK(elementTree.GetNode(firstBranch.nextSibling).nextSibling == ELEMENT_NONE);
+     CHECK(elementTree.GetElementIndexAt(6) == multiloopIdx);
+     CHECK(elementTree.GetElementTypeCount(ElementTree_t::ELEMENT_HAIRPIN) == 2);
+     CHECK(elementTree.GetElementTypeCount(ElementTree_t::ELEMENT_STEM) == 3);
+}
+
+UNIT_TEST(ElementTreeExteriorLoop) {
+     ElementTree_t elementTree(PairTableFromDotBracket("..((...))..((...))."));
+     CHECK(CheckTreeLinks(elementTree));
+     const ElementTree_t::ElementNode_t &exterior = elementTree.GetNode(elementTree.GetRootIndex());
+     CHECK(exterior.openIdx == -1 && exterior.closeIdx == 19);
+     CHECK(exterior.length == 5);
+     CHECK(exterior.numBranches == 2);
+     CHECK(elementTree.GetNode(exterior.firstChild).openIdx == 2);
+     for(int pos = 0; pos < 19; pos++) {
+          bool exteriorBase = pos < 2 || pos == 9 || pos == 10 || pos == 18;
+          CHECK((elementTree.GetElementIndexAt(pos) == elementTree.GetRootIndex()) == exteriorBase);
+     }
+
+     ElementTree_t unpairedTree(PairTableFromDotBracket("...."));
+     REQUIRE(unpairedTree.GetNodeCount() == 1);
+     CHECK(unpairedTree.GetNode(0).length == 4);
+     CHECK(unpairedTree.GetElementTypeAt(2) == ElementTree_t::ELEMENT_EXTERIOR);
+}
+
+UNIT_TEST(ElementTreeCrossingPairs) {
+     // The "[]" pairs cross the "()" stem, so they are treated as unpaired
+     // (in the hairpin and in the exterior loop):
+     ElementTree_t elementTree(PairTableFromDotBracket("((..[[..))..]]"));
+     CHECK(CheckTreeLinks(elementTree));
+     CHECK(elementTree.GetElementTypeCount(ElementTree_t::ELEMENT_STEM) == 1);
+     CHECK(elementTree.GetElementTypeCount(ElementTree_t::ELEMENT_HAIRPIN) == 1);
+     int hairpinIdx = FindNode(elementTree, ElementTree_t::ELEMENT_HAIRPIN, 1, 8);
+     REQUIRE(hairpinIdx != ELEMENT_NONE);
+     CHECK(elementTree.GetNode(hairpinIdx).length == 6);
+     for(int pos = 2; pos < 8; pos++) {
+          CHECK(elementTree.GetElementIndexAt(pos) == hairpinIdx);
+     }
+     CHECK(elementTree.GetNode(elementTree.GetRootIndex()).length == 4);
+     CHECK(elementTree.GetElementTypeAt(12) == ElementTree_t::ELEMENT_EXTERIOR);
+     CHECK(elementTree.GetElementTypeAt(13) == ElementTree_t::ELEMENT_EXTERIOR);
+}
@@ -0,0 +1,116 @@
+/* TestStructureLayout.cpp : Checks the spacing of the bases in the native
+ *                           radial layouts of random nested structures, 
+ *                           and the headless export of the layout images;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "RNAStructure.h"
+#include "StructureElementTree.h"
+#include "StructureLayout.h"
+#include "RadialLayoutImage.h"
+#include "UnitTest.h"
+
+/* Fills [lowIdx, highIdx] with runs of unpaired bases and branches, which
+ * are stems of three to eight pairs closing another random region: */
+static void AddRandomBranches(std::mt19937 &rng, std::vector<int> &pairTable, int lowIdx, int highIdx) {
+     int pos = lowIdx;
+     while(pos <= highIdx) {
+          int remaining = highIdx - pos + 1;
+          if(remaining < 12 || rng() % 3 != 0) {
+               pos += 1 + rng() % 4;
+               continue;
+          }
+          int branchLength = std::min(remaining, (int) (20 + rng() % std::min(400, remaining)));
+          int stemLength = 3 + rng() % 6;
+          if(2 * stemLength + 3 > branchLength) {
+               pos++;
+               continue;
+          }
+          int openIdx = pos, closeIdx = pos + branchLength - 1;
+          for(int k = 0; k < stemLength; k++) {
+               pairTable[openIdx + k] = closeIdx - k;
+               pairTable[closeIdx - k] = openIdx + k;
+          }
+          int innerLow = openIdx + stemLength + rng() % 3;
+          int innerHigh = closeIdx - stemLength - rng() % 3;
+          AddRandomBranches(rng, pairTable, innerLow, innerHigh);
+          pos = closeIdx + 1;
+     }
+}
+
+static double BaseDistance(const StructureLayout_t &structLayout, int i, int j) {
+     double dx = structLayout.GetX(i) - structLayout.GetX(j);
+     double dy = structLayout.GetY(i) - structLayout.GetY(j);
+     return sqrt(dx * dx + dy * dy);
+}
+
+UNIT_TEST(RadialLayoutPairSpacing) {
+     std::mt19937 rng(1000);
+     std::vector<int> pairTable(1000, -1);
+     AddRandomBranches(rng, pairTable, 0, pairTable.size() - 1);
+     StructureElementTree_t elementTree(pairTable);
+     StructureLayout_t structLayout(elementTree, pairTable, StructureLayout_t::LAYOUT_RADIAL);
+     REQUIRE(structLayout.GetLength() == (int) pairTable.size());
+     for(int bidx = 0; bidx < structLayout.GetLength(); bidx++) {
+          // The two bases of a pair are one unit apart, and none of the
+          // neighbors along the backbone are closer than that:
+          if(pairTable[bidx] > bidx) {
+               CHECK(fabs(BaseDistance(structLayout, bidx, pairTable[bidx]) - 1.0) < 0.05);
+          }
+          if(bidx + 1 < structLayout.GetLength()) {
+               CHECK(BaseDistance(structLayout, bidx, bidx + 1) > 0.9);
+          }
+     }
+}
+
+UNIT_TEST(RadialLayoutNoOverlaps) {
+     // The first of these used to put the branches at the 5' and 3' ends
+     // on top of each other:
+     const int seqLengths[] = { 500, 1000, 3000 };
+     for(int sidx = 0; sidx < 3; sidx++) {
+          std::mt19937 rng(seqLengths[sidx]);
+          std::vector<int> pairTable(seqLengths[sidx], -1);
+          AddRandomBranches(rng, pairTable, 0, pairTable.size() - 1);
+          StructureElementTree_t elementTree(pairTable);
+          StructureLayout_t structLayout(elementTree, pairTable, StructureLayout_t::LAYOUT_RADIAL);
+          int numOverlaps = 0;
+          for(int i = 0; i < structLayout.GetLength(); i++) {
+               for(int j = i + 1; j < structLayout.GetLength(); j++) {
+                    numOverlaps += BaseDistance(structLayout, i, j) < 0.5 ? 1 : 0;
+               }
+          }
+          CHECK(numOverlaps == 0);
+     }
+}
+
+UNIT_TEST(RadialLayoutImageExport) {
+     RNAStructure *rnaStruct = RNAStructure::CreateFromDotBracketData("export.dbn", 
+                                                                      "GGGAAACCCAGGGAAACCC", 
+                                                                      "(((...))).(((...)))", 0);
+     REQUIRE(rnaStruct != NULL);
+     std::string pngPath = UnitTest::GetScratchPath("layout-export.png");
+     CHECK(RadialLayoutDisplayWindow::WriteLayoutImage(rnaStruct, pngPath.c_str()));
+     CHECK(RadialLayoutDisplayWindow::WriteLayoutImage(rnaStruct, pngPath.c_str(), 
+                                                       RadialLayoutDisplayWindow::PLOT_TYPE_NAVIEW));
+     CHECK(!RadialLayoutDisplayWindow::WriteLayoutImage(NULL, pngPath.c_str()));
+     CHECK(!RadialLayoutDisplayWindow::WriteLayoutImage(rnaStruct, NULL));
+     delete rnaStruct;
+
+     unsigned char pngSignature[8] = { 0 };
+     FILE *fpImage = fopen(pngPath.c_str(), "rb");
+     REQUIRE(fpImage != NULL);
+     size_t readCount = fread(pngSignature, 1, sizeof(pngSignature), fpImage);
+     fclose(fpImage);
+     CHECK(readCount == sizeof(pngSignature) && !memcmp(pngSignature, "\x89PNG\r\n\x1a\n", 8));
+}
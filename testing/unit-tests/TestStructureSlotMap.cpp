@@ -0,0 +1,61 @@
+/* TestStructureSlotMap.cpp : Checks the slot reuse and the stale handles of
+ *                            the generational structure slot map;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.18
+ */
+
+#include <stdlib.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "StructureSlotMap.h"
+#include "UnitTest.h"
+
+/* The slot map only stores the pointers, so any distinct addresses do: */
+static RNAStructure *TestStructure(int structIndex) {
+     static char structData[8];
+     return (RNAStructure *) (structData + structIndex);
+}
+
+UNIT_TEST(SlotMapInsertAndRemove) {
+     StructureSlotMap_t structSlots;
+     StructureHandle_t handles[4];
+     for(int sidx = 0; sidx < 4; sidx++) {
+          handles[sidx] = structSlots.Insert(TestStructure(sidx));
+          CHECK(handles[sidx].slotIndex == sidx);
+          CHECK(structSlots.Get(handles[sidx]) == TestStructure(sidx));
+     }
+     CHECK(structSlots.Insert(NULL).IsNone());
+     CHECK(structSlots.GetLiveCount() == 4);
+
+     CHECK(structSlots.Remove(handles[1]) == TestStructure(1));
+     CHECK(structSlots.Remove(handles[1]) == NULL);
+     CHECK(structSlots.RemoveAt(2) == TestStructure(2));
+     CHECK(structSlots.GetLiveCount() == 2);
+     CHECK(structSlots.GetSlotCount() == 4);
+     std::vector<int> liveSlots = structSlots.GetLiveSlots();
+     std::sort(liveSlots.begin(), liveSlots.end());
+     CHECK(liveSlots.size() == 2 && liveSlots[0] == 0 && liveSlots[1] == 3);
+     CHECK(structSlots.GetAt(-1) == NULL && structSlots.GetAt(4) == NULL);
+     CHECK(structSlots.GetHandleAt(1).IsNone());
+     CHECK(structSlots.GetHandleAt(3) == handles[3]);
+}
+
+UNIT_TEST(SlotMapStaleHandles) {
+     StructureSlotMap_t structSlots;
+     StructureHandle_t firstHandle = structSlots.Insert(TestStructure(0));
+     structSlots.Insert(TestStructure(1));
+     CHECK(structSlots.Remove(firstHandle) == TestStructure(0));
+
+     // The freed slot is reused, but the old handle does not resolve to the
+     // structure which is in it now:
+     StructureHandle_t reusedHandle = structSlots.Insert(TestStructure(2));
+     CHECK(reusedHandle.slotIndex == firstHandle.slotIndex);
+     CHECK(reusedHandle != firstHandle);
+     CHECK(structSlots.Get(firstHandle) == NULL);
+     CHECK(structSlots.Remove(firstHandle) == NULL);
+     CHECK(structSlots.Get(reusedHandle) == TestStructure(2));
+     CHECK(structSlots.GetAt(firstHandle.slotIndex) == TestStructure(2));
+     CHECK(structSlots.Get(STRUCTURE_HANDLE_NONE) == NULL);
+}
@@ -0,0 +1,181 @@
+/* TestTreeEditDistance.cpp : Checks the Zhang-Shasha distances against a naive
+ *                            recursive forest edit distance on small structures;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+#include <string>
+#include <map>
+#include <random>
+#include <algorithm>
+
+#include "TreeEditDistance.h"
+#include "UnitTest.h"
+
+using namespace TreeEditDistance;
+
+static std::vector<int> PairTableFromDotBracket(const char *dotBracket) {
+     int seqLength = strlen(dotBracket);
+     std::vector<int> pairTable(seqLength, -1), openStack;
+     for(int pos = 0; pos < seqLength; pos++) {
+          if(dotBracket[pos] == '(') {
+               openStack.push_back(pos);
+          }
+          else if(dotBracket[pos] == ')') {
+               pairTable[pos] = openStack.back();
+               pairTable[openStack.back()] = pos;
+               openStack.pop_back();
+          }
+     }
+     return pairTable;
+}
+
+static std::string RandomNestedDotBracket(std::mt19937 &rng, int seqLength) {
+     std::string dotBracket(seqLength, '.');
+     std::vector<int> openStack;
+     for(int pos = 0; pos < seqLength; pos++) {
+          int remaining = seqLength - pos;
+          int choice = rng() % 3;
+          if(!openStack.empty() && (choice == 0 || (int) openStack.size() >= remaining)) {
+               dotBracket[openStack.back()] = '(';
+               dotBracket[pos] = ')';
+               openStack.pop_back();
+          }
+          else if(choice == 1 && (int) openStack.size() + 1 < remaining) {
+               openStack.push_back(pos);
+          }
+     }
+     for(unsigned int oidx = 0; oidx < openStack.size(); oidx++) {
+          dotBracket[openStack[oidx]] = '.';
+     }
+     return dotBracket;
+}
+
+/* The reference implementation works on the forests as sequences of post-order
+ * node indices (each subtree is contiguous), deleting the rightmost roots: */
+typedef std::vector<int> Forest_t;
+
+static int ForestWeight(const OrderedTree_t &tree, const Forest_t &forest) {
+     int weight = 0;
+     for(unsigned int n = 0; n < forest.size(); n++) {
+          weight += tree.weights[forest[n]];
+     }
+     return weight;
+}
+
+static int NaiveRelabelCost(const OrderedTree_t &t1, int n1, const OrderedTree_t &t2, int n2) {
+     if(t1.labels[n1] == t2.labels[n2]) {
+          return abs(t1.weights[n1] - t2.weights[n2]);
+     }
+     return t1.weights[n1] + t2.weights[n2];
+}
+
+static int NaiveForestDistance(const OrderedTree_t &t1, const Forest_t &f1,
+		               const OrderedTree_t &t2, const Forest_t &f2,
+			       std::map<std::pair<Forest_t, Forest_t>, int> &memo) {
+     if(f1.empty() || f2.empty()) {
+          return ForestWeight(t1, f1) + ForestWeight(t2, f2);
+     }
+     std::pair<Forest_t, Forest_t> memoKey(f1, f2);
+     std::map<std::pair<Forest_t, Forest_t>, int>::iterator memoIt = memo.find(memoKey);
+     if(memoIt != memo.end()) {
+          return memoIt->second;
+     }
+     int v = f1.back(), w = f2.back();
+     Forest_t f1NoV(f1.begin(), f1.end() - 1), f2NoW(f2.begin(), f2.end() - 1);
+     int vSubtreeStart = f1.size() - (v - t1.leftmostLeaves[v] + 1);
+     int wSubtreeStart = f2.size() - (w - t2.leftmostLeaves[w] + 1);
+     Forest_t f1Children(f1.begin() + vSubtreeStart, f1.end() - 1);
+     Forest_t f2Children(f2.begin() + wSubtreeStart, f2.end() - 1);
+     Forest_t f1Rest(f1.begin(), f1.begin() + vSubtreeStart);
+     Forest_t f2Rest(f2.begin(), f2.begin() + wSubtreeStart);
+     int distance = NaiveForestDistance(t1, f1NoV, t2, f2, memo) + t1.weights[v];
+     distance = std::min(distance, NaiveForestDistance(t1, f1, t2, f2NoW, memo) + t2.weights[w]);
+     distance = std::min(distance, NaiveForestDistance(t1, f1Children, t2, f2Children, memo) +
+		                   NaiveForestDistance(t1, f1Rest, t2, f2Rest, memo) +
+				   NaiveRelabelCost(t1, v, t2, w));
+     memo[memoKey] = distance;
+     return distance;
+}
+
+static int NaiveTreeDistance(const OrderedTree_t &t1, const OrderedTree_t &t2) {
+     Forest_t f1(t1.GetNodeCount()), f2(t2.GetNodeCount());
+     for(unsigned int n = 0; n < f1.size(); n++) f1[n] = n;
+     for(unsigned int n = 0; n < f2.size(); n++) f2[n] = n;
+     std::map<std::pair<Forest_t, Forest_t>, int> memo;
+     return NaiveForestDistance(t1, f1, t2, f2, memo);
+}
+
+static OrderedTree_t TreeFromDotBracket(const char *dotBracket) {
+     return OrderedTree_t::FromPairTable(PairTableFromDotBracket(dotBracket));
+}
+
+UNIT_TEST(TreeEditDistance_SmallKnownDistances) {
+     OrderedTree_t hairpin = TreeFromDotBracket("((....))");
+     CHECK(hairpin.GetNodeCount() == 7);
+     CHECK(ComputeDistance(hairpin, hairpin) == 0);
+     // Open the inner pair (remove the pair node, insert two unpaired bases):
+     CHECK(ComputeDistance(hairpin, TreeFromDotBracket("(......)")) == 4);
+     // Only an extra unpaired base in the loop:
+     CHECK(ComputeDistance(TreeFromDotBracket("((...))"), hairpin) == 1);
+     // Against the empty structure every pair node is removed:
+     CHECK(ComputeDistance(hairpin, TreeFromDotBracket("........")) == 8);
+}
+
+UNIT_TEST(TreeEditDistance_MatchesNaiveDistance) {
+     std::mt19937 rng(0x7ed);
+     for(int trial = 0; trial < 60; trial++) {
+          std::string db1 = RandomNestedDotBracket(rng, 3 + rng() % 9);
+          std::string db2 = RandomNestedDotBracket(rng, 3 + rng() % 9);
+          OrderedTree_t t1 = TreeFromDotBracket(db1.c_str());
+          OrderedTree_t t2 = TreeFromDotBracket(db2.c_str());
+          int distance = ComputeDistance(t1, t2);
+          CHECK(distance == NaiveTreeDistance(t1, t2));
+          CHECK(distance == ComputeDistance(t2, t1));
+          // Deleting one tree and inserting the other is always an option:
+          CHECK(distance <= (int) (db1.size() + db2.size()));
+     }
+}
+
+/* Records any progress reports outside of [0, numTotal]: */
+static void CheckProgressRange(int numDone, int numTotal, void *udata) {
+     int *badProgressCalls = (int *) udata;
+     if(numDone < 0 || numDone > numTotal) {
+          (*badProgressCalls)++;
+     }
+}
+
+UNIT_TEST(TreeEditDistance_ParallelMatchesSerial) {
+     std::mt19937 rng(0xd157);
+     OrderedTree_t refTree = TreeFromDotBracket(RandomNestedDotBracket(rng, 200).c_str());
+     std::vector<OrderedTree_t> cmpTrees(24);
+     std::vector<const OrderedTree_t *> cmpTreePtrs;
+     for(unsigned int tidx = 0; tidx < cmpTrees.size(); tidx++) {
+          cmpTrees[tidx] = TreeFromDotBracket(RandomNestedDotBracket(rng, 100 + rng() % 200).c_str());
+          cmpTreePtrs.push_back(tidx == 5 ? NULL : &cmpTrees[tidx]);
+     }
+     int badProgressCalls = 0;
+     std::vector<int> distances;
+     ComputeDistancesParallel(refTree, cmpTreePtrs, distances, 4, CheckProgressRange, &badProgressCalls);
+     REQUIRE(distances.size() == cmpTrees.size());
+     for(unsigned int tidx = 0; tidx < cmpTrees.size(); tidx++) {
+          int expected = tidx == 5 ? TED_DISTANCE_UNDEFINED : ComputeDistance(refTree, cmpTrees[tidx]);
+          CHECK(distances[tidx] == expected);
+     }
+     CHECK(badProgressCalls == 0);
+}
+
+UNIT_TEST(TreeEditDistance_OversizedTreesAreUndefined) {
+     std::string longHairpin = std::string(2000, '(') + std::string(1000, '.') + std::string(2000, ')');
+     OrderedTree_t bigTree = TreeFromDotBracket(longHairpin.c_str());
+     CHECK(GetDPTableCells(bigTree, bigTree) > TED_MAX_DP_TABLE_CELLS);
+     CHECK(ComputeDistance(bigTree, bigTree) == TED_DISTANCE_UNDEFINED);
+     std::vector<const OrderedTree_t *> cmpTreePtrs(3, &bigTree);
+     std::vector<int> distances;
+     ComputeDistancesParallel(bigTree, cmpTreePtrs, distances, 2);
+     CHECK(distances[0] == TED_DISTANCE_UNDEFINED && distances[2] == TED_DISTANCE_UNDEFINED);
+}
@@ -0,0 +1,202 @@
+/* TestXMLExportWriter.cpp : Checks the output of the streaming XML writers
+ *                           (plain and gzip compressed) and the tag nesting;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2019.12.03
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <zlib.h>
+
+#include "RNAStructure.h"
+#include "XMLExportWriter.h"
+#include "StructureSlotMap.h"
+#include "FolderStructure.h"
+#include "UnitTest.h"
+
+using namespace XMLExport;
+
+static const char *TEST_SEQUENCE = "GGGAAACCCUU";
+static const char *TEST_STRUCTURES[] = {
+     "(((...)))..",
+     "...........",
+};
+
+static std::string ReadXMLOutput(const std::string &xmlPath) {
+     std::string xmlData;
+     gzFile gzInput = gzopen(xmlPath.c_str(), "rb");
+     if(gzInput == NULL) {
+          return xmlData;
+     }
+     char readBuf[4096];
+     int readCount;
+     while((readCount = gzread(gzInput, readBuf, sizeof(readBuf))) > 0) {
+          xmlData.append(readBuf, readCount);
+     }
+     gzclose(gzInput);
+     return xmlData;
+}
+
+static size_t CountMatches(const std::string &xmlData, const char *pattern) {
+     size_t numMatches = 0;
+     for(size_t pos = xmlData.find(pattern); pos != std::string::npos;
+         pos = xmlData.find(pattern, pos + 1)) {
+          numMatches++;
+     }
+     return numMatches;
+}
+
+static std::vector<RNAStructure *> CreateTestStructures(int numStructs) {
+     std::shared_ptr<RNAStructure::SharedSequence_t> sharedSeq =
+          RNAStructure::CreateSharedSequence(TEST_SEQUENCE);
+     std::vector<RNAStructure *> rnaStructs;
+     for(int sidx = 0; sidx < numStructs; sidx++) {
+          const char *dotBracket = TEST_STRUCTURES[sidx % 2];
+          rnaStructs.push_back(RNAStructure::CreateFromSharedDotBracket("sample<1>.dbn", sharedSeq,
+                               dotBracket, strlen(dotBracket), sidx));
+     }
+     return rnaStructs;
+}
+
+static std::string WriteFolderStructures(const char *fileName, const char *folderName,
+                                         const std::vector<RNAStructure *> &folderStructs,
+                                         unsigned int optionFlags) {
+     std::string xmlPath = UnitTest::GetScratchPath(fileName);
+     XMLExportWriter_FullSequenceFolder xmlWriter;
+     int writeStatus = xmlWriter.OpenFile(xmlPath, optionFlags);
+     if(writeStatus == 0) {
+          writeStatus = xmlWriter.WriteFolder(folderName, folderStructs, optionFlags);
+          int closeStatus = xmlWriter.CloseFile();
+          writeStatus = writeStatus != 0 ? writeStatus : closeStatus;
+     }
+     return writeStatus == 0 ? ReadXMLOutput(xmlPath) : std::string();
+}
+
+static std::string WriteTestFolder(const char *fileName, unsigned int optionFlags) {
+     std::vector<RNAStructure *> folderStructs = CreateTestStructures(2);
+     std::string xmlData = WriteFolderStructures(fileName, "A & B", folderStructs, optionFlags);
+     for(unsigned int sidx = 0; sidx < folderStructs.size(); sidx++) {
+          delete folderStructs[sidx];
+     }
+     return xmlData;
+}
+
+UNIT_TEST(XMLFolderExport) {
+     std::string xmlData = WriteTestFolder("folder.xml", XMLEXPORT_STRUCTURE_FULL);
+     REQUIRE(!xmlData.empty());
+     CHECK(xmlData.find(XMLExportWriter::GLOBAL_META_TAG) == 0);
+     CHECK(xmlData.find("<RNAStructVizFolder name=\"A &amp; B\" structureCount=\"2\" "
+                        "sequenceLength=\"11\">") != std::string::npos);
+     CHECK(xmlData.find("<Sequence>GGGAAACCCUU</Sequence>") != std::string::npos);
+     CHECK(xmlData.find("<DotBracket>(((...)))..</DotBracket>") != std::string::npos);
+     CHECK(xmlData.find("<DotBracket>...........</DotBracket>") != std::string::npos);
+     CHECK(xmlData.find("&lt;1&gt;") != std::string::npos);
+     CHECK(CountMatches(xmlData, "<Structure ") == 2);
+     CHECK(CountMatches(xmlData, "</Structure>") == 2);
+     CHECK(CountMatches(xmlData, "<Pair ") == 3);
+     CHECK(xmlData.find("<Pair i=\"1\" j=\"9\"/>") != std::string::npos);
+     // The structure without any pairs has an empty list:
+     CHECK(xmlData.find("<Pairs/>") != std::string::npos);
+     CHECK(xmlData.find("</RNAStructVizFolder>") != std::string::npos);
+
+     // Without the full option only the dot bracket strings are written:
+     std::string standardData = WriteTestFolder("standard.xml", 0x00);
+     CHECK(CountMatches(standardData, "<Pair") == 0);
+     CHECK(CountMatches(standardData, "<DotBracket>") == 2);
+}
+
+UNIT_TEST(XMLFolderWithRemovedStructure) {
+     std::vector<RNAStructure *> rnaStructs = CreateTestStructures(3);
+     StructureSlotMap_t structSlots;
+     Folder testFolder;
+     testFolder.SetPerformWidgetDeletion(false);
+     testFolder.folderName = strdup("Removed");
+     for(unsigned int sidx = 0; sidx < rnaStructs.size(); sidx++) {
+          testFolder.AddStructure(structSlots.Insert(rnaStructs[sidx]));
+     }
+     // Remove the first structure of the folder:
+     int removedSlot = testFolder.folderStructs[0].slotIndex;
+     CHECK(testFolder.RemoveStructure(removedSlot));
+     delete structSlots.RemoveAt(removedSlot);
+     rnaStructs.erase(rnaStructs.begin());
+
+     std::vector<RNAStructure *> folderStructs;
+     testFolder.CollectStructures(structSlots, folderStructs);
+     REQUIRE(folderStructs.size() == 2);
+     std::string xmlData = WriteFolderStructures("removed.xml", testFolder.folderName,
+                                                 folderStructs, XMLEXPORT_STRUCTURE_FULL);
+     REQUIRE(!xmlData.empty());
+     CHECK(xmlData.find("structureCount=\"2\"") != std::string::npos);
+     CHECK(CountMatches(xmlData, "<Structure ") == 2);
+     // Both structures after the removed one are written (the last one is
+     // the first test structure again):
+     CHECK(CountMatches(xmlData, "<DotBracket>(((...)))..</DotBracket>") == 1);
+     CHECK(CountMatches(xmlData, "<DotBracket>...........</DotBracket>") == 1);
+     for(unsigned int sidx = 0; sidx < rnaStructs.size(); sidx++) {
+          delete rnaStructs[sidx];
+     }
+}
+
+UNIT_TEST(XMLGzipOutput) {
+     std::string plainData = WriteTestFolder("plain.xml", XMLEXPORT_STRUCTURE_FULL);
+     std::string gzipData = WriteTestFolder("compressed.xml.gz", XMLEXPORT_STRUCTURE_FULL);
+     REQUIRE(!plainData.empty());
+     CHECK(gzipData == plainData);
+     // The compressed file really is gzip data:
+     FILE *fpCompressed = fopen(UnitTest::GetScratchPath("compressed.xml.gz").c_str(), "rb");
+     REQUIRE(fpCompressed != NULL);
+     unsigned char gzipMagic[2] = { 0, 0 };
+     CHECK(fread(gzipMagic, 1, 2, fpCompressed) == 2);
+     fclose(fpCompressed);
+     CHECK(gzipMagic[0] == 0x1f && gzipMagic[1] == 0x8b);
+}
+
+UNIT_TEST(XMLNoOverwrite) {
+     std::string xmlPath = UnitTest::WriteScratchFile("existing.xml", "keep");
+     XMLExportWriter_FullSequenceFolder xmlWriter;
+     CHECK(xmlWriter.OpenFile(xmlPath, 0x00) == EEXIST);
+     CHECK(ReadXMLOutput(xmlPath) == "keep");
+     CHECK(xmlWriter.OpenFile(xmlPath, XMLEXPORT_ALLOW_OVERWRITES) == 0);
+     CHECK(xmlWriter.CloseFile() == 0);
+}
+
+UNIT_TEST(XMLTagDepthOverflow) {
+     std::string xmlPath = UnitTest::GetScratchPath("deep.xml");
+     XMLExportWriter xmlWriter;
+     REQUIRE(xmlWriter.OpenFile(xmlPath, 0x00) == 0);
+     int numLevels = XMLEXPORT_MAX_TAG_DEPTH + 8;
+     for(int level = 0; level < numLevels; level++) {
+          xmlWriter.StartElement("Level");
+          // The attributes and text of the dropped tags are dropped with them:
+          xmlWriter.WriteAttribute("depth", (long) level);
+          xmlWriter.WriteText(level < XMLEXPORT_MAX_TAG_DEPTH ? "" : "dropped");
+     }
+     for(int level = 0; level < numLevels - 1; level++) {
+          xmlWriter.EndElement();
+     }
+     // The outermost tag is still open (its EndElement was not called yet):
+     xmlWriter.StartElement("Sibling");
+     xmlWriter.EndElement();
+     xmlWriter.EndElement();
+     CHECK(xmlWriter.CloseFile() == EOVERFLOW);
+
+     std::string xmlData = ReadXMLOutput(xmlPath);
+     CHECK(CountMatches(xmlData, "<Level ") == XMLEXPORT_MAX_TAG_DEPTH);
+     CHECK(CountMatches(xmlData, "</Level>") + CountMatches(xmlData, "/>") ==
+           XMLEXPORT_MAX_TAG_DEPTH + 1);
+     CHECK(xmlData.find("dropped") == std::string::npos);
+     char lastDepthAttr[32];
+     snprintf(lastDepthAttr, sizeof(lastDepthAttr), "depth=\"%d\"", XMLEXPORT_MAX_TAG_DEPTH);
+     CHECK(xmlData.find(lastDepthAttr) == std::string::npos);
+     // The sibling is a child of the outermost tag:
+     size_t siblingPos = xmlData.find("<Sibling/>");
+     REQUIRE(siblingPos != std::string::npos);
+     CHECK(xmlData.rfind("</Level>") > siblingPos);
+     CHECK(xmlData.find("<Level", siblingPos) == std::string::npos);
+}
@@ -0,0 +1,55 @@
+/* UnitTest.h : A minimal registry of unit checks for the non-GUI modules
+ *              (the parsers, file formats and algorithms), which are all
+ *              linked into one runner by 'make check';
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#ifndef __UNIT_TEST_H__
+#define __UNIT_TEST_H__
+
+#include <stdio.h>
+
+#include <string>
+
+namespace UnitTest {
+
+     typedef void (*UnitTestFunc_t)();
+
+     /* Adds the test to the list run by main (see UNIT_TEST): */
+     int RegisterTest(const char *testName, UnitTestFunc_t testFunc);
+
+     /* Records a failed check in the test that is currently running: */
+     void ReportFailure(const char *fileName, int lineNum, const char *checkExpr);
+
+     /* A path for the named file in a scratch directory which is removed
+      * after all of the tests have run: */
+     std::string GetScratchPath(const char *fileName);
+
+     /* Writes the text to a new scratch file, and returns its path: */
+     std::string WriteScratchFile(const char *fileName, const std::string &fileData);
+
+}
+
+#define UNIT_TEST(testName)                                                    \
+     static void testName();                                                   \
+     static int testName##_registered = UnitTest::RegisterTest(#testName, testName); \
+     static void testName()
+
+#define CHECK(checkExpr)                                                       \
+     do {                                                                      \
+          if(!(checkExpr)) {                                                   \
+               UnitTest::ReportFailure(__FILE__, __LINE__, #checkExpr);        \
+          }                                                                    \
+     } while(0)
+
+/* Stops the test when the check fails (e.g., before using a NULL result): */
+#define REQUIRE(checkExpr)                                                     \
+     do {                                                                      \
+          if(!(checkExpr)) {                                                   \
+               UnitTest::ReportFailure(__FILE__, __LINE__, #checkExpr);        \
+               return;                                                         \
+          }                                                                    \
+     } while(0)
+
+#endif
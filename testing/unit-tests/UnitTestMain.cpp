@@ -0,0 +1,125 @@
+/* UnitTestMain.cpp : Runs all of the registered unit checks;
+ * Author: Maxie D. Schmidt (maxieds@gmail.com)
+ * Created: 2020.02.19
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "UnitTest.h"
+
+namespace UnitTest {
+
+     typedef struct {
+          const char *testName;
+          UnitTestFunc_t testFunc;
+     } RegisteredTest_t;
+
+     /* The tests are registered by static initializers in the other files,
+      * so the list is created on first use: */
+     static std::vector<RegisteredTest_t> & GetRegisteredTests() {
+          static std::vector<RegisteredTest_t> registeredTests;
+          return registeredTests;
+     }
+
+     static int curTestFailures = 0;
+     static std::string scratchDirPath;
+
+     int RegisterTest(const char *testName, UnitTestFunc_t testFunc) {
+          RegisteredTest_t regTest = { testName, testFunc };
+          GetRegisteredTests().push_back(regTest);
+          return (int) GetRegisteredTests().size();
+     }
+
+     void ReportFailure(const char *fileName, int lineNum, const char *checkExpr) {
+          fprintf(stderr, "    %s:%d: CHECK FAILED: %s\n", fileName, lineNum, checkExpr);
+          curTestFailures++;
+     }
+
+     std::string GetScratchPath(const char *fileName) {
+          if(scratchDirPath.empty()) {
+               const char *tmpDir = getenv("TMPDIR");
+               std::string dirTemplate = std::string(tmpDir != NULL ? tmpDir : "/tmp") +
+                                         "/RNAStructVizTests.XXXXXX";
+               std::vector<char> dirPathBuf(dirTemplate.begin(), dirTemplate.end());
+               dirPathBuf.push_back('\0');
+               if(mkdtemp(dirPathBuf.data()) == NULL) {
+                    perror("mkdtemp");
+                    exit(EXIT_FAILURE);
+               }
+               scratchDirPath = std::string(dirPathBuf.data());
+          }
+          return scratchDirPath + "/" + fileName;
+     }
+
+     std::string WriteScratchFile(const char *fileName, const std::string &fileData) {
+          std::string filePath = GetScratchPath(fileName);
+          FILE *fpScratch = fopen(filePath.c_str(), "wb");
+          if(fpScratch != NULL) {
+               fwrite(fileData.data(), 1, fileData.length(), fpScratch);
+               fclose(fpScratch);
+          }
+          return filePath;
+     }
+
+     /* Some tests create subdirectories (e.g., a config directory), so the
+      * scratch files are removed recursively: */
+     static void RemoveDirectoryTree(const std::string &dirPath) {
+          DIR *scratchDir = opendir(dirPath.c_str());
+          struct dirent *dirEntry;
+          while(scratchDir != NULL && (dirEntry = readdir(scratchDir)) != NULL) {
+               if(strcmp(dirEntry->d_name, ".") && strcmp(dirEntry->d_name, "..")) {
+                    std::string entryPath = dirPath + "/" + dirEntry->d_name;
+                    struct stat entryStat;
+                    if(lstat(entryPath.c_str(), &entryStat) == 0 && S_ISDIR(entryStat.st_mode)) {
+                         RemoveDirectoryTree(entryPath);
+                    }
+                    else {
+                         unlink(entryPath.c_str());
+                    }
+               }
+          }
+          if(scratchDir != NULL) {
+               closedir(scratchDir);
+          }
+          rmdir(dirPath.c_str());
+     }
+
+     static void RemoveScratchDir() {
+          if(!scratchDirPath.empty()) {
+               RemoveDirectoryTree(scratchDirPath);
+          }
+     }
+
+}
+
+int main(int argc, char **argv) {
+
+     // An optional argument selects the tests whose names contain it:
+     const char *testFilter = argc > 1 ? argv[1] : NULL;
+     int numRun = 0, numFailed = 0;
+     std::vector<UnitTest::RegisteredTest_t> &registeredTests = UnitTest::GetRegisteredTests();
+     for(unsigned int tidx = 0; tidx < registeredTests.size(); tidx++) {
+          const UnitTest::RegisteredTest_t &regTest = registeredTests[tidx];
+          if(testFilter != NULL && strstr(regTest.testName, testFilter) == NULL) {
+               continue;
+          }
+          UnitTest::curTestFailures = 0;
+          regTest.testFunc();
+          fprintf(stdout, "[%s] %s\n", UnitTest::curTestFailures == 0 ? "PASS" : "FAIL",
+                  regTest.testName);
+          numRun++;
+          numFailed += UnitTest::curTestFailures > 0 ? 1 : 0;
+     }
+     UnitTest::RemoveScratchDir();
+     fprintf(stdout, "\n%d of %d tests passed\n", numRun - numFailed, numRun);
+     return numFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}